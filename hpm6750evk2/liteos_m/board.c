@@ -18,6 +18,11 @@
 #include <hpm_enet_drv.h>
 #include <hpm_gpio_drv.h>
 #include <hpm_pmp_drv.h>
+#include "hpm_boottime.h"
+#include "hpm_clock_mgr.h"
+#include "hpm_lowpower.h"
+#include "hpm_pma.h"
+#include <string.h>
 /**
  * @brief FLASH configuration option definitions:
  * option[0]:
@@ -96,88 +101,8 @@ void board_init_clock(void)
         sysctl_clock_set_preset(HPM_SYSCTL, sysctl_preset_1);
     }
 
-    /* Add most Clocks to group 0 */
-    clock_add_to_group(clock_cpu0, 0);
-    clock_add_to_group(clock_mchtmr0, 0);
-    clock_add_to_group(clock_axi0, 0);
-    clock_add_to_group(clock_axi1, 0);
-    clock_add_to_group(clock_axi2, 0);
-    clock_add_to_group(clock_ahb, 0);
-    clock_add_to_group(clock_dram, 0);
-    clock_add_to_group(clock_xpi0, 0);
-    clock_add_to_group(clock_xpi1, 0);
-    clock_add_to_group(clock_gptmr0, 0);
-    clock_add_to_group(clock_gptmr1, 0);
-    clock_add_to_group(clock_gptmr2, 0);
-    clock_add_to_group(clock_gptmr3, 0);
-    clock_add_to_group(clock_gptmr4, 0);
-    clock_add_to_group(clock_gptmr5, 0);
-    clock_add_to_group(clock_gptmr6, 0);
-    clock_add_to_group(clock_gptmr7, 0);
-    clock_add_to_group(clock_uart0, 0);
-    clock_add_to_group(clock_uart1, 0);
-    clock_add_to_group(clock_uart2, 0);
-    clock_add_to_group(clock_uart3, 0);
-    clock_add_to_group(clock_uart13, 0);
-    clock_add_to_group(clock_i2c0, 0);
-    clock_add_to_group(clock_i2c1, 0);
-    clock_add_to_group(clock_i2c2, 0);
-    clock_add_to_group(clock_i2c3, 0);
-    clock_add_to_group(clock_spi0, 0);
-    clock_add_to_group(clock_spi1, 0);
-    clock_add_to_group(clock_spi2, 0);
-    clock_add_to_group(clock_spi3, 0);
-    clock_add_to_group(clock_can0, 0);
-    clock_add_to_group(clock_can1, 0);
-    clock_add_to_group(clock_can2, 0);
-    clock_add_to_group(clock_can3, 0);
-    clock_add_to_group(clock_display, 0);
-    clock_add_to_group(clock_sdxc0, 0);
-    clock_add_to_group(clock_sdxc1, 0);
-    clock_add_to_group(clock_camera0, 0);
-    clock_add_to_group(clock_camera1, 0);
-    clock_add_to_group(clock_ptpc, 0);
-    clock_add_to_group(clock_ref0, 0);
-    clock_add_to_group(clock_ref1, 0);
-    clock_add_to_group(clock_watchdog0, 0);
-    clock_add_to_group(clock_watchdog1, 0);
-    clock_add_to_group(clock_watchdog2, 0);
-    clock_add_to_group(clock_watchdog3, 0);
-    clock_add_to_group(clock_pwdg, 0);
-    clock_add_to_group(clock_eth0, 0);
-    clock_add_to_group(clock_eth1, 0);
-    clock_add_to_group(clock_sdp, 0);
-    clock_add_to_group(clock_xdma, 0);
-    clock_add_to_group(clock_ram0, 0);
-    clock_add_to_group(clock_ram1, 0);
-    clock_add_to_group(clock_usb0, 0);
-    clock_add_to_group(clock_usb1, 0);
-    clock_add_to_group(clock_jpeg, 0);
-    clock_add_to_group(clock_pdma, 0);
-    clock_add_to_group(clock_kman, 0);
-    clock_add_to_group(clock_gpio, 0);
-    clock_add_to_group(clock_mbx0, 0);
-    clock_add_to_group(clock_hdma, 0);
-    clock_add_to_group(clock_rng, 0);
-    clock_add_to_group(clock_mot0, 0);
-    clock_add_to_group(clock_mot1, 0);
-    clock_add_to_group(clock_mot2, 0);
-    clock_add_to_group(clock_mot3, 0);
-    clock_add_to_group(clock_acmp, 0);
-    clock_add_to_group(clock_dao, 0);
-    clock_add_to_group(clock_msyn, 0);
-    clock_add_to_group(clock_lmm0, 0);
-    clock_add_to_group(clock_lmm1, 0);
-
-    clock_add_to_group(clock_adc0, 0);
-    clock_add_to_group(clock_adc1, 0);
-    clock_add_to_group(clock_adc2, 0);
-    clock_add_to_group(clock_adc3, 0);
-
-    clock_add_to_group(clock_i2s0, 0);
-    clock_add_to_group(clock_i2s1, 0);
-    clock_add_to_group(clock_i2s2, 0);
-    clock_add_to_group(clock_i2s3, 0);
+    /* Group 0: the boot clocks, peripheral clocks are added by their drivers, see hpm_clock_mgr.h */
+    HpmClockInit();
 
     /* Add the CPU1 clock to Group1 */
     clock_add_to_group(clock_mchtmr1, 1);
@@ -199,30 +124,35 @@ void board_init_clock(void)
     clock_update_core_clock();
 }
 
+/*
+ * PMA regions, from the linker script. Each section is padded to whole PMA granules so the
+ * rest of the AXI SRAM stays cacheable (write-back, the default).
+ *  noncacheable: ENET descriptors, the buffers of an offloaded MAC, the inter-core rings.
+ *  writethrough: ATTR_PLACE_AT_WRITETHROUGH data, cached for reads and always current in memory.
+ */
 void board_init_pmp(void)
 {
     extern uint32_t __noncacheable_start__[];
     extern uint32_t __noncacheable_end__[];
+    extern uint32_t __writethrough_start__[];
+    extern uint32_t __writethrough_end__[];
 
-    uint32_t start_addr = (uint32_t) __noncacheable_start__;
-    uint32_t end_addr = (uint32_t) __noncacheable_end__;
-    uint32_t length = end_addr - start_addr;
-
-    if (length == 0) {
-        return;
-    }
+    static struct HpmPmaRegion regions[] = {
+        { .name = "noncacheable", .memType = MEM_TYPE_MEM_NON_CACHE_BUF },
+        { .name = "writethrough", .memType = MEM_TYPE_MEM_WT_READ_ALLOC },
+    };
 
-    /* Ensure the address and the length are power of 2 aligned */
-    assert((length & (length - 1U)) == 0U);
-    assert((start_addr & (length - 1U)) == 0U);
+    regions[0].start = (uint32_t)__noncacheable_start__;
+    regions[0].end = (uint32_t)__noncacheable_end__;
+    regions[1].start = (uint32_t)__writethrough_start__;
+    regions[1].end = (uint32_t)__writethrough_end__;
 
-    pmp_entry_t pmp_entry[1];
-    pmp_entry[0].pmp_addr = PMP_NAPOT_ADDR(start_addr, length);
-    pmp_entry[0].pmp_cfg.val = PMP_CFG(READ_EN, WRITE_EN, EXECUTE_EN, ADDR_MATCH_NAPOT, REG_UNLOCK);
-    pmp_entry[0].pma_addr = PMA_NAPOT_ADDR(start_addr, length);
-    pmp_entry[0].pma_cfg.val = PMA_CFG(ADDR_MATCH_NAPOT, MEM_TYPE_MEM_NON_CACHE_BUF, AMO_EN);
+    /* NOLOAD section, nothing else clears it */
+    memset(__writethrough_start__, 0, regions[1].end - regions[1].start);
 
-    pmp_config(&pmp_entry[0], ARRAY_SIZE(pmp_entry));
+    if (HpmPmaConfig(regions, ARRAY_SIZE(regions)) < 0) {
+        while (1);
+    }
 }
 
 void board_init_ahb(void)
@@ -232,14 +162,21 @@ void board_init_ahb(void)
 
 void board_init(void)
 {
+    HpmBootMark("startup");
     board_init_clock();
-    sysctl_set_cpu_lp_mode(HPM_SYSCTL, HPM_CORE0, cpu_lp_mode_ungate_cpu_clock);
+    HpmBootMark("clock");
+    HpmLowPowerSetMode(HPM_LP_MODE_DEFAULT);
     board_init_pmp();
     board_init_ahb();
+    HpmBootMark("board");
 }
 
 void board_print_clock_freq(void)
 {
+    /* fast boot: printed by "boottime -v" */
+    if (HpmBootQuiet()) {
+        return;
+    }
     printf("==============================\r\n");
     printf(" %s clock summary\r\n", "HPM6750EVK2");
     printf("==============================\r\n");
@@ -252,18 +189,16 @@ void board_print_clock_freq(void)
     printf("mchtmr0:\t %dHz\r\n", clock_get_frequency(clock_mchtmr0));
     printf("mchtmr1:\t %dHz\r\n", clock_get_frequency(clock_mchtmr1));
     printf("xpi0:\t\t %dHz\r\n", clock_get_frequency(clock_xpi0));
-    printf("xpi1:\t\t %dHz\r\n", clock_get_frequency(clock_xpi1));
-    printf("dram:\t\t %dHz\r\n", clock_get_frequency(clock_dram));
-    printf("display:\t %dHz\r\n", clock_get_frequency(clock_display));
-    printf("cam0:\t\t %dHz\r\n", clock_get_frequency(clock_camera0));
-    printf("cam1:\t\t %dHz\r\n", clock_get_frequency(clock_camera1));
-    printf("jpeg:\t\t %dHz\r\n", clock_get_frequency(clock_jpeg));
-    printf("pdma:\t\t %dHz\r\n", clock_get_frequency(clock_pdma));
+    printf("==============================\r\n");
+    HpmClockPrintActive();
     printf("==============================\r\n");
 }
 
 void board_print_banner(void)
 {
+    if (HpmBootQuiet()) {
+        return;
+    }
     const uint8_t banner[] = {"\n\
 ----------------------------------------------------------------------\r\n\
 $$\\   $$\\ $$$$$$$\\  $$\\      $$\\ $$\\\r\n\
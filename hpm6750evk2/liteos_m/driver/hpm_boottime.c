@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <los_interrupt.h>
+#include "hpm_clock_drv.h"
+#include "hpm_mchtmr_drv.h"
+#include "board.h"
+#include "hpm_boottime.h"
+#include "ohos_init.h"
+#ifdef LOSCFG_SHELL
+#include "shcmd.h"
+#endif
+
+/*
+ * MCHTMR0 counts from reset on the 24 MHz oscillator whatever the CPU clock does, so a mark
+ * taken before board_init_clock() is on the same scale as the later ones.
+ */
+
+struct HpmBootMarkEntry {
+    const char *name;
+    uint64_t count;
+};
+
+static struct HpmBootMarkEntry g_hpmBootMarks[HPM_BOOT_MARK_MAX];
+static uint32_t g_hpmBootMarkNum;
+static int g_hpmBootQuiet = HPM_FAST_BOOT_ENABLE;
+
+void HpmBootMark(const char *name)
+{
+    uint64_t count = mchtmr_get_count(HPM_MCHTMR);
+
+    uint32_t intSave = LOS_IntLock();
+    if (g_hpmBootMarkNum < HPM_BOOT_MARK_MAX) {
+        g_hpmBootMarks[g_hpmBootMarkNum].name = name;
+        g_hpmBootMarks[g_hpmBootMarkNum].count = count;
+        g_hpmBootMarkNum++;
+    }
+    LOS_IntRestore(intSave);
+}
+
+void HpmBootPrint(void)
+{
+    uint32_t ticksPerUs = clock_get_frequency(clock_mchtmr0) / 1000000U;
+    uint64_t last = 0;
+
+    printf("%-12s %12s %12s\n", "phase", "done at us", "took us");
+    for (uint32_t i = 0; i < g_hpmBootMarkNum; i++) {
+        uint64_t count = g_hpmBootMarks[i].count;
+        printf("%-12s %12llu %12llu\n", g_hpmBootMarks[i].name, (unsigned long long)(count / ticksPerUs),
+               (unsigned long long)((count - last) / ticksPerUs));
+        last = count;
+    }
+}
+
+int HpmBootQuiet(void)
+{
+    return g_hpmBootQuiet;
+}
+
+#ifdef LOSCFG_SHELL
+static UINT32 HpmBootCmd(UINT32 argc, const CHAR **argv)
+{
+    if ((argc > 0) && (strcmp(argv[0], "-v") == 0)) {
+        /* boot is over, nothing to hold back any more */
+        g_hpmBootQuiet = 0;
+        board_print_banner();
+        board_print_clock_freq();
+    } else if (argc > 0) {
+        printf("usage: boottime [-v]\n");
+        return 1;
+    }
+    HpmBootPrint();
+    return 0;
+}
+
+static void HpmBootShellReg(void)
+{
+    osCmdReg(CMD_TYPE_EX, "boottime", XARGS, (CmdCallBackFunc)HpmBootCmd);
+}
+
+APP_FEATURE_INIT(HpmBootShellReg);
+#endif
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HPM_BOOTTIME_H
+#define _HPM_BOOTTIME_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif
+#endif
+
+/*
+ * Fast boot: the banner and the clock summary are held back for "boottime -v" instead of going
+ * out over the polled 115200 baud UART, littlefs prints one line per partition and reuses the
+ * NOR configuration probed on an earlier boot, see hpm_littlefs_drv.c.
+ */
+#define HPM_FAST_BOOT_ENABLE    1
+
+#define HPM_BOOT_MARK_MAX       16
+
+/* Record that the boot phase name ended now, in MCHTMR0 ticks since reset; name must stay valid */
+void HpmBootMark(const char *name);
+
+/* Print the phases recorded so far with their end time and duration */
+void HpmBootPrint(void);
+
+/* Non-zero while boot messages are held back */
+int HpmBootQuiet(void);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <los_interrupt.h>
+#include "hpm_clock_mgr.h"
+#ifdef LOSCFG_SHELL
+#include "ohos_init.h"
+#include "shcmd.h"
+#endif
+
+struct HpmClockNode {
+    clock_name_t clock;
+    const char *name;
+    uint8_t boot;  /* needed to run at all, on from board_init_clock() and never turned off */
+    uint16_t refs;
+};
+
+#define HPM_CLOCK_BOOT(clk, str) { .clock = (clk), .name = (str), .boot = 1 }
+#define HPM_CLOCK_PERI(clk, str) { .clock = (clk), .name = (str), .boot = 0 }
+
+/* The group 0 clocks of CPU0. CPU1 has its own group 1, set up in board_init_clock() */
+static struct HpmClockNode g_hpmClocks[] = {
+    HPM_CLOCK_BOOT(clock_cpu0, "cpu0"),
+    HPM_CLOCK_BOOT(clock_mchtmr0, "mchtmr0"),
+    HPM_CLOCK_BOOT(clock_axi0, "axi0"),
+    HPM_CLOCK_BOOT(clock_axi1, "axi1"),
+    HPM_CLOCK_BOOT(clock_axi2, "axi2"),
+    HPM_CLOCK_BOOT(clock_ahb, "ahb"),
+    HPM_CLOCK_BOOT(clock_xpi0, "xpi0"),
+    HPM_CLOCK_BOOT(clock_ram0, "ram0"),
+    HPM_CLOCK_BOOT(clock_ram1, "ram1"),
+    HPM_CLOCK_BOOT(clock_lmm0, "lmm0"),
+
+    HPM_CLOCK_PERI(clock_dram, "dram"),
+    HPM_CLOCK_PERI(clock_xpi1, "xpi1"),
+    HPM_CLOCK_PERI(clock_gptmr0, "gptmr0"),
+    HPM_CLOCK_PERI(clock_gptmr1, "gptmr1"),
+    HPM_CLOCK_PERI(clock_gptmr2, "gptmr2"),
+    HPM_CLOCK_PERI(clock_gptmr3, "gptmr3"),
+    HPM_CLOCK_PERI(clock_gptmr4, "gptmr4"),
+    HPM_CLOCK_PERI(clock_gptmr5, "gptmr5"),
+    HPM_CLOCK_PERI(clock_gptmr6, "gptmr6"),
+    HPM_CLOCK_PERI(clock_gptmr7, "gptmr7"),
+    HPM_CLOCK_PERI(clock_uart0, "uart0"),
+    HPM_CLOCK_PERI(clock_uart1, "uart1"),
+    HPM_CLOCK_PERI(clock_uart2, "uart2"),
+    HPM_CLOCK_PERI(clock_uart3, "uart3"),
+    HPM_CLOCK_PERI(clock_uart13, "uart13"),
+    HPM_CLOCK_PERI(clock_i2c0, "i2c0"),
+    HPM_CLOCK_PERI(clock_i2c1, "i2c1"),
+    HPM_CLOCK_PERI(clock_i2c2, "i2c2"),
+    HPM_CLOCK_PERI(clock_i2c3, "i2c3"),
+    HPM_CLOCK_PERI(clock_spi0, "spi0"),
+    HPM_CLOCK_PERI(clock_spi1, "spi1"),
+    HPM_CLOCK_PERI(clock_spi2, "spi2"),
+    HPM_CLOCK_PERI(clock_spi3, "spi3"),
+    HPM_CLOCK_PERI(clock_can0, "can0"),
+    HPM_CLOCK_PERI(clock_can1, "can1"),
+    HPM_CLOCK_PERI(clock_can2, "can2"),
+    HPM_CLOCK_PERI(clock_can3, "can3"),
+    HPM_CLOCK_PERI(clock_display, "display"),
+    HPM_CLOCK_PERI(clock_sdxc0, "sdxc0"),
+    HPM_CLOCK_PERI(clock_sdxc1, "sdxc1"),
+    HPM_CLOCK_PERI(clock_camera0, "cam0"),
+    HPM_CLOCK_PERI(clock_camera1, "cam1"),
+    HPM_CLOCK_PERI(clock_ptpc, "ptpc"),
+    HPM_CLOCK_PERI(clock_ref0, "ref0"),
+    HPM_CLOCK_PERI(clock_ref1, "ref1"),
+    HPM_CLOCK_PERI(clock_watchdog0, "wdg0"),
+    HPM_CLOCK_PERI(clock_watchdog1, "wdg1"),
+    HPM_CLOCK_PERI(clock_watchdog2, "wdg2"),
+    HPM_CLOCK_PERI(clock_watchdog3, "wdg3"),
+    HPM_CLOCK_PERI(clock_pwdg, "pwdg"),
+    HPM_CLOCK_PERI(clock_eth0, "eth0"),
+    HPM_CLOCK_PERI(clock_eth1, "eth1"),
+    HPM_CLOCK_PERI(clock_sdp, "sdp"),
+    HPM_CLOCK_PERI(clock_xdma, "xdma"),
+    HPM_CLOCK_PERI(clock_usb0, "usb0"),
+    HPM_CLOCK_PERI(clock_usb1, "usb1"),
+    HPM_CLOCK_PERI(clock_jpeg, "jpeg"),
+    HPM_CLOCK_PERI(clock_pdma, "pdma"),
+    HPM_CLOCK_PERI(clock_kman, "kman"),
+    HPM_CLOCK_PERI(clock_gpio, "gpio"),
+    HPM_CLOCK_PERI(clock_mbx0, "mbx0"),
+    HPM_CLOCK_PERI(clock_hdma, "hdma"),
+    HPM_CLOCK_PERI(clock_rng, "rng"),
+    HPM_CLOCK_PERI(clock_mot0, "mot0"),
+    HPM_CLOCK_PERI(clock_mot1, "mot1"),
+    HPM_CLOCK_PERI(clock_mot2, "mot2"),
+    HPM_CLOCK_PERI(clock_mot3, "mot3"),
+    HPM_CLOCK_PERI(clock_acmp, "acmp"),
+    HPM_CLOCK_PERI(clock_dao, "dao"),
+    HPM_CLOCK_PERI(clock_msyn, "msyn"),
+    HPM_CLOCK_PERI(clock_lmm1, "lmm1"),
+    HPM_CLOCK_PERI(clock_adc0, "adc0"),
+    HPM_CLOCK_PERI(clock_adc1, "adc1"),
+    HPM_CLOCK_PERI(clock_adc2, "adc2"),
+    HPM_CLOCK_PERI(clock_adc3, "adc3"),
+    HPM_CLOCK_PERI(clock_i2s0, "i2s0"),
+    HPM_CLOCK_PERI(clock_i2s1, "i2s1"),
+    HPM_CLOCK_PERI(clock_i2s2, "i2s2"),
+    HPM_CLOCK_PERI(clock_i2s3, "i2s3"),
+};
+
+#define HPM_CLOCK_NUM (sizeof(g_hpmClocks) / sizeof(g_hpmClocks[0]))
+
+static struct HpmClockNode *HpmClockFind(clock_name_t clock)
+{
+    for (uint32_t i = 0; i < HPM_CLOCK_NUM; i++) {
+        if (g_hpmClocks[i].clock == clock) {
+            return &g_hpmClocks[i];
+        }
+    }
+    return NULL;
+}
+
+int HpmClockGet(clock_name_t clock)
+{
+    struct HpmClockNode *node = HpmClockFind(clock);
+
+    if (node == NULL) {
+        printf("Err: clock 0x%x is not managed\n", (uint32_t)clock);
+        return -1;
+    }
+
+    uint32_t intSave = LOS_IntLock();
+    if (node->refs++ == 0) {
+        clock_add_to_group(clock, 0);
+    }
+    LOS_IntRestore(intSave);
+    return 0;
+}
+
+int HpmClockPut(clock_name_t clock)
+{
+    struct HpmClockNode *node = HpmClockFind(clock);
+
+    if ((node == NULL) || (node->refs == 0)) {
+        printf("Err: clock 0x%x put without get\n", (uint32_t)clock);
+        return -1;
+    }
+
+    uint32_t intSave = LOS_IntLock();
+    if ((--node->refs == 0) && !node->boot) {
+        clock_remove_from_group(clock, 0);
+    }
+    LOS_IntRestore(intSave);
+    return 0;
+}
+
+int HpmClockRefs(clock_name_t clock)
+{
+    struct HpmClockNode *node = HpmClockFind(clock);
+    return (node == NULL) ? -1 : (int)node->refs;
+}
+
+void HpmClockInit(void)
+{
+    for (uint32_t i = 0; i < HPM_CLOCK_NUM; i++) {
+        struct HpmClockNode *node = &g_hpmClocks[i];
+        if (node->boot || !HPM_CLOCK_GATING_ENABLE) {
+            node->refs = 1;
+            clock_add_to_group(node->clock, 0);
+        } else {
+            /* the boot ROM or a previous image may have left it on */
+            node->refs = 0;
+            clock_remove_from_group(node->clock, 0);
+        }
+    }
+}
+
+void HpmClockPrintActive(void)
+{
+    uint32_t active = 0;
+
+    printf("clock\t\t refs\t frequency\r\n");
+    for (uint32_t i = 0; i < HPM_CLOCK_NUM; i++) {
+        struct HpmClockNode *node = &g_hpmClocks[i];
+        if (node->refs == 0) {
+            continue;
+        }
+        active++;
+        printf("%-8s\t %u%s\t %uHz\r\n", node->name, node->refs, node->boot ? "*" : "",
+               clock_get_frequency(node->clock));
+    }
+    printf("%u of %u group 0 clocks on, * = boot clock\r\n", active, (uint32_t)HPM_CLOCK_NUM);
+}
+
+#ifdef LOSCFG_SHELL
+static UINT32 HpmClockCmd(UINT32 argc, const CHAR **argv)
+{
+    (void)argc;
+    (void)argv;
+    HpmClockPrintActive();
+    return 0;
+}
+
+static void HpmClockShellReg(void)
+{
+    osCmdReg(CMD_TYPE_EX, "clocks", XARGS, (CmdCallBackFunc)HpmClockCmd);
+}
+
+APP_FEATURE_INIT(HpmClockShellReg);
+#endif
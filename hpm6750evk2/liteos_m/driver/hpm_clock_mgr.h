@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HPM_CLOCK_MGR_H
+#define _HPM_CLOCK_MGR_H
+
+#include <stdint.h>
+#include "hpm_clock_drv.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif
+#endif
+
+/*
+ * 1: only the clocks the system needs to run (CPU0, buses, memories, XPI0) are on after
+ *    board_init_clock(), every driver turns on its own clocks with HpmClockGet().
+ * 0: every peripheral clock of group 0 is on from boot, as before.
+ */
+#define HPM_CLOCK_GATING_ENABLE 1
+
+/* Take a reference on a group 0 clock, the clock is turned on with the first one */
+int HpmClockGet(clock_name_t clock);
+/* Drop a reference, the clock is turned off with the last one. Boot clocks stay on */
+int HpmClockPut(clock_name_t clock);
+/* Reference count of a clock, -1 if the clock is not managed */
+int HpmClockRefs(clock_name_t clock);
+
+/* Called by board_init_clock(): applies the boot clock set of HPM_CLOCK_GATING_ENABLE */
+void HpmClockInit(void);
+/* Lists the clocks that are on, with their users and frequencies */
+void HpmClockPrintActive(void);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+#endif
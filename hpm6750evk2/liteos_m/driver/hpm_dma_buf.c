@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hpm_dma_buf.h"
+#ifdef LOSCFG_SHELL
+#include "hpm_clock_drv.h"
+#include "hpm_mchtmr_drv.h"
+#include "ohos_init.h"
+#include "shcmd.h"
+#endif
+
+#define HPM_DMA_LINE_DOWN(addr)     ((uint32_t)(addr) & ~(HPM_L1C_CACHELINE_SIZE - 1U))
+
+void HpmDmaSyncForCpu(const void *addr, uint32_t size)
+{
+    uint32_t start = HPM_DMA_LINE_DOWN(addr);
+    uint32_t end = HPM_DMA_BUF_ALIGN_UP((uint32_t)addr + size);
+
+    if (size != 0) {
+        l1c_dc_invalidate(start, end - start);
+    }
+}
+
+void HpmDmaSyncForDevice(const void *addr, uint32_t size)
+{
+    uint32_t start = HPM_DMA_LINE_DOWN(addr);
+    uint32_t end = HPM_DMA_BUF_ALIGN_UP((uint32_t)addr + size);
+
+    if (size != 0) {
+        l1c_dc_writeback(start, end - start);
+    }
+}
+
+#ifdef LOSCFG_SHELL
+/*
+ * dmabench [frames] [size]: the copy of an Ethernet driver in both directions, once with the
+ * DMA buffer in the noncacheable region and once in cacheable memory with the sync calls.
+ *  rx: sync for CPU (cacheable only) then copy from the DMA buffer into a cacheable buffer.
+ *  tx: copy into the DMA buffer, then sync for device (cacheable only).
+ * Timed with MCHTMR0 at its fixed 24 MHz, DVFS may change the CPU clock during a run.
+ */
+#define HPM_DMA_BENCH_SIZE      1536
+#define HPM_DMA_BENCH_FRAMES    1000
+
+static ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(HPM_L1C_CACHELINE_SIZE) uint8_t g_hpmDmaBenchUncached[HPM_DMA_BENCH_SIZE];
+static ATTR_DMA_BUF uint8_t g_hpmDmaBenchCached[HPM_DMA_BENCH_SIZE];
+static ATTR_DMA_BUF uint8_t g_hpmDmaBenchPbuf[HPM_DMA_BENCH_SIZE];
+
+static uint64_t HpmDmaBenchRun(uint8_t *dmaBuf, int cached, int rx, uint32_t frames, uint32_t size)
+{
+    uint64_t start = mchtmr_get_count(HPM_MCHTMR);
+
+    for (uint32_t i = 0; i < frames; i++) {
+        if (rx) {
+            if (cached) {
+                HpmDmaSyncForCpu(dmaBuf, size);
+            }
+            memcpy(g_hpmDmaBenchPbuf, dmaBuf, size);
+        } else {
+            memcpy(dmaBuf, g_hpmDmaBenchPbuf, size);
+            if (cached) {
+                HpmDmaSyncForDevice(dmaBuf, size);
+            }
+        }
+    }
+    return mchtmr_get_count(HPM_MCHTMR) - start;
+}
+
+static UINT32 HpmDmaBenchCmd(UINT32 argc, const CHAR **argv)
+{
+    uint32_t frames = (argc > 0) ? (uint32_t)strtoul(argv[0], NULL, 0) : HPM_DMA_BENCH_FRAMES;
+    uint32_t size = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 1514U;
+    uint32_t ticksPerUs = clock_get_frequency(clock_mchtmr0) / 1000000U;
+
+    if ((frames == 0) || (size == 0) || (size > HPM_DMA_BENCH_SIZE)) {
+        printf("usage: dmabench [frames] [size <= %u]\n", HPM_DMA_BENCH_SIZE);
+        return 1;
+    }
+
+    printf("dmabench: %u frames of %u bytes\n", frames, size);
+    for (int rx = 1; rx >= 0; rx--) {
+        uint64_t uncached = HpmDmaBenchRun(g_hpmDmaBenchUncached, 0, rx, frames, size);
+        uint64_t cached = HpmDmaBenchRun(g_hpmDmaBenchCached, 1, rx, frames, size);
+        printf("%s noncacheable %llu ns/frame (%llu MB/s), cacheable+sync %llu ns/frame (%llu MB/s)\n",
+               rx ? "rx" : "tx", (unsigned long long)(uncached * 1000U / ticksPerUs / frames),
+               (unsigned long long)((uint64_t)frames * size * ticksPerUs / (uncached + 1U)),
+               (unsigned long long)(cached * 1000U / ticksPerUs / frames),
+               (unsigned long long)((uint64_t)frames * size * ticksPerUs / (cached + 1U)));
+    }
+    return 0;
+}
+
+static void HpmDmaBenchShellReg(void)
+{
+    osCmdReg(CMD_TYPE_EX, "dmabench", XARGS, (CmdCallBackFunc)HpmDmaBenchCmd);
+}
+
+APP_FEATURE_INIT(HpmDmaBenchShellReg);
+#endif
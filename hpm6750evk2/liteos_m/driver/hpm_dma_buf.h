@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HPM_DMA_BUF_H
+#define _HPM_DMA_BUF_H
+
+#include <stdint.h>
+#include "hpm_common.h"
+#include "hpm_l1c_drv.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif
+#endif
+
+/*
+ * DMA buffers in cacheable memory. ATTR_DMA_BUF places a buffer in the .dma_buf section of the
+ * AXI SRAM, the DMA masters cannot reach DLM where .bss lives. A buffer takes whole cache lines
+ * (ATTR_DMA_BUF and a size rounded with HPM_DMA_BUF_ALIGN_UP), so the maintenance below never
+ * hits a neighbour. The section is not cleared at startup.
+ *  HpmDmaSyncForCpu():    the device wrote the range, drop the stale lines before the CPU reads.
+ *  HpmDmaSyncForDevice(): the CPU wrote the range, push it to memory before the device reads.
+ * Buffers in the noncacheable region need neither call.
+ */
+#define HPM_DMA_BUF_ALIGN_UP(n)     (((n) + HPM_L1C_CACHELINE_SIZE - 1U) & ~(HPM_L1C_CACHELINE_SIZE - 1U))
+#define ATTR_DMA_BUF                ATTR_PLACE_AT(".dma_buf") ATTR_ALIGN(HPM_L1C_CACHELINE_SIZE)
+
+void HpmDmaSyncForCpu(const void *addr, uint32_t size);
+void HpmDmaSyncForDevice(const void *addr, uint32_t size);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <los_interrupt.h>
+#include <los_mux.h>
+#include <los_task.h>
+#include <los_tick.h>
+#ifdef LOSCFG_BASE_CORE_CPUP
+#include <los_cpup.h>
+#endif
+#include "board.h"
+#include "hpm_pllctl_drv.h"
+#include "hpm_mchtmr_drv.h"
+#include "hpm_dvfs.h"
+#if HPM_DVFS_VOLTAGE_ENABLE
+#include "hpm_pcfg_drv.h"
+#endif
+#include "ohos_init.h"
+#ifdef LOSCFG_SHELL
+#include "shcmd.h"
+#endif
+
+/*
+ * Level changes run the CPUs from the 24 MHz oscillator while PLL0 relocks, with interrupts
+ * locked for the relock time. Drivers whose clock follows PLL0 register a notifier to redo their
+ * dividers, the core itself checks that the tick timer clock did not move.
+ *
+ * Governor: every HPM_DVFS_GOV_PERIOD_TICKS it looks at the CPU usage of the last second. At
+ * HPM_DVFS_UP_PERMILLE or more it goes straight to the fastest level allowed by the cap, and it
+ * steps one level down when the usage projected for the slower level stays under
+ * HPM_DVFS_DOWN_PERMILLE.
+ */
+
+#define HPM_DVFS_GOV_TASK_PRIO          (OS_TASK_PRIORITY_LOWEST - 2)
+#define HPM_DVFS_GOV_TASK_STACK_SIZE    1024
+#define HPM_DVFS_GOV_PERIOD_TICKS       (LOSCFG_BASE_CORE_TICK_PER_SECOND / 2)
+#define HPM_DVFS_UP_PERMILLE            800
+#define HPM_DVFS_DOWN_PERMILLE          600
+#define HPM_DVFS_BENCH_MS               500
+#define HPM_DVFS_BENCH_BUF_SIZE         1024
+
+struct HpmDvfsLevel {
+    uint32_t freq;
+    uint16_t mv; /* DCDC output, only used with HPM_DVFS_VOLTAGE_ENABLE */
+};
+
+struct HpmDvfsNotifierNode {
+    HpmDvfsNotifier notifier;
+    void *arg;
+};
+
+static const struct HpmDvfsLevel g_hpmDvfsLevels[HPM_DVFS_LEVEL_NUM] = {
+    { BOARD_CPU_FREQ, 1275 },
+    { 600000000UL, 1175 },
+    { 400000000UL, 1100 },
+    { 200000000UL, 1000 },
+};
+
+static struct HpmDvfsNotifierNode g_hpmDvfsNotifiers[HPM_DVFS_MAX_NOTIFIERS];
+static UINT32 g_hpmDvfsMux;
+static int g_hpmDvfsInited;
+static uint32_t g_hpmDvfsLevel; /* board_init_clock() leaves the CPU at level 0 */
+static uint32_t g_hpmDvfsCap;
+static int g_hpmDvfsGovernor = HPM_DVFS_GOVERNOR_ENABLE;
+static uint32_t g_hpmDvfsTransitions;
+static UINT64 g_hpmDvfsResidency[HPM_DVFS_LEVEL_NUM]; /* ticks spent at each level */
+static UINT64 g_hpmDvfsLevelSince;
+static uint32_t g_hpmDvfsPowerMw[HPM_DVFS_LEVEL_NUM]; /* board power measured by the user, 0 if unknown */
+
+int HpmDvfsRegisterNotifier(HpmDvfsNotifier notifier, void *arg)
+{
+    int ret = -1;
+
+    uint32_t intSave = LOS_IntLock();
+    for (int i = 0; i < HPM_DVFS_MAX_NOTIFIERS; i++) {
+        if (g_hpmDvfsNotifiers[i].notifier == NULL) {
+            g_hpmDvfsNotifiers[i].notifier = notifier;
+            g_hpmDvfsNotifiers[i].arg = arg;
+            ret = 0;
+            break;
+        }
+    }
+    LOS_IntRestore(intSave);
+
+    if (ret != 0) {
+        printf("Err: no room for another DVFS notifier\n");
+    }
+    return ret;
+}
+
+static void HpmDvfsNotify(uint32_t event, uint32_t oldFreq, uint32_t newFreq)
+{
+    for (int i = 0; i < HPM_DVFS_MAX_NOTIFIERS; i++) {
+        if (g_hpmDvfsNotifiers[i].notifier != NULL) {
+            g_hpmDvfsNotifiers[i].notifier(event, oldFreq, newFreq, g_hpmDvfsNotifiers[i].arg);
+        }
+    }
+}
+
+static void HpmDvfsSetVoltage(uint32_t level)
+{
+#if HPM_DVFS_VOLTAGE_ENABLE
+    if (pcfg_dcdc_set_voltage(HPM_PCFG, g_hpmDvfsLevels[level].mv) != status_success) {
+        printf("Err: DCDC could not be set to %umV\n", g_hpmDvfsLevels[level].mv);
+    }
+#else
+    (void)level;
+#endif
+}
+
+static hpm_stat_t HpmDvfsSwitchPll(uint32_t freq)
+{
+    hpm_stat_t stat;
+
+    uint32_t intSave = LOS_IntLock();
+    clock_set_source_divider(clock_cpu0, clk_src_osc24m, 1);
+    clock_set_source_divider(clock_cpu1, clk_src_osc24m, 1);
+    stat = pllctl_init_int_pll_with_freq(HPM_PLLCTL, 0, freq);
+    clock_set_source_divider(clock_cpu0, clk_src_pll0_clk0, 1);
+    clock_set_source_divider(clock_cpu1, clk_src_pll0_clk0, 1);
+    clock_update_core_clock();
+    LOS_IntRestore(intSave);
+    return stat;
+}
+
+static void HpmDvfsAccount(void)
+{
+    UINT64 now = LOS_TickCountGet();
+
+    g_hpmDvfsResidency[g_hpmDvfsLevel] += now - g_hpmDvfsLevelSince;
+    g_hpmDvfsLevelSince = now;
+}
+
+int HpmDvfsSetLevel(uint32_t level)
+{
+    if (!g_hpmDvfsInited || (level >= HPM_DVFS_LEVEL_NUM)) {
+        return -1;
+    }
+
+    LOS_MuxPend(g_hpmDvfsMux, LOS_WAIT_FOREVER);
+    if (level < g_hpmDvfsCap) {
+        level = g_hpmDvfsCap;
+    }
+    if (level == g_hpmDvfsLevel) {
+        LOS_MuxPost(g_hpmDvfsMux);
+        return 0;
+    }
+
+    uint32_t oldLevel = g_hpmDvfsLevel;
+    uint32_t oldFreq = clock_get_frequency(clock_cpu0);
+    uint32_t tickFreq = clock_get_frequency(clock_mchtmr0);
+
+    HpmDvfsNotify(HPM_DVFS_PRE_CHANGE, oldFreq, g_hpmDvfsLevels[level].freq);
+    if (level < oldLevel) {
+        HpmDvfsSetVoltage(level);
+    }
+    if (HpmDvfsSwitchPll(g_hpmDvfsLevels[level].freq) != status_success) {
+        printf("Err: PLL0 did not lock at %uHz, back to %uHz\n", g_hpmDvfsLevels[level].freq, oldFreq);
+        (void)HpmDvfsSwitchPll(g_hpmDvfsLevels[oldLevel].freq);
+        level = oldLevel;
+    }
+    if (level > oldLevel) {
+        HpmDvfsSetVoltage(level);
+    }
+
+    HpmDvfsAccount();
+    g_hpmDvfsLevel = level;
+    g_hpmDvfsTransitions++;
+    HpmDvfsNotify(HPM_DVFS_POST_CHANGE, oldFreq, clock_get_frequency(clock_cpu0));
+
+    if (clock_get_frequency(clock_mchtmr0) != tickFreq) {
+        printf("Err: the tick timer clock moved with PLL0, system time is off\n");
+    }
+    LOS_MuxPost(g_hpmDvfsMux);
+    return (level == oldLevel) ? -1 : 0;
+}
+
+uint32_t HpmDvfsGetLevel(void)
+{
+    return g_hpmDvfsLevel;
+}
+
+uint32_t HpmDvfsLevelFreq(uint32_t level)
+{
+    return (level < HPM_DVFS_LEVEL_NUM) ? g_hpmDvfsLevels[level].freq : 0;
+}
+
+int HpmDvfsSetCap(uint32_t level)
+{
+    int ret;
+
+    if (!g_hpmDvfsInited || (level >= HPM_DVFS_LEVEL_NUM)) {
+        return -1;
+    }
+
+    /* the mutex nests, the governor cannot pick a level between the new cap and applying it */
+    LOS_MuxPend(g_hpmDvfsMux, LOS_WAIT_FOREVER);
+    g_hpmDvfsCap = level;
+    /* slows down at once if the current level is above the cap */
+    ret = HpmDvfsSetLevel(g_hpmDvfsLevel);
+    LOS_MuxPost(g_hpmDvfsMux);
+    return ret;
+}
+
+void HpmDvfsGovernorEnable(int enable)
+{
+    g_hpmDvfsGovernor = enable;
+}
+
+#ifdef LOSCFG_BASE_CORE_CPUP
+static void HpmDvfsGovernorTask(void)
+{
+    while (1) {
+        LOS_TaskDelay(HPM_DVFS_GOV_PERIOD_TICKS);
+        if (!g_hpmDvfsGovernor) {
+            continue;
+        }
+
+        uint32_t usage = LOS_HistorySysCpuUsage(CPUP_LAST_ONE_SECONDS);
+        uint32_t level = g_hpmDvfsLevel;
+        if (usage >= HPM_DVFS_UP_PERMILLE) {
+            (void)HpmDvfsSetLevel(g_hpmDvfsCap);
+        } else if (level + 1U < HPM_DVFS_LEVEL_NUM) {
+            uint64_t projected = (uint64_t)usage * g_hpmDvfsLevels[level].freq / g_hpmDvfsLevels[level + 1U].freq;
+            if (projected < HPM_DVFS_DOWN_PERMILLE) {
+                (void)HpmDvfsSetLevel(level + 1U);
+            }
+        }
+    }
+}
+
+static void HpmDvfsGovernorStart(void)
+{
+    TSK_INIT_PARAM_S task = {0};
+    UINT32 taskId;
+
+    task.pfnTaskEntry = (TSK_ENTRY_FUNC)HpmDvfsGovernorTask;
+    task.uwStackSize = HPM_DVFS_GOV_TASK_STACK_SIZE;
+    task.pcName = "dvfs_gov";
+    task.usTaskPrio = HPM_DVFS_GOV_TASK_PRIO;
+    task.uwResved = LOS_TASK_STATUS_DETACHED;
+    if (LOS_TaskCreate(&taskId, &task) != LOS_OK) {
+        printf("Err: DVFS governor task create failed\n");
+    }
+}
+#else
+static void HpmDvfsGovernorStart(void)
+{
+    /* no CPU usage to go by, the level only changes on request */
+    g_hpmDvfsGovernor = 0;
+}
+#endif
+
+#ifdef LOSCFG_SHELL
+/* Bitwise CRC32 over a RAM buffer: integer and load bound, with no peripheral in the loop */
+static uint32_t HpmDvfsBenchRound(const uint8_t *buf, uint32_t len, uint32_t crc)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+    return crc;
+}
+
+static void HpmDvfsBench(uint32_t ms)
+{
+    static uint8_t buf[HPM_DVFS_BENCH_BUF_SIZE];
+    uint32_t savedLevel = g_hpmDvfsLevel;
+    int savedGovernor = g_hpmDvfsGovernor;
+    uint32_t crc = 0;
+
+    for (uint32_t i = 0; i < HPM_DVFS_BENCH_BUF_SIZE; i++) {
+        buf[i] = (uint8_t)i;
+    }
+
+    g_hpmDvfsGovernor = 0;
+    printf("level\t freq(MHz)\t rounds/s\t power(mW)\t rounds/J\n");
+    for (uint32_t level = g_hpmDvfsCap; level < HPM_DVFS_LEVEL_NUM; level++) {
+        if (HpmDvfsSetLevel(level) != 0) {
+            continue;
+        }
+        /* MCHTMR0 runs from the oscillator, its rate does not change with the level */
+        uint64_t span = (uint64_t)clock_get_frequency(clock_mchtmr0) / 1000U * ms;
+        uint64_t start = mchtmr_get_count(HPM_MCHTMR);
+        uint32_t rounds = 0;
+        while (mchtmr_get_count(HPM_MCHTMR) - start < span) {
+            crc = HpmDvfsBenchRound(buf, HPM_DVFS_BENCH_BUF_SIZE, crc);
+            rounds++;
+        }
+
+        uint32_t perSec = (uint32_t)((uint64_t)rounds * 1000U / ms);
+        printf("%u\t %u\t\t %u\t\t", level, g_hpmDvfsLevels[level].freq / 1000000U, perSec);
+        if (g_hpmDvfsPowerMw[level] != 0) {
+            printf(" %u\t\t %u\n", g_hpmDvfsPowerMw[level], (uint32_t)((uint64_t)perSec * 1000U / g_hpmDvfsPowerMw[level]));
+        } else {
+            printf(" -\t\t -\n");
+        }
+    }
+    printf("round = CRC32 of %u bytes (0x%08x), set power with: dvfs power <level> <mW>\n",
+           HPM_DVFS_BENCH_BUF_SIZE, crc);
+
+    (void)HpmDvfsSetLevel(savedLevel);
+    g_hpmDvfsGovernor = savedGovernor;
+}
+
+static void HpmDvfsShow(void)
+{
+    UINT64 total = 0;
+
+    LOS_MuxPend(g_hpmDvfsMux, LOS_WAIT_FOREVER);
+    HpmDvfsAccount();
+    LOS_MuxPost(g_hpmDvfsMux);
+
+    printf("cpu0 %uHz, level %u, cap %u, governor %s, %u transitions\n", clock_get_frequency(clock_cpu0),
+           g_hpmDvfsLevel, g_hpmDvfsCap, g_hpmDvfsGovernor ? "on" : "off", g_hpmDvfsTransitions);
+    for (uint32_t i = 0; i < HPM_DVFS_LEVEL_NUM; i++) {
+        total += g_hpmDvfsResidency[i];
+    }
+    for (uint32_t i = 0; i < HPM_DVFS_LEVEL_NUM; i++) {
+        uint32_t permille = (total == 0) ? 0 : (uint32_t)(g_hpmDvfsResidency[i] * 1000U / total);
+        printf("  %u: %3uMHz %3u.%u%%\n", i, g_hpmDvfsLevels[i].freq / 1000000U, permille / 10U, permille % 10U);
+    }
+}
+
+static UINT32 HpmDvfsCmd(UINT32 argc, const CHAR **argv)
+{
+    if (argc == 0) {
+        HpmDvfsShow();
+        return 0;
+    }
+
+    if ((strcmp(argv[0], "set") == 0) && (argc > 1)) {
+        return (HpmDvfsSetLevel((uint32_t)strtoul(argv[1], NULL, 0)) == 0) ? 0 : 1;
+    }
+    if ((strcmp(argv[0], "cap") == 0) && (argc > 1)) {
+        return (HpmDvfsSetCap((uint32_t)strtoul(argv[1], NULL, 0)) == 0) ? 0 : 1;
+    }
+    if ((strcmp(argv[0], "gov") == 0) && (argc > 1)) {
+        HpmDvfsGovernorEnable(strcmp(argv[1], "on") == 0);
+        return 0;
+    }
+    if (strcmp(argv[0], "bench") == 0) {
+        uint32_t ms = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : HPM_DVFS_BENCH_MS;
+        HpmDvfsBench((ms == 0) ? HPM_DVFS_BENCH_MS : ms);
+        return 0;
+    }
+    if ((strcmp(argv[0], "power") == 0) && (argc > 2)) {
+        uint32_t level = (uint32_t)strtoul(argv[1], NULL, 0);
+        if (level < HPM_DVFS_LEVEL_NUM) {
+            g_hpmDvfsPowerMw[level] = (uint32_t)strtoul(argv[2], NULL, 0);
+            return 0;
+        }
+    }
+
+    printf("usage: dvfs [set <level> | cap <level> | gov on|off | bench [ms] | power <level> <mW>]\n");
+    return 1;
+}
+#endif
+
+static void HpmDvfsInit(void)
+{
+    if (LOS_MuxCreate(&g_hpmDvfsMux) != LOS_OK) {
+        printf("Err: DVFS mutex create failed\n");
+        return;
+    }
+    g_hpmDvfsLevelSince = LOS_TickCountGet();
+    g_hpmDvfsInited = 1;
+
+    /* the task stays around with the governor off, so "dvfs gov on" can bring it back */
+    HpmDvfsGovernorStart();
+#ifdef LOSCFG_SHELL
+    osCmdReg(CMD_TYPE_EX, "dvfs", XARGS, (CmdCallBackFunc)HpmDvfsCmd);
+#endif
+}
+
+APP_SERVICE_INIT(HpmDvfsInit);
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HPM_DVFS_H
+#define _HPM_DVFS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif
+#endif
+
+/*
+ * CPU frequency scaling. PLL0 feeds CPU0 and CPU1 and is reprogrammed per performance level,
+ * level 0 is BOARD_CPU_FREQ and higher levels are slower. AHB runs from PLL1 and is not touched,
+ * the same goes for UART0 and MCHTMR0 which run from the 24 MHz oscillator.
+ */
+#define HPM_DVFS_LEVEL_NUM          4
+
+/* 1: the governor task follows the CPU usage of LiteOS (needs LOSCFG_BASE_CORE_CPUP) */
+#define HPM_DVFS_GOVERNOR_ENABLE    1
+
+/*
+ * 1: the DCDC output follows the level, raised before speeding up and lowered after slowing
+ * down. Check the voltages in hpm_dvfs.c against the datasheet of the part before enabling.
+ */
+#define HPM_DVFS_VOLTAGE_ENABLE     0
+
+#define HPM_DVFS_PRE_CHANGE         0
+#define HPM_DVFS_POST_CHANGE        1
+
+#define HPM_DVFS_MAX_NOTIFIERS      8
+
+/* Called before and after every level change with the CPU frequencies in Hz */
+typedef void (*HpmDvfsNotifier)(uint32_t event, uint32_t oldFreq, uint32_t newFreq, void *arg);
+
+int HpmDvfsRegisterNotifier(HpmDvfsNotifier notifier, void *arg);
+
+int HpmDvfsSetLevel(uint32_t level);
+uint32_t HpmDvfsGetLevel(void);
+uint32_t HpmDvfsLevelFreq(uint32_t level);
+
+/* Thermal cap: neither the governor nor HpmDvfsSetLevel() go faster than this level */
+int HpmDvfsSetCap(uint32_t level);
+void HpmDvfsGovernorEnable(int enable);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+#endif
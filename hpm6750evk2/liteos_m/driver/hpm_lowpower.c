@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <los_interrupt.h>
+#include <los_sem.h>
+#ifdef LOSCFG_KERNEL_PM
+#include <los_pm.h>
+#endif
+#include "hpm_sysctl_drv.h"
+#include "hpm_mchtmr_drv.h"
+#include "hpm_gptmr_drv.h"
+#include "hpm_clock_mgr.h"
+#include "hpm_lowpower.h"
+#include "ohos_init.h"
+#ifdef LOSCFG_SHELL
+#include "shcmd.h"
+#endif
+
+/*
+ * The mode is applied to SYSCTL whenever it or the busy count changes, the WFI itself is the
+ * one of the idle task. With LOSCFG_KERNEL_PM the WFI goes through HpmLowPowerSuspend() instead,
+ * which counts the time spent in it.
+ *
+ * MCHTMR0 runs from the 24 MHz oscillator, which is stopped in the system low-power mode and
+ * restarted on exit: the tick the scheduler programmed never fires and the time asleep is missing
+ * from the system time. SYSTEM is therefore only entered while a driver has armed a wake source
+ * that runs without the oscillator (GPIO, RTC alarm), and the system time stands still while it
+ * lasts; until one is armed the mode cannot be selected and a selected one runs as WFI.
+ *
+ * Wake latency ("lpmode lat", shell builds only): GPTMR0 channel 0 fires once per sample while the shell task waits
+ * for it, so CPU0 is in the idle WFI when it does. The counter restarts at the reload that raises
+ * the interrupt, the value the ISR reads is the time from the event to the first instruction of
+ * the handler.
+ */
+
+#define HPM_LP_LAT_GPTMR            HPM_GPTMR0
+#define HPM_LP_LAT_GPTMR_CLOCK      clock_gptmr0
+#define HPM_LP_LAT_GPTMR_IRQ        IRQn_GPTMR0
+#define HPM_LP_LAT_CH               0
+#define HPM_LP_LAT_SAMPLES          100
+#define HPM_LP_LAT_PERIOD_US        2000
+#define HPM_LP_LAT_TIMEOUT_TICKS    100
+
+static const sysctl_cpu_lp_mode_t g_hpmLpSysctlModes[HPM_LP_MODE_NUM] = {
+    [HPM_LP_MODE_NONE] = cpu_lp_mode_ungate_cpu_clock,
+    [HPM_LP_MODE_WFI] = cpu_lp_mode_gate_cpu_clock,
+    [HPM_LP_MODE_SYSTEM] = cpu_lp_mode_trigger_system_lp,
+};
+
+static uint32_t g_hpmLpMode = HPM_LP_MODE_DEFAULT;
+static uint32_t g_hpmLpBusy;
+static uint32_t g_hpmLpWakeSources;
+static uint32_t g_hpmLpApplied = HPM_LP_MODE_NUM;
+
+#ifdef LOSCFG_KERNEL_PM
+static uint32_t g_hpmLpEntries[HPM_LP_MODE_NUM];
+static uint64_t g_hpmLpIdleCycles;
+static uint64_t g_hpmLpStatsSince;
+#endif
+
+/* Called with interrupts locked */
+static void HpmLowPowerApply(void)
+{
+    uint32_t mode = g_hpmLpMode;
+
+    if ((mode == HPM_LP_MODE_SYSTEM) && ((g_hpmLpBusy != 0) || (g_hpmLpWakeSources == 0))) {
+        mode = HPM_LP_MODE_WFI;
+    }
+    if (mode != g_hpmLpApplied) {
+        sysctl_set_cpu_lp_mode(HPM_SYSCTL, HPM_CORE0, g_hpmLpSysctlModes[mode]);
+        g_hpmLpApplied = mode;
+    }
+}
+
+int HpmLowPowerSetMode(uint32_t mode)
+{
+    if (mode >= HPM_LP_MODE_NUM) {
+        return -1;
+    }
+
+    uint32_t intSave = LOS_IntLock();
+    if ((mode == HPM_LP_MODE_SYSTEM) && (g_hpmLpWakeSources == 0)) {
+        LOS_IntRestore(intSave);
+        return -1;
+    }
+    g_hpmLpMode = mode;
+    HpmLowPowerApply();
+    LOS_IntRestore(intSave);
+    return 0;
+}
+
+uint32_t HpmLowPowerGetMode(void)
+{
+    return g_hpmLpMode;
+}
+
+void HpmLowPowerBusyGet(void)
+{
+    uint32_t intSave = LOS_IntLock();
+    g_hpmLpBusy++;
+    HpmLowPowerApply();
+    LOS_IntRestore(intSave);
+}
+
+void HpmLowPowerBusyPut(void)
+{
+    uint32_t intSave = LOS_IntLock();
+    if (g_hpmLpBusy != 0) {
+        g_hpmLpBusy--;
+    }
+    HpmLowPowerApply();
+    LOS_IntRestore(intSave);
+}
+
+void HpmLowPowerWakeSourceGet(void)
+{
+    uint32_t intSave = LOS_IntLock();
+    g_hpmLpWakeSources++;
+    HpmLowPowerApply();
+    LOS_IntRestore(intSave);
+}
+
+void HpmLowPowerWakeSourcePut(void)
+{
+    uint32_t intSave = LOS_IntLock();
+    if (g_hpmLpWakeSources != 0) {
+        g_hpmLpWakeSources--;
+    }
+    HpmLowPowerApply();
+    LOS_IntRestore(intSave);
+}
+
+#ifdef LOSCFG_KERNEL_PM
+static UINT32 HpmLowPowerSuspend(VOID)
+{
+    uint64_t start = mchtmr_get_count(HPM_MCHTMR);
+
+    __asm volatile("wfi");
+    g_hpmLpIdleCycles += mchtmr_get_count(HPM_MCHTMR) - start;
+    g_hpmLpEntries[g_hpmLpApplied]++;
+    return LOS_OK;
+}
+
+static LosPmSysctrl g_hpmLpSysctrl = {
+    .normalSuspend = HpmLowPowerSuspend,
+};
+#endif
+
+#ifdef LOSCFG_SHELL
+static const char *g_hpmLpModeNames[HPM_LP_MODE_NUM] = { "none", "wfi", "system" };
+
+static uint32_t g_hpmLpLatTicks;
+static UINT32 g_hpmLpLatSem;
+static int g_hpmLpLatInited;
+
+static __attribute__((section(".interrupt.text"))) VOID HpmLowPowerLatIsr(VOID *parm)
+{
+    (VOID)parm;
+    /* first thing: everything after this read is not part of the latency */
+    g_hpmLpLatTicks = gptmr_channel_get_counter(HPM_LP_LAT_GPTMR, HPM_LP_LAT_CH, gptmr_counter_type_normal);
+    gptmr_stop_counter(HPM_LP_LAT_GPTMR, HPM_LP_LAT_CH);
+    gptmr_clear_status(HPM_LP_LAT_GPTMR, GPTMR_CH_RLD_STAT_MASK(HPM_LP_LAT_CH));
+    LOS_SemPost(g_hpmLpLatSem);
+}
+
+static int HpmLowPowerLatInit(void)
+{
+    HwiIrqParam irqParam;
+
+    if (g_hpmLpLatInited) {
+        return 0;
+    }
+    if (LOS_SemCreate(0, &g_hpmLpLatSem) != LOS_OK) {
+        return -1;
+    }
+    irqParam.pDevId = NULL;
+    if (LOS_HwiCreate(HPM2LITEOS_IRQ(HPM_LP_LAT_GPTMR_IRQ), 1, 0, (HWI_PROC_FUNC)HpmLowPowerLatIsr,
+                      &irqParam) != LOS_OK) {
+        LOS_SemDelete(g_hpmLpLatSem);
+        return -1;
+    }
+    LOS_HwiEnable(HPM2LITEOS_IRQ(HPM_LP_LAT_GPTMR_IRQ));
+    g_hpmLpLatInited = 1;
+    return 0;
+}
+
+/* Wake latency of the current mode in GPTMR0 ticks, -1 if the timer did not fire */
+static int HpmLowPowerLatMeasure(uint32_t samples, uint32_t *minTicks, uint32_t *avgTicks, uint32_t *maxTicks)
+{
+    gptmr_channel_config_t config;
+    uint64_t total = 0;
+    int ret = 0;
+
+    HpmClockGet(HPM_LP_LAT_GPTMR_CLOCK);
+    if (HpmLowPowerLatInit() != 0) {
+        HpmClockPut(HPM_LP_LAT_GPTMR_CLOCK);
+        return -1;
+    }
+
+    gptmr_channel_get_default_config(HPM_LP_LAT_GPTMR, &config);
+    config.reload = clock_get_frequency(HPM_LP_LAT_GPTMR_CLOCK) / 1000000U * HPM_LP_LAT_PERIOD_US;
+    gptmr_channel_config(HPM_LP_LAT_GPTMR, HPM_LP_LAT_CH, &config, false);
+    gptmr_enable_irq(HPM_LP_LAT_GPTMR, GPTMR_CH_RLD_IRQ_MASK(HPM_LP_LAT_CH));
+
+    *minTicks = UINT32_MAX;
+    *maxTicks = 0;
+    for (uint32_t i = 0; i < samples; i++) {
+        gptmr_channel_reset_count(HPM_LP_LAT_GPTMR, HPM_LP_LAT_CH);
+        gptmr_start_counter(HPM_LP_LAT_GPTMR, HPM_LP_LAT_CH);
+        if (LOS_SemPend(g_hpmLpLatSem, HPM_LP_LAT_TIMEOUT_TICKS) != LOS_OK) {
+            gptmr_stop_counter(HPM_LP_LAT_GPTMR, HPM_LP_LAT_CH);
+            ret = -1;
+            break;
+        }
+        *minTicks = (g_hpmLpLatTicks < *minTicks) ? g_hpmLpLatTicks : *minTicks;
+        *maxTicks = (g_hpmLpLatTicks > *maxTicks) ? g_hpmLpLatTicks : *maxTicks;
+        total += g_hpmLpLatTicks;
+    }
+    *avgTicks = (ret == 0) ? (uint32_t)(total / samples) : 0;
+
+    gptmr_disable_irq(HPM_LP_LAT_GPTMR, GPTMR_CH_RLD_IRQ_MASK(HPM_LP_LAT_CH));
+    HpmClockPut(HPM_LP_LAT_GPTMR_CLOCK);
+    return ret;
+}
+
+static void HpmLowPowerShow(void)
+{
+    printf("mode %s, applied %s, %u busy, %u wake sources\n", g_hpmLpModeNames[g_hpmLpMode],
+           g_hpmLpModeNames[g_hpmLpApplied], g_hpmLpBusy, g_hpmLpWakeSources);
+#ifdef LOSCFG_KERNEL_PM
+    uint64_t span = mchtmr_get_count(HPM_MCHTMR) - g_hpmLpStatsSince;
+    uint32_t permille = (span == 0) ? 0 : (uint32_t)(g_hpmLpIdleCycles * 1000U / span);
+    printf("idle %u.%u%%, sleeps none %u wfi %u system %u\n", permille / 10U, permille % 10U,
+           g_hpmLpEntries[HPM_LP_MODE_NONE], g_hpmLpEntries[HPM_LP_MODE_WFI], g_hpmLpEntries[HPM_LP_MODE_SYSTEM]);
+#endif
+}
+
+static void HpmLowPowerLatShow(uint32_t samples)
+{
+    uint32_t saved = g_hpmLpMode;
+    uint32_t nsPerTick;
+    uint32_t minTicks;
+    uint32_t avgTicks;
+    uint32_t maxTicks;
+
+    HpmClockGet(HPM_LP_LAT_GPTMR_CLOCK);
+    nsPerTick = 1000000000U / clock_get_frequency(HPM_LP_LAT_GPTMR_CLOCK);
+    HpmClockPut(HPM_LP_LAT_GPTMR_CLOCK);
+
+    printf("wake latency over %u samples, %uns per tick\n", samples, nsPerTick);
+    for (uint32_t mode = 0; mode < HPM_LP_MODE_NUM; mode++) {
+        if (HpmLowPowerSetMode(mode) != 0) {
+            printf("%-6s  no wake source armed\n", g_hpmLpModeNames[mode]);
+            continue;
+        }
+        if (HpmLowPowerLatMeasure(samples, &minTicks, &avgTicks, &maxTicks) != 0) {
+            printf("%-6s  timer did not wake the CPU\n", g_hpmLpModeNames[mode]);
+            continue;
+        }
+        printf("%-6s  min/avg/max %u / %u / %u ns%s\n", g_hpmLpModeNames[mode], minTicks * nsPerTick,
+               avgTicks * nsPerTick, maxTicks * nsPerTick,
+               (g_hpmLpApplied != mode) ? " (busy, ran as wfi)" : "");
+    }
+    HpmLowPowerSetMode(saved);
+}
+
+static UINT32 HpmLowPowerCmd(UINT32 argc, const CHAR **argv)
+{
+    if (argc == 0) {
+        HpmLowPowerShow();
+        return 0;
+    }
+    if (strcmp(argv[0], "lat") == 0) {
+        uint32_t samples = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : HPM_LP_LAT_SAMPLES;
+        HpmLowPowerLatShow((samples == 0) ? HPM_LP_LAT_SAMPLES : samples);
+        return 0;
+    }
+    for (uint32_t mode = 0; mode < HPM_LP_MODE_NUM; mode++) {
+        if (strcmp(argv[0], g_hpmLpModeNames[mode]) == 0) {
+            if (HpmLowPowerSetMode(mode) != 0) {
+                printf("Err: %s needs a wake source other than MCHTMR\n", g_hpmLpModeNames[mode]);
+                return 1;
+            }
+            return 0;
+        }
+    }
+    printf("usage: lpmode [none | wfi | system | lat [samples]]\n");
+    return 1;
+}
+#endif
+
+static void HpmLowPowerInit(void)
+{
+#ifdef LOSCFG_KERNEL_PM
+    g_hpmLpStatsSince = mchtmr_get_count(HPM_MCHTMR);
+    if (LOS_PmRegister(LOS_PM_TYPE_SYSCTRL, &g_hpmLpSysctrl) != LOS_OK) {
+        printf("Err: low power hooks not registered\n");
+    }
+#endif
+#ifdef LOSCFG_SHELL
+    osCmdReg(CMD_TYPE_EX, "lpmode", XARGS, (CmdCallBackFunc)HpmLowPowerCmd);
+#endif
+}
+
+APP_SERVICE_INIT(HpmLowPowerInit);
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HPM_LOWPOWER_H
+#define _HPM_LOWPOWER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif
+#endif
+
+/*
+ * What CPU0 does in the WFI of the LiteOS idle task. The scheduler already programs MCHTMR0 for
+ * the next timer expiry, so the idle task sleeps until then or until an interrupt.
+ *  NONE:   the CPU clock keeps running, lowest wake latency, needed to attach a debugger.
+ *  WFI:    the CPU clock is gated.
+ *  SYSTEM: the whole system enters its low-power mode, as long as no driver holds a busy
+ *          reference (DMA in flight). Otherwise the same as WFI. The oscillator MCHTMR0 runs
+ *          from stops, so this needs a wake source armed through HpmLowPowerWakeSourceGet()
+ *          and the system time does not advance while asleep.
+ */
+#define HPM_LP_MODE_NONE        0
+#define HPM_LP_MODE_WFI         1
+#define HPM_LP_MODE_SYSTEM      2
+#define HPM_LP_MODE_NUM         3
+
+#define HPM_LP_MODE_DEFAULT     HPM_LP_MODE_WFI
+
+int HpmLowPowerSetMode(uint32_t mode);
+uint32_t HpmLowPowerGetMode(void);
+
+/* Held by drivers with DMA running, keeps SYSTEM down to WFI */
+void HpmLowPowerBusyGet(void);
+void HpmLowPowerBusyPut(void);
+
+/* Held by drivers with a wake source armed that runs in SYSTEM (GPIO, RTC alarm), SYSTEM needs one */
+void HpmLowPowerWakeSourceGet(void);
+void HpmLowPowerWakeSourcePut(void);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "hpm_pmp_drv.h"
+#include "hpm_pma.h"
+#ifdef LOSCFG_SHELL
+#include "ohos_init.h"
+#include "shcmd.h"
+#endif
+
+/*
+ * The PMA only matches NAPOT entries, so a region of any other size becomes several of them:
+ * from the start, each block is the largest power of two the current address is aligned to
+ * that still fits. A 40 KB region at a 32 KB boundary takes a 32 KB and an 8 KB entry, the
+ * worst case is about two entries per bit of the region size.
+ */
+
+static pmp_entry_t g_hpmPmaEntries[HPM_PMA_MAX_ENTRIES];
+static const struct HpmPmaRegion *g_hpmPmaRegions;
+static uint32_t g_hpmPmaRegionNum;
+static uint32_t g_hpmPmaEntryNum;
+
+static uint32_t HpmPmaBlockSize(uint32_t addr, uint32_t end)
+{
+    uint32_t size = HPM_PMA_GRANULE;
+
+    while (((addr & ((size << 1) - 1U)) == 0U) && (size << 1) != 0U && (addr + (size << 1) <= end)) {
+        size <<= 1;
+    }
+    return size;
+}
+
+int HpmPmaConfig(const struct HpmPmaRegion *regions, uint32_t num)
+{
+    uint32_t count = 0;
+
+    memset(g_hpmPmaEntries, 0, sizeof(g_hpmPmaEntries));
+    for (uint32_t i = 0; i < num; i++) {
+        const struct HpmPmaRegion *region = &regions[i];
+        uint32_t addr = region->start;
+
+        if (((region->start | region->end) & (HPM_PMA_GRANULE - 1U)) != 0U) {
+            printf("Err: PMA region %s 0x%08x-0x%08x is not %u aligned\n", region->name, region->start,
+                   region->end, HPM_PMA_GRANULE);
+            return -1;
+        }
+        while (addr < region->end) {
+            uint32_t size = HpmPmaBlockSize(addr, region->end);
+            if (count >= HPM_PMA_MAX_ENTRIES) {
+                printf("Err: PMA regions need more than %u entries\n", HPM_PMA_MAX_ENTRIES);
+                return -1;
+            }
+            g_hpmPmaEntries[count].pmp_addr = PMP_NAPOT_ADDR(addr, size);
+            g_hpmPmaEntries[count].pmp_cfg.val = PMP_CFG(READ_EN, WRITE_EN, EXECUTE_EN, ADDR_MATCH_NAPOT, REG_UNLOCK);
+            g_hpmPmaEntries[count].pma_addr = PMA_NAPOT_ADDR(addr, size);
+            g_hpmPmaEntries[count].pma_cfg.val = PMA_CFG(ADDR_MATCH_NAPOT, region->memType, AMO_EN);
+            count++;
+            addr += size;
+        }
+    }
+
+    g_hpmPmaRegions = regions;
+    g_hpmPmaRegionNum = num;
+    g_hpmPmaEntryNum = count;
+    if (count != 0) {
+        pmp_config(g_hpmPmaEntries, count);
+    }
+    return (int)count;
+}
+
+#ifdef LOSCFG_SHELL
+static UINT32 HpmPmaCmd(UINT32 argc, const CHAR **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    for (uint32_t i = 0; i < g_hpmPmaRegionNum; i++) {
+        const struct HpmPmaRegion *region = &g_hpmPmaRegions[i];
+        printf("%-14s 0x%08x-0x%08x %6u KB type %u\n", region->name, region->start, region->end,
+               (region->end - region->start) / 1024U, region->memType);
+    }
+    printf("%u of %u PMA entries used\n", g_hpmPmaEntryNum, HPM_PMA_MAX_ENTRIES);
+    return 0;
+}
+
+static void HpmPmaShellReg(void)
+{
+    osCmdReg(CMD_TYPE_EX, "pma", XARGS, (CmdCallBackFunc)HpmPmaCmd);
+}
+
+APP_FEATURE_INIT(HpmPmaShellReg);
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HPM_PMA_H
+#define _HPM_PMA_H
+
+#include <stdint.h>
+#include "hpm_common.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif
+#endif
+
+#define HPM_PMA_MAX_ENTRIES     16
+/* Smallest region, matches PMA_GRANULE in the linker script */
+#define HPM_PMA_GRANULE         0x1000U
+
+/* Data that is read far more than written and shared with a bus master, gets a PMA_GRANULE alone */
+#define ATTR_PLACE_AT_WRITETHROUGH ATTR_PLACE_AT(".writethrough")
+
+/* A memory range with one PMA memory type, MEM_TYPE_* of hpm_pmp_drv.h */
+struct HpmPmaRegion {
+    const char *name;
+    uint32_t start;
+    uint32_t end;
+    uint8_t memType;
+};
+
+/*
+ * Programs PMP/PMA entries for the regions, each split into naturally aligned power of two
+ * blocks. Start and end must be HPM_PMA_GRANULE aligned, empty regions are skipped.
+ * Returns the number of entries used or -1 if they do not fit.
+ */
+int HpmPmaConfig(const struct HpmPmaRegion *regions, uint32_t num);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <los_interrupt.h>
+#include <los_task.h>
+#include "hpm_clock_drv.h"
+#include "hpm_csr_drv.h"
+#include "hpm_gptmr_drv.h"
+#include "hpm_clock_mgr.h"
+#include "hpm_prof.h"
+#include "ohos_init.h"
+#ifdef LOSCFG_SHELL
+#include "shcmd.h"
+#endif
+
+/*
+ * With DISABLE_IRQ_PREEMPTIVE interrupts do not nest, so mepc in the timer ISR is the PC the
+ * sampled task (or the idle WFI) was interrupted at. GPTMR1 is used as "lpmode lat" has GPTMR0.
+ *
+ * Andes performance monitor: mhpmcounter3 counts I-cache misses and mhpmcounter4 D-cache misses,
+ * the ISR keeps the 32-bit deltas. Cores without it (mmsc_cfg.PMNDS clear) report no misses.
+ */
+
+#define HPM_PROF_GPTMR              HPM_GPTMR1
+#define HPM_PROF_GPTMR_CLOCK        clock_gptmr1
+#define HPM_PROF_GPTMR_IRQ          IRQn_GPTMR1
+#define HPM_PROF_CH                 0
+
+#define HPM_PROF_CSR_MEPC           0x341
+#define HPM_PROF_CSR_MCOUNTINHIBIT  0x320
+#define HPM_PROF_CSR_MHPMEVENT3     0x323
+#define HPM_PROF_CSR_MHPMEVENT4     0x324
+#define HPM_PROF_CSR_MHPMCOUNTER3   0xB03
+#define HPM_PROF_CSR_MHPMCOUNTER4   0xB04
+#define HPM_PROF_CSR_MINSTRET       0xB02
+#define HPM_PROF_CSR_MINSTRETH      0xB82
+#define HPM_PROF_CSR_MMSC_CFG       0xFC2
+#define HPM_PROF_MMSC_CFG_PMNDS     (1UL << 15)
+#define HPM_PROF_EVENT_ICACHE_MISS  0x31
+#define HPM_PROF_EVENT_DCACHE_MISS  0x51
+
+/* task IDs at or above this are profiled but not named in the dump */
+#define HPM_PROF_MAX_TASKS          64
+#define HPM_PROF_NAME_LEN           28
+#define HPM_PROF_FILE_MAGIC         0x464F5250U /* "PROF" */
+#define HPM_PROF_FILE_VERSION       1
+
+struct HpmProfCtx {
+    struct HpmProfSample *ring;
+    uint32_t size;
+    uint32_t head; /* samples taken, the ring holds the last size of them */
+    uint32_t hz;
+    int running;
+    int pmu;
+    uint32_t lastIcMiss;
+    uint32_t lastDcMiss;
+    uint64_t startCycles;
+    uint64_t startInstret;
+    struct HpmProfCounters counters;
+};
+
+/* File written by HpmProfSave(), little endian: header, task names, samples */
+struct HpmProfFileHdr {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t hz;
+    uint32_t num;
+    uint32_t dropped;
+    uint32_t taskNum;
+    struct HpmProfCounters counters;
+};
+
+struct HpmProfFileTask {
+    uint32_t id;
+    char name[HPM_PROF_NAME_LEN];
+};
+
+static struct HpmProfCtx g_hpmProf;
+static int g_hpmProfIrqInited;
+
+static uint64_t HpmProfInstret(void)
+{
+    uint32_t hi;
+    uint32_t lo;
+
+    do {
+        hi = read_csr(HPM_PROF_CSR_MINSTRETH);
+        lo = read_csr(HPM_PROF_CSR_MINSTRET);
+    } while (hi != read_csr(HPM_PROF_CSR_MINSTRETH));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline uint16_t HpmProfSat16(uint32_t value)
+{
+    return (value > UINT16_MAX) ? UINT16_MAX : (uint16_t)value;
+}
+
+/* Add the misses since the last call to the totals, returns them through the pointers */
+static __attribute__((section(".interrupt.text"))) void HpmProfPmuAccount(struct HpmProfCtx *ctx, uint32_t *ic,
+                                                                          uint32_t *dc)
+{
+    uint32_t icNow = read_csr(HPM_PROF_CSR_MHPMCOUNTER3);
+    uint32_t dcNow = read_csr(HPM_PROF_CSR_MHPMCOUNTER4);
+
+    *ic = icNow - ctx->lastIcMiss;
+    *dc = dcNow - ctx->lastDcMiss;
+    ctx->lastIcMiss = icNow;
+    ctx->lastDcMiss = dcNow;
+    ctx->counters.icMiss += *ic;
+    ctx->counters.dcMiss += *dc;
+}
+
+static __attribute__((section(".interrupt.text"))) VOID HpmProfIsr(VOID *parm)
+{
+    struct HpmProfCtx *ctx = &g_hpmProf;
+    struct HpmProfSample *sample = &ctx->ring[ctx->head % ctx->size];
+    uint32_t ic = 0;
+    uint32_t dc = 0;
+    (VOID)parm;
+
+    sample->pc = read_csr(HPM_PROF_CSR_MEPC);
+    gptmr_clear_status(HPM_PROF_GPTMR, GPTMR_CH_RLD_STAT_MASK(HPM_PROF_CH));
+    sample->task = (uint16_t)LOS_CurTaskIDGet();
+    if (ctx->pmu) {
+        HpmProfPmuAccount(ctx, &ic, &dc);
+    }
+    sample->icMiss = HpmProfSat16(ic);
+    sample->dcMiss = HpmProfSat16(dc);
+    sample->reserved = 0;
+    ctx->head++;
+}
+
+static int HpmProfIrqInit(void)
+{
+    HwiIrqParam irqParam;
+
+    if (g_hpmProfIrqInited) {
+        return 0;
+    }
+    irqParam.pDevId = NULL;
+    if (LOS_HwiCreate(HPM2LITEOS_IRQ(HPM_PROF_GPTMR_IRQ), 1, 0, (HWI_PROC_FUNC)HpmProfIsr, &irqParam) != LOS_OK) {
+        return -1;
+    }
+    LOS_HwiEnable(HPM2LITEOS_IRQ(HPM_PROF_GPTMR_IRQ));
+    g_hpmProfIrqInited = 1;
+    return 0;
+}
+
+static void HpmProfPmuStart(struct HpmProfCtx *ctx)
+{
+    ctx->pmu = (read_csr(HPM_PROF_CSR_MMSC_CFG) & HPM_PROF_MMSC_CFG_PMNDS) != 0;
+    if (!ctx->pmu) {
+        return;
+    }
+    write_csr(HPM_PROF_CSR_MHPMEVENT3, HPM_PROF_EVENT_ICACHE_MISS);
+    write_csr(HPM_PROF_CSR_MHPMEVENT4, HPM_PROF_EVENT_DCACHE_MISS);
+    clear_csr(HPM_PROF_CSR_MCOUNTINHIBIT, (1UL << 3) | (1UL << 4));
+    ctx->lastIcMiss = read_csr(HPM_PROF_CSR_MHPMCOUNTER3);
+    ctx->lastDcMiss = read_csr(HPM_PROF_CSR_MHPMCOUNTER4);
+}
+
+int HpmProfStart(uint32_t hz, uint32_t samples)
+{
+    struct HpmProfCtx *ctx = &g_hpmProf;
+    gptmr_channel_config_t config;
+
+    if (ctx->running || (hz == 0) || (hz > HPM_PROF_MAX_HZ) || (samples == 0) ||
+        (samples > UINT32_MAX / sizeof(struct HpmProfSample))) {
+        return -1;
+    }
+
+    free(ctx->ring);
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->ring = (struct HpmProfSample *)malloc(samples * sizeof(struct HpmProfSample));
+    if (ctx->ring == NULL) {
+        printf("Err: no memory for %u samples\n", samples);
+        return -1;
+    }
+    ctx->size = samples;
+    ctx->hz = hz;
+
+    HpmClockGet(HPM_PROF_GPTMR_CLOCK);
+    if (HpmProfIrqInit() != 0) {
+        HpmClockPut(HPM_PROF_GPTMR_CLOCK);
+        return -1;
+    }
+
+    gptmr_channel_get_default_config(HPM_PROF_GPTMR, &config);
+    config.reload = clock_get_frequency(HPM_PROF_GPTMR_CLOCK) / hz;
+    gptmr_channel_config(HPM_PROF_GPTMR, HPM_PROF_CH, &config, false);
+    gptmr_enable_irq(HPM_PROF_GPTMR, GPTMR_CH_RLD_IRQ_MASK(HPM_PROF_CH));
+
+    uint32_t intSave = LOS_IntLock();
+    HpmProfPmuStart(ctx);
+    ctx->startCycles = hpm_csr_get_core_cycle();
+    ctx->startInstret = HpmProfInstret();
+    ctx->running = 1;
+    gptmr_channel_reset_count(HPM_PROF_GPTMR, HPM_PROF_CH);
+    gptmr_start_counter(HPM_PROF_GPTMR, HPM_PROF_CH);
+    LOS_IntRestore(intSave);
+    return 0;
+}
+
+void HpmProfStop(void)
+{
+    struct HpmProfCtx *ctx = &g_hpmProf;
+    uint32_t ic;
+    uint32_t dc;
+
+    if (!ctx->running) {
+        return;
+    }
+
+    uint32_t intSave = LOS_IntLock();
+    gptmr_stop_counter(HPM_PROF_GPTMR, HPM_PROF_CH);
+    gptmr_disable_irq(HPM_PROF_GPTMR, GPTMR_CH_RLD_IRQ_MASK(HPM_PROF_CH));
+    gptmr_clear_status(HPM_PROF_GPTMR, GPTMR_CH_RLD_STAT_MASK(HPM_PROF_CH));
+    ctx->counters.cycles = hpm_csr_get_core_cycle() - ctx->startCycles;
+    ctx->counters.instret = HpmProfInstret() - ctx->startInstret;
+    if (ctx->pmu) {
+        HpmProfPmuAccount(ctx, &ic, &dc);
+    }
+    ctx->running = 0;
+    LOS_IntRestore(intSave);
+    HpmClockPut(HPM_PROF_GPTMR_CLOCK);
+}
+
+static uint32_t HpmProfNum(const struct HpmProfCtx *ctx)
+{
+    return (ctx->head < ctx->size) ? ctx->head : ctx->size;
+}
+
+/* i-th oldest sample still in the ring */
+static const struct HpmProfSample *HpmProfAt(const struct HpmProfCtx *ctx, uint32_t i)
+{
+    return &ctx->ring[(ctx->head - HpmProfNum(ctx) + i) % ctx->size];
+}
+
+/* Tasks seen in the samples, as a bitmap of IDs below HPM_PROF_MAX_TASKS */
+static uint32_t HpmProfTasks(const struct HpmProfCtx *ctx, uint32_t *seen)
+{
+    uint32_t num = 0;
+
+    memset(seen, 0, (HPM_PROF_MAX_TASKS / 32) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < HpmProfNum(ctx); i++) {
+        uint32_t task = HpmProfAt(ctx, i)->task;
+        if ((task < HPM_PROF_MAX_TASKS) && !(seen[task / 32] & (1UL << (task % 32)))) {
+            seen[task / 32] |= 1UL << (task % 32);
+            num++;
+        }
+    }
+    return num;
+}
+
+static void HpmProfTaskName(uint32_t task, char *name)
+{
+    TSK_INFO_S info;
+
+    memset(name, 0, HPM_PROF_NAME_LEN);
+    if (LOS_TaskInfoGet(task, &info) == LOS_OK) {
+        strncpy(name, info.acName, HPM_PROF_NAME_LEN - 1);
+    } else {
+        strncpy(name, "?", HPM_PROF_NAME_LEN - 1);
+    }
+}
+
+void HpmProfDump(void)
+{
+    struct HpmProfCtx *ctx = &g_hpmProf;
+    uint32_t seen[HPM_PROF_MAX_TASKS / 32];
+    char name[HPM_PROF_NAME_LEN];
+    uint32_t num = HpmProfNum(ctx);
+
+    if ((ctx->ring == NULL) || ctx->running) {
+        printf("prof: nothing to dump, stop a run first\n");
+        return;
+    }
+
+    printf("prof-begin hz=%u samples=%u dropped=%u\n", ctx->hz, num, ctx->head - num);
+    printf("prof-counters cycles=%llu instret=%llu icmiss=%llu dcmiss=%llu\n",
+           (unsigned long long)ctx->counters.cycles, (unsigned long long)ctx->counters.instret,
+           (unsigned long long)ctx->counters.icMiss, (unsigned long long)ctx->counters.dcMiss);
+    (void)HpmProfTasks(ctx, seen);
+    for (uint32_t task = 0; task < HPM_PROF_MAX_TASKS; task++) {
+        if (seen[task / 32] & (1UL << (task % 32))) {
+            HpmProfTaskName(task, name);
+            printf("prof-task %u %s\n", task, name);
+        }
+    }
+    for (uint32_t i = 0; i < num; i++) {
+        const struct HpmProfSample *sample = HpmProfAt(ctx, i);
+        printf("%08x %u %u %u\n", sample->pc, sample->task, sample->icMiss, sample->dcMiss);
+    }
+    printf("prof-end\n");
+}
+
+int HpmProfSave(const char *path)
+{
+    struct HpmProfCtx *ctx = &g_hpmProf;
+    struct HpmProfFileHdr hdr;
+    struct HpmProfFileTask entry;
+    uint32_t seen[HPM_PROF_MAX_TASKS / 32];
+    uint32_t num = HpmProfNum(ctx);
+    int ret = 0;
+    int fd;
+
+    if ((ctx->ring == NULL) || ctx->running) {
+        return -1;
+    }
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    hdr.magic = HPM_PROF_FILE_MAGIC;
+    hdr.version = HPM_PROF_FILE_VERSION;
+    hdr.hz = ctx->hz;
+    hdr.num = num;
+    hdr.dropped = ctx->head - num;
+    hdr.taskNum = HpmProfTasks(ctx, seen);
+    hdr.counters = ctx->counters;
+    if (write(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)) {
+        ret = -1;
+    }
+    for (uint32_t task = 0; (ret == 0) && (task < HPM_PROF_MAX_TASKS); task++) {
+        if (seen[task / 32] & (1UL << (task % 32))) {
+            entry.id = task;
+            HpmProfTaskName(task, entry.name);
+            ret = (write(fd, &entry, sizeof(entry)) == (ssize_t)sizeof(entry)) ? 0 : -1;
+        }
+    }
+    /* oldest first, the ring may wrap once */
+    for (uint32_t i = 0; (ret == 0) && (i < num); i++) {
+        ret = (write(fd, HpmProfAt(ctx, i), sizeof(struct HpmProfSample)) == (ssize_t)sizeof(struct HpmProfSample)) ?
+              0 : -1;
+    }
+    if (close(fd) != 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+#ifdef LOSCFG_SHELL
+static void HpmProfShow(void)
+{
+    struct HpmProfCtx *ctx = &g_hpmProf;
+    uint32_t counts[HPM_PROF_MAX_TASKS] = {0};
+    uint32_t seen[HPM_PROF_MAX_TASKS / 32];
+    char name[HPM_PROF_NAME_LEN];
+    uint32_t num = HpmProfNum(ctx);
+
+    printf("prof: %s, %u Hz, %u samples kept of %u, %s\n", ctx->running ? "running" : "stopped", ctx->hz, num,
+           ctx->head, ctx->pmu ? "cache misses counted" : "no performance monitor");
+    if (ctx->running || (num == 0)) {
+        return;
+    }
+
+    const struct HpmProfCounters *c = &ctx->counters;
+    uint64_t kinst = (c->instret / 1000U) + 1U;
+    /* the core issues two instructions per cycle, IPC may exceed 1 */
+    uint64_t ipc100 = (c->cycles == 0) ? 0 : (c->instret * 100U / c->cycles);
+    printf("cycles %llu, instructions %llu, IPC %llu.%02llu, I$ miss %llu (%llu/kinst), D$ miss %llu (%llu/kinst)\n",
+           (unsigned long long)c->cycles, (unsigned long long)c->instret,
+           (unsigned long long)(ipc100 / 100U), (unsigned long long)(ipc100 % 100U),
+           (unsigned long long)c->icMiss, (unsigned long long)(c->icMiss / kinst),
+           (unsigned long long)c->dcMiss, (unsigned long long)(c->dcMiss / kinst));
+
+    for (uint32_t i = 0; i < num; i++) {
+        uint32_t task = HpmProfAt(ctx, i)->task;
+        if (task < HPM_PROF_MAX_TASKS) {
+            counts[task]++;
+        }
+    }
+    (void)HpmProfTasks(ctx, seen);
+    for (uint32_t task = 0; task < HPM_PROF_MAX_TASKS; task++) {
+        if (seen[task / 32] & (1UL << (task % 32))) {
+            HpmProfTaskName(task, name);
+            printf("  task %2u %-20s %3u.%u%%\n", task, name, counts[task] * 100U / num,
+                   (counts[task] * 1000U / num) % 10U);
+        }
+    }
+}
+
+static UINT32 HpmProfCmd(UINT32 argc, const CHAR **argv)
+{
+    if (argc == 0) {
+        HpmProfShow();
+        return 0;
+    }
+
+    if (strcmp(argv[0], "start") == 0) {
+        uint32_t hz = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : HPM_PROF_DEFAULT_HZ;
+        uint32_t samples = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : HPM_PROF_DEFAULT_SAMPLES;
+        if (HpmProfStart(hz, samples) != 0) {
+            printf("prof: not started (running already, or hz 1..%u and samples > 0)\n", HPM_PROF_MAX_HZ);
+            return 1;
+        }
+        return 0;
+    }
+    if (strcmp(argv[0], "stop") == 0) {
+        HpmProfStop();
+        HpmProfShow();
+        return 0;
+    }
+    if (strcmp(argv[0], "dump") == 0) {
+        HpmProfDump();
+        return 0;
+    }
+    if (strcmp(argv[0], "save") == 0) {
+        const char *path = (argc > 1) ? argv[1] : HPM_PROF_DEFAULT_FILE;
+        if (HpmProfSave(path) != 0) {
+            printf("prof: saving to %s failed\n", path);
+            return 1;
+        }
+        printf("prof: saved to %s\n", path);
+        return 0;
+    }
+
+    printf("usage: prof [start [hz] [samples] | stop | dump | save [path]]\n");
+    return 1;
+}
+
+static void HpmProfShellReg(void)
+{
+    osCmdReg(CMD_TYPE_EX, "prof", XARGS, (CmdCallBackFunc)HpmProfCmd);
+}
+
+APP_FEATURE_INIT(HpmProfShellReg);
+#endif
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HPM_PROF_H
+#define _HPM_PROF_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif
+#endif
+
+/*
+ * Sampling profiler. GPTMR1 channel 0 interrupts CPU0 at the sampling rate, each interrupt
+ * records the interrupted PC, the running task and, on cores with the Andes performance
+ * monitor, the I-cache and D-cache misses since the previous sample. The samples go to a ring
+ * that keeps the newest ones. tools/prof_symbolize.py turns a "prof dump" or a "prof save"
+ * file into a flat profile or folded stacks for a flame graph.
+ */
+#define HPM_PROF_DEFAULT_HZ         997 /* not a divisor of the tick rate, so no lockstep with it */
+#define HPM_PROF_MAX_HZ             20000
+#define HPM_PROF_DEFAULT_SAMPLES    4096
+#define HPM_PROF_DEFAULT_FILE       "/data/prof.bin"
+
+struct HpmProfSample {
+    uint32_t pc;
+    uint16_t task;
+    uint16_t icMiss; /* since the previous sample, saturated */
+    uint16_t dcMiss;
+    uint16_t reserved;
+};
+
+/* Whole-run totals, the misses are 0 without the Andes performance monitor */
+struct HpmProfCounters {
+    uint64_t cycles;
+    uint64_t instret;
+    uint64_t icMiss;
+    uint64_t dcMiss;
+};
+
+int HpmProfStart(uint32_t hz, uint32_t samples);
+void HpmProfStop(void);
+
+/* Print the samples of the last run over the console, see tools/prof_symbolize.py */
+void HpmProfDump(void);
+
+/* Write the samples of the last run to a file, 0 on success */
+int HpmProfSave(const char *path);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+#endif
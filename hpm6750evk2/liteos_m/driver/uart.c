@@ -17,6 +17,8 @@
 #include "los_arch_interrupt.h"
 #include "los_interrupt.h"
 #include "riscv_hal.h"
+#include "hpm_clock_mgr.h"
+#include "hpm_dvfs.h"
 
 #ifdef __cplusplus
 #if __cplusplus
@@ -28,6 +30,7 @@ extern "C" {
 static uint8_t rx_buf[RX_BUF_SIZE];
 static uint16_t rx_index;
 static uint16_t tx_index;
+static uart_config_t g_uartConfig;
 
 INT32 UartPutc(INT32 c, VOID *file)
 {
@@ -49,6 +52,24 @@ INT32 UartGetc(VOID)
     return c;
 }
 
+/* Redo the baud divider if the UART0 source followed a CPU frequency change */
+static VOID UartDvfsNotifier(uint32_t event, uint32_t oldFreq, uint32_t newFreq, VOID *arg)
+{
+    (VOID)oldFreq;
+    (VOID)newFreq;
+    (VOID)arg;
+    uint32_t srcFreq = clock_get_frequency(clock_uart0);
+
+    /* the oscillator source used here does not move, this is for a PLL source */
+    if ((event != HPM_DVFS_POST_CHANGE) || (srcFreq == g_uartConfig.src_freq_in_hz)) {
+        return;
+    }
+    uint32_t ier = HPM_UART0->IER;
+    g_uartConfig.src_freq_in_hz = srcFreq;
+    uart_init(HPM_UART0, &g_uartConfig);
+    HPM_UART0->IER = ier;
+}
+
 VOID UartInit(VOID)
 {
     HPM_IOC->PAD[IOC_PAD_PY07].FUNC_CTL = IOC_PY07_FUNC_CTL_UART0_RXD;
@@ -57,12 +78,13 @@ VOID UartInit(VOID)
     HPM_PIOC->PAD[IOC_PAD_PY07].FUNC_CTL = IOC_PY06_FUNC_CTL_SOC_PY_06;
     HPM_PIOC->PAD[IOC_PAD_PY06].FUNC_CTL = IOC_PY07_FUNC_CTL_SOC_PY_07;
 
-    uart_config_t config = {0};
+    HpmClockGet(clock_uart0);
     clock_set_source_divider(clock_uart0, clk_src_osc24m, 1U);
-    uart_default_config(HPM_UART0, &config);
-    config.src_freq_in_hz = clock_get_frequency(clock_uart0);
-    config.baudrate = 115200;
-    uart_init(HPM_UART0, &config);  
+    uart_default_config(HPM_UART0, &g_uartConfig);
+    g_uartConfig.src_freq_in_hz = clock_get_frequency(clock_uart0);
+    g_uartConfig.baudrate = 115200;
+    uart_init(HPM_UART0, &g_uartConfig);
+    HpmDvfsRegisterNotifier(UartDvfsNotifier, NULL);
 }
 
 VOID UartReceiveHandler(VOID)
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "hpm_sysctl_drv.h"
+#include "hpm_mbx_drv.h"
+#include "hpm_l1c_drv.h"
+#include "hpm_ipc.h"
+#include "hpm_clock_mgr.h"
+#include <los_interrupt.h>
+
+#define HPM_IPC_CPU1_RUNNING    0x52554E31U /* "RUN1" */
+#define HPM_IPC_CPU1_SP         (0x80000U + 256U * 1024U) /* top of the CPU1 local DLM */
+#define HPM_IPC_CPU1_WAIT_LOOPS 1000000U
+#define HPM_IPC_FENCE()         __asm volatile("fence rw, rw" ::: "memory")
+
+struct HpmIpcCpu1Boot {
+    volatile uint32_t state;
+    void (*entry)(void *arg);
+    void *arg;
+};
+
+struct HpmIpcDoorbell {
+    void (*handler)(void *arg);
+    void *arg;
+};
+
+static ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(8) struct HpmIpcCpu1Boot g_hpmIpcCpu1Boot;
+static struct HpmIpcDoorbell g_hpmIpcDoorbells[HPM_IPC_CH_NUM];
+static int g_hpmIpcDoorbellInited;
+static int g_hpmIpcCpu1Started;
+
+static inline uint8_t *HpmIpcSlot(struct HpmIpcRing *ring, uint32_t index)
+{
+    return ring->slots + (index % ring->slotNum) * HPM_IPC_SLOT_STRIDE(ring->slotSize);
+}
+
+void HpmIpcRingInit(struct HpmIpcRing *ring, uint8_t *slots, uint32_t slotSize, uint32_t slotNum)
+{
+    ring->head = 0;
+    ring->tail = 0;
+    ring->armed = 0;
+    ring->slotSize = slotSize;
+    ring->slotNum = slotNum;
+    ring->slots = slots;
+    ring->full = 0;
+}
+
+ATTR_RAMFUNC void *HpmIpcRingAcquire(struct HpmIpcRing *ring)
+{
+    uint32_t head = ring->head;
+
+    if (head - ring->tail >= ring->slotNum) {
+        ring->full++;
+        return NULL;
+    }
+    return HpmIpcSlot(ring, head) + 4U;
+}
+
+ATTR_RAMFUNC void HpmIpcRingCommit(struct HpmIpcRing *ring, uint32_t len)
+{
+    uint32_t head = ring->head;
+
+    *(uint32_t *)HpmIpcSlot(ring, head) = len;
+    HPM_IPC_FENCE(); /* the slot is complete before the consumer can see it */
+    ring->head = head + 1U;
+}
+
+ATTR_RAMFUNC void *HpmIpcRingPeek(struct HpmIpcRing *ring, uint32_t *len)
+{
+    uint32_t tail = ring->tail;
+    uint8_t *slot = NULL;
+
+    if (tail == ring->head) {
+        return NULL;
+    }
+    HPM_IPC_FENCE(); /* head is read before the slot it covers */
+    slot = HpmIpcSlot(ring, tail);
+    *len = *(uint32_t *)slot;
+    return slot + 4U;
+}
+
+ATTR_RAMFUNC void HpmIpcRingRelease(struct HpmIpcRing *ring)
+{
+    HPM_IPC_FENCE(); /* done with the slot before the producer may reuse it */
+    ring->tail = ring->tail + 1U;
+}
+
+ATTR_RAMFUNC int HpmIpcRingSend(struct HpmIpcRing *ring, const void *data, uint32_t len)
+{
+    void *slot = NULL;
+
+    if (len > ring->slotSize) {
+        return -1;
+    }
+    slot = HpmIpcRingAcquire(ring);
+    if (slot == NULL) {
+        return -1;
+    }
+    memcpy(slot, data, len);
+    HpmIpcRingCommit(ring, len);
+    return 0;
+}
+
+ATTR_RAMFUNC int HpmIpcRingRecv(struct HpmIpcRing *ring, void *data, uint32_t *len)
+{
+    uint32_t slotLen = 0;
+    void *slot = HpmIpcRingPeek(ring, &slotLen);
+
+    if ((slot == NULL) || (slotLen > *len)) {
+        return -1;
+    }
+    memcpy(data, slot, slotLen);
+    *len = slotLen;
+    HpmIpcRingRelease(ring);
+    return 0;
+}
+
+ATTR_RAMFUNC int HpmIpcRingNotify(struct HpmIpcRing *ring, uint32_t channel)
+{
+    HPM_IPC_FENCE();
+    if (!ring->armed || (ring->head == ring->tail)) {
+        return 0;
+    }
+
+    ring->armed = 0;
+    if (mbx_send_message(HPM_MBX0B, channel) != status_success) {
+        /* mailbox FIFO full: stay armed so the next commit tries again */
+        ring->armed = 1;
+        return 0;
+    }
+    return 1;
+}
+
+int HpmIpcRingArm(struct HpmIpcRing *ring)
+{
+    ring->armed = 1;
+    HPM_IPC_FENCE();
+    /* a slot committed before the producer saw armed would not ring, report it now */
+    return ring->head != ring->tail;
+}
+
+static __attribute__((section(".interrupt.text"))) VOID HpmIpcMbxIsr(VOID *parm)
+{
+    uint32_t msg;
+    (VOID)parm;
+
+    while (mbx_retrieve_message(HPM_MBX0A, &msg) == status_success) {
+        if ((msg < HPM_IPC_CH_NUM) && (g_hpmIpcDoorbells[msg].handler != NULL)) {
+            g_hpmIpcDoorbells[msg].handler(g_hpmIpcDoorbells[msg].arg);
+        }
+    }
+}
+
+int HpmIpcDoorbellRegister(uint32_t channel, void (*handler)(void *arg), void *arg)
+{
+    if (channel >= HPM_IPC_CH_NUM) {
+        return -1;
+    }
+
+    uint32_t intSave = LOS_IntLock();
+    g_hpmIpcDoorbells[channel].handler = handler;
+    g_hpmIpcDoorbells[channel].arg = arg;
+    LOS_IntRestore(intSave);
+
+    if (!g_hpmIpcDoorbellInited) {
+        HwiIrqParam irqParam;
+        irqParam.pDevId = NULL;
+        g_hpmIpcDoorbellInited = 1;
+        HpmClockGet(clock_mbx0);
+        mbx_init(HPM_MBX0A);
+        LOS_HwiCreate(HPM2LITEOS_IRQ(IRQn_MBX0A), 1, 0, (HWI_PROC_FUNC)HpmIpcMbxIsr, &irqParam);
+        mbx_enable_intr(HPM_MBX0A, MBX_CR_RWMVIE_MASK);
+        LOS_HwiEnable(HPM2LITEOS_IRQ(IRQn_MBX0A));
+    }
+    return 0;
+}
+
+/* only referenced from the entry stub below */
+ATTR_RAMFUNC __attribute__((used)) static void HpmIpcCpu1Main(void)
+{
+    struct HpmIpcCpu1Boot *boot = &g_hpmIpcCpu1Boot;
+
+    l1c_ic_enable();
+    mbx_init(HPM_MBX0B);
+    boot->state = HPM_IPC_CPU1_RUNNING;
+    boot->entry(boot->arg);
+    while (1) {
+    }
+}
+
+/* CPU1 reset entry: no interrupts, own stack in its DLM, same gp as CPU0 */
+ATTR_RAMFUNC __attribute__((naked)) static void HpmIpcCpu1Entry(void)
+{
+    __asm volatile(
+        "csrw mie, zero\n"
+        ".option push\n"
+        ".option norelax\n"
+        "la gp, __global_pointer$\n"
+        ".option pop\n"
+        "li sp, %0\n"
+        "j HpmIpcCpu1Main\n"
+        :: "i"(HPM_IPC_CPU1_SP));
+}
+
+int HpmIpcCpu1Start(void (*entry)(void *arg), void *arg)
+{
+    struct HpmIpcCpu1Boot *boot = &g_hpmIpcCpu1Boot;
+
+    uint32_t intSave = LOS_IntLock();
+    if (g_hpmIpcCpu1Started) {
+        LOS_IntRestore(intSave);
+        printf("Err: CPU1 is already running a program\n");
+        return -1;
+    }
+    g_hpmIpcCpu1Started = 1;
+    LOS_IntRestore(intSave);
+
+    /* CPU1 runs from its own local memory, its clock sits in group 0 like the rest */
+    HpmClockGet(clock_lmm1);
+    boot->state = 0;
+    boot->entry = entry;
+    boot->arg = arg;
+
+    /* CPU1 fetches .fast from memory, not from the CPU0 data cache */
+    l1c_dc_writeback_all();
+    sysctl_set_cpu_entry(HPM_SYSCTL, 1, (uint32_t)HpmIpcCpu1Entry);
+    sysctl_release_cpu1(HPM_SYSCTL);
+
+    for (uint32_t i = 0; (i < HPM_IPC_CPU1_WAIT_LOOPS) && (boot->state != HPM_IPC_CPU1_RUNNING); i++) {
+    }
+    if (boot->state != HPM_IPC_CPU1_RUNNING) {
+        printf("Err: CPU1 did not start\n");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HPM_IPC_H
+#define HPM_IPC_H
+
+#include <stdint.h>
+#include "hpm_common.h"
+
+/*
+ * Inter-core IPC for the HPM6750 dual core.
+ *
+ * HpmIpcRing is a single producer, single consumer ring of fixed-size slots. The ring header and
+ * its slots must be in noncacheable memory (HPM_IPC_RING_DEFINE). Slots are handed over without
+ * copying: the producer fills the slot it acquired and commits it, the consumer peeks at it and
+ * releases it. The ring functions are in RAM and use no OS services, so bare-metal code on CPU1
+ * can call them.
+ *
+ * Doorbells go from CPU1 to CPU0 through MBX0B -> MBX0A and carry the channel number. The
+ * consumer arms its ring before it sleeps and the producer rings at most once per arming, so a
+ * burst of slots costs one interrupt. CPU1 runs without interrupts and polls its rings.
+ */
+
+#define HPM_IPC_CH_ENET_RX      0
+#define HPM_IPC_CH_BENCH        1
+#define HPM_IPC_CH_NUM          4
+
+struct HpmIpcRing {
+    volatile uint32_t head; /* written by the producer only */
+    volatile uint32_t tail; /* written by the consumer only */
+    volatile uint32_t armed; /* the consumer waits for a doorbell */
+    uint32_t slotSize; /* payload bytes per slot */
+    uint32_t slotNum;
+    uint8_t *slots;
+    volatile uint32_t full; /* acquire attempts on a full ring */
+};
+
+/* Each slot is a length word followed by the payload, kept word aligned */
+#define HPM_IPC_SLOT_STRIDE(slotSize) (4U + (((slotSize) + 3U) & ~3U))
+
+#define HPM_IPC_RING_DEFINE(name, slotSize, slotNum) \
+    static ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(8) \
+    uint8_t name##Slots[(slotNum) * HPM_IPC_SLOT_STRIDE(slotSize)]; \
+    static ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(8) struct HpmIpcRing name
+
+/* Set up an empty ring; done by CPU0 before the other side uses it */
+void HpmIpcRingInit(struct HpmIpcRing *ring, uint8_t *slots, uint32_t slotSize, uint32_t slotNum);
+
+/* Producer: slot to fill, NULL if the ring is full; then commit it with the bytes written */
+void *HpmIpcRingAcquire(struct HpmIpcRing *ring);
+void HpmIpcRingCommit(struct HpmIpcRing *ring, uint32_t len);
+
+/* Consumer: oldest slot and its length, NULL if the ring is empty; then release it */
+void *HpmIpcRingPeek(struct HpmIpcRing *ring, uint32_t *len);
+void HpmIpcRingRelease(struct HpmIpcRing *ring);
+
+/* Copying wrappers, return 0 on success, -1 if the ring is full/empty or len does not fit */
+int HpmIpcRingSend(struct HpmIpcRing *ring, const void *data, uint32_t len);
+int HpmIpcRingRecv(struct HpmIpcRing *ring, void *data, uint32_t *len);
+
+/* Producer side: ring the consumer's doorbell if it asked for one; returns 1 if it rang */
+int HpmIpcRingNotify(struct HpmIpcRing *ring, uint32_t channel);
+
+/* Consumer side, before sleeping: ask for a doorbell; non-zero if slots arrived meanwhile */
+int HpmIpcRingArm(struct HpmIpcRing *ring);
+
+static inline uint32_t HpmIpcRingCount(const struct HpmIpcRing *ring)
+{
+    return ring->head - ring->tail;
+}
+
+/* CPU0: run handler(arg) from the mailbox interrupt for doorbells on channel */
+int HpmIpcDoorbellRegister(uint32_t channel, void (*handler)(void *arg), void *arg);
+
+/*
+ * CPU0: release CPU1 into entry(arg). CPU1 gets interrupts off, its data cache off, the instruction
+ * cache on and a stack at the top of its DLM; entry must not return. Only one program can run on
+ * CPU1, returns -1 if it is taken or CPU1 did not come up.
+ */
+int HpmIpcCpu1Start(void (*entry)(void *arg), void *arg);
+
+#endif
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hpm_clock_drv.h"
+#include "hpm_mchtmr_drv.h"
+#include "hpm_ipc.h"
+#include "ohos_init.h"
+#include <los_sem.h>
+#include "shcmd.h"
+
+/*
+ * Shell command, built with LOSCFG_SHELL only: ipcbench [iterations] [size]
+ *
+ * CPU1 runs an echo loop: every slot of the request ring is copied to the response ring. CPU0
+ * measures the round trip of single messages with busy polling and with the doorbell interrupt
+ * waking a task, then streams messages with the ring kept full to get the throughput. Times are
+ * MCHTMR0 ticks at a fixed 24 MHz, the DVFS governor may change the CPU clock during a run.
+ */
+
+#define HPM_IPC_BENCH_SLOT_SIZE     256
+#define HPM_IPC_BENCH_SLOT_NUM      16
+#define HPM_IPC_BENCH_ITERATIONS    1000
+#define HPM_IPC_BENCH_SEM_TIMEOUT   100
+
+HPM_IPC_RING_DEFINE(g_hpmIpcBenchReq, HPM_IPC_BENCH_SLOT_SIZE, HPM_IPC_BENCH_SLOT_NUM);
+HPM_IPC_RING_DEFINE(g_hpmIpcBenchRsp, HPM_IPC_BENCH_SLOT_SIZE, HPM_IPC_BENCH_SLOT_NUM);
+
+static UINT32 g_hpmIpcBenchSem;
+static int g_hpmIpcBenchStarted;
+
+struct HpmIpcBenchResult {
+    uint64_t minTicks;
+    uint64_t maxTicks;
+    uint64_t totalTicks;
+};
+
+ATTR_RAMFUNC static void HpmIpcBenchEcho(void *arg)
+{
+    (void)arg;
+
+    while (1) {
+        uint32_t len = 0;
+        void *req = HpmIpcRingPeek(&g_hpmIpcBenchReq, &len);
+        if (req == NULL) {
+            continue;
+        }
+
+        void *rsp = NULL;
+        while ((rsp = HpmIpcRingAcquire(&g_hpmIpcBenchRsp)) == NULL) {
+        }
+        memcpy(rsp, req, len);
+        HpmIpcRingCommit(&g_hpmIpcBenchRsp, len);
+        HpmIpcRingRelease(&g_hpmIpcBenchReq);
+        HpmIpcRingNotify(&g_hpmIpcBenchRsp, HPM_IPC_CH_BENCH);
+    }
+}
+
+static void HpmIpcBenchDoorbell(void *arg)
+{
+    (void)arg;
+    LOS_SemPost(g_hpmIpcBenchSem);
+}
+
+static int HpmIpcBenchStart(void)
+{
+    if (g_hpmIpcBenchStarted) {
+        return 0;
+    }
+
+    HpmIpcRingInit(&g_hpmIpcBenchReq, g_hpmIpcBenchReqSlots, HPM_IPC_BENCH_SLOT_SIZE, HPM_IPC_BENCH_SLOT_NUM);
+    HpmIpcRingInit(&g_hpmIpcBenchRsp, g_hpmIpcBenchRspSlots, HPM_IPC_BENCH_SLOT_SIZE, HPM_IPC_BENCH_SLOT_NUM);
+    /* fails if CPU1 already runs something else, e.g. the network offload */
+    if (HpmIpcCpu1Start(HpmIpcBenchEcho, NULL) != 0) {
+        return -1;
+    }
+    if (LOS_SemCreate(0, &g_hpmIpcBenchSem) != LOS_OK) {
+        return -1;
+    }
+    HpmIpcDoorbellRegister(HPM_IPC_CH_BENCH, HpmIpcBenchDoorbell, NULL);
+    g_hpmIpcBenchStarted = 1;
+    return 0;
+}
+
+static void HpmIpcBenchAccount(struct HpmIpcBenchResult *res, uint64_t ticks)
+{
+    res->minTicks = (ticks < res->minTicks) ? ticks : res->minTicks;
+    res->maxTicks = (ticks > res->maxTicks) ? ticks : res->maxTicks;
+    res->totalTicks += ticks;
+}
+
+/* One message there and back per iteration, either spinning on the ring or sleeping on the doorbell */
+static int HpmIpcBenchPingPong(uint8_t *buf, uint32_t size, uint32_t iterations, int useDoorbell,
+                               struct HpmIpcBenchResult *res)
+{
+    uint32_t len;
+
+    memset(res, 0, sizeof(*res));
+    res->minTicks = UINT64_MAX;
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint64_t start = mchtmr_get_count(HPM_MCHTMR);
+
+        if (useDoorbell) {
+            (void)HpmIpcRingArm(&g_hpmIpcBenchRsp);
+        }
+        if (HpmIpcRingSend(&g_hpmIpcBenchReq, buf, size) != 0) {
+            return -1;
+        }
+        if (useDoorbell) {
+            while (HpmIpcRingCount(&g_hpmIpcBenchRsp) == 0) {
+                if (LOS_SemPend(g_hpmIpcBenchSem, HPM_IPC_BENCH_SEM_TIMEOUT) != LOS_OK) {
+                    return -1;
+                }
+            }
+        }
+        do {
+            len = size;
+        } while (HpmIpcRingRecv(&g_hpmIpcBenchRsp, buf, &len) != 0);
+
+        HpmIpcBenchAccount(res, mchtmr_get_count(HPM_MCHTMR) - start);
+    }
+
+    /* drop a doorbell that raced with the last reply */
+    while (LOS_SemPend(g_hpmIpcBenchSem, 0) == LOS_OK) {
+    }
+    return 0;
+}
+
+/* Keep the request ring full and drain replies as they come, returns the MCHTMR0 ticks taken */
+static uint64_t HpmIpcBenchStream(uint8_t *buf, uint32_t size, uint32_t iterations)
+{
+    uint64_t start = mchtmr_get_count(HPM_MCHTMR);
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    uint32_t len;
+
+    while (received < iterations) {
+        while ((sent < iterations) && (HpmIpcRingSend(&g_hpmIpcBenchReq, buf, size) == 0)) {
+            sent++;
+        }
+        len = size;
+        while (HpmIpcRingRecv(&g_hpmIpcBenchRsp, buf, &len) == 0) {
+            received++;
+            len = size;
+        }
+    }
+    return mchtmr_get_count(HPM_MCHTMR) - start;
+}
+
+static void HpmIpcBenchPrint(const char *name, const struct HpmIpcBenchResult *res, uint32_t iterations,
+                             uint32_t ticksPerUs)
+{
+    uint64_t avg = res->totalTicks / iterations;
+
+    printf("%-10s round trip min/avg/max: %llu / %llu / %llu ns\n", name,
+           (unsigned long long)(res->minTicks * 1000U / ticksPerUs), (unsigned long long)(avg * 1000U / ticksPerUs),
+           (unsigned long long)(res->maxTicks * 1000U / ticksPerUs));
+}
+
+static UINT32 HpmIpcBenchCmd(UINT32 argc, const CHAR **argv)
+{
+    uint32_t iterations = (argc > 0) ? (uint32_t)strtoul(argv[0], NULL, 0) : HPM_IPC_BENCH_ITERATIONS;
+    uint32_t size = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 64U;
+    uint32_t ticksPerUs = clock_get_frequency(clock_mchtmr0) / 1000000U;
+    struct HpmIpcBenchResult res;
+    static uint8_t buf[HPM_IPC_BENCH_SLOT_SIZE];
+
+    if ((iterations == 0) || (size == 0) || (size > HPM_IPC_BENCH_SLOT_SIZE)) {
+        printf("usage: ipcbench [iterations] [size <= %u]\n", HPM_IPC_BENCH_SLOT_SIZE);
+        return 1;
+    }
+    if (HpmIpcBenchStart() != 0) {
+        printf("ipcbench: CPU1 echo loop not available\n");
+        return 1;
+    }
+
+    printf("ipcbench: %u messages of %u bytes, %u slots\n", iterations, size, HPM_IPC_BENCH_SLOT_NUM);
+    if (HpmIpcBenchPingPong(buf, size, iterations, 0, &res) == 0) {
+        HpmIpcBenchPrint("polled", &res, iterations, ticksPerUs);
+    }
+    if (HpmIpcBenchPingPong(buf, size, iterations, 1, &res) == 0) {
+        HpmIpcBenchPrint("doorbell", &res, iterations, ticksPerUs);
+    } else {
+        printf("doorbell   timed out\n");
+    }
+
+    uint64_t us = HpmIpcBenchStream(buf, size, iterations) / ticksPerUs;
+    if (us != 0) {
+        printf("streaming  %llu messages/s, %llu KB/s each way\n", (unsigned long long)iterations * 1000000U / us,
+               (unsigned long long)iterations * size * 1000000U / us / 1024U);
+    }
+    printf("ring full  req %u rsp %u\n", g_hpmIpcBenchReq.full, g_hpmIpcBenchRsp.full);
+    return 0;
+}
+
+static void HpmIpcBenchShellReg(void)
+{
+    osCmdReg(CMD_TYPE_EX, "ipcbench", XARGS, (CmdCallBackFunc)HpmIpcBenchCmd);
+}
+
+APP_FEATURE_INIT(HpmIpcBenchShellReg);
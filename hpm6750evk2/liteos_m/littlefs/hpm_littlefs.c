@@ -19,11 +19,28 @@
 #include "hpm_littlefs_drv.h"
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mount.h>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <los_fs.h>
+#include <los_mux.h>
+#include "hpm_littlefs.h"
 
+/*
+ * Partition table. Each partition carries its own littlefs tuning, a value left as 0 is
+ * derived from the flash geometry in HpmLittlefsDriverInit().
+ *  /data: general purpose, mounted at boot.
+ *  /cfg:  read-mostly configuration, two-sector blocks and a whole-block cache so a lookup
+ *         is served from RAM, mounted on demand.
+ *  /log:  high churn appends, one-page cache for small writes and a high blockCycles so
+ *         metadata is not relocated on every few erases, mounted on demand.
+ * /data and /log have free blocks erased ahead of time by the idle worker.
+ * The VFS knows nothing of an on-demand partition until HpmLittlefsMount() or HpmLittlefsOpen()
+ * mounts it, a plain open() of a path on it fails before that.
+ */
 struct HpmLittlefsCfg g_hpmLittlefsCfgs[] = {
     [0] = {
         .cfg = {
@@ -34,14 +51,15 @@ struct HpmLittlefsCfg g_hpmLittlefsCfgs[] = {
             /* partition low-level erase func */
             .eraseFunc = HpmLittlefsErase,
 
-            .readSize = 16,
-            .writeSize = 16,
+            /* 0 means derived from the flash geometry in HpmLittlefsDriverInit() */
+            .readSize = 0,
+            .writeSize = 0,
             .blockSize = 0, /* auto fill in HpmLittlefsDriverInit() */
             .blockCount = 0, /* auto fill in HpmLittlefsDriverInit() */
-            .cacheSize = 1024,
+            .cacheSize = 0,
 
             .partNo = 0,
-            .lookaheadSize = 16,
+            .lookaheadSize = 0,
             .blockCycles = 1000,
         },
         .ctx = {
@@ -49,15 +67,231 @@ struct HpmLittlefsCfg g_hpmLittlefsCfgs[] = {
             .len = 2 * 1024 * 1024,
             .base = HPM_XPI0_BASE,
             .mountPoint = "/data",
+            .preErase = 1,
+        }
+    },
+    [1] = {
+        .cfg = {
+            .readFunc = HpmLittlefsRead,
+            .writeFunc = HpmLittlefsProg,
+            .eraseFunc = HpmLittlefsErase,
+
+            .readSize = 0,
+            .writeSize = 0,
+            .blockSize = 8 * 1024,
+            .blockCount = 0, /* auto fill in HpmLittlefsDriverInit() */
+            .cacheSize = 8 * 1024,
+
+            .partNo = 1,
+            .lookaheadSize = 0,
+            .blockCycles = 1000,
+        },
+        .ctx = {
+            .startOffset = 7 * 1024 * 1024,
+            .len = 256 * 1024,
+            .base = HPM_XPI0_BASE,
+            .mountPoint = "/cfg",
+            .mountOnDemand = 1,
+        }
+    },
+    [2] = {
+        .cfg = {
+            .readFunc = HpmLittlefsRead,
+            .writeFunc = HpmLittlefsProg,
+            .eraseFunc = HpmLittlefsErase,
+
+            .readSize = 0,
+            .writeSize = 0,
+            .blockSize = 0, /* auto fill in HpmLittlefsDriverInit() */
+            .blockCount = 0, /* auto fill in HpmLittlefsDriverInit() */
+            .cacheSize = 256,
+
+            .partNo = 2,
+            .lookaheadSize = 0,
+            .blockCycles = 5000,
+        },
+        .ctx = {
+            .startOffset = 7 * 1024 * 1024 + 256 * 1024,
+            .len = 1024 * 1024,
+            .base = HPM_XPI0_BASE,
+            .mountPoint = "/log",
+            .mountOnDemand = 1,
+            .preErase = 1,
         }
     },
 };
 
-void HpmLittlefsInit(void)
+#define HPM_LFS_PART_NUM (sizeof(g_hpmLittlefsCfgs) / sizeof(g_hpmLittlefsCfgs[0]))
+
+const uint32_t g_hpmLittlefsPartNum = HPM_LFS_PART_NUM;
+
+/* Serializes mount state changes and wear file updates */
+UINT32 g_hpmLittlefsMux;
+
+#define HPM_LFS_MAX_TRACKED_FDS 16
+
+/* Files opened through HpmLittlefsOpen(), so HpmLittlefsWrite() knows which partition to charge */
+static struct {
+    int fd;
+    struct HpmLittlefsCfg *part; /* NULL for a free slot */
+} g_hpmLittlefsFds[HPM_LFS_MAX_TRACKED_FDS];
+
+static int HpmLittlefsMountPart(struct HpmLittlefsCfg *part)
+{
+    struct HpmLittleCtx *ctx = &part->ctx;
+    int ret;
+
+    if (ctx->isMounted) {
+        return 0;
+    }
+
+    HpmLittlefsDriverInit(part);
+    ret = mount(NULL, ctx->mountPoint, "littlefs", 0, &part->cfg);
+    if (ret < 0) {
+        printf("Err: hpm littlefs [%s] mount failed!!!\n", ctx->mountPoint);
+        return -1;
+    }
+
+    DIR *dir = NULL;
+    if ((dir = opendir(ctx->mountPoint)) == NULL) {
+        ret = mkdir(ctx->mountPoint, S_IRUSR | S_IWUSR);
+        if (ret) {
+            printf("Err: hpm littlefs mkdir [%s] mount failed!!!\n", ctx->mountPoint);
+            return -1;
+        }
+    } else {
+        closedir(dir);
+    }
+
+    /* the allocator view of the idle worker starts over with every mount */
+    ctx->usedGen = ctx->writeGen - 1U;
+    ctx->isMounted = 1;
+
+    if (!ctx->wearLoaded) {
+        HpmLittlefsWearLoad(part);
+    }
+    return 0;
+}
+
+static struct HpmLittlefsCfg *HpmLittlefsFindPart(const char *path)
+{
+    for (int i = 0; i < HPM_LFS_PART_NUM; i++) {
+        const char *mountPoint = g_hpmLittlefsCfgs[i].ctx.mountPoint;
+        size_t len = strlen(mountPoint);
+        if ((strncmp(path, mountPoint, len) == 0) && ((path[len] == '\0') || (path[len] == '/'))) {
+            return &g_hpmLittlefsCfgs[i];
+        }
+    }
+    return NULL;
+}
+
+int HpmLittlefsMount(const char *path)
 {
-    uint32_t num = sizeof(g_hpmLittlefsCfgs) / sizeof(g_hpmLittlefsCfgs[0]);
+    struct HpmLittlefsCfg *part = HpmLittlefsFindPart(path);
     int ret;
 
+    if (part == NULL) {
+        return -1;
+    }
+    if (part->ctx.isMounted) {
+        return 0;
+    }
+
+    LOS_MuxPend(g_hpmLittlefsMux, LOS_WAIT_FOREVER);
+    ret = HpmLittlefsMountPart(part);
+    LOS_MuxPost(g_hpmLittlefsMux);
+    return ret;
+}
+
+int HpmLittlefsUnmount(const char *mountPoint)
+{
+    struct HpmLittlefsCfg *part = HpmLittlefsFindPart(mountPoint);
+    int ret = 0;
+
+    if (part == NULL) {
+        return -1;
+    }
+
+    LOS_MuxPend(g_hpmLittlefsMux, LOS_WAIT_FOREVER);
+    if (part->ctx.isMounted) {
+        if (part->ctx.unsavedErases != 0) {
+            (void)HpmLittlefsWearSave(part);
+        }
+        ret = umount(part->ctx.mountPoint);
+        if (ret == 0) {
+            part->ctx.isMounted = 0;
+        }
+    }
+    LOS_MuxPost(g_hpmLittlefsMux);
+    return ret;
+}
+
+int HpmLittlefsOpen(const char *path, int oflag, mode_t mode)
+{
+    struct HpmLittlefsCfg *part = HpmLittlefsFindPart(path);
+    int fd;
+
+    if ((part == NULL) || (HpmLittlefsMount(path) != 0)) {
+        return -1;
+    }
+
+    fd = open(path, oflag, mode);
+    if (fd < 0) {
+        return fd;
+    }
+
+    /* an untracked file still works, its writes are just not counted */
+    uint32_t intSave = LOS_IntLock();
+    for (int i = 0; i < HPM_LFS_MAX_TRACKED_FDS; i++) {
+        if (g_hpmLittlefsFds[i].part == NULL) {
+            g_hpmLittlefsFds[i].fd = fd;
+            g_hpmLittlefsFds[i].part = part;
+            break;
+        }
+    }
+    LOS_IntRestore(intSave);
+    return fd;
+}
+
+static struct HpmLittlefsCfg *HpmLittlefsFdPart(int fd, int release)
+{
+    struct HpmLittlefsCfg *part = NULL;
+
+    uint32_t intSave = LOS_IntLock();
+    for (int i = 0; i < HPM_LFS_MAX_TRACKED_FDS; i++) {
+        if ((g_hpmLittlefsFds[i].part != NULL) && (g_hpmLittlefsFds[i].fd == fd)) {
+            part = g_hpmLittlefsFds[i].part;
+            if (release) {
+                g_hpmLittlefsFds[i].part = NULL;
+            }
+            break;
+        }
+    }
+    LOS_IntRestore(intSave);
+    return part;
+}
+
+ssize_t HpmLittlefsWrite(int fd, const void *buf, size_t len)
+{
+    ssize_t ret = write(fd, buf, len);
+    struct HpmLittlefsCfg *part = HpmLittlefsFdPart(fd, 0);
+
+    if ((ret > 0) && (part != NULL)) {
+        part->ctx.appBytes += (uint64_t)ret;
+    }
+    return ret;
+}
+
+int HpmLittlefsClose(int fd)
+{
+    (void)HpmLittlefsFdPart(fd, 1);
+    return close(fd);
+}
+
+void HpmLittlefsInit(void)
+{
+    uint32_t num = HPM_LFS_PART_NUM;
+
     int *lengthArray = (int *)malloc(num * sizeof(int) * 2);
     int *addrArray = lengthArray + num;
 
@@ -69,24 +303,18 @@ void HpmLittlefsInit(void)
     LOS_DiskPartition("spiflash", "littlefs", lengthArray, addrArray, num);
     free(lengthArray);
 
-    for (int i = 0; i < num; i++) {
-        HpmLittlefsDriverInit(&g_hpmLittlefsCfgs[i]);
-        ret = mount(NULL, g_hpmLittlefsCfgs[i].ctx.mountPoint, "littlefs", 0, &g_hpmLittlefsCfgs[i].cfg);
-        if (ret < 0) {
-            printf("Err: hpm littlefs [%s] mount failed!!!\n", g_hpmLittlefsCfgs[i].ctx.mountPoint);
-            continue;
-        }
+    if (g_hpmLittlefsMux == 0) {
+        LOS_MuxCreate(&g_hpmLittlefsMux);
+    }
 
-        DIR *dir = NULL;
-        if ((dir = opendir(g_hpmLittlefsCfgs[i].ctx.mountPoint)) == NULL) {
-            ret = mkdir(g_hpmLittlefsCfgs[i].ctx.mountPoint, S_IRUSR | S_IWUSR);
-            if (ret) {
-                printf("Err: hpm littlefs mkdir [%s] mount failed!!!\n", g_hpmLittlefsCfgs[i].ctx.mountPoint);
-                continue;
-            }
-        } else {
-            closedir(dir);
+    /* partitions marked mountOnDemand cost nothing at boot, their users mount them, see hpm_littlefs.h */
+    for (int i = 0; i < num; i++) {
+        if (!g_hpmLittlefsCfgs[i].ctx.mountOnDemand) {
+            HpmLittlefsMountPart(&g_hpmLittlefsCfgs[i]);
         }
     }
-}
 
+    HpmLittlefsIdleStart();
+    HpmLittlefsWearShellReg();
+    HPM_LFS_BOOT_MARK("littlefs");
+}
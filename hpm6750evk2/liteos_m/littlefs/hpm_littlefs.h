@@ -15,6 +15,53 @@
 #ifndef HPM_LITTLEFS_H
 #define HPM_LITTLEFS_H
 
+#include <stdint.h>
+#include <sys/types.h>
+
 void HpmLittlefsInit(void);
 
+/*
+ * Make sure the partition holding path is mounted, mounting it on first use.
+ * Returns 0 on success, -1 if no partition covers path or the mount failed.
+ * The VFS does not mount an on-demand partition (/cfg, /log) by itself: code going through
+ * open()/opendir()/stat() calls this first, or opens its files with HpmLittlefsOpen().
+ */
+int HpmLittlefsMount(const char *path);
+
+/* Unmount an on-demand partition again, e.g. to give its caches back */
+int HpmLittlefsUnmount(const char *mountPoint);
+
+/* Start the lowest priority worker doing background maintenance such as pre-erasing free blocks */
+void HpmLittlefsIdleStart(void);
+
+/* One unit of background work, returns non-zero if anything was done; the worker loops on it */
+int HpmLittlefsIdleStep(void);
+
+/*
+ * open/write/close for files on the littlefs partitions. Open mounts an on-demand partition first,
+ * write counts the bytes towards the write amplification reported by HpmLittlefsWearGet().
+ */
+int HpmLittlefsOpen(const char *path, int oflag, mode_t mode);
+ssize_t HpmLittlefsWrite(int fd, const void *buf, size_t len);
+int HpmLittlefsClose(int fd);
+
+#define HPM_LFS_WEAR_HIST_BUCKETS 8
+
+struct HpmLittlefsWearStats {
+    uint32_t blockCount;
+    uint32_t minErases;
+    uint32_t maxErases;
+    uint32_t avgErases;
+    uint64_t totalErases; /* Lifetime, all blocks */
+    uint32_t bootErases; /* Since boot, all blocks */
+    uint32_t bucketWidth; /* hist[i] counts blocks with i * bucketWidth ... (i + 1) * bucketWidth - 1 erases */
+    uint32_t hist[HPM_LFS_WEAR_HIST_BUCKETS];
+    uint64_t progBytes; /* Lifetime bytes programmed to flash */
+    uint64_t appBytes; /* Lifetime bytes written through HpmLittlefsWrite() */
+    uint32_t lifetimeHours; /* Until the most worn block reaches the rated endurance, UINT32_MAX if unknown */
+};
+
+/* Erase count summary of the partition mounted at mountPoint, 0 on success */
+int HpmLittlefsWearGet(const char *mountPoint, struct HpmLittlefsWearStats *stats);
+
 #endif
@@ -15,6 +15,8 @@
 
 #include <hpm_clock_drv.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <los_interrupt.h>
 #include "hpm_littlefs_drv.h"
 #include "hpm_csr_regs.h"
@@ -25,13 +27,13 @@ extern struct HpmLittlefsCfg g_hpmLittlefsCfgs[];
 int HpmLittlefsRead(int partition, UINT32 *offset, void *buf, UINT32 size)
 {
     struct HpmLittleCtx *ctx = &g_hpmLittlefsCfgs[partition].ctx;
-    XPI_Type *base = (XPI_Type *)ctx->base;
+    XPI_Type *base = (XPI_Type *)(uintptr_t)ctx->base;
     uint32_t chipOffset = *offset;
 
     uint32_t intSave = LOS_IntLock();
     hpm_stat_t status = rom_xpi_nor_read(base, xpi_xfer_channel_auto,
                                  &ctx->xpiNorConfig, (uint32_t *)buf, chipOffset, size);
-    __asm volatile("fence.i");
+    HPM_LFS_FENCE_I();
     LOS_IntRestore(intSave);
     if (status != status_success) {
         printf("[%s]: read addr: %u, size: %u failed!!!\n", ctx->mountPoint, chipOffset, size);
@@ -41,17 +43,39 @@ int HpmLittlefsRead(int partition, UINT32 *offset, void *buf, UINT32 size)
 }
 
 
+static inline uint32_t HpmLittlefsBlockOf(struct HpmLittlefsCfg *part, uint32_t chipOffset)
+{
+    return (chipOffset - part->ctx.startOffset) / (uint32_t)part->cfg.blockSize;
+}
+
+static void HpmLittlefsCountErase(struct HpmLittlefsCfg *part, uint32_t block)
+{
+    struct HpmLittleCtx *ctx = &part->ctx;
+
+    if (ctx->eraseCount != NULL) {
+        ctx->eraseCount[block]++;
+    }
+    ctx->bootErases++;
+    ctx->unsavedErases++;
+}
+
 int HpmLittlefsProg(int partition, UINT32 *offset, const void *buf, UINT32 size)
 {
     struct HpmLittleCtx *ctx = &g_hpmLittlefsCfgs[partition].ctx;
-    XPI_Type *base = (XPI_Type *)ctx->base;
+    XPI_Type *base = (XPI_Type *)(uintptr_t)ctx->base;
     uint32_t chipOffset = *offset;
 
+    ctx->writeGen++;
+    ctx->progBytes += size;
+    if (ctx->erasedMap != NULL) {
+        HPM_LFS_BIT_CLR(ctx->erasedMap, HpmLittlefsBlockOf(&g_hpmLittlefsCfgs[partition], chipOffset));
+    }
+
     uint32_t intSave = LOS_IntLock();
     hpm_stat_t status = rom_xpi_nor_program(base, xpi_xfer_channel_auto,
                                  &ctx->xpiNorConfig, (const uint32_t *)buf, chipOffset, size);
 
-    __asm volatile("fence.i"); /* mandatory, very important!!! */
+    HPM_LFS_FENCE_I(); /* mandatory, very important!!! */
     LOS_IntRestore(intSave);
     
     if (status != status_success) {
@@ -61,24 +85,69 @@ int HpmLittlefsProg(int partition, UINT32 *offset, const void *buf, UINT32 size)
     return 0;
 }
 
-int HpmLittlefsErase(int partition, UINT32 offset, UINT32 size)
+static int HpmLittlefsEraseRange(struct HpmLittleCtx *ctx, uint32_t offset, uint32_t size)
 {
-    struct HpmLittleCtx *ctx = &g_hpmLittlefsCfgs[partition].ctx;
-    XPI_Type *base = (XPI_Type *)ctx->base;
+    XPI_Type *base = (XPI_Type *)(uintptr_t)ctx->base;
     uint32_t chipOffset = offset;
-    
-    uint32_t intSave = LOS_IntLock();
-    hpm_stat_t status = rom_xpi_nor_erase_sector(base, xpi_xfer_channel_auto, &ctx->xpiNorConfig, chipOffset);
-    __asm volatile("fence.i"); /* mandatory, very important!!! */
-    LOS_IntRestore(intSave);
+    hpm_stat_t status = status_success;
+
+    /* A littlefs block may span several sectors, erase them one by one to bound the interrupt lock time */
+    do {
+        uint32_t intSave = LOS_IntLock();
+        status = rom_xpi_nor_erase_sector(base, xpi_xfer_channel_auto, &ctx->xpiNorConfig, chipOffset);
+        HPM_LFS_FENCE_I(); /* mandatory, very important!!! */
+        LOS_IntRestore(intSave);
+        chipOffset += ctx->sectorSize;
+    } while ((status == status_success) && (chipOffset < offset + size));
+
     if (status != status_success) {
-        printf("[%s]: erase addr: %u, size: %u failed!!!\n", ctx->mountPoint, chipOffset, size);
+        printf("[%s]: erase addr: %u, size: %u failed!!!\n", ctx->mountPoint, chipOffset - ctx->sectorSize, size);
         return -1;
     }
 
     return 0;
 }
 
+int HpmLittlefsErase(int partition, UINT32 offset, UINT32 size)
+{
+    struct HpmLittlefsCfg *part = &g_hpmLittlefsCfgs[partition];
+    struct HpmLittleCtx *ctx = &part->ctx;
+    uint32_t block = HpmLittlefsBlockOf(part, offset);
+
+    ctx->writeGen++;
+    /* already erased in the background and not programmed since: nothing to wait for */
+    if ((ctx->erasedMap != NULL) && HPM_LFS_BIT_GET(ctx->erasedMap, block)) {
+        HPM_LFS_BIT_CLR(ctx->erasedMap, block);
+        ctx->eraseSkipped++;
+        return 0;
+    }
+
+    if (HpmLittlefsEraseRange(ctx, offset, size) != 0) {
+        return -1;
+    }
+    HpmLittlefsCountErase(part, block);
+    return 0;
+}
+
+int HpmLittlefsPreErase(int partition, uint32_t block)
+{
+    struct HpmLittlefsCfg *part = &g_hpmLittlefsCfgs[partition];
+    struct HpmLittleCtx *ctx = &part->ctx;
+    uint32_t blockSize = (uint32_t)part->cfg.blockSize;
+
+    if ((ctx->erasedMap == NULL) || (block >= (uint32_t)part->cfg.blockCount)) {
+        return -1;
+    }
+    if (HpmLittlefsEraseRange(ctx, ctx->startOffset + block * blockSize, blockSize) != 0) {
+        return -1;
+    }
+
+    HpmLittlefsCountErase(part, block);
+    HPM_LFS_BIT_SET(ctx->erasedMap, block);
+    ctx->preErased++;
+    return 0;
+}
+
 
 #define HPMICRO_FLASH_SELFTEST_ENABLE 0
 
@@ -136,44 +205,251 @@ static void SelfTest(struct HpmLittlefsCfg *lfsPart)
 }
 #endif
 
+#define HPM_LFS_NOR_CFG_MAGIC 0x43524F4EU /* "NORC" */
+
+/* Flash copy of the probed configuration, with the probe options it was made with */
+struct HpmLittlefsNorCfgHdr {
+    uint32_t magic;
+    uint32_t option[3];
+};
+
+/* Probed once for all partitions, they share the XPI0 NOR */
+static xpi_nor_config_t g_hpmLfsNorConfig;
+static int g_hpmLfsNorConfigured;
+
+#if HPM_LFS_NOR_CFG_CACHE_ENABLE
+static int HpmLittlefsNorCfgLoad(XPI_Type *base, const xpi_nor_config_option_t *option)
+{
+    const struct HpmLittlefsNorCfgHdr *hdr =
+        (const struct HpmLittlefsNorCfgHdr *)(HPM_LFS_XIP_MEM_BASE + HPM_LFS_NOR_CFG_OFFSET);
+    uint32_t check[sizeof(*hdr) / sizeof(uint32_t)];
+
+    if ((hdr->magic != HPM_LFS_NOR_CFG_MAGIC) || (hdr->option[0] != option->header.U) ||
+        (hdr->option[1] != option->option0.U) || (hdr->option[2] != option->option1.U)) {
+        return -1;
+    }
+    memcpy(&g_hpmLfsNorConfig, hdr + 1, sizeof(g_hpmLfsNorConfig));
+
+    /* a copy made for another flash part must not be used: it has to read what XIP reads */
+    uint32_t intSave = LOS_IntLock();
+    hpm_stat_t status = rom_xpi_nor_read(base, xpi_xfer_channel_auto, &g_hpmLfsNorConfig, check,
+                                         HPM_LFS_NOR_CFG_OFFSET, sizeof(check));
+    HPM_LFS_FENCE_I();
+    LOS_IntRestore(intSave);
+    return ((status == status_success) && (memcmp(check, hdr, sizeof(check)) == 0)) ? 0 : -1;
+}
+
+static void HpmLittlefsNorCfgSave(XPI_Type *base, const xpi_nor_config_option_t *option)
+{
+    static struct {
+        struct HpmLittlefsNorCfgHdr hdr;
+        xpi_nor_config_t config;
+    } copy;
+    uint32_t sectorSize = 0;
+    hpm_stat_t status;
+
+    /* a bigger erase unit would reach into the image */
+    rom_xpi_nor_get_property(base, &g_hpmLfsNorConfig, xpi_nor_property_sector_size, &sectorSize);
+    if ((sectorSize == 0) || (sectorSize > HPM_LFS_NOR_CFG_AREA)) {
+        return;
+    }
+
+    copy.hdr.magic = HPM_LFS_NOR_CFG_MAGIC;
+    copy.hdr.option[0] = option->header.U;
+    copy.hdr.option[1] = option->option0.U;
+    copy.hdr.option[2] = option->option1.U;
+    copy.config = g_hpmLfsNorConfig;
+
+    /* the header goes last, a copy cut short by a power loss has no magic */
+    uint32_t intSave = LOS_IntLock();
+    status = rom_xpi_nor_erase_sector(base, xpi_xfer_channel_auto, &g_hpmLfsNorConfig, HPM_LFS_NOR_CFG_OFFSET);
+    HPM_LFS_FENCE_I();
+    LOS_IntRestore(intSave);
+    if (status == status_success) {
+        intSave = LOS_IntLock();
+        status = rom_xpi_nor_program(base, xpi_xfer_channel_auto, &g_hpmLfsNorConfig, (const uint32_t *)&copy.config,
+                                     HPM_LFS_NOR_CFG_OFFSET + sizeof(copy.hdr), sizeof(copy.config));
+        if (status == status_success) {
+            status = rom_xpi_nor_program(base, xpi_xfer_channel_auto, &g_hpmLfsNorConfig,
+                                         (const uint32_t *)&copy.hdr, HPM_LFS_NOR_CFG_OFFSET, sizeof(copy.hdr));
+        }
+        HPM_LFS_FENCE_I();
+        LOS_IntRestore(intSave);
+    }
+    if (status != status_success) {
+        printf("hpm lfs: NOR configuration not saved\n");
+    }
+}
+#endif
+
+/*
+ * The SFDP probe of rom_xpi_nor_auto_config() takes milliseconds and finds the same thing on
+ * every boot. With HPM_LFS_NOR_CFG_CACHE_ENABLE its result is kept in flash at
+ * HPM_LFS_NOR_CFG_OFFSET and the next boots start from that copy.
+ */
+static hpm_stat_t HpmLittlefsNorConfig(XPI_Type *base)
+{
+    xpi_nor_config_option_t option;
+    hpm_stat_t status;
+
+    if (g_hpmLfsNorConfigured) {
+        return status_success;
+    }
+
+    option.header.U = 0xfcf90001U;
+    option.option0.U = 0x00000005U;
+    option.option1.U = 0x00001000U;
+#if HPM_LFS_NOR_CFG_CACHE_ENABLE
+    if (HpmLittlefsNorCfgLoad(base, &option) == 0) {
+        g_hpmLfsNorConfigured = 1;
+        return status_success;
+    }
+#endif
+
+    uint32_t intSave = LOS_IntLock();
+    status = rom_xpi_nor_auto_config(base, &g_hpmLfsNorConfig, &option);
+    HPM_LFS_FENCE_I();
+    LOS_IntRestore(intSave);
+    if (status != status_success) {
+        return status;
+    }
+    g_hpmLfsNorConfigured = 1;
+#if HPM_LFS_NOR_CFG_CACHE_ENABLE
+    HpmLittlefsNorCfgSave(base, &option);
+#endif
+    return status_success;
+}
+
+/*
+ * Fill the littlefs I/O tuning left as 0 in g_hpmLittlefsCfgs from the flash geometry.
+ * A non-zero value in the table is a per-partition override and is kept if littlefs can use it.
+ */
+static void HpmLittlefsTune(struct HpmLittlefsCfg *lfsPart, uint32_t pageSize)
+{
+    struct HpmLittleCtx *ctx = &lfsPart->ctx;
+    struct PartitionCfg *cfg = &lfsPart->cfg;
+    int blockSize = cfg->blockSize;
+
+    /*
+     * readSize and writeSize are not derived, they stay at the fixed 16 bytes the board always used.
+     * NOR programs any byte of an erased page and reads go through rom_xpi_nor_read(), not the XIP
+     * cache, so the geometry sets no floor above the word the ROM calls transfer. littlefs pads each
+     * metadata commit to writeSize, a larger value would only cost space and program time.
+     */
+    if (cfg->readSize <= 0) {
+        cfg->readSize = HPM_LFS_MIN_IO_SIZE;
+    }
+    if (cfg->writeSize <= 0) {
+        cfg->writeSize = HPM_LFS_MIN_IO_SIZE;
+    }
+
+    /*
+     * littlefs reads a metadata block from its start on every fetch, one rom_xpi_nor_read() per
+     * cache miss: half a block (2 KB of a 4 KB sector, twice the old 1 KB) takes a fetch in two
+     * calls instead of four. The RAM cost is the read and program cache plus one per open file.
+     * Whole pages keep every flush of the program cache to full page program commands.
+     */
+    if ((cfg->cacheSize <= 0) || (cfg->cacheSize % cfg->readSize) || (cfg->cacheSize % cfg->writeSize) ||
+        (blockSize % cfg->cacheSize)) {
+        if (cfg->cacheSize != 0) {
+            printf("[%s]: cacheSize %d is not usable, derived from geometry\n", ctx->mountPoint, cfg->cacheSize);
+        }
+        cfg->cacheSize = blockSize / HPM_LFS_CACHE_BLOCK_DIV;
+        cfg->cacheSize -= cfg->cacheSize % (int)pageSize;
+        if ((cfg->cacheSize < (int)pageSize) || (blockSize % cfg->cacheSize)) {
+            cfg->cacheSize = ((int)pageSize < blockSize) ? (int)pageSize : blockSize;
+        }
+    }
+
+    /* One lookahead bit per block lets a single allocator scan see the whole partition */
+    if ((cfg->lookaheadSize <= 0) || (cfg->lookaheadSize % 8)) {
+        if (cfg->lookaheadSize != 0) {
+            printf("[%s]: lookaheadSize %d is not usable, derived from geometry\n", ctx->mountPoint,
+                   cfg->lookaheadSize);
+        }
+        cfg->lookaheadSize = ((cfg->blockCount + 63) / 64) * 8;
+        if (cfg->lookaheadSize > HPM_LFS_MAX_LOOKAHEAD_SIZE) {
+            cfg->lookaheadSize = HPM_LFS_MAX_LOOKAHEAD_SIZE;
+        }
+    }
+}
+
 int HpmLittlefsDriverInit(struct HpmLittlefsCfg *lfsPart)
 {
     struct HpmLittleCtx *ctx = &lfsPart->ctx;
     struct PartitionCfg *cfg = &lfsPart->cfg;
-    XPI_Type *base = (XPI_Type *)ctx->base;
+    XPI_Type *base = (XPI_Type *)(uintptr_t)ctx->base;
 
     if (ctx->isInited) {
         return 0;
     }
     ctx->isInited = 1;
 
+#if HPM_LFS_VERBOSE_INIT
     printf("hpm lfs: mountPoint: %s\n", ctx->mountPoint);
     printf("hpm lfs: startOffset: %u\n", ctx->startOffset);
     printf("hpm lfs: len: %u\n", ctx->len);
-    
-    xpi_nor_config_option_t option;
-    option.header.U = 0xfcf90001U;
-    option.option0.U = 0x00000005U;
-    option.option1.U = 0x00001000U;
+#endif
+
     uint32_t blockSize;
+    uint32_t pageSize;
     uint32_t blockCount;
+    if (HpmLittlefsNorConfig(base) != status_success) {
+        printf("Error: rom_xpi_nor_auto_config\n");
+        while (1);
+    }
+    ctx->xpiNorConfig = g_hpmLfsNorConfig;
     uint32_t intSave = LOS_IntLock();
-    hpm_stat_t status = rom_xpi_nor_auto_config(base, &ctx->xpiNorConfig, &option);
     rom_xpi_nor_get_property(base, &ctx->xpiNorConfig, xpi_nor_property_sector_size, &blockSize);
-    __asm volatile("fence.i");
+    rom_xpi_nor_get_property(base, &ctx->xpiNorConfig, xpi_nor_property_page_size, &pageSize);
     LOS_IntRestore(intSave);
-    if (status != status_success) {
-        printf("Error: rom_xpi_nor_auto_config\n");
-        while (1);
+
+    ctx->sectorSize = blockSize;
+    if (cfg->blockSize > 0) {
+        /* per-partition override: a littlefs block of several erase sectors */
+        if (cfg->blockSize % blockSize) {
+            printf("[%s]: blockSize %d is not a multiple of the sector size\n", ctx->mountPoint, cfg->blockSize);
+        } else {
+            blockSize = cfg->blockSize;
+        }
     }
 
     blockCount = ctx->len / blockSize;
+#if HPM_LFS_VERBOSE_INIT
     printf("hpm lfs: blockCount: %u\n", blockCount);
     printf("hpm lfs: blockSize: %u\n", blockSize);
-    printf("------------------------------------------\n");
-    
+    printf("hpm lfs: pageSize: %u\n", pageSize);
+#endif
+
     cfg->blockSize = blockSize;
     cfg->blockCount = blockCount;
+    HpmLittlefsTune(lfsPart, pageSize);
+
+#if HPM_LFS_VERBOSE_INIT
+    printf("hpm lfs: readSize: %d\n", cfg->readSize);
+    printf("hpm lfs: writeSize: %d\n", cfg->writeSize);
+    printf("hpm lfs: cacheSize: %d\n", cfg->cacheSize);
+    printf("hpm lfs: lookaheadSize: %d\n", cfg->lookaheadSize);
+    printf("------------------------------------------\n");
+#else
+    printf("hpm lfs: %s: %uK at %uK, %u blocks of %u, cache %d\n", ctx->mountPoint, ctx->len / 1024U,
+           ctx->startOffset / 1024U, blockCount, blockSize, cfg->cacheSize);
+#endif
+
+    if (ctx->preErase) {
+        /* nothing is known to be erased yet, the idle worker finds out from the allocator */
+        uint32_t words = (blockCount + 31U) / 32U;
+        ctx->erasedMap = (uint32_t *)calloc(words * 2U, sizeof(uint32_t));
+        ctx->usedMap = (ctx->erasedMap == NULL) ? NULL : ctx->erasedMap + words;
+        if (ctx->erasedMap == NULL) {
+            printf("[%s]: no memory for pre-erase maps\n", ctx->mountPoint);
+        }
+    }
+
+    ctx->eraseCount = (uint32_t *)calloc(blockCount, sizeof(uint32_t));
+    if (ctx->eraseCount == NULL) {
+        printf("[%s]: no memory for erase counters\n", ctx->mountPoint);
+    }
 #if HPMICRO_FLASH_SELFTEST_ENABLE == 1
     SelfTest(lfsPart);
 #endif
@@ -20,15 +20,72 @@
 #include <hpm_romapi.h>
 #include <los_fs.h>
 
+/* The host simulator (see sim/) runs this driver on x86, where fence.i does not exist */
+#ifdef HPM_LITTLEFS_HOST_SIM
+#define HPM_LFS_FENCE_I()
+#define HPM_LFS_BOOT_MARK(name)
+#define HPM_LFS_NOR_CFG_CACHE_ENABLE    0
+#define HPM_LFS_VERBOSE_INIT            1
+#else
+#include "hpm_boottime.h"
+#define HPM_LFS_FENCE_I() __asm volatile("fence.i")
+#define HPM_LFS_BOOT_MARK(name) HpmBootMark(name)
+#define HPM_LFS_NOR_CFG_CACHE_ENABLE    HPM_FAST_BOOT_ENABLE
+#define HPM_LFS_VERBOSE_INIT            (!HPM_FAST_BOOT_ENABLE)
+#endif
+
+/*
+ * Sector keeping the NOR configuration of an earlier boot, right below the partitions; the
+ * linker script keeps the image out of it (FLASH_IMAGE_END). Read through the XIP mapping.
+ */
+#define HPM_LFS_NOR_CFG_OFFSET      0x4FF000U
+#define HPM_LFS_NOR_CFG_AREA        0x1000U
+#define HPM_LFS_XIP_MEM_BASE        0x80000000U
+
+/* Tuning used when a partition leaves the value as 0 in g_hpmLittlefsCfgs */
+#define HPM_LFS_MIN_IO_SIZE         16
+#define HPM_LFS_CACHE_BLOCK_DIV     2 /* cacheSize is this part of a block */
+#define HPM_LFS_MAX_LOOKAHEAD_SIZE  256
+
+/* Rated program/erase cycles per sector of the NOR part, used for lifetime projection */
+#define HPM_LFS_NOR_ENDURANCE       100000U
+/* Erases between two updates of the wear file; a power loss forgets at most this many */
+#define HPM_LFS_WEAR_SAVE_ERASES    64U
+
 struct HpmLittleCtx {
     xpi_nor_config_t xpiNorConfig;
     int isInited;
     uint32_t startOffset; /* The partion address in chip; unit in byte */
     uint32_t len; /* The partion length, unit in byte */
     uint32_t base; /* XPI register base */
+    uint32_t sectorSize; /* The flash erase unit, unit in byte */
     char *mountPoint;
+    int mountOnDemand; /* Mounted by the first HpmLittlefsMount()/HpmLittlefsOpen() instead of at boot */
+    int isMounted;
+
+    /* Background pre-erase, see hpm_littlefs_idle.c */
+    int preErase; /* Let the idle worker erase free blocks ahead of time */
+    uint32_t *erasedMap; /* Blocks erased by the worker and not programmed since */
+    uint32_t *usedMap; /* Blocks in use, as last reported by the littlefs allocator */
+    uint32_t writeGen; /* Bumped on every program/erase, invalidates usedMap */
+    uint32_t usedGen; /* writeGen usedMap was built at */
+    uint32_t scanPos; /* Next block the worker looks at */
+    uint32_t preErased;
+    uint32_t eraseSkipped;
+
+    /* Wear telemetry, see hpm_littlefs_wear.c */
+    uint32_t *eraseCount; /* Lifetime erases per block */
+    uint32_t bootErases; /* Erases since boot */
+    uint32_t unsavedErases; /* Erases not yet in the wear file */
+    int wearLoaded; /* Counts of earlier boots merged in */
+    uint64_t progBytes; /* Lifetime bytes programmed */
+    uint64_t appBytes; /* Lifetime bytes written through HpmLittlefsWrite() */
 };
 
+#define HPM_LFS_BIT_GET(map, bit) (((map)[(bit) >> 5] >> ((bit) & 31U)) & 1U)
+#define HPM_LFS_BIT_SET(map, bit) ((map)[(bit) >> 5] |= (1UL << ((bit) & 31U)))
+#define HPM_LFS_BIT_CLR(map, bit) ((map)[(bit) >> 5] &= ~(1UL << ((bit) & 31U)))
+
 struct HpmLittlefsCfg {
     struct PartitionCfg cfg;
     struct HpmLittleCtx ctx;
@@ -39,4 +96,16 @@ int HpmLittlefsProg(int partition, UINT32 *offset, const void *buf, UINT32 size)
 int HpmLittlefsErase(int partition, UINT32 offset, UINT32 size);
 int HpmLittlefsDriverInit(struct HpmLittlefsCfg *cfg);
 
+/* Erase a free block ahead of use; the next erase request for it returns at once */
+int HpmLittlefsPreErase(int partition, uint32_t block);
+
+/* Merge the wear file of a freshly mounted partition into its counters */
+void HpmLittlefsWearLoad(struct HpmLittlefsCfg *part);
+
+/* Write the counters back to the wear file of a mounted partition */
+int HpmLittlefsWearSave(struct HpmLittlefsCfg *part);
+
+/* Register the lfswear shell command */
+void HpmLittlefsWearShellReg(void);
+
 #endif
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <los_mux.h>
+#include <los_task.h>
+#include "lfs.h"
+#include "vfs_mount.h"
+#include "hpm_littlefs.h"
+#include "hpm_littlefs_drv.h"
+
+/*
+ * Idle-time worker for the littlefs partitions.
+ *
+ * Pre-erase: NOR program latency is dominated by the sector erase littlefs requests right before
+ * it writes a new block. While the system is idle the worker asks the littlefs allocator which
+ * blocks are in use (lfs_fs_traverse) and erases free ones one at a time, marking them in
+ * ctx->erasedMap so HpmLittlefsErase() can return at once when littlefs picks them. Every free
+ * block is erased before littlefs uses it anyway, so this moves erases in time but adds none.
+ *
+ * Wear file: once HPM_LFS_WEAR_SAVE_ERASES erases piled up on a partition the worker writes its
+ * erase counters back, see hpm_littlefs_wear.c.
+ */
+
+#define HPM_LFS_IDLE_TASK_PRIO          (OS_TASK_PRIORITY_LOWEST - 1)
+#define HPM_LFS_IDLE_TASK_STACK_SIZE    2048
+#define HPM_LFS_IDLE_PERIOD_TICKS       100
+
+extern struct HpmLittlefsCfg g_hpmLittlefsCfgs[];
+extern const uint32_t g_hpmLittlefsPartNum;
+extern UINT32 g_hpmLittlefsMux;
+
+/*
+ * The VFS serializes every file system call with this lock. The worker holds it across one
+ * traverse or one block erase, so the allocator view cannot go stale while it is used.
+ */
+extern int VfsLock(void);
+extern void VfsUnlock(void);
+
+static UINT32 g_hpmLittlefsIdleTaskId = LOS_ERRNO_TSK_ID_INVALID;
+
+static int HpmLittlefsMarkUsed(void *data, lfs_block_t block)
+{
+    struct HpmLittlefsCfg *part = (struct HpmLittlefsCfg *)data;
+
+    if (block < (lfs_block_t)part->cfg.blockCount) {
+        HPM_LFS_BIT_SET(part->ctx.usedMap, block);
+    }
+    return 0;
+}
+
+/* Erase at most one free block of the partition, returns 1 if it did */
+static int HpmLittlefsPreEraseStep(struct HpmLittlefsCfg *part)
+{
+    struct HpmLittleCtx *ctx = &part->ctx;
+    uint32_t blockCount = (uint32_t)part->cfg.blockCount;
+    struct MountPoint *mp = NULL;
+    int erased = 0;
+
+    if (!ctx->preErase || (ctx->erasedMap == NULL) || !ctx->isMounted) {
+        return 0;
+    }
+    /* cheap early out without the lock: everything free is erased and nothing changed since */
+    if ((ctx->usedGen == ctx->writeGen) && (ctx->scanPos >= blockCount)) {
+        return 0;
+    }
+
+    if (VfsLock() != 0) {
+        return 0;
+    }
+
+    mp = VfsMpFind(ctx->mountPoint, NULL);
+    if ((mp == NULL) || (mp->mData == NULL)) {
+        VfsUnlock();
+        return 0;
+    }
+
+    if (ctx->usedGen != ctx->writeGen) {
+        memset(ctx->usedMap, 0, ((blockCount + 31U) / 32U) * sizeof(uint32_t));
+        if (lfs_fs_traverse((lfs_t *)mp->mData, HpmLittlefsMarkUsed, part) != 0) {
+            VfsUnlock();
+            return 0;
+        }
+        ctx->usedGen = ctx->writeGen;
+        ctx->scanPos = 0;
+    }
+
+    for (; ctx->scanPos < blockCount; ctx->scanPos++) {
+        uint32_t block = ctx->scanPos;
+        if (!HPM_LFS_BIT_GET(ctx->usedMap, block) && !HPM_LFS_BIT_GET(ctx->erasedMap, block)) {
+            erased = (HpmLittlefsPreErase(part->cfg.partNo, block) == 0);
+            ctx->scanPos++;
+            break;
+        }
+    }
+
+    VfsUnlock();
+    return erased;
+}
+
+static int HpmLittlefsWearStep(struct HpmLittlefsCfg *part)
+{
+    int saved = 0;
+
+    if (part->ctx.unsavedErases < HPM_LFS_WEAR_SAVE_ERASES) {
+        return 0;
+    }
+
+    /* keeps the partition from being unmounted while the file is open */
+    LOS_MuxPend(g_hpmLittlefsMux, LOS_WAIT_FOREVER);
+    if (part->ctx.isMounted) {
+        saved = (HpmLittlefsWearSave(part) == 0);
+    }
+    LOS_MuxPost(g_hpmLittlefsMux);
+    return saved;
+}
+
+int HpmLittlefsIdleStep(void)
+{
+    int worked = 0;
+
+    for (uint32_t i = 0; i < g_hpmLittlefsPartNum; i++) {
+        worked |= HpmLittlefsPreEraseStep(&g_hpmLittlefsCfgs[i]);
+        worked |= HpmLittlefsWearStep(&g_hpmLittlefsCfgs[i]);
+    }
+    return worked;
+}
+
+static VOID *HpmLittlefsIdleTask(UINT32 arg)
+{
+    (VOID)arg;
+
+    while (1) {
+        if (HpmLittlefsIdleStep()) {
+            /* one sector at a time, anything else that became ready runs first */
+            LOS_TaskYield();
+        } else {
+            LOS_TaskDelay(HPM_LFS_IDLE_PERIOD_TICKS);
+        }
+    }
+    return NULL;
+}
+
+void HpmLittlefsIdleStart(void)
+{
+    TSK_INIT_PARAM_S task = {0};
+
+    if (g_hpmLittlefsIdleTaskId != LOS_ERRNO_TSK_ID_INVALID) {
+        return;
+    }
+
+    task.pfnTaskEntry = (TSK_ENTRY_FUNC)HpmLittlefsIdleTask;
+    task.uwStackSize = HPM_LFS_IDLE_TASK_STACK_SIZE;
+    task.pcName = "lfs_idle";
+    task.usTaskPrio = HPM_LFS_IDLE_TASK_PRIO;
+    task.uwResved = LOS_TASK_STATUS_DETACHED;
+    if (LOS_TaskCreate(&g_hpmLittlefsIdleTaskId, &task) != LOS_OK) {
+        printf("Err: hpm littlefs idle task create failed!!!\n");
+        g_hpmLittlefsIdleTaskId = LOS_ERRNO_TSK_ID_INVALID;
+    }
+}
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <los_tick.h>
+#include "hpm_littlefs.h"
+#include "hpm_littlefs_drv.h"
+#ifdef LOSCFG_SHELL
+#include "shcmd.h"
+#endif
+
+/*
+ * Erase count telemetry for the littlefs partitions.
+ *
+ * The driver counts every physical erase per littlefs block in ctx->eraseCount (a block
+ * pre-erased by the idle worker counts once, when it is erased). The table lives in RAM and is
+ * written to <mountPoint>/.wear by the idle worker every HPM_LFS_WEAR_SAVE_ERASES erases and on
+ * unmount, so keeping it costs about one block rewrite per HPM_LFS_WEAR_SAVE_ERASES erases. On the
+ * first mount after boot the saved counts are added to whatever this boot has erased already.
+ */
+
+#define HPM_LFS_WEAR_FILE       ".wear"
+#define HPM_LFS_WEAR_MAGIC      0x52414557U /* "WEAR" */
+#define HPM_LFS_WEAR_PATH_LEN   32
+#define HPM_LFS_WEAR_CHUNK      32
+
+struct HpmLittlefsWearHdr {
+    uint32_t magic;
+    uint32_t blockCount;
+    uint64_t progBytes;
+    uint64_t appBytes;
+};
+
+extern struct HpmLittlefsCfg g_hpmLittlefsCfgs[];
+extern const uint32_t g_hpmLittlefsPartNum;
+
+static void HpmLittlefsWearPath(struct HpmLittleCtx *ctx, char *path)
+{
+    snprintf(path, HPM_LFS_WEAR_PATH_LEN, "%s/%s", ctx->mountPoint, HPM_LFS_WEAR_FILE);
+}
+
+void HpmLittlefsWearLoad(struct HpmLittlefsCfg *part)
+{
+    struct HpmLittleCtx *ctx = &part->ctx;
+    struct HpmLittlefsWearHdr hdr;
+    uint32_t counts[HPM_LFS_WEAR_CHUNK];
+    char path[HPM_LFS_WEAR_PATH_LEN];
+    uint32_t block = 0;
+    int fd;
+
+    /* no file yet is a fresh partition, there is nothing to merge later either */
+    ctx->wearLoaded = 1;
+    if (ctx->eraseCount == NULL) {
+        return;
+    }
+
+    HpmLittlefsWearPath(ctx, path);
+    fd = open(path, O_RDONLY, 0);
+    if (fd < 0) {
+        return;
+    }
+
+    if ((read(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)) || (hdr.magic != HPM_LFS_WEAR_MAGIC) ||
+        (hdr.blockCount != (uint32_t)part->cfg.blockCount)) {
+        printf("[%s]: wear file does not match the partition, counting from 0\n", ctx->mountPoint);
+        close(fd);
+        return;
+    }
+
+    while (block < hdr.blockCount) {
+        uint32_t num = hdr.blockCount - block;
+        if (num > HPM_LFS_WEAR_CHUNK) {
+            num = HPM_LFS_WEAR_CHUNK;
+        }
+        if (read(fd, counts, num * sizeof(uint32_t)) != (ssize_t)(num * sizeof(uint32_t))) {
+            printf("[%s]: wear file is truncated\n", ctx->mountPoint);
+            break;
+        }
+        for (uint32_t i = 0; i < num; i++) {
+            ctx->eraseCount[block + i] += counts[i];
+        }
+        block += num;
+    }
+    ctx->progBytes += hdr.progBytes;
+    ctx->appBytes += hdr.appBytes;
+    close(fd);
+}
+
+int HpmLittlefsWearSave(struct HpmLittlefsCfg *part)
+{
+    struct HpmLittleCtx *ctx = &part->ctx;
+    struct HpmLittlefsWearHdr hdr;
+    char path[HPM_LFS_WEAR_PATH_LEN];
+    uint32_t unsaved = ctx->unsavedErases;
+    ssize_t len = (ssize_t)((uint32_t)part->cfg.blockCount * sizeof(uint32_t));
+    int fd;
+
+    if ((ctx->eraseCount == NULL) || !ctx->wearLoaded) {
+        return -1;
+    }
+
+    HpmLittlefsWearPath(ctx, path);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    /* erases done by writing the file itself go into the next save */
+    ctx->unsavedErases = 0;
+    hdr.magic = HPM_LFS_WEAR_MAGIC;
+    hdr.blockCount = (uint32_t)part->cfg.blockCount;
+    hdr.progBytes = ctx->progBytes;
+    hdr.appBytes = ctx->appBytes;
+    if ((write(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)) || (write(fd, ctx->eraseCount, len) != len)) {
+        close(fd);
+        ctx->unsavedErases += unsaved;
+        printf("[%s]: wear file write failed\n", ctx->mountPoint);
+        return -1;
+    }
+    /* littlefs commits the new content on close, a power loss before keeps the previous file */
+    if (close(fd) != 0) {
+        ctx->unsavedErases += unsaved;
+        return -1;
+    }
+    return 0;
+}
+
+int HpmLittlefsWearGet(const char *mountPoint, struct HpmLittlefsWearStats *stats)
+{
+    struct HpmLittlefsCfg *part = NULL;
+    struct HpmLittleCtx *ctx = NULL;
+
+    for (uint32_t i = 0; i < g_hpmLittlefsPartNum; i++) {
+        if (strcmp(g_hpmLittlefsCfgs[i].ctx.mountPoint, mountPoint) == 0) {
+            part = &g_hpmLittlefsCfgs[i];
+            break;
+        }
+    }
+    if ((part == NULL) || (part->ctx.eraseCount == NULL)) {
+        return -1;
+    }
+    ctx = &part->ctx;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->blockCount = (uint32_t)part->cfg.blockCount;
+    stats->minErases = UINT32_MAX;
+    for (uint32_t i = 0; i < stats->blockCount; i++) {
+        uint32_t count = ctx->eraseCount[i];
+        stats->totalErases += count;
+        stats->minErases = (count < stats->minErases) ? count : stats->minErases;
+        stats->maxErases = (count > stats->maxErases) ? count : stats->maxErases;
+    }
+    stats->avgErases = (uint32_t)(stats->totalErases / stats->blockCount);
+    stats->bootErases = ctx->bootErases;
+    stats->progBytes = ctx->progBytes;
+    stats->appBytes = ctx->appBytes;
+
+    stats->bucketWidth = stats->maxErases / HPM_LFS_WEAR_HIST_BUCKETS + 1U;
+    for (uint32_t i = 0; i < stats->blockCount; i++) {
+        stats->hist[ctx->eraseCount[i] / stats->bucketWidth]++;
+    }
+
+    /*
+     * Projection: the erase rate of this boot, of which the most worn block is assumed to keep
+     * taking its lifetime share, until it reaches the rated endurance.
+     */
+    stats->lifetimeHours = UINT32_MAX;
+    uint64_t uptime = LOS_TickCountGet() / LOSCFG_BASE_CORE_TICK_PER_SECOND;
+    uint64_t hotErases = (stats->totalErases == 0) ? 0 :
+                         (uint64_t)stats->bootErases * stats->maxErases / stats->totalErases;
+    if ((uptime != 0) && (hotErases != 0)) {
+        uint64_t left = (stats->maxErases < HPM_LFS_NOR_ENDURANCE) ? (HPM_LFS_NOR_ENDURANCE - stats->maxErases) : 0;
+        uint64_t hours = left * uptime / hotErases / 3600U;
+        stats->lifetimeHours = (hours < UINT32_MAX) ? (uint32_t)hours : (UINT32_MAX - 1U);
+    }
+    return 0;
+}
+
+#ifdef LOSCFG_SHELL
+static void HpmLittlefsWearShow(const char *mountPoint)
+{
+    struct HpmLittlefsWearStats stats;
+
+    /* the lifetime counts of an on-demand partition are in its wear file, loaded by the mount */
+    if (HpmLittlefsMount(mountPoint) != 0) {
+        printf("%s: mount failed\n", mountPoint);
+        return;
+    }
+    if (HpmLittlefsWearGet(mountPoint, &stats) != 0) {
+        printf("%s: no erase counters\n", mountPoint);
+        return;
+    }
+
+    printf("%s: %u blocks, erases min %u max %u avg %u, total %llu, this boot %u\n", mountPoint,
+           stats.blockCount, stats.minErases, stats.maxErases, stats.avgErases,
+           (unsigned long long)stats.totalErases, stats.bootErases);
+    for (uint32_t i = 0; i < HPM_LFS_WEAR_HIST_BUCKETS; i++) {
+        printf("  %6u - %6u: %u\n", i * stats.bucketWidth, (i + 1U) * stats.bucketWidth - 1U, stats.hist[i]);
+    }
+
+    printf("  programmed %llu bytes, application wrote %llu bytes", (unsigned long long)stats.progBytes,
+           (unsigned long long)stats.appBytes);
+    if (stats.appBytes != 0) {
+        uint64_t amp = stats.progBytes * 100U / stats.appBytes;
+        printf(", write amplification %u.%02u", (uint32_t)(amp / 100U), (uint32_t)(amp % 100U));
+    }
+    printf("\n");
+
+    if (stats.lifetimeHours == UINT32_MAX) {
+        printf("  projected lifetime: unknown, no erases this boot\n");
+    } else {
+        printf("  projected lifetime: %u hours at %u cycles\n", stats.lifetimeHours, HPM_LFS_NOR_ENDURANCE);
+    }
+}
+
+static UINT32 HpmLittlefsWearCmd(UINT32 argc, const CHAR **argv)
+{
+    if (argc > 0) {
+        HpmLittlefsWearShow(argv[0]);
+        return 0;
+    }
+    for (uint32_t i = 0; i < g_hpmLittlefsPartNum; i++) {
+        HpmLittlefsWearShow(g_hpmLittlefsCfgs[i].ctx.mountPoint);
+    }
+    return 0;
+}
+#endif
+
+void HpmLittlefsWearShellReg(void)
+{
+#ifdef LOSCFG_SHELL
+    osCmdReg(CMD_TYPE_EX, "lfswear", XARGS, (CmdCallBackFunc)HpmLittlefsWearCmd);
+#endif
+}
@@ -0,0 +1,397 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host runner for the littlefs driver on top of the simulated XPI NOR.
+ *
+ * Without -c it runs a log-append + config-rewrite workload once and reports flash traffic and
+ * modelled latency, which is what performance regressions compare. With -c N it replays the same
+ * workload N times, cutting the power at a different program/erase step each time, then remounts
+ * without formatting and checks that every file is in a consistent state.
+ */
+
+#include <getopt.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hpm_littlefs.h"
+#include "hpm_littlefs_drv.h"
+#include "hpm_littlefs_sim_vfs.h"
+#include "hpm_xpi_nor_sim.h"
+
+#define SIM_MOUNT_POINT "/data"
+#define SIM_LOG_FILE    "log.bin"
+#define SIM_CFG_FILE    "cfg.bin"
+#define SIM_LOG_MAGIC   0x474F4C48U /* "HLOG" */
+#define SIM_CFG_MAGIC   0x47464348U /* "HCFG" */
+#define SIM_CFG_PERIOD  16
+
+extern struct HpmLittlefsCfg g_hpmLittlefsCfgs[];
+
+struct SimLogRecord {
+    uint32_t magic;
+    uint32_t seq;
+    uint8_t payload[36];
+    uint32_t crc;
+};
+
+struct SimCfgRecord {
+    uint32_t magic;
+    uint32_t version;
+    uint8_t payload[240];
+    uint32_t crc;
+};
+
+struct SimWorkloadResult {
+    uint32_t appends;
+    uint64_t appBytes;
+    uint64_t maxAppendNs;
+    uint64_t totalAppendNs;
+};
+
+static uint32_t SimCrc32(const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    uint32_t crc = 0xFFFFFFFFU;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+    return ~crc;
+}
+
+static uint64_t SimNow(void)
+{
+    struct HpmXpiNorSimStats stats;
+    HpmXpiNorSimGetStats(&stats);
+    return stats.timeNs;
+}
+
+static int SimWriteCfg(lfs_t *lfs, uint32_t version, struct SimWorkloadResult *res)
+{
+    struct SimCfgRecord rec;
+    lfs_file_t file;
+
+    rec.magic = SIM_CFG_MAGIC;
+    rec.version = version;
+    memset(rec.payload, (int)(version & 0xFF), sizeof(rec.payload));
+    rec.crc = SimCrc32(&rec, offsetof(struct SimCfgRecord, crc));
+
+    if (lfs_file_open(lfs, &file, SIM_CFG_FILE, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC) < 0) {
+        return -1;
+    }
+    int ret = lfs_file_write(lfs, &file, &rec, sizeof(rec));
+    /* littlefs commits the new contents atomically on close */
+    if ((lfs_file_close(lfs, &file) < 0) || (ret != (int)sizeof(rec))) {
+        return -1;
+    }
+    res->appBytes += sizeof(rec);
+    return 0;
+}
+
+/* idle worker steps the runner grants between two appends, 0 = the system is never idle */
+static uint32_t g_simIdleSteps;
+
+static int SimRunWorkload(uint32_t iterations, struct SimWorkloadResult *res)
+{
+    lfs_t *lfs = HpmSimLfsGet(SIM_MOUNT_POINT);
+    lfs_file_t file;
+    struct SimLogRecord rec;
+
+    memset(res, 0, sizeof(*res));
+    if (lfs == NULL) {
+        return -1;
+    }
+    if (lfs_file_open(lfs, &file, SIM_LOG_FILE, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND) < 0) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint64_t start = SimNow();
+
+        rec.magic = SIM_LOG_MAGIC;
+        rec.seq = i;
+        memset(rec.payload, (int)(i & 0xFF), sizeof(rec.payload));
+        rec.crc = SimCrc32(&rec, offsetof(struct SimLogRecord, crc));
+        if ((lfs_file_write(lfs, &file, &rec, sizeof(rec)) != (int)sizeof(rec)) ||
+            (lfs_file_sync(lfs, &file) < 0)) {
+            lfs_file_close(lfs, &file);
+            return -1;
+        }
+
+        uint64_t spent = SimNow() - start;
+        res->appends++;
+        res->appBytes += sizeof(rec);
+        res->totalAppendNs += spent;
+        if (spent > res->maxAppendNs) {
+            res->maxAppendNs = spent;
+        }
+
+        if ((i % SIM_CFG_PERIOD) == (SIM_CFG_PERIOD - 1)) {
+            if (SimWriteCfg(lfs, i / SIM_CFG_PERIOD, res) != 0) {
+                lfs_file_close(lfs, &file);
+                return -1;
+            }
+        }
+
+        for (uint32_t step = 0; step < g_simIdleSteps; step++) {
+            if (!HpmLittlefsIdleStep()) {
+                break;
+            }
+        }
+        if (HpmXpiNorSimIsPoweredOff()) {
+            lfs_file_close(lfs, &file);
+            return -1;
+        }
+    }
+
+    return (lfs_file_close(lfs, &file) < 0) ? -1 : 0;
+}
+
+/* Every synced log record must be intact and in order, and the config must be a whole version */
+static int SimCheckConsistency(lfs_t *lfs, uint32_t *records)
+{
+    lfs_file_t file;
+    struct SimLogRecord rec;
+    struct SimCfgRecord cfg;
+    uint32_t seq = 0;
+    int ret;
+
+    if (lfs_file_open(lfs, &file, SIM_LOG_FILE, LFS_O_RDONLY) >= 0) {
+        while ((ret = lfs_file_read(lfs, &file, &rec, sizeof(rec))) == (int)sizeof(rec)) {
+            if ((rec.magic != SIM_LOG_MAGIC) || (rec.seq != seq) ||
+                (rec.crc != SimCrc32(&rec, offsetof(struct SimLogRecord, crc)))) {
+                printf("  log record %u corrupted\n", seq);
+                lfs_file_close(lfs, &file);
+                return -1;
+            }
+            seq++;
+        }
+        lfs_file_close(lfs, &file);
+        if (ret != 0) {
+            printf("  log has a torn record after %u records\n", seq);
+            return -1;
+        }
+    }
+
+    if (lfs_file_open(lfs, &file, SIM_CFG_FILE, LFS_O_RDONLY) >= 0) {
+        ret = lfs_file_read(lfs, &file, &cfg, sizeof(cfg));
+        lfs_file_close(lfs, &file);
+        if ((ret != (int)sizeof(cfg)) || (cfg.magic != SIM_CFG_MAGIC) ||
+            (cfg.crc != SimCrc32(&cfg, offsetof(struct SimCfgRecord, crc)))) {
+            printf("  config file is torn\n");
+            return -1;
+        }
+    }
+
+    *records = seq;
+    return 0;
+}
+
+static int SimFreshMount(void)
+{
+    /* drops both a board mount and a verification mount made behind the board code's back */
+    HpmLittlefsUnmount(SIM_MOUNT_POINT);
+    HpmSimUmount(SIM_MOUNT_POINT);
+    HpmXpiNorSimEraseAll();
+    HpmSimSetAutoFormat(1);
+    HpmLittlefsInit();
+    return (HpmSimLfsGet(SIM_MOUNT_POINT) == NULL) ? -1 : 0;
+}
+
+static void SimReport(const struct SimWorkloadResult *res)
+{
+    struct HpmXpiNorSimStats stats;
+    struct HpmLittleCtx *ctx = &g_hpmLittlefsCfgs[0].ctx;
+    HpmXpiNorSimGetStats(&stats);
+
+    printf("appends:          %u\n", res->appends);
+    printf("app bytes:        %llu\n", (unsigned long long)res->appBytes);
+    printf("read ops/bytes:   %llu / %llu\n", (unsigned long long)stats.readOps,
+           (unsigned long long)stats.readBytes);
+    printf("prog ops/bytes:   %llu / %llu\n", (unsigned long long)stats.progOps,
+           (unsigned long long)stats.progBytes);
+    printf("erase ops:        %llu\n", (unsigned long long)stats.eraseOps);
+    printf("write amp:        %.2f\n", res->appBytes ? (double)stats.progBytes / (double)res->appBytes : 0.0);
+    printf("pre-erased:       %u (%u erases skipped)\n", ctx->preErased, ctx->eraseSkipped);
+    printf("modelled time:    %.3f ms\n", (double)stats.timeNs / 1e6);
+    if (res->appends != 0) {
+        printf("append avg/max:   %.3f / %.3f ms\n", (double)res->totalAppendNs / res->appends / 1e6,
+               (double)res->maxAppendNs / 1e6);
+    }
+
+    struct HpmLittlefsWearStats wear;
+    if (HpmLittlefsWearGet(SIM_MOUNT_POINT, &wear) == 0) {
+        printf("block erases:     min %u max %u avg %u\n", wear.minErases, wear.maxErases, wear.avgErases);
+        printf("erase histogram: ");
+        for (int i = 0; i < HPM_LFS_WEAR_HIST_BUCKETS; i++) {
+            printf(" %u", wear.hist[i]);
+        }
+        printf(" (buckets of %u)\n", wear.bucketWidth);
+    }
+}
+
+/*
+ * Lose the mount the way a reset does: the board context forgets it without saving the wear
+ * counters and the sim VFS releases it, nothing is read from or written to flash.
+ */
+static void SimForgetMount(void)
+{
+    g_hpmLittlefsCfgs[0].ctx.isMounted = 0;
+    g_hpmLittlefsCfgs[0].ctx.unsavedErases = 0;
+    HpmSimUmount(SIM_MOUNT_POINT);
+}
+
+static int SimPowerCutSweep(uint32_t iterations, uint32_t cuts, uint32_t seed)
+{
+    struct SimWorkloadResult res;
+    struct HpmXpiNorSimStats stats;
+    uint32_t failures = 0;
+
+    /* a clean run tells how many program/erase steps the workload takes */
+    if (SimFreshMount() != 0) {
+        return -1;
+    }
+    HpmXpiNorSimResetStats();
+    if (SimRunWorkload(iterations, &res) != 0) {
+        printf("workload failed without power cut\n");
+        return -1;
+    }
+    HpmXpiNorSimGetStats(&stats);
+
+    uint64_t stride = (stats.steps > cuts) ? (stats.steps / cuts) : 1;
+    printf("power cut sweep: %llu steps, cutting every %llu\n", (unsigned long long)stats.steps,
+           (unsigned long long)stride);
+
+    for (uint64_t step = 1; step <= stats.steps; step += stride) {
+        uint32_t records = 0;
+
+        if (SimFreshMount() != 0) {
+            return -1;
+        }
+        HpmXpiNorSimSetPowerCut(step, seed + (uint32_t)step);
+        (void)SimRunWorkload(iterations, &res);
+        HpmXpiNorSimPowerOn();
+        SimForgetMount();
+
+        HpmSimSetAutoFormat(0);
+        if (mount(NULL, SIM_MOUNT_POINT, "littlefs", 0, &g_hpmLittlefsCfgs[0].cfg) != 0) {
+            printf("step %llu: remount failed\n", (unsigned long long)step);
+            failures++;
+            continue;
+        }
+        if (SimCheckConsistency(HpmSimLfsGet(SIM_MOUNT_POINT), &records) != 0) {
+            printf("step %llu: inconsistent\n", (unsigned long long)step);
+            failures++;
+            continue;
+        }
+        if (records < res.appends) {
+            printf("step %llu: %u synced records lost\n", (unsigned long long)step, res.appends - records);
+            failures++;
+        }
+    }
+
+    printf("power cut sweep: %u failures\n", failures);
+    return (failures == 0) ? 0 : -1;
+}
+
+static void SimUsage(const char *prog)
+{
+    printf("usage: %s [-i image] [-t trace] [-n iterations] [-e idle] [-c cuts] [-s seed]\n"
+           "       [-R ns] [-P us] [-E us] [-r]\n", prog);
+    printf("  -i  flash image file (default hpm_xpi0_nor.img)\n");
+    printf("  -t  write a text trace of every flash operation\n");
+    printf("  -n  workload iterations (default 256)\n");
+    printf("  -e  idle worker steps between two appends (background pre-erase)\n");
+    printf("  -c  run a power cut sweep with this many cut points\n");
+    printf("  -s  seed for partial program/erase on power cut\n");
+    printf("  -R  read time per byte in ns (default 20)\n");
+    printf("  -P  page program time in us (default 400)\n");
+    printf("  -E  sector erase time in us (default 45000)\n");
+    printf("  -r  sleep for the modelled flash time\n");
+}
+
+int main(int argc, char **argv)
+{
+    struct HpmXpiNorSimCfg cfg;
+    struct SimWorkloadResult res;
+    uint32_t iterations = 256;
+    uint32_t cuts = 0;
+    uint32_t seed = 1;
+    int opt;
+    int ret;
+
+    HpmXpiNorSimDefaultCfg(&cfg);
+    while ((opt = getopt(argc, argv, "i:t:n:e:c:s:R:P:E:rh")) != -1) {
+        switch (opt) {
+            case 'i':
+                cfg.imagePath = optarg;
+                break;
+            case 't':
+                cfg.tracePath = optarg;
+                break;
+            case 'n':
+                iterations = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'e':
+                g_simIdleSteps = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                cuts = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                seed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'R':
+                cfg.timing.readNsPerByte = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'P':
+                cfg.timing.pageProgramUs = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'E':
+                cfg.timing.sectorEraseUs = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                cfg.timing.realTime = 1;
+                break;
+            default:
+                SimUsage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if (HpmXpiNorSimOpen(&cfg) != 0) {
+        return 1;
+    }
+
+    if (cuts != 0) {
+        ret = SimPowerCutSweep(iterations, cuts, seed);
+    } else {
+        ret = SimFreshMount();
+        if (ret == 0) {
+            HpmXpiNorSimResetStats();
+            ret = SimRunWorkload(iterations, &res);
+            SimReport(&res);
+        }
+    }
+
+    HpmLittlefsUnmount(SIM_MOUNT_POINT);
+    HpmSimUmount(SIM_MOUNT_POINT);
+    HpmXpiNorSimClose();
+    return (ret == 0) ? 0 : 1;
+}
@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "los_fs.h"
+#include "los_tick.h"
+#include "vfs_mount.h"
+#include "hpm_littlefs_sim_vfs.h"
+#include "hpm_xpi_nor_sim.h"
+
+#define HPM_SIM_MAX_PARTITIONS 8
+#define HPM_SIM_MAX_FILES      8
+
+struct HpmSimPartition {
+    int used;
+    uint32_t addr;
+    uint32_t len;
+};
+
+struct HpmSimMountPoint {
+    int mounted;
+    char path[32];
+    const struct PartitionCfg *part;
+    struct lfs_config cfg;
+    lfs_t lfs;
+    struct MountPoint vfsMp;
+};
+
+struct HpmSimFile {
+    struct HpmSimMountPoint *mp; /* NULL for a free slot */
+    lfs_file_t file;
+};
+
+static struct HpmSimPartition g_simParts[HPM_SIM_MAX_PARTITIONS];
+static struct HpmSimMountPoint g_simMounts[HPM_SIM_MAX_PARTITIONS];
+static struct HpmSimFile g_simFiles[HPM_SIM_MAX_FILES];
+
+/* dummy directory handle handed out for mount point roots */
+static int g_simDirHandle;
+static int g_simAutoFormat = 1;
+
+int LOS_DiskPartition(const char *dev, const char *fsType, int *lengthArray, int *addrArray, int partNum)
+{
+    (void)dev;
+    (void)fsType;
+
+    if ((partNum <= 0) || (partNum > HPM_SIM_MAX_PARTITIONS)) {
+        return -1;
+    }
+    for (int i = 0; i < partNum; i++) {
+        g_simParts[i].used = 1;
+        g_simParts[i].addr = (uint32_t)addrArray[i];
+        g_simParts[i].len = (uint32_t)lengthArray[i];
+    }
+    return 0;
+}
+
+static uint32_t SimChipAddr(const struct lfs_config *c, lfs_block_t block, lfs_off_t off)
+{
+    const struct PartitionCfg *part = c->context;
+    return g_simParts[part->partNo].addr + block * c->block_size + off;
+}
+
+static int SimLfsRead(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size)
+{
+    const struct PartitionCfg *part = c->context;
+    UINT32 addr = SimChipAddr(c, block, off);
+    return (part->readFunc(part->partNo, &addr, buffer, size) == 0) ? LFS_ERR_OK : LFS_ERR_IO;
+}
+
+static int SimLfsProg(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer,
+                      lfs_size_t size)
+{
+    const struct PartitionCfg *part = c->context;
+    UINT32 addr = SimChipAddr(c, block, off);
+    return (part->writeFunc(part->partNo, &addr, buffer, size) == 0) ? LFS_ERR_OK : LFS_ERR_IO;
+}
+
+static int SimLfsErase(const struct lfs_config *c, lfs_block_t block)
+{
+    const struct PartitionCfg *part = c->context;
+    return (part->eraseFunc(part->partNo, SimChipAddr(c, block, 0), c->block_size) == 0) ? LFS_ERR_OK : LFS_ERR_IO;
+}
+
+static int SimLfsSync(const struct lfs_config *c)
+{
+    (void)c;
+    return LFS_ERR_OK;
+}
+
+static struct HpmSimMountPoint *SimFindMount(const char *path)
+{
+    for (int i = 0; i < HPM_SIM_MAX_PARTITIONS; i++) {
+        if (g_simMounts[i].mounted && (strcmp(g_simMounts[i].path, path) == 0)) {
+            return &g_simMounts[i];
+        }
+    }
+    return NULL;
+}
+
+/* The mount holding path, with *rel set to the path inside it */
+static struct HpmSimMountPoint *SimFindMountOf(const char *path, const char **rel)
+{
+    for (int i = 0; i < HPM_SIM_MAX_PARTITIONS; i++) {
+        size_t len = strlen(g_simMounts[i].path);
+        if (g_simMounts[i].mounted && (strncmp(g_simMounts[i].path, path, len) == 0) && (path[len] == '/')) {
+            *rel = path + len + 1;
+            return &g_simMounts[i];
+        }
+    }
+    return NULL;
+}
+
+int HpmSimMount(const char *source, const char *target, const char *fsType, unsigned long mountFlags,
+                const void *data)
+{
+    const struct PartitionCfg *part = data;
+    struct HpmSimMountPoint *mp = NULL;
+    (void)source;
+    (void)mountFlags;
+
+    if ((target == NULL) || (part == NULL) || (strcmp(fsType, "littlefs") != 0) ||
+        (part->partNo < 0) || (part->partNo >= HPM_SIM_MAX_PARTITIONS) || !g_simParts[part->partNo].used) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (SimFindMount(target) != NULL) {
+        errno = EBUSY;
+        return -1;
+    }
+    for (int i = 0; i < HPM_SIM_MAX_PARTITIONS; i++) {
+        if (!g_simMounts[i].mounted) {
+            mp = &g_simMounts[i];
+            break;
+        }
+    }
+    if (mp == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    memset(mp, 0, sizeof(*mp));
+    snprintf(mp->path, sizeof(mp->path), "%s", target);
+    mp->part = part;
+    mp->cfg.context = (void *)part;
+    mp->cfg.read = SimLfsRead;
+    mp->cfg.prog = SimLfsProg;
+    mp->cfg.erase = SimLfsErase;
+    mp->cfg.sync = SimLfsSync;
+    mp->cfg.read_size = part->readSize;
+    mp->cfg.prog_size = part->writeSize;
+    mp->cfg.block_size = part->blockSize;
+    mp->cfg.block_count = part->blockCount;
+    mp->cfg.cache_size = part->cacheSize;
+    mp->cfg.lookahead_size = part->lookaheadSize;
+    mp->cfg.block_cycles = part->blockCycles;
+
+    /* same policy as the LiteOS-M adapter: an unformatted partition is formatted on first mount */
+    int ret = lfs_mount(&mp->lfs, &mp->cfg);
+    if ((ret != LFS_ERR_OK) && g_simAutoFormat) {
+        ret = lfs_format(&mp->lfs, &mp->cfg);
+        if (ret == LFS_ERR_OK) {
+            ret = lfs_mount(&mp->lfs, &mp->cfg);
+        }
+    }
+    if (ret != LFS_ERR_OK) {
+        errno = EIO;
+        return -1;
+    }
+
+    mp->vfsMp.mPath = mp->path;
+    mp->vfsMp.mData = &mp->lfs;
+    mp->mounted = 1;
+    return 0;
+}
+
+void HpmSimSetAutoFormat(int enable)
+{
+    g_simAutoFormat = enable;
+}
+
+int HpmSimUmount(const char *mountPoint)
+{
+    struct HpmSimMountPoint *mp = SimFindMount(mountPoint);
+    if (mp == NULL) {
+        return -1;
+    }
+    /* files left open are dropped like a reset would, lfs_unmount() only releases memory */
+    for (int i = 0; i < HPM_SIM_MAX_FILES; i++) {
+        if (g_simFiles[i].mp == mp) {
+            g_simFiles[i].mp = NULL;
+        }
+    }
+    (void)lfs_unmount(&mp->lfs);
+    mp->mounted = 0;
+    return 0;
+}
+
+struct MountPoint *VfsMpFind(const char *path, const char **pathInMp)
+{
+    struct HpmSimMountPoint *mp = SimFindMount(path);
+    if (pathInMp != NULL) {
+        *pathInMp = "";
+    }
+    return (mp == NULL) ? NULL : &mp->vfsMp;
+}
+
+/* single threaded: the VFS lock is always free */
+int VfsLock(void)
+{
+    return 0;
+}
+
+void VfsUnlock(void)
+{
+}
+
+lfs_t *HpmSimLfsGet(const char *mountPoint)
+{
+    struct HpmSimMountPoint *mp = SimFindMount(mountPoint);
+    return (mp == NULL) ? NULL : &mp->lfs;
+}
+
+DIR *HpmSimOpendir(const char *path)
+{
+    if (SimFindMount(path) == NULL) {
+        errno = ENOENT;
+        return NULL;
+    }
+    return (DIR *)&g_simDirHandle;
+}
+
+int HpmSimClosedir(DIR *dir)
+{
+    return (dir == (DIR *)&g_simDirHandle) ? 0 : -1;
+}
+
+int HpmSimMkdir(const char *path, mode_t mode)
+{
+    (void)mode;
+    /* only mount point roots are created by the board code, and those exist once mounted */
+    if (SimFindMount(path) != NULL) {
+        errno = EEXIST;
+        return -1;
+    }
+    errno = ENOENT;
+    return -1;
+}
+
+static struct HpmSimFile *SimFileGet(int fd)
+{
+    if ((fd < 0) || (fd >= HPM_SIM_MAX_FILES) || (g_simFiles[fd].mp == NULL)) {
+        errno = EBADF;
+        return NULL;
+    }
+    return &g_simFiles[fd];
+}
+
+int HpmSimOpen(const char *path, int oflag, ...)
+{
+    const char *rel = NULL;
+    struct HpmSimMountPoint *mp = SimFindMountOf(path, &rel);
+    int flags = 0;
+
+    if (mp == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    switch (oflag & O_ACCMODE) {
+        case O_RDONLY:
+            flags = LFS_O_RDONLY;
+            break;
+        case O_WRONLY:
+            flags = LFS_O_WRONLY;
+            break;
+        default:
+            flags = LFS_O_RDWR;
+            break;
+    }
+    flags |= (oflag & O_CREAT) ? LFS_O_CREAT : 0;
+    flags |= (oflag & O_EXCL) ? LFS_O_EXCL : 0;
+    flags |= (oflag & O_TRUNC) ? LFS_O_TRUNC : 0;
+    flags |= (oflag & O_APPEND) ? LFS_O_APPEND : 0;
+
+    for (int fd = 0; fd < HPM_SIM_MAX_FILES; fd++) {
+        if (g_simFiles[fd].mp == NULL) {
+            if (lfs_file_open(&mp->lfs, &g_simFiles[fd].file, rel, flags) < 0) {
+                errno = ENOENT;
+                return -1;
+            }
+            g_simFiles[fd].mp = mp;
+            return fd;
+        }
+    }
+    errno = EMFILE;
+    return -1;
+}
+
+ssize_t HpmSimRead(int fd, void *buf, size_t len)
+{
+    struct HpmSimFile *f = SimFileGet(fd);
+    lfs_ssize_t ret;
+
+    if (f == NULL) {
+        return -1;
+    }
+    ret = lfs_file_read(&f->mp->lfs, &f->file, buf, len);
+    if (ret < 0) {
+        errno = EIO;
+        return -1;
+    }
+    return ret;
+}
+
+ssize_t HpmSimWrite(int fd, const void *buf, size_t len)
+{
+    struct HpmSimFile *f = SimFileGet(fd);
+    lfs_ssize_t ret;
+
+    if (f == NULL) {
+        return -1;
+    }
+    ret = lfs_file_write(&f->mp->lfs, &f->file, buf, len);
+    if (ret < 0) {
+        errno = (ret == LFS_ERR_NOSPC) ? ENOSPC : EIO;
+        return -1;
+    }
+    return ret;
+}
+
+int HpmSimClose(int fd)
+{
+    struct HpmSimFile *f = SimFileGet(fd);
+    int ret;
+
+    if (f == NULL) {
+        return -1;
+    }
+    ret = lfs_file_close(&f->mp->lfs, &f->file);
+    f->mp = NULL;
+    if (ret < 0) {
+        errno = EIO;
+        return -1;
+    }
+    return 0;
+}
+
+UINT64 LOS_TickCountGet(VOID)
+{
+    struct HpmXpiNorSimStats stats;
+
+    HpmXpiNorSimGetStats(&stats);
+    return stats.timeNs / (1000000000ULL / LOSCFG_BASE_CORE_TICK_PER_SECOND);
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HPM_LITTLEFS_SIM_VFS_H
+#define HPM_LITTLEFS_SIM_VFS_H
+
+#include "lfs.h"
+
+/*
+ * Minimal stand-in for the LiteOS-M VFS + littlefs adapter: mount() builds an lfs_config from the
+ * board's PartitionCfg exactly like the kernel adapter does, and routes block I/O through the
+ * partition's readFunc/writeFunc/eraseFunc, i.e. through hpm_littlefs_drv.c.
+ */
+
+/* The mounted littlefs instance behind a mount point, NULL if not mounted */
+lfs_t *HpmSimLfsGet(const char *mountPoint);
+
+/* Format-on-mount-failure policy, disabled while checking crash consistency */
+void HpmSimSetAutoFormat(int enable);
+
+/* Drop a mount without syncing anything, as a power cut or reset would */
+int HpmSimUmount(const char *mountPoint);
+
+#endif
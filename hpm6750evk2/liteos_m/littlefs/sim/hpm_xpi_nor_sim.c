@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "hpm_romapi.h"
+#include "hpm_xpi_nor_sim.h"
+
+#define HPM_XPI_NOR_SIM_TAG 0x53494D31U /* "SIM1" */
+
+struct HpmXpiNorSim {
+    struct HpmXpiNorSimCfg cfg;
+    int fd;
+    uint8_t *mem;
+    FILE *trace;
+    int poweredOff;
+    uint64_t cutStep;
+    uint32_t seed;
+    struct HpmXpiNorSimStats stats;
+    struct HpmXpiNorSimOp *log;
+    size_t logCount;
+    size_t logCap;
+};
+
+static struct HpmXpiNorSim g_nor = { .fd = -1 };
+
+static const char *g_opNames[] = {
+    [HPM_XPI_NOR_SIM_OP_READ] = "read",
+    [HPM_XPI_NOR_SIM_OP_PROGRAM] = "program",
+    [HPM_XPI_NOR_SIM_OP_ERASE] = "erase",
+};
+
+static uint32_t SimRand(void)
+{
+    /* xorshift32, deterministic for a given seed so failures can be replayed */
+    uint32_t x = g_nor.seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g_nor.seed = x;
+    return x;
+}
+
+static void SimSpend(uint64_t ns)
+{
+    g_nor.stats.timeNs += ns;
+    if (g_nor.cfg.timing.realTime && ns > 0) {
+        struct timespec ts = {
+            .tv_sec = (time_t)(ns / 1000000000ULL),
+            .tv_nsec = (long)(ns % 1000000000ULL),
+        };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void SimRecord(uint32_t type, uint32_t addr, uint32_t size, int interrupted)
+{
+    if (g_nor.logCount == g_nor.logCap) {
+        size_t cap = g_nor.logCap ? g_nor.logCap * 2 : 4096;
+        struct HpmXpiNorSimOp *log = realloc(g_nor.log, cap * sizeof(*log));
+        if (log == NULL) {
+            return;
+        }
+        g_nor.log = log;
+        g_nor.logCap = cap;
+    }
+
+    struct HpmXpiNorSimOp *op = &g_nor.log[g_nor.logCount];
+    op->seq = g_nor.logCount++;
+    op->timeNs = g_nor.stats.timeNs;
+    op->type = type;
+    op->addr = addr;
+    op->size = size;
+    op->interrupted = interrupted;
+
+    if (g_nor.trace != NULL) {
+        fprintf(g_nor.trace, "%llu %llu %s 0x%08x %u%s\n", (unsigned long long)op->seq,
+                (unsigned long long)op->timeNs, g_opNames[type], addr, size, interrupted ? " POWERCUT" : "");
+    }
+}
+
+/* Returns 1 when this step is the one selected for power cut injection */
+static int SimStep(void)
+{
+    g_nor.stats.steps++;
+    if (g_nor.cutStep != 0 && g_nor.stats.steps == g_nor.cutStep) {
+        g_nor.poweredOff = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int SimRangeValid(uint32_t addr, uint32_t size)
+{
+    return (g_nor.mem != NULL) && (addr < g_nor.cfg.totalSize) && (size <= g_nor.cfg.totalSize - addr);
+}
+
+void HpmXpiNorSimDefaultCfg(struct HpmXpiNorSimCfg *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->imagePath = "hpm_xpi0_nor.img";
+    cfg->totalSize = HPM_XPI_NOR_SIM_TOTAL_SIZE;
+    cfg->sectorSize = HPM_XPI_NOR_SIM_SECTOR_SIZE;
+    cfg->pageSize = HPM_XPI_NOR_SIM_PAGE_SIZE;
+    /* typical figures of a quad SPI NOR at 100MHz: ~50MB/s read, tPP 0.4ms, tSE 45ms */
+    cfg->timing.readNsPerByte = 20;
+    cfg->timing.pageProgramUs = 400;
+    cfg->timing.sectorEraseUs = 45000;
+}
+
+int HpmXpiNorSimOpen(const struct HpmXpiNorSimCfg *cfg)
+{
+    struct stat st;
+
+    if (g_nor.mem != NULL) {
+        HpmXpiNorSimClose();
+    }
+    if ((cfg->sectorSize == 0) || (cfg->pageSize == 0) || (cfg->totalSize % cfg->sectorSize) ||
+        (cfg->sectorSize % cfg->pageSize)) {
+        printf("nor sim: invalid geometry\n");
+        return -1;
+    }
+
+    g_nor.cfg = *cfg;
+    g_nor.fd = open(cfg->imagePath, O_RDWR | O_CREAT, 0644);
+    if (g_nor.fd < 0) {
+        printf("nor sim: open %s failed: %s\n", cfg->imagePath, strerror(errno));
+        return -1;
+    }
+
+    if ((fstat(g_nor.fd, &st) != 0) || (ftruncate(g_nor.fd, cfg->totalSize) != 0)) {
+        printf("nor sim: resize %s failed: %s\n", cfg->imagePath, strerror(errno));
+        close(g_nor.fd);
+        g_nor.fd = -1;
+        return -1;
+    }
+
+    g_nor.mem = mmap(NULL, cfg->totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, g_nor.fd, 0);
+    if (g_nor.mem == MAP_FAILED) {
+        printf("nor sim: mmap %s failed: %s\n", cfg->imagePath, strerror(errno));
+        g_nor.mem = NULL;
+        close(g_nor.fd);
+        g_nor.fd = -1;
+        return -1;
+    }
+
+    /* a new image comes out of the factory erased; ftruncate() zero-filled any new tail */
+    if ((uint32_t)st.st_size < cfg->totalSize) {
+        memset(g_nor.mem + st.st_size, 0xFF, cfg->totalSize - st.st_size);
+    }
+
+    if (cfg->tracePath != NULL) {
+        g_nor.trace = fopen(cfg->tracePath, "w");
+    }
+
+    g_nor.poweredOff = 0;
+    g_nor.cutStep = 0;
+    HpmXpiNorSimResetStats();
+    HpmXpiNorSimClearOpLog();
+    return 0;
+}
+
+void HpmXpiNorSimClose(void)
+{
+    if (g_nor.mem != NULL) {
+        msync(g_nor.mem, g_nor.cfg.totalSize, MS_SYNC);
+        munmap(g_nor.mem, g_nor.cfg.totalSize);
+        g_nor.mem = NULL;
+    }
+    if (g_nor.fd >= 0) {
+        close(g_nor.fd);
+        g_nor.fd = -1;
+    }
+    if (g_nor.trace != NULL) {
+        fclose(g_nor.trace);
+        g_nor.trace = NULL;
+    }
+    free(g_nor.log);
+    g_nor.log = NULL;
+    g_nor.logCount = 0;
+    g_nor.logCap = 0;
+}
+
+void HpmXpiNorSimEraseAll(void)
+{
+    if (g_nor.mem != NULL) {
+        memset(g_nor.mem, 0xFF, g_nor.cfg.totalSize);
+    }
+}
+
+void HpmXpiNorSimSetPowerCut(uint64_t step, uint32_t seed)
+{
+    g_nor.cutStep = (step == 0) ? 0 : g_nor.stats.steps + step;
+    g_nor.seed = (seed == 0) ? 0x2545F491U : seed;
+}
+
+int HpmXpiNorSimIsPoweredOff(void)
+{
+    return g_nor.poweredOff;
+}
+
+void HpmXpiNorSimPowerOn(void)
+{
+    g_nor.poweredOff = 0;
+    g_nor.cutStep = 0;
+}
+
+void HpmXpiNorSimGetStats(struct HpmXpiNorSimStats *stats)
+{
+    *stats = g_nor.stats;
+}
+
+void HpmXpiNorSimResetStats(void)
+{
+    memset(&g_nor.stats, 0, sizeof(g_nor.stats));
+}
+
+const struct HpmXpiNorSimOp *HpmXpiNorSimOpLog(size_t *count)
+{
+    *count = g_nor.logCount;
+    return g_nor.log;
+}
+
+void HpmXpiNorSimClearOpLog(void)
+{
+    g_nor.logCount = 0;
+}
+
+hpm_stat_t rom_xpi_nor_auto_config(XPI_Type *base, xpi_nor_config_t *config, xpi_nor_config_option_t *option)
+{
+    (void)base;
+    (void)option;
+
+    if ((g_nor.mem == NULL) || (config == NULL)) {
+        return status_fail;
+    }
+
+    config->tag = HPM_XPI_NOR_SIM_TAG;
+    config->totalSize = g_nor.cfg.totalSize;
+    config->pageSize = g_nor.cfg.pageSize;
+    config->sectorSize = g_nor.cfg.sectorSize;
+    config->blockSize = HPM_XPI_NOR_SIM_BLOCK_SIZE;
+    return status_success;
+}
+
+hpm_stat_t rom_xpi_nor_get_property(XPI_Type *base, xpi_nor_config_t *config, uint32_t property_id, uint32_t *value)
+{
+    (void)base;
+
+    if ((config == NULL) || (value == NULL) || (config->tag != HPM_XPI_NOR_SIM_TAG)) {
+        return status_invalid_argument;
+    }
+
+    switch (property_id) {
+        case xpi_nor_property_total_size:
+            *value = config->totalSize;
+            break;
+        case xpi_nor_property_page_size:
+            *value = config->pageSize;
+            break;
+        case xpi_nor_property_sector_size:
+            *value = config->sectorSize;
+            break;
+        case xpi_nor_property_block_size:
+            *value = config->blockSize;
+            break;
+        default:
+            return status_invalid_argument;
+    }
+    return status_success;
+}
+
+hpm_stat_t rom_xpi_nor_read(XPI_Type *base, xpi_xfer_channel_t channel, const xpi_nor_config_t *config,
+                            uint32_t *dst, uint32_t start, uint32_t length)
+{
+    (void)base;
+    (void)channel;
+    (void)config;
+
+    if (g_nor.poweredOff) {
+        return status_fail;
+    }
+    if (!SimRangeValid(start, length)) {
+        return status_invalid_argument;
+    }
+
+    memcpy(dst, g_nor.mem + start, length);
+    g_nor.stats.readOps++;
+    g_nor.stats.readBytes += length;
+    SimSpend((uint64_t)length * g_nor.cfg.timing.readNsPerByte);
+    SimRecord(HPM_XPI_NOR_SIM_OP_READ, start, length, 0);
+    return status_success;
+}
+
+hpm_stat_t rom_xpi_nor_program(XPI_Type *base, xpi_xfer_channel_t channel, const xpi_nor_config_t *config,
+                               const uint32_t *src, uint32_t dst_addr, uint32_t length)
+{
+    const uint8_t *data = (const uint8_t *)src;
+    uint32_t pageSize = g_nor.cfg.pageSize;
+    (void)base;
+    (void)channel;
+    (void)config;
+
+    if (g_nor.poweredOff) {
+        return status_fail;
+    }
+    if (!SimRangeValid(dst_addr, length)) {
+        return status_invalid_argument;
+    }
+
+    g_nor.stats.progOps++;
+    while (length > 0) {
+        /* one page program command never crosses a page boundary */
+        uint32_t chunk = pageSize - (dst_addr % pageSize);
+        uint8_t *cell = g_nor.mem + dst_addr;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        if (SimStep()) {
+            /* the page program was interrupted: only a random prefix of the cells got programmed */
+            uint32_t done = SimRand() % (chunk + 1);
+            for (uint32_t i = 0; i < done; i++) {
+                cell[i] &= data[i];
+            }
+            g_nor.stats.progBytes += done;
+            SimSpend((uint64_t)g_nor.cfg.timing.pageProgramUs * 1000ULL * done / chunk);
+            SimRecord(HPM_XPI_NOR_SIM_OP_PROGRAM, dst_addr, chunk, 1);
+            return status_fail;
+        }
+
+        for (uint32_t i = 0; i < chunk; i++) {
+            cell[i] &= data[i];
+        }
+        g_nor.stats.progBytes += chunk;
+        SimSpend((uint64_t)g_nor.cfg.timing.pageProgramUs * 1000ULL);
+        SimRecord(HPM_XPI_NOR_SIM_OP_PROGRAM, dst_addr, chunk, 0);
+
+        data += chunk;
+        dst_addr += chunk;
+        length -= chunk;
+    }
+    return status_success;
+}
+
+hpm_stat_t rom_xpi_nor_erase_sector(XPI_Type *base, xpi_xfer_channel_t channel, const xpi_nor_config_t *config,
+                                    uint32_t start)
+{
+    uint32_t sectorSize = g_nor.cfg.sectorSize;
+    (void)base;
+    (void)channel;
+    (void)config;
+
+    if (g_nor.poweredOff) {
+        return status_fail;
+    }
+    if ((start % sectorSize) || !SimRangeValid(start, sectorSize)) {
+        return status_invalid_argument;
+    }
+
+    g_nor.stats.eraseOps++;
+    if (SimStep()) {
+        /* an interrupted erase leaves the sector partially erased, the rest keeps stale data */
+        uint32_t done = SimRand() % (sectorSize + 1);
+        memset(g_nor.mem + start, 0xFF, done);
+        SimSpend((uint64_t)g_nor.cfg.timing.sectorEraseUs * 1000ULL * done / sectorSize);
+        SimRecord(HPM_XPI_NOR_SIM_OP_ERASE, start, sectorSize, 1);
+        return status_fail;
+    }
+
+    memset(g_nor.mem + start, 0xFF, sectorSize);
+    SimSpend((uint64_t)g_nor.cfg.timing.sectorEraseUs * 1000ULL);
+    SimRecord(HPM_XPI_NOR_SIM_OP_ERASE, start, sectorSize, 0);
+    return status_success;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HPM_XPI_NOR_SIM_H
+#define HPM_XPI_NOR_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * File-backed model of the XPI0 serial NOR used by hpm_littlefs_drv.c on the host.
+ *
+ * The model follows NOR semantics: erase works on whole sectors and sets every byte to 0xFF,
+ * program can only clear bits (new = old & data) and is split into page program steps the
+ * same way the ROM driver does. Every operation is recorded, its duration is modelled from
+ * HpmXpiNorSimTiming, and a power cut can be injected at any program/erase step.
+ */
+
+#define HPM_XPI_NOR_SIM_TOTAL_SIZE   (16 * 1024 * 1024)
+#define HPM_XPI_NOR_SIM_SECTOR_SIZE  (4 * 1024)
+#define HPM_XPI_NOR_SIM_BLOCK_SIZE   (64 * 1024)
+#define HPM_XPI_NOR_SIM_PAGE_SIZE    (256)
+
+enum HpmXpiNorSimOpType {
+    HPM_XPI_NOR_SIM_OP_READ,
+    HPM_XPI_NOR_SIM_OP_PROGRAM,
+    HPM_XPI_NOR_SIM_OP_ERASE,
+};
+
+struct HpmXpiNorSimTiming {
+    uint32_t readNsPerByte;
+    uint32_t pageProgramUs;
+    uint32_t sectorEraseUs;
+    int realTime; /* also sleep for the modelled time, not only account it */
+};
+
+struct HpmXpiNorSimCfg {
+    const char *imagePath;
+    const char *tracePath; /* optional, one text line per operation */
+    uint32_t totalSize;
+    uint32_t sectorSize;
+    uint32_t pageSize;
+    struct HpmXpiNorSimTiming timing;
+};
+
+struct HpmXpiNorSimOp {
+    uint64_t seq;
+    uint64_t timeNs; /* modelled time when the operation completed */
+    uint32_t type;
+    uint32_t addr;
+    uint32_t size;
+    int interrupted; /* the power cut hit this operation */
+};
+
+struct HpmXpiNorSimStats {
+    uint64_t readOps;
+    uint64_t readBytes;
+    uint64_t progOps;
+    uint64_t progBytes;
+    uint64_t eraseOps;
+    uint64_t steps; /* page program + sector erase steps, the unit of power cut injection */
+    uint64_t timeNs;
+};
+
+/* Fill cfg with the geometry and typical timing of the on-board 16MB QSPI NOR */
+void HpmXpiNorSimDefaultCfg(struct HpmXpiNorSimCfg *cfg);
+int HpmXpiNorSimOpen(const struct HpmXpiNorSimCfg *cfg);
+void HpmXpiNorSimClose(void);
+void HpmXpiNorSimEraseAll(void);
+
+/* Cut the power at the step-th program/erase step from now (1 = the next one); 0 disables injection */
+void HpmXpiNorSimSetPowerCut(uint64_t step, uint32_t seed);
+int HpmXpiNorSimIsPoweredOff(void);
+void HpmXpiNorSimPowerOn(void);
+
+void HpmXpiNorSimGetStats(struct HpmXpiNorSimStats *stats);
+void HpmXpiNorSimResetStats(void);
+const struct HpmXpiNorSimOp *HpmXpiNorSimOpLog(size_t *count);
+void HpmXpiNorSimClearOpLog(void);
+
+#endif
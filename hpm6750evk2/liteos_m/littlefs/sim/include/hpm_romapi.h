@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host shim: XPI NOR ROM API.
+ * The ROM entries are implemented by the flash simulator in hpm_xpi_nor_sim.c.
+ */
+#ifndef HPM_SIM_ROMAPI_H
+#define HPM_SIM_ROMAPI_H
+
+#include "hpm_common.h"
+#include "hpm_soc.h"
+
+typedef enum {
+    xpi_xfer_channel_a1,
+    xpi_xfer_channel_a2,
+    xpi_xfer_channel_b1,
+    xpi_xfer_channel_b2,
+    xpi_xfer_channel_auto,
+} xpi_xfer_channel_t;
+
+typedef enum {
+    xpi_nor_property_total_size,
+    xpi_nor_property_page_size,
+    xpi_nor_property_sector_size,
+    xpi_nor_property_block_size,
+    xpi_nor_property_max,
+} xpi_nor_property_t;
+
+typedef struct {
+    uint32_t U;
+} xpi_nor_config_option_word_t;
+
+typedef struct {
+    xpi_nor_config_option_word_t header;
+    xpi_nor_config_option_word_t option0;
+    xpi_nor_config_option_word_t option1;
+    xpi_nor_config_option_word_t option2;
+} xpi_nor_config_option_t;
+
+typedef struct {
+    uint32_t tag;
+    uint32_t totalSize;
+    uint32_t pageSize;
+    uint32_t sectorSize;
+    uint32_t blockSize;
+} xpi_nor_config_t;
+
+hpm_stat_t rom_xpi_nor_auto_config(XPI_Type *base, xpi_nor_config_t *config, xpi_nor_config_option_t *option);
+hpm_stat_t rom_xpi_nor_get_property(XPI_Type *base, xpi_nor_config_t *config, uint32_t property_id, uint32_t *value);
+hpm_stat_t rom_xpi_nor_read(XPI_Type *base, xpi_xfer_channel_t channel, const xpi_nor_config_t *config,
+                            uint32_t *dst, uint32_t start, uint32_t length);
+hpm_stat_t rom_xpi_nor_program(XPI_Type *base, xpi_xfer_channel_t channel, const xpi_nor_config_t *config,
+                               const uint32_t *src, uint32_t dst_addr, uint32_t length);
+hpm_stat_t rom_xpi_nor_erase_sector(XPI_Type *base, xpi_xfer_channel_t channel, const xpi_nor_config_t *config,
+                                    uint32_t start);
+
+#endif
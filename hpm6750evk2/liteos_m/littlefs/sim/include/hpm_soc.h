@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: XPI0 is backed by the simulator in hpm_xpi_nor_sim.c */
+#ifndef HPM_SIM_SOC_H
+#define HPM_SIM_SOC_H
+
+#include "hpm_common.h"
+
+typedef struct {
+    uint32_t reserved;
+} XPI_Type;
+
+#define HPM_XPI0_BASE (0xF3040000UL)
+
+#endif
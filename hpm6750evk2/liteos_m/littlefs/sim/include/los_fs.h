@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host shim: the LiteOS-M VFS entry points used by hpm_littlefs.c.
+ * mount/umount/opendir/closedir/mkdir and the file calls are routed to the littlefs glue in
+ * hpm_littlefs_sim_vfs.c,
+ * so the board code runs unmodified without touching the host file system.
+ */
+#ifndef HPM_SIM_LOS_FS_H
+#define HPM_SIM_LOS_FS_H
+
+#include <dirent.h>
+#include <sys/types.h>
+#include "los_compiler.h"
+
+struct PartitionCfg {
+    /* partition low-level read func */
+    int  (*readFunc)(int partition, UINT32 *offset, void *buf, UINT32 size);
+    /* partition low-level write func */
+    int  (*writeFunc)(int partition, UINT32 *offset, const void *buf, UINT32 size);
+    /* partition low-level erase func */
+    int  (*eraseFunc)(int partition, UINT32 offset, UINT32 size);
+
+    int readSize;
+    int writeSize;
+    int blockSize;
+    int blockCount;
+    int cacheSize;
+
+    int partNo;
+    int lookaheadSize;
+    int blockCycles;
+};
+
+int LOS_DiskPartition(const char *dev, const char *fsType, int *lengthArray, int *addrArray, int partNum);
+
+int HpmSimMount(const char *source, const char *target, const char *fsType, unsigned long mountFlags,
+                const void *data);
+int HpmSimUmount(const char *target);
+DIR *HpmSimOpendir(const char *path);
+int HpmSimClosedir(DIR *dir);
+int HpmSimMkdir(const char *path, mode_t mode);
+int HpmSimOpen(const char *path, int oflag, ...);
+ssize_t HpmSimRead(int fd, void *buf, size_t len);
+ssize_t HpmSimWrite(int fd, const void *buf, size_t len);
+int HpmSimClose(int fd);
+
+#define mount    HpmSimMount
+#define umount   HpmSimUmount
+#define opendir  HpmSimOpendir
+#define closedir HpmSimClosedir
+#define mkdir    HpmSimMkdir
+#define open     HpmSimOpen
+#define read     HpmSimRead
+#define write    HpmSimWrite
+#define close    HpmSimClose
+
+#endif
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: the simulator is single threaded, interrupt locking is a no-op */
+#ifndef HPM_SIM_LOS_INTERRUPT_H
+#define HPM_SIM_LOS_INTERRUPT_H
+
+#include "los_compiler.h"
+
+static inline UINT32 LOS_IntLock(VOID)
+{
+    return 0;
+}
+
+static inline VOID LOS_IntRestore(UINT32 intSave)
+{
+    (VOID)intSave;
+}
+
+#endif
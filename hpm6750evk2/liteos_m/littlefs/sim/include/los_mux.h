@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: the simulator is single threaded, mutexes always succeed */
+#ifndef HPM_SIM_LOS_MUX_H
+#define HPM_SIM_LOS_MUX_H
+
+#include "los_compiler.h"
+
+#define LOS_WAIT_FOREVER 0xFFFFFFFFU
+
+static inline UINT32 LOS_MuxCreate(UINT32 *muxHandle)
+{
+    *muxHandle = 1;
+    return LOS_OK;
+}
+
+static inline UINT32 LOS_MuxPend(UINT32 muxHandle, UINT32 timeout)
+{
+    (VOID)muxHandle;
+    (VOID)timeout;
+    return LOS_OK;
+}
+
+static inline UINT32 LOS_MuxPost(UINT32 muxHandle)
+{
+    (VOID)muxHandle;
+    return LOS_OK;
+}
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host shim: tasks are not started on the host. Background work is driven explicitly by the
+ * runner through the step functions the task loops would call (e.g. HpmLittlefsIdleStep()).
+ */
+#ifndef HPM_SIM_LOS_TASK_H
+#define HPM_SIM_LOS_TASK_H
+
+#include "los_compiler.h"
+
+#define OS_TASK_PRIORITY_LOWEST     31
+#define LOS_TASK_STATUS_DETACHED    0x0100U
+#define LOS_ERRNO_TSK_ID_INVALID    0x02000207U
+
+typedef VOID *(*TSK_ENTRY_FUNC)(UINT32 arg);
+
+typedef struct {
+    TSK_ENTRY_FUNC pfnTaskEntry;
+    UINT16 usTaskPrio;
+    UINT32 uwArg;
+    UINT32 uwStackSize;
+    CHAR *pcName;
+    UINT32 uwResved;
+} TSK_INIT_PARAM_S;
+
+static inline UINT32 LOS_TaskCreate(UINT32 *taskID, TSK_INIT_PARAM_S *initParam)
+{
+    (VOID)initParam;
+    *taskID = 1;
+    return LOS_OK;
+}
+
+static inline UINT32 LOS_TaskDelay(UINT32 tick)
+{
+    (VOID)tick;
+    return LOS_OK;
+}
+
+static inline UINT32 LOS_TaskYield(VOID)
+{
+    return LOS_OK;
+}
+
+#endif
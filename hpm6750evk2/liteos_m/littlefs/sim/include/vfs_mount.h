@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: the part of the LiteOS-M mount table the board code looks at */
+#ifndef HPM_SIM_VFS_MOUNT_H
+#define HPM_SIM_VFS_MOUNT_H
+
+struct MountPoint {
+    const char *mPath;
+    void *mData; /* lfs_t of the mount */
+};
+
+struct MountPoint *VfsMpFind(const char *path, const char **pathInMp);
+
+#endif
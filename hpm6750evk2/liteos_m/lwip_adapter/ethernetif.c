@@ -23,9 +23,28 @@
 #include "lwip/timeouts.h"
 #include "ethernetif.h"
 #include "hpm_enet_drv.h"
+#include "hpm_enet_offload.h"
+#include "hpm_enet_raw.h"
+#include "hpm_enet_bridge.h"
+#include "hpm_enet_qos.h"
+#include "hpm_enet_pcap.h"
+#include "hpm_dma_buf.h"
+#include "hpm_mchtmr_drv.h"
 #include <string.h>
 #include <los_task.h>
 #include <los_sem.h>
+#include <los_mux.h>
+#include <los_interrupt.h>
+
+#define ETHERNETIF_RX_SHARED_MAX 2
+
+/* the RX task polling every device with rxShared set */
+static struct {
+    uint32_t semHandle;
+    uint32_t taskId;
+    uint32_t num;
+    struct netif *netifs[ETHERNETIF_RX_SHARED_MAX];
+} g_ethernetif_rx_shared;
 
 /**
 * In this function, the hardware should be initialized.
@@ -48,8 +67,8 @@ static void low_level_init(struct netif *netif)
     netif->hwaddr[4] =  dev->macAddr[4];
     netif->hwaddr[5] =  dev->macAddr[5];
 
-    /* set netif maximum transfer unit */
-    netif->mtu = 1500;
+    /* set netif maximum transfer unit, enetDevInit() checked it against the MAC */
+    netif->mtu = dev->mtu;
 
     /* need to judge from phy status */
     netif->flags |= NETIF_FLAG_LINK_UP;
@@ -75,9 +94,8 @@ static void low_level_init(struct netif *netif)
 *       dropped because of memory failure (except for the TCP timers).
 */
 
-static err_t low_level_output(struct netif *netif, struct pbuf *p)
+err_t ethernetif_copy_output(struct HpmEnetDevice *dev, struct pbuf *p)
 {
-    struct HpmEnetDevice *dev = (struct HpmEnetDevice *)netif->state;
     enet_desc_t *desc = &dev->desc;
     uint32_t tx_buff_size = desc->tx_buff_cfg.size;
     struct pbuf *q;
@@ -89,6 +107,13 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
     uint32_t payload_offset = 0;
     enet_tx_desc_t  *tx_desc_list_cur = desc->tx_desc_list_cur;
 
+    /* all descriptors of the frame must be free before any of it is copied */
+    if (!ethernetif_tx_ready(dev, p->tot_len))
+    {
+        return ERR_MEM;
+    }
+
+    HpmEnetPcapPbuf(dev, HPM_ENET_PCAP_TX, p);
     dma_tx_desc = tx_desc_list_cur;
     buffer = (uint8_t *)(dma_tx_desc->tdes2_bm.buffer1);
     buffer_offset = 0;
@@ -108,16 +133,12 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
                     (uint8_t *)((uint8_t *)q->payload + payload_offset),
                     tx_buff_size - buffer_offset);
 
-            /* Point to next descriptor */
-            dma_tx_desc = (enet_tx_desc_t *)(dma_tx_desc->tdes3_bm.next_desc);
-
-            /* Check if the buffer is available */
-            if (dma_tx_desc->tdes0_bm.own != 0)
-            {
-                printf("DMA tx desc buffer is not valid\n");
-                return ERR_USE;
+            if (dev->buffCached) {
+                HpmDmaSyncForDevice(buffer, tx_buff_size);
             }
 
+            /* Point to next descriptor, checked free above */
+            dma_tx_desc = (enet_tx_desc_t *)(dma_tx_desc->tdes3_bm.next_desc);
             buffer = (uint8_t *)(dma_tx_desc->tdes2_bm.buffer1);
 
             bytes_left_to_copy = bytes_left_to_copy - (tx_buff_size - buffer_offset);
@@ -135,6 +156,10 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
         frame_length = frame_length + bytes_left_to_copy;
     }
 
+    if (dev->buffCached) {
+        HpmDmaSyncForDevice(buffer, buffer_offset);
+    }
+
     /* Prepare transmit descriptors to give to DMA */
 
 
@@ -144,15 +169,123 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
     return ERR_OK;
 }
 
+int ethernetif_tx_ready(struct HpmEnetDevice *dev, uint32_t len)
+{
+    enet_desc_t *desc = &dev->desc;
+    enet_tx_desc_t *dma_tx_desc = desc->tx_desc_list_cur;
+    /* as enet_prepare_transmission_descriptors() splits it, CRC included */
+    uint32_t count = (len + 4U + desc->tx_buff_cfg.size - 1U) / desc->tx_buff_cfg.size;
+
+    if (count > desc->tx_buff_cfg.count) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (dma_tx_desc->tdes0_bm.own != 0) {
+            return 0;
+        }
+        dma_tx_desc = (enet_tx_desc_t *)(dma_tx_desc->tdes3_bm.next_desc);
+    }
+    return 1;
+}
+
+err_t ethernetif_port_output(struct HpmEnetDevice *dev, struct pbuf *p)
+{
+#if HPM_ENET_QOS_ENABLE
+    return HpmEnetQosOutput(dev, p);
+#else
+    err_t err;
+
+    LOS_MuxPend(dev->txMux, LOS_WAIT_FOREVER);
+    err = ethernetif_copy_output(dev, p);
+    LOS_MuxPost(dev->txMux);
+    return err;
+#endif
+}
+
+static err_t low_level_output(struct netif *netif, struct pbuf *p)
+{
+#if HPM_ENET_BRIDGE_ENABLE
+    (void)netif;
+    return HpmEnetBridgeOutput(p);
+#else
+    return ethernetif_port_output((struct HpmEnetDevice *)netif->state, p);
+#endif
+}
+
+int ethernetif_tx_frame(struct HpmEnetDevice *dev, const void *frame, uint32_t len)
+{
+    enet_desc_t *desc = &dev->desc;
+    int ret = -1;
+
+    /* the frame goes to one buffer, with the CRC counted by the descriptors it must stay one */
+    if (len + 4U > desc->tx_buff_cfg.size) {
+        return -1;
+    }
+
+    LOS_MuxPend(dev->txMux, LOS_WAIT_FOREVER);
+    enet_tx_desc_t *dma_tx_desc = desc->tx_desc_list_cur;
+    if (ethernetif_tx_ready(dev, len)) {
+        uint8_t *buffer = (uint8_t *)dma_tx_desc->tdes2_bm.buffer1;
+        HpmEnetPcapBuf(dev, HPM_ENET_PCAP_TX, (const uint8_t *)frame, len);
+        memcpy(buffer, frame, len);
+        if (dev->buffCached) {
+            HpmDmaSyncForDevice(buffer, len);
+        }
+        /* same length convention as ethernetif_copy_output() */
+        enet_prepare_transmission_descriptors(dev->base, &desc->tx_desc_list_cur, len + 4U, desc->tx_buff_cfg.size);
+        ret = 0;
+    }
+    LOS_MuxPost(dev->txMux);
+    return ret;
+}
+
+/*
+ * Frames that never reach lwIP, handled in place: the bridge forwards or filters, then raw
+ * EtherTypes go to their handler. Only the first cache line is synced to look at the header,
+ * both sync the rest if they take the frame. Frames spanning descriptors go to lwIP.
+ * Returns 1 if the descriptor went back to the DMA.
+ */
+static int low_level_fast_input(struct HpmEnetDevice *dev, enet_frame_t *frame)
+{
+    enet_desc_t *desc = &dev->desc;
+    uint8_t *buffer = (uint8_t *)frame->buffer;
+    int taken = 0;
+
+    if (desc->rx_frame_info.seg_count != 1) {
+        return 0;
+    }
+    if (dev->buffCached) {
+        HpmDmaSyncForCpu(buffer, HPM_L1C_CACHELINE_SIZE);
+    }
+#if HPM_ENET_BRIDGE_ENABLE
+    taken = !HpmEnetBridgeInput(dev, buffer, frame->length);
+#endif
+    if (!taken && !HpmEnetRawInput(dev, buffer, frame->length)) {
+        return 0;
+    }
+
+    if (g_hpmEnetPcapActive) {
+        /* a filtered frame has only its first cache line synced */
+        if (dev->buffCached) {
+            HpmDmaSyncForCpu(buffer, frame->length);
+        }
+        HpmEnetPcapBuf(dev, HPM_ENET_PCAP_RX, buffer, frame->length);
+    }
+    frame->rx_desc->rdes0_bm.own = 1;
+    desc->rx_frame_info.seg_count = 0;
+    return 1;
+}
+
 /**
 * Should allocate a pbuf and transfer the bytes of the incoming
 * packet from the interface into the pbuf.
 *
 * @param netif the lwip network interface structure for this ethernetif
-* @return a pbuf filled with the received packet (including MAC header)
-*         NULL on memory error
+* @param out a pbuf filled with the received packet (including MAC header),
+*        NULL if the frame was bridged, taken by a raw handler or dropped for lack of pbufs
+* @return 1 if a frame was taken off the ring, 0 if it is empty
 */
-static struct pbuf *low_level_input(struct netif *netif)
+static int low_level_input(struct netif *netif, struct pbuf **out)
 {
     struct HpmEnetDevice *dev = (struct HpmEnetDevice *)netif->state;
     enet_desc_t *desc = &dev->desc;
@@ -167,7 +300,14 @@ static struct pbuf *low_level_input(struct netif *netif)
     uint32_t bytes_left_to_copy = 0;
     uint32_t i = 0;
 
-    /* Get a received frame */
+#if HPM_ENET_OFFLOAD_ENABLE
+    if (dev->offload) {
+        return HpmEnetOffloadInput(dev, out);
+    }
+#endif
+
+    *out = NULL;
+    /* Get a received frame, bridged frames and raw EtherTypes are handled without lwIP */
     frame = enet_get_received_frame_interrupt(&desc->rx_desc_list_cur,
                                               &desc->rx_frame_info,
                                               desc->rx_buff_cfg.count);
@@ -176,15 +316,30 @@ static struct pbuf *low_level_input(struct netif *netif)
     len = frame.length;
     buffer = (uint8_t *)frame.buffer;
 
-    if (len > 0)
+    if (len == 0)
     {
-        /* allocate a pbuf chain of pbufs from the Lwip buffer pool */
-        p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+        return 0;
     }
+    if (low_level_fast_input(dev, &frame))
+    {
+        return 1;
+    }
+
+    /* allocate a pbuf chain of pbufs from the Lwip buffer pool */
+    p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
 
     if (p != NULL)
     {
         dma_rx_desc = frame.rx_desc;
+        if (dev->buffCached) {
+            /* drop whatever the cache holds of the buffers of this frame */
+            for (bytes_left_to_copy = len; bytes_left_to_copy > 0; bytes_left_to_copy -= buffer_offset) {
+                buffer_offset = (bytes_left_to_copy > rx_buff_size) ? rx_buff_size : bytes_left_to_copy;
+                HpmDmaSyncForCpu((void *)dma_rx_desc->rdes2_bm.buffer1, buffer_offset);
+                dma_rx_desc = (enet_rx_desc_t *)(dma_rx_desc->rdes3_bm.next_desc);
+            }
+            dma_rx_desc = frame.rx_desc;
+        }
         buffer_offset = 0;
         for (q = p; q != NULL; q = q->next)
         {
@@ -212,7 +367,11 @@ static struct pbuf *low_level_input(struct netif *netif)
     }
     else
     {
-        return NULL;
+        /*
+         * Out of pool pbufs the frame is dropped: descriptors kept by the CPU would stop the DMA
+         * once it wraps around to them.
+         */
+        dev->rxStats.noMem++;
     }
 
     /* Release descriptors to DMA */
@@ -229,7 +388,9 @@ static struct pbuf *low_level_input(struct netif *netif)
     /* Clear Segment_Count */
     desc->rx_frame_info.seg_count = 0;
 
-    return p;
+    /* a dropped frame still counts, the frames behind it are read in this round */
+    *out = p;
+    return 1;
 }
 
 
@@ -246,26 +407,66 @@ static struct pbuf *low_level_input(struct netif *netif)
  /*
   invoked after receiving data packet
  */
-err_t ethernetif_input(struct netif *netif)
+uint32_t ethernetif_input(struct netif *netif, uint32_t budget)
 {
     err_t err;
     struct pbuf *p = NULL;
-    /* move received packet into a new pbuf */
-    while ((p = low_level_input(netif)) != NULL) {
-        /* no packet could be read, silently ignore this */
+    uint32_t frames = 0;
+#if HPM_ENET_BRIDGE_ENABLE
+    /* every port delivers to the netif of the bridge */
+    struct netif *upper = HpmEnetBridgeNetif();
+#else
+    struct netif *upper = netif;
+#endif
+    /* move received packet into a new pbuf, bridged, raw and dropped frames count against the budget too */
+    while ((frames < budget) && low_level_input(netif, &p)) {
+        frames++;
         if (p == NULL) {
-            return ERR_MEM;
+            continue;
         }
+        HpmEnetPcapPbuf((struct HpmEnetDevice *)netif->state, HPM_ENET_PCAP_RX, p);
 
         /* entry point to the LwIP stack */
-        err = netif->input(p, netif);
+        err = upper->input(p, upper);
 
         if (err != ERR_OK) {
             LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_input: IP input error\n"));
             pbuf_free(p);
         }
     }
-    return err;
+    return frames;
+}
+
+/* One budget of RX work for the device of netif: 1 if frames are left for another round */
+static int ethernetif_rx_round(struct netif *netif)
+{
+    struct HpmEnetDevice *dev = (struct HpmEnetDevice *)netif->state;
+    struct HpmEnetRxStats *stats = &dev->rxStats;
+    uint32_t start = (uint32_t)mchtmr_get_count(HPM_MCHTMR);
+    uint32_t frames;
+    uint32_t ticks;
+    int more;
+
+#if HPM_ENET_QOS_ENABLE
+    /* the wakeup may also be a TX complete with frames waiting in the traffic classes */
+    HpmEnetQosKick(dev);
+#endif
+    frames = ethernetif_input(netif, dev->rxBudget);
+    more = (frames == dev->rxBudget);
+#if HPM_ENET_OFFLOAD_ENABLE
+    /* the doorbell is armed again once the ring is drained */
+    if (dev->offload && !more) {
+        more = HpmEnetOffloadRearm();
+    }
+#endif
+
+    ticks = (uint32_t)mchtmr_get_count(HPM_MCHTMR) - start;
+    stats->rounds++;
+    stats->overBudget += (uint32_t)more;
+    stats->frames += frames;
+    stats->busyTicks += ticks;
+    stats->maxRoundTicks = (ticks > stats->maxRoundTicks) ? ticks : stats->maxRoundTicks;
+    return more;
 }
 
 static VOID *ethernetif_recv_thread(UINT32 arg)
@@ -274,9 +475,38 @@ static VOID *ethernetif_recv_thread(UINT32 arg)
     struct HpmEnetDevice *dev = (struct HpmEnetDevice *)netif->state;
 
     while (1) {
-        LOS_SemPend(dev->rxSemHandle, 0xffffffff);
-        ethernetif_input(netif);
+        LOS_SemPend(dev->rxSemHandle, LOS_WAIT_FOREVER);
+        dev->rxStats.wakeups++;
+        while (ethernetif_rx_round(netif)) {
+            LOS_TaskYield();
+        }
+    }
+    return NULL;
+}
+
+/* RX of every device with rxShared set, round robin one budget each until all are drained */
+static VOID *ethernetif_shared_recv_thread(UINT32 arg)
+{
+    uint32_t i;
+    int more;
+    (void)arg;
+
+    while (1) {
+        LOS_SemPend(g_ethernetif_rx_shared.semHandle, LOS_WAIT_FOREVER);
+        for (i = 0; i < g_ethernetif_rx_shared.num; i++) {
+            ((struct HpmEnetDevice *)g_ethernetif_rx_shared.netifs[i]->state)->rxStats.wakeups++;
+        }
+        do {
+            more = 0;
+            for (i = 0; i < g_ethernetif_rx_shared.num; i++) {
+                more |= ethernetif_rx_round(g_ethernetif_rx_shared.netifs[i]);
+            }
+            if (more) {
+                LOS_TaskYield();
+            }
+        } while (more);
     }
+    return NULL;
 }
 
 static __attribute__((section(".interrupt.text"))) VOID hpm_enet_isr(VOID *parm)
@@ -293,36 +523,86 @@ static __attribute__((section(".interrupt.text"))) VOID hpm_enet_isr(VOID *parm)
     if (ENET_DMA_STATUS_RI_GET(status)) {
         dev->base->DMA_STATUS |= ENET_DMA_STATUS_RI_SET(ENET_DMA_STATUS_RI_GET(status));
         LOS_SemPost(dev->rxSemHandle);
+#if HPM_ENET_QOS_ENABLE
+    } else if (ENET_DMA_STATUS_TI_GET(status)) {
+        /* one shot, HpmEnetQosKick() enables it again if frames still wait */
+        dev->base->DMA_STATUS |= ENET_DMA_STATUS_TI_SET(ENET_DMA_STATUS_TI_GET(status));
+        dev->base->DMA_INTR_EN &= ~ENET_DMA_INTR_EN_TIE_MASK;
+        LOS_SemPost(dev->rxSemHandle);
+#endif
     } else {
         printf("error ---status = 0x%X\n", status);
     }
 }
 
-void ethernetif_recv_start(struct netif *netif)
+static UINT32 ethernetif_task_create(const char *name, TSK_ENTRY_FUNC entry, UINT32 arg,
+                                     struct HpmEnetDevice *dev)
 {
-    struct HpmEnetDevice *dev = (struct HpmEnetDevice *)netif->state;
     UINT32 taskID = LOS_ERRNO_TSK_ID_INVALID;
     UINT32 ret;
     TSK_INIT_PARAM_S task = {0};
 
-    LOS_SemCreate(0, &dev->rxSemHandle);
-
-    HwiIrqParam irqParam;
-    irqParam.pDevId = netif;
-    LOS_HwiCreate(HPM2LITEOS_IRQ(dev->irqNum), 1, 0, (HWI_PROC_FUNC)hpm_enet_isr, &irqParam);
-    LOS_HwiEnable(HPM2LITEOS_IRQ(dev->irqNum));
-
-    /* Create host Task */
-    task.pfnTaskEntry = (TSK_ENTRY_FUNC)ethernetif_recv_thread;
-    task.uwStackSize = 4096;
-    task.pcName = (char *)(dev->name);
-    task.usTaskPrio = 3;
-    task.uwArg = (UINTPTR)netif;
+    task.pfnTaskEntry = entry;
+    task.uwStackSize = dev->rxTaskStack;
+    task.pcName = (char *)name;
+    task.usTaskPrio = dev->rxTaskPrio;
+    task.uwArg = arg;
     task.uwResved = LOS_TASK_STATUS_DETACHED;
     ret = LOS_TaskCreate(&taskID, &task);
     if (ret != LOS_OK) {
         LWIP_DEBUGF(SYS_DEBUG, ("sys_thread_new: LOS_TaskCreate error %u\n", ret));
-        return -1;
+        return LOS_ERRNO_TSK_ID_INVALID;
+    }
+    return taskID;
+}
+
+void ethernetif_recv_start(struct netif *netif)
+{
+    struct HpmEnetDevice *dev = (struct HpmEnetDevice *)netif->state;
+
+    dev->rxTaskPrio = (dev->rxTaskPrio != 0) ? dev->rxTaskPrio : HPM_ENET_RX_TASK_PRIO;
+    dev->rxTaskStack = (dev->rxTaskStack != 0) ? dev->rxTaskStack : HPM_ENET_RX_TASK_STACK;
+    dev->rxBudget = (dev->rxBudget != 0) ? dev->rxBudget : HPM_ENET_RX_BUDGET;
+
+    /* binary: a wakeup drains the ring, interrupts meanwhile only ask for one more look */
+    if (!dev->rxShared) {
+        LOS_BinarySemCreate(0, &dev->rxSemHandle);
+    } else if (g_ethernetif_rx_shared.num == 0) {
+        LOS_BinarySemCreate(0, &g_ethernetif_rx_shared.semHandle);
+        dev->rxSemHandle = g_ethernetif_rx_shared.semHandle;
+    } else {
+        dev->rxSemHandle = g_ethernetif_rx_shared.semHandle;
+    }
+    LOS_MuxCreate(&dev->txMux);
+#if HPM_ENET_QOS_ENABLE
+    HpmEnetQosInit(dev);
+#endif
+
+    /* Create host Task, the shared one comes with its first device */
+    if (!dev->rxShared) {
+        dev->rxTaskId = ethernetif_task_create(dev->name, (TSK_ENTRY_FUNC)ethernetif_recv_thread, (UINTPTR)netif, dev);
+    } else {
+        uint32_t intSave = LOS_IntLock();
+        g_ethernetif_rx_shared.netifs[g_ethernetif_rx_shared.num++] = netif;
+        LOS_IntRestore(intSave);
+        if (g_ethernetif_rx_shared.num == 1) {
+            g_ethernetif_rx_shared.taskId = ethernetif_task_create("enet_rx",
+                                                                   (TSK_ENTRY_FUNC)ethernetif_shared_recv_thread, 0, dev);
+        }
+        dev->rxTaskId = g_ethernetif_rx_shared.taskId;
+    }
+
+#if HPM_ENET_OFFLOAD_ENABLE
+    if (dev->offload) {
+        HpmEnetOffloadIrqInit(dev);
+    }
+#endif
+    /* an offloaded MAC still interrupts on TX complete for the traffic classes */
+    if (!dev->offload || HPM_ENET_QOS_ENABLE) {
+        HwiIrqParam irqParam;
+        irqParam.pDevId = netif;
+        LOS_HwiCreate(HPM2LITEOS_IRQ(dev->irqNum), 1, 0, (HWI_PROC_FUNC)hpm_enet_isr, &irqParam);
+        LOS_HwiEnable(HPM2LITEOS_IRQ(dev->irqNum));
     }
 }
 
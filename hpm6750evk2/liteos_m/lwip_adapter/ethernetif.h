@@ -25,8 +25,33 @@
 extern "C" {
 #endif
 
+struct HpmEnetDevice;
+
 err_t ethernetif_init(struct netif *netif);
-err_t ethernetif_input(struct netif *netif);
+
+/* Hand up to budget received frames of netif to lwIP, returns how many there were */
+uint32_t ethernetif_input(struct netif *netif, uint32_t budget);
+
+/* Hook the MAC interrupt and start the RX task of netif->state, or join the shared one */
+void ethernetif_recv_start(struct netif *netif);
+
+/* Send a pbuf chain on the MAC of dev, serialized with the other senders */
+err_t ethernetif_port_output(struct HpmEnetDevice *dev, struct pbuf *p);
+
+/*
+ * Copy a pbuf chain into the TX descriptors and start them; the caller holds dev->txMux.
+ * ERR_MEM, nothing copied, if the MAC still owns one of the descriptors the frame needs.
+ */
+err_t ethernetif_copy_output(struct HpmEnetDevice *dev, struct pbuf *p);
+
+/* Enough free TX descriptors for a frame of len bytes without CRC; the caller holds dev->txMux */
+int ethernetif_tx_ready(struct HpmEnetDevice *dev, uint32_t len);
+
+/*
+ * Copy one frame without CRC into the next TX descriptor; -1 if it does not fit a single TX buffer
+ * together with its CRC, or the descriptor is not free
+ */
+int ethernetif_tx_frame(struct HpmEnetDevice *dev, const void *frame, uint32_t len);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <los_interrupt.h>
+#include <los_tick.h>
+#include "lwip/prot/ethernet.h"
+#include "hpm_mchtmr_drv.h"
+#include "hpm_dma_buf.h"
+#include "ethernetif.h"
+#include "hpm_enet_bridge.h"
+#include "ohos_init.h"
+#ifdef LOSCFG_SHELL
+#include "shcmd.h"
+#endif
+
+#if HPM_ENET_BRIDGE_ENABLE
+
+#define HPM_ENET_BRIDGE_PORTS       2
+#define HPM_ENET_BRIDGE_FLOOD       0xFFFFFFFFU
+
+struct HpmEnetBridgeFdbEntry {
+    uint8_t mac[ETH_HWADDR_LEN];
+    uint8_t valid;
+    uint8_t port;
+    UINT64 seen; /* tick */
+};
+
+struct HpmEnetBridge {
+    struct HpmEnetDevice *ports[HPM_ENET_BRIDGE_PORTS];
+    struct HpmEnetBridgeFdbEntry fdb[HPM_ENET_BRIDGE_FDB_SIZE];
+    struct HpmEnetBridgeStats stats;
+};
+
+static struct HpmEnetBridge g_hpmEnetBridge;
+
+static inline uint32_t HpmEnetBridgeHash(const uint8_t *mac)
+{
+    return (uint32_t)(mac[3] ^ mac[4] ^ mac[5]) & (HPM_ENET_BRIDGE_FDB_SIZE - 1U);
+}
+
+static int HpmEnetBridgeIsLocal(const uint8_t *mac)
+{
+    for (uint32_t i = 0; i < HPM_ENET_BRIDGE_PORTS; i++) {
+        struct HpmEnetDevice *port = g_hpmEnetBridge.ports[i];
+        if ((port != NULL) && (memcmp(port->macAddr, mac, ETH_HWADDR_LEN) == 0)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void HpmEnetBridgeLearn(const uint8_t *mac, uint32_t port)
+{
+    struct HpmEnetBridgeFdbEntry *entry = &g_hpmEnetBridge.fdb[HpmEnetBridgeHash(mac)];
+    UINT64 now = LOS_TickCountGet();
+
+    /* group addresses are never a source */
+    if (mac[0] & 1U) {
+        return;
+    }
+    /* both RX tasks learn, an entry changes only with interrupts locked */
+    uint32_t intSave = LOS_IntLock();
+    if (!entry->valid || (entry->port != port) || (memcmp(entry->mac, mac, ETH_HWADDR_LEN) != 0)) {
+        memcpy(entry->mac, mac, ETH_HWADDR_LEN);
+        entry->port = (uint8_t)port;
+        entry->valid = 1;
+    }
+    entry->seen = now;
+    LOS_IntRestore(intSave);
+}
+
+/* Port the unicast destination was learned on, HPM_ENET_BRIDGE_FLOOD if unknown or aged out */
+static uint32_t HpmEnetBridgeLookup(const uint8_t *mac)
+{
+    struct HpmEnetBridgeFdbEntry *entry = &g_hpmEnetBridge.fdb[HpmEnetBridgeHash(mac)];
+    UINT64 age = (UINT64)HPM_ENET_BRIDGE_AGE_SECONDS * LOSCFG_BASE_CORE_TICK_PER_SECOND;
+    uint32_t port = HPM_ENET_BRIDGE_FLOOD;
+
+    uint32_t intSave = LOS_IntLock();
+    if (entry->valid && (memcmp(entry->mac, mac, ETH_HWADDR_LEN) == 0) &&
+        (LOS_TickCountGet() - entry->seen < age)) {
+        port = entry->port;
+    }
+    LOS_IntRestore(intSave);
+    return port;
+}
+
+static uint32_t HpmEnetBridgePortOf(const struct HpmEnetDevice *dev)
+{
+    return (dev == g_hpmEnetBridge.ports[0]) ? 0U : 1U;
+}
+
+void HpmEnetBridgeAddPort(struct HpmEnetDevice *dev)
+{
+    /* every frame on the wire, not only those for our MAC */
+    dev->base->MACFF |= ENET_MACFF_PR_MASK;
+    g_hpmEnetBridge.ports[dev->isDefault ? 0 : 1] = dev;
+    g_hpmEnetBridge.stats.fwdMinTicks = UINT32_MAX;
+}
+
+int HpmEnetBridgeInput(struct HpmEnetDevice *dev, const uint8_t *frame, uint32_t len)
+{
+    struct HpmEnetBridgeStats *stats = &g_hpmEnetBridge.stats;
+    const uint8_t *dst = frame;
+    uint32_t in = HpmEnetBridgePortOf(dev);
+    struct HpmEnetDevice *out = g_hpmEnetBridge.ports[in ^ 1U];
+    uint32_t start = (uint32_t)mchtmr_get_count(HPM_MCHTMR);
+    int group = (dst[0] & 1U) != 0;
+
+    HpmEnetBridgeLearn(frame + ETH_HWADDR_LEN, in);
+    if (!group && HpmEnetBridgeIsLocal(dst)) {
+        stats->local++;
+        return 1;
+    }
+    if (!group) {
+        uint32_t port = HpmEnetBridgeLookup(dst);
+        if (port == in) {
+            stats->filtered++;
+            return 0;
+        }
+        if (port == HPM_ENET_BRIDGE_FLOOD) {
+            stats->flooded++;
+        } else {
+            stats->forwarded++;
+        }
+    } else {
+        stats->flooded++;
+    }
+
+    if (out != NULL) {
+        if (dev->buffCached) {
+            HpmDmaSyncForCpu(frame, len);
+        }
+        if (ethernetif_tx_frame(out, frame, len) != 0) {
+            stats->txBusy++;
+        } else {
+            uint32_t ticks = (uint32_t)mchtmr_get_count(HPM_MCHTMR) - start;
+            stats->fwdMinTicks = (ticks < stats->fwdMinTicks) ? ticks : stats->fwdMinTicks;
+            stats->fwdMaxTicks = (ticks > stats->fwdMaxTicks) ? ticks : stats->fwdMaxTicks;
+            stats->fwdTotalTicks += ticks;
+        }
+    }
+    if (group) {
+        stats->local++;
+    }
+    return group;
+}
+
+err_t HpmEnetBridgeOutput(struct pbuf *p)
+{
+    const uint8_t *dst = (const uint8_t *)p->payload;
+    uint32_t port = (dst[0] & 1U) ? HPM_ENET_BRIDGE_FLOOD : HpmEnetBridgeLookup(dst);
+    err_t err = ERR_OK;
+
+    for (uint32_t i = 0; i < HPM_ENET_BRIDGE_PORTS; i++) {
+        struct HpmEnetDevice *dev = g_hpmEnetBridge.ports[i];
+        if ((dev != NULL) && ((port == HPM_ENET_BRIDGE_FLOOD) || (port == i))) {
+            err_t ret = ethernetif_port_output(dev, p);
+            err = (err == ERR_OK) ? ret : err;
+        }
+    }
+    return err;
+}
+
+struct netif *HpmEnetBridgeNetif(void)
+{
+    return &g_hpmEnetBridge.ports[0]->netif;
+}
+
+void HpmEnetBridgeGetStats(struct HpmEnetBridgeStats *stats)
+{
+    memcpy(stats, &g_hpmEnetBridge.stats, sizeof(*stats));
+}
+
+void HpmEnetBridgeFlush(void)
+{
+    uint32_t intSave = LOS_IntLock();
+    memset(g_hpmEnetBridge.fdb, 0, sizeof(g_hpmEnetBridge.fdb));
+    LOS_IntRestore(intSave);
+}
+
+#ifdef LOSCFG_SHELL
+static void HpmEnetBridgeShow(void)
+{
+    struct HpmEnetBridgeStats stats;
+    uint32_t ticksPerUs = clock_get_frequency(clock_mchtmr0) / 1000000U;
+    uint32_t sent;
+
+    HpmEnetBridgeGetStats(&stats);
+    printf("forwarded %u, flooded %u, filtered %u, local %u, tx busy %u\n", stats.forwarded, stats.flooded,
+           stats.filtered, stats.local, stats.txBusy);
+    sent = stats.forwarded + stats.flooded - stats.txBusy;
+    if (sent != 0) {
+        uint32_t avg = (uint32_t)(stats.fwdTotalTicks / sent);
+        printf("forwarding min/avg/max: %u / %u / %u ns\n", stats.fwdMinTicks * 1000U / ticksPerUs,
+               avg * 1000U / ticksPerUs, stats.fwdMaxTicks * 1000U / ticksPerUs);
+    }
+
+    for (uint32_t i = 0; i < HPM_ENET_BRIDGE_FDB_SIZE; i++) {
+        struct HpmEnetBridgeFdbEntry *entry = &g_hpmEnetBridge.fdb[i];
+        if (entry->valid) {
+            printf("  %02x:%02x:%02x:%02x:%02x:%02x on %s, %u s ago\n", entry->mac[0], entry->mac[1],
+                   entry->mac[2], entry->mac[3], entry->mac[4], entry->mac[5],
+                   g_hpmEnetBridge.ports[entry->port]->name,
+                   (uint32_t)((LOS_TickCountGet() - entry->seen) / LOSCFG_BASE_CORE_TICK_PER_SECOND));
+        }
+    }
+}
+
+static UINT32 HpmEnetBridgeCmd(UINT32 argc, const CHAR **argv)
+{
+    if ((argc > 0) && (strcmp(argv[0], "flush") == 0)) {
+        HpmEnetBridgeFlush();
+        return 0;
+    }
+    if (argc > 0) {
+        printf("usage: bridge [flush]\n");
+        return 1;
+    }
+    HpmEnetBridgeShow();
+    return 0;
+}
+
+static void HpmEnetBridgeShellReg(void)
+{
+    osCmdReg(CMD_TYPE_EX, "bridge", XARGS, (CmdCallBackFunc)HpmEnetBridgeCmd);
+}
+
+APP_FEATURE_INIT(HpmEnetBridgeShellReg);
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HPM_ENET_BRIDGE_H
+#define HPM_ENET_BRIDGE_H
+
+#include <stdint.h>
+#include "hpm_lwip.h"
+
+/*
+ * Two-port L2 bridge between "geth" (ENET0) and "eth" (ENET1), for daisy-chained boards. Both MACs
+ * run promiscuous. The RX task of a port looks at each frame in its DMA buffer: it learns the
+ * source MAC, copies frames for the other side straight into a TX descriptor of the other port,
+ * and only passes frames for the board (either MAC, broadcast, multicast) on to lwIP. "geth"
+ * carries the one netif of the bridge, "eth" has none; lwIP output goes to the port the
+ * destination was learned on, or to both.
+ */
+
+#define HPM_ENET_BRIDGE_FDB_SIZE    64  /* power of 2, direct mapped on the low MAC bytes */
+#define HPM_ENET_BRIDGE_AGE_SECONDS 300
+
+struct HpmEnetBridgeStats {
+    uint32_t forwarded; /* unicast sent on to the learned port */
+    uint32_t flooded; /* broadcast, multicast or unknown unicast sent on */
+    uint32_t filtered; /* destination sits behind the port it came from */
+    uint32_t local; /* passed to lwIP */
+    uint32_t txBusy; /* dropped, no free TX descriptor on the other port */
+    uint32_t fwdMinTicks; /* frame picked up to TX descriptor handed over, MCHTMR0 ticks */
+    uint32_t fwdMaxTicks;
+    uint64_t fwdTotalTicks;
+};
+
+/* Called by enetDevInit() for each MAC once the hardware is up */
+void HpmEnetBridgeAddPort(struct HpmEnetDevice *dev);
+
+/*
+ * RX task of a port, frame in place with at least the header synced: forwards it as needed and
+ * returns 1 if it is also for lwIP, 0 if the descriptor can go back to the DMA.
+ */
+int HpmEnetBridgeInput(struct HpmEnetDevice *dev, const uint8_t *frame, uint32_t len);
+
+/* lwIP output of the bridge netif */
+err_t HpmEnetBridgeOutput(struct pbuf *p);
+
+/* netif frames received on any port go up to */
+struct netif *HpmEnetBridgeNetif(void);
+
+void HpmEnetBridgeGetStats(struct HpmEnetBridgeStats *stats);
+void HpmEnetBridgeFlush(void);
+
+#endif
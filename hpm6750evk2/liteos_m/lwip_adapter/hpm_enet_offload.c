@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "lwip/pbuf.h"
+#include "lwip/prot/ethernet.h"
+#include "hpm_ipc.h"
+#include "hpm_enet_offload.h"
+#include "hpm_enet_raw.h"
+#include "hpm_enet_pcap.h"
+#include <los_interrupt.h>
+#include <los_sem.h>
+
+#if HPM_ENET_OFFLOAD_ENABLE
+
+/*
+ * Everything CPU1 touches lives in its own DLM (stack) or in the noncacheable region (descriptors,
+ * buffers, the ring and the offload context), see hpm_ipc.h for how CPU1 is started.
+ */
+
+struct HpmEnetOffloadCtx {
+    ENET_Type *base;
+    enet_rx_desc_t *rxDesc;
+    uint32_t etherTypeNum;
+    uint16_t etherTypes[HPM_ENET_OFFLOAD_MAX_ETHERTYPES];
+    struct HpmEnetOffloadStats stats;
+};
+
+HPM_IPC_RING_DEFINE(g_hpmEnetOffloadRing, ENET_RX_BUFF_SIZE, HPM_ENET_OFFLOAD_SLOTS);
+static ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(8) volatile struct HpmEnetOffloadCtx g_hpmEnetOffloadCtx;
+
+ATTR_RAMFUNC static int HpmEnetOffloadAccept(volatile struct HpmEnetOffloadCtx *ctx, const uint8_t *frame)
+{
+    uint16_t type = (uint16_t)((frame[12] << 8) | frame[13]);
+
+    if (ctx->etherTypeNum == 0) {
+        return 1;
+    }
+    for (uint32_t i = 0; i < ctx->etherTypeNum; i++) {
+        if (ctx->etherTypes[i] == type) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Check, filter and queue the frame of one completed descriptor; the caller gives it back */
+ATTR_RAMFUNC static void HpmEnetOffloadTakeDesc(volatile struct HpmEnetOffloadCtx *ctx, enet_rx_desc_t *desc)
+{
+    uint32_t len = desc->rdes0_bm.fl;
+    const uint8_t *frame = (const uint8_t *)desc->rdes2_bm.buffer1;
+    void *slot = NULL;
+
+    if (desc->rdes0_bm.es || !desc->rdes0_bm.fs || !desc->rdes0_bm.ls || (len <= 4U + SIZEOF_ETH_HDR)) {
+        ctx->stats.dropError++;
+        return;
+    }
+    len -= 4U; /* CRC */
+    if (!HpmEnetOffloadAccept(ctx, frame)) {
+        ctx->stats.dropFilter++;
+        return;
+    }
+
+    slot = HpmIpcRingAcquire(&g_hpmEnetOffloadRing);
+    if (slot == NULL) {
+        ctx->stats.dropFull++;
+        return;
+    }
+    memcpy(slot, frame, len);
+    HpmIpcRingCommit(&g_hpmEnetOffloadRing, len);
+    ctx->stats.rxFrames++;
+}
+
+ATTR_RAMFUNC static void HpmEnetOffloadCpu1Main(void *arg)
+{
+    volatile struct HpmEnetOffloadCtx *ctx = (volatile struct HpmEnetOffloadCtx *)arg;
+    enet_rx_desc_t *desc = ctx->rxDesc;
+
+    while (1) {
+        uint32_t taken = 0;
+
+        while (!desc->rdes0_bm.own && (taken < HPM_ENET_OFFLOAD_BUDGET)) {
+            HpmEnetOffloadTakeDesc(ctx, desc);
+            desc->rdes0_bm.own = 1;
+            desc = (enet_rx_desc_t *)desc->rdes3_bm.next_desc;
+            taken++;
+        }
+        if (taken == 0) {
+            continue;
+        }
+
+        /* resume the DMA in case it ran out of descriptors */
+        ctx->base->DMA_RX_POLL_DEMAND = 1;
+        ctx->stats.doorbells += (uint32_t)HpmIpcRingNotify(&g_hpmEnetOffloadRing, HPM_IPC_CH_ENET_RX);
+    }
+}
+
+static void HpmEnetOffloadDoorbell(void *arg)
+{
+    struct HpmEnetDevice *dev = (struct HpmEnetDevice *)arg;
+    LOS_SemPost(dev->rxSemHandle);
+}
+
+int HpmEnetOffloadStart(struct HpmEnetDevice *dev)
+{
+    volatile struct HpmEnetOffloadCtx *ctx = &g_hpmEnetOffloadCtx;
+
+    memset((void *)ctx, 0, sizeof(*ctx));
+    ctx->base = dev->base;
+    ctx->rxDesc = dev->desc.rx_desc_list_head;
+    ctx->etherTypes[ctx->etherTypeNum++] = ETHTYPE_ARP;
+    ctx->etherTypes[ctx->etherTypeNum++] = ETHTYPE_IP;
+    ctx->etherTypes[ctx->etherTypeNum++] = ETHTYPE_VLAN;
+#if LWIP_IPV6
+    ctx->etherTypes[ctx->etherTypeNum++] = ETHTYPE_IPV6;
+#endif
+
+    HpmIpcRingInit(&g_hpmEnetOffloadRing, g_hpmEnetOffloadRingSlots, ENET_RX_BUFF_SIZE, HPM_ENET_OFFLOAD_SLOTS);
+    /* the receive task starts out waiting */
+    (void)HpmIpcRingArm(&g_hpmEnetOffloadRing);
+
+    if (HpmIpcCpu1Start(HpmEnetOffloadCpu1Main, (void *)ctx) != 0) {
+        printf("Err: %s: RX offload disabled\n", dev->name);
+        return -1;
+    }
+    printf("%s: RX offloaded to CPU1\n", dev->name);
+    return 0;
+}
+
+void HpmEnetOffloadIrqInit(struct HpmEnetDevice *dev)
+{
+    HpmIpcDoorbellRegister(HPM_IPC_CH_ENET_RX, HpmEnetOffloadDoorbell, dev);
+}
+
+int HpmEnetOffloadAcceptType(uint16_t etherType)
+{
+    volatile struct HpmEnetOffloadCtx *ctx = &g_hpmEnetOffloadCtx;
+    int ret = -1;
+
+    uint32_t intSave = LOS_IntLock();
+    for (uint32_t i = 0; i < ctx->etherTypeNum; i++) {
+        if (ctx->etherTypes[i] == etherType) {
+            ret = 0;
+        }
+    }
+    if ((ret != 0) && (ctx->etherTypeNum < HPM_ENET_OFFLOAD_MAX_ETHERTYPES)) {
+        ctx->etherTypes[ctx->etherTypeNum] = etherType;
+        /* CPU1 may be filtering right now, the entry is complete before it counts */
+        __asm volatile("fence rw, rw" ::: "memory");
+        ctx->etherTypeNum++;
+        ret = 0;
+    }
+    LOS_IntRestore(intSave);
+    return ret;
+}
+
+int HpmEnetOffloadInput(struct HpmEnetDevice *dev, struct pbuf **p)
+{
+    uint32_t len = 0;
+    void *slot = HpmIpcRingPeek(&g_hpmEnetOffloadRing, &len);
+
+    *p = NULL;
+    if (slot == NULL) {
+        return 0;
+    }
+
+    /* raw EtherTypes are handled straight from the ring slot */
+    if (HpmEnetRawInput(dev, slot, len)) {
+        HpmEnetPcapBuf(dev, HPM_ENET_PCAP_RX, (const uint8_t *)slot, len);
+        HpmIpcRingRelease(&g_hpmEnetOffloadRing);
+        return 1;
+    }
+
+    /* out of pbufs the frame is dropped, as the receive task would otherwise spin on it */
+    *p = pbuf_alloc(PBUF_RAW, (u16_t)len, PBUF_POOL);
+    if (*p != NULL) {
+        pbuf_take(*p, slot, (u16_t)len);
+    } else {
+        g_hpmEnetOffloadCtx.stats.dropNoMem++;
+    }
+    HpmIpcRingRelease(&g_hpmEnetOffloadRing);
+    return 1;
+}
+
+int HpmEnetOffloadRearm(void)
+{
+    return HpmIpcRingArm(&g_hpmEnetOffloadRing);
+}
+
+void HpmEnetOffloadGetStats(struct HpmEnetOffloadStats *stats)
+{
+    memcpy(stats, (const void *)&g_hpmEnetOffloadCtx.stats, sizeof(*stats));
+}
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HPM_ENET_OFFLOAD_H
+#define HPM_ENET_OFFLOAD_H
+
+#include <stdint.h>
+#include "hpm_lwip.h"
+
+/*
+ * AMP network offload: CPU1 runs a bare-metal loop that owns the RX descriptor ring of one MAC.
+ * It checks and filters received frames, copies them into an IPC ring (hpm_ipc.h) and hands the
+ * descriptors straight back to the DMA. CPU0 only drains that ring, woken by the IPC doorbell
+ * once per burst. TX stays on CPU0.
+ */
+
+/*
+ * Both live in the noncacheable region together with the ENET1 TX buffers, about 64 KB all told
+ * with these values; hpm_noncacheable_max_kb in BUILD.gn is sized for it. Two bursts of
+ * HPM_ENET_OFFLOAD_BUDGET frames fit either of them.
+ */
+#define HPM_ENET_OFFLOAD_SLOTS          16
+#define HPM_ENET_OFFLOAD_RX_BUFF_COUNT  16  /* RX descriptors of the offloaded MAC */
+#define HPM_ENET_OFFLOAD_BUDGET         8   /* frames CPU1 takes before handing descriptors back */
+#define HPM_ENET_OFFLOAD_MAX_ETHERTYPES 8
+
+struct HpmEnetOffloadStats {
+    uint32_t rxFrames; /* handed to CPU0 */
+    uint32_t dropFull; /* shared ring full */
+    uint32_t dropFilter; /* EtherType not accepted */
+    uint32_t dropError; /* MAC reported an error or the frame spans descriptors */
+    uint32_t doorbells;
+    uint32_t dropNoMem; /* counted by CPU0: no pbuf for a queued frame */
+};
+
+/* Start CPU1 on the RX ring of dev; dev must be initialized with RX interrupts off */
+int HpmEnetOffloadStart(struct HpmEnetDevice *dev);
+
+/* Hook the doorbell interrupt, it posts dev->rxSemHandle */
+void HpmEnetOffloadIrqInit(struct HpmEnetDevice *dev);
+
+/* Let CPU1 pass frames of one more EtherType, e.g. for hpm_enet_raw.h; 0 on success */
+int HpmEnetOffloadAcceptType(uint16_t etherType);
+
+/*
+ * Take the next frame off the ring: 1 with *p the frame as a pbuf, or NULL if a raw handler took
+ * it or it was dropped for lack of pbufs; 0 if the ring is empty.
+ */
+int HpmEnetOffloadInput(struct HpmEnetDevice *dev, struct pbuf **p);
+
+/* Ask for a doorbell on the next frame; returns non-zero if frames arrived meanwhile */
+int HpmEnetOffloadRearm(void);
+
+void HpmEnetOffloadGetStats(struct HpmEnetOffloadStats *stats);
+
+#endif
@@ -0,0 +1,499 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <los_interrupt.h>
+#include <los_task.h>
+#include "lwip/ip_addr.h"
+#include "lwip/prot/ethernet.h"
+#include "lwip/prot/ip.h"
+#include "hpm_mchtmr_drv.h"
+#include "hpm_enet_pcap.h"
+#include "ohos_init.h"
+#ifdef LOSCFG_SHELL
+#include "shcmd.h"
+#endif
+
+#if HPM_ENET_PCAP_ENABLE
+
+#define HPM_ENET_PCAP_MAGIC         0xA1B2C3D4U /* microsecond timestamps */
+#define HPM_ENET_PCAP_LINKTYPE_ETH  1U
+#define HPM_ENET_PCAP_PATH_LEN      64
+#define HPM_ENET_PCAP_HEX_LINE      16
+#define HPM_ENET_PCAP_FENCE()       __atomic_thread_fence(__ATOMIC_SEQ_CST) /* fence rw, rw */
+
+struct HpmEnetPcapSlot {
+    volatile uint32_t ready;
+    uint16_t capLen;
+    uint16_t origLen;
+    uint32_t dir;
+    uint64_t ticks; /* MCHTMR0 */
+    uint8_t data[HPM_ENET_PCAP_SNAPLEN_MAX];
+};
+
+struct HpmEnetPcapFileHdr {
+    uint32_t magic;
+    uint16_t versionMajor;
+    uint16_t versionMinor;
+    int32_t thisZone;
+    uint32_t sigFigs;
+    uint32_t snapLen;
+    uint32_t linkType;
+};
+
+struct HpmEnetPcapRecHdr {
+    uint32_t sec;
+    uint32_t usec;
+    uint32_t capLen;
+    uint32_t origLen;
+};
+
+struct HpmEnetPcap {
+    struct HpmEnetPcapConfig cfg;
+    char path[HPM_ENET_PCAP_PATH_LEN];
+    uint32_t head; /* slots handed to producers */
+    uint32_t tail; /* slots the consumer is done with */
+    volatile uint32_t sinkRunning;
+    struct HpmEnetPcapStats stats;
+    struct HpmEnetPcapSlot slots[HPM_ENET_PCAP_SLOTS];
+};
+
+typedef int (*HpmEnetPcapWriter)(void *arg, const struct HpmEnetPcapRecHdr *rec, const struct HpmEnetPcapSlot *slot);
+
+volatile uint32_t g_hpmEnetPcapActive;
+static struct HpmEnetPcap g_hpmEnetPcap = {
+    .cfg.snapLen = HPM_ENET_PCAP_SNAPLEN_MAX,
+};
+
+static inline uint16_t HpmEnetPcapBe16(const uint8_t *data)
+{
+    return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+/* Looks at the headers in frame[0, len) only, for a pbuf that is its first one */
+static int HpmEnetPcapMatch(const struct HpmEnetPcapFilter *filter, struct HpmEnetDevice *dev, uint32_t dir,
+                            const uint8_t *frame, uint32_t len)
+{
+    uint32_t off = SIZEOF_ETH_HDR;
+    const uint8_t *ip = NULL;
+    uint16_t type;
+
+    if (((filter->dev != NULL) && (filter->dev != dev)) || ((filter->dirs != 0) && !(filter->dirs & dir))) {
+        return 0;
+    }
+    if (len < SIZEOF_ETH_HDR) {
+        return 0;
+    }
+    type = HpmEnetPcapBe16(frame + 12);
+    if ((type == ETHTYPE_VLAN) && (len >= SIZEOF_ETH_HDR + SIZEOF_VLAN_HDR)) {
+        type = HpmEnetPcapBe16(frame + 16);
+        off += SIZEOF_VLAN_HDR;
+    }
+    if ((filter->etherType != 0) && (type != filter->etherType)) {
+        return 0;
+    }
+    if ((filter->proto == 0) && (filter->ip == 0) && (filter->port == 0)) {
+        return 1;
+    }
+
+    if ((type != ETHTYPE_IP) || (len < off + IP_HLEN)) {
+        return 0;
+    }
+    ip = frame + off;
+    if ((filter->proto != 0) && (ip[9] != filter->proto)) {
+        return 0;
+    }
+    if (filter->ip != 0) {
+        uint32_t src;
+        uint32_t dst;
+        memcpy(&src, ip + 12, sizeof(src));
+        memcpy(&dst, ip + 16, sizeof(dst));
+        if ((src != filter->ip) && (dst != filter->ip)) {
+            return 0;
+        }
+    }
+    if (filter->port != 0) {
+        uint32_t hlen = (ip[0] & 0xFU) * 4U;
+        /* only the first fragment carries the ports */
+        if (((ip[9] != IP_PROTO_TCP) && (ip[9] != IP_PROTO_UDP)) || ((HpmEnetPcapBe16(ip + 6) & 0x1FFFU) != 0) ||
+            (len < off + hlen + 4U)) {
+            return 0;
+        }
+        if ((HpmEnetPcapBe16(ip + hlen) != filter->port) && (HpmEnetPcapBe16(ip + hlen + 2U) != filter->port)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Slot to copy a matching frame into, NULL if it does not match or the ring is full */
+static struct HpmEnetPcapSlot *HpmEnetPcapReserve(int match)
+{
+    struct HpmEnetPcap *pcap = &g_hpmEnetPcap;
+    struct HpmEnetPcapSlot *slot = NULL;
+
+    uint32_t intSave = LOS_IntLock();
+    if (!match) {
+        pcap->stats.filtered++;
+    } else if (pcap->head - pcap->tail >= HPM_ENET_PCAP_SLOTS) {
+        pcap->stats.dropped++;
+    } else {
+        slot = &pcap->slots[pcap->head % HPM_ENET_PCAP_SLOTS];
+        pcap->head++;
+        pcap->stats.captured++;
+    }
+    LOS_IntRestore(intSave);
+    return slot;
+}
+
+static void HpmEnetPcapCommit(struct HpmEnetPcapSlot *slot, uint32_t dir, uint32_t capLen, uint32_t origLen)
+{
+    slot->dir = dir;
+    slot->capLen = (uint16_t)capLen;
+    slot->origLen = (uint16_t)origLen;
+    slot->ticks = mchtmr_get_count(HPM_MCHTMR);
+    HPM_ENET_PCAP_FENCE(); /* the slot is complete before the consumer can see it */
+    slot->ready = 1;
+}
+
+void HpmEnetPcapCaptureBuf(struct HpmEnetDevice *dev, uint32_t dir, const uint8_t *frame, uint32_t len)
+{
+    struct HpmEnetPcap *pcap = &g_hpmEnetPcap;
+    struct HpmEnetPcapSlot *slot = HpmEnetPcapReserve(HpmEnetPcapMatch(&pcap->cfg.filter, dev, dir, frame, len));
+    uint32_t capLen = (len < pcap->cfg.snapLen) ? len : pcap->cfg.snapLen;
+
+    if (slot != NULL) {
+        memcpy(slot->data, frame, capLen);
+        HpmEnetPcapCommit(slot, dir, capLen, len);
+    }
+}
+
+void HpmEnetPcapCapturePbuf(struct HpmEnetDevice *dev, uint32_t dir, struct pbuf *p)
+{
+    struct HpmEnetPcap *pcap = &g_hpmEnetPcap;
+    struct HpmEnetPcapSlot *slot = HpmEnetPcapReserve(HpmEnetPcapMatch(&pcap->cfg.filter, dev, dir,
+                                                                       (const uint8_t *)p->payload, p->len));
+    uint32_t capLen = (p->tot_len < pcap->cfg.snapLen) ? p->tot_len : pcap->cfg.snapLen;
+
+    if (slot != NULL) {
+        (void)pbuf_copy_partial(p, slot->data, (u16_t)capLen, 0);
+        HpmEnetPcapCommit(slot, dir, capLen, p->tot_len);
+    }
+}
+
+/* Hand every completed slot in order to writer, returns how many */
+static uint32_t HpmEnetPcapDrain(HpmEnetPcapWriter writer, void *arg)
+{
+    struct HpmEnetPcap *pcap = &g_hpmEnetPcap;
+    uint32_t hz = clock_get_frequency(clock_mchtmr0);
+    uint32_t num = 0;
+
+    while (pcap->tail != pcap->head) {
+        struct HpmEnetPcapSlot *slot = &pcap->slots[pcap->tail % HPM_ENET_PCAP_SLOTS];
+        struct HpmEnetPcapRecHdr rec;
+
+        /* a producer still copying holds up the rest until the next drain */
+        if (!slot->ready) {
+            break;
+        }
+        HPM_ENET_PCAP_FENCE();
+        rec.sec = (uint32_t)(slot->ticks / hz);
+        rec.usec = (uint32_t)((slot->ticks % hz) / (hz / 1000000U));
+        rec.capLen = slot->capLen;
+        rec.origLen = slot->origLen;
+        if (writer(arg, &rec, slot) != 0) {
+            break;
+        }
+
+        slot->ready = 0;
+        HPM_ENET_PCAP_FENCE(); /* done with the slot before a producer may reuse it */
+        pcap->tail++;
+        pcap->stats.exported++;
+        num++;
+    }
+    return num;
+}
+
+static int HpmEnetPcapFileWriter(void *arg, const struct HpmEnetPcapRecHdr *rec, const struct HpmEnetPcapSlot *slot)
+{
+    int fd = *(int *)arg;
+
+    if ((write(fd, rec, sizeof(*rec)) != (ssize_t)sizeof(*rec)) ||
+        (write(fd, slot->data, rec->capLen) != (ssize_t)rec->capLen)) {
+        return -1;
+    }
+    return 0;
+}
+
+/* text2pcap -D -t "%s.": direction and time, then offset and bytes */
+static int HpmEnetPcapUartWriter(void *arg, const struct HpmEnetPcapRecHdr *rec, const struct HpmEnetPcapSlot *slot)
+{
+    (void)arg;
+
+    printf("%c %u.%06u\n", (slot->dir == HPM_ENET_PCAP_RX) ? 'I' : 'O', rec->sec, rec->usec);
+    for (uint32_t i = 0; i < rec->capLen; i++) {
+        if ((i % HPM_ENET_PCAP_HEX_LINE) == 0) {
+            printf("%s%06x", (i == 0) ? "" : "\n", i);
+        }
+        printf(" %02x", slot->data[i]);
+    }
+    printf("\n\n");
+    return 0;
+}
+
+static int HpmEnetPcapOpen(const char *path)
+{
+    struct HpmEnetPcapFileHdr hdr = {
+        .magic = HPM_ENET_PCAP_MAGIC,
+        .versionMajor = 2,
+        .versionMinor = 4,
+        .thisZone = 0,
+        .sigFigs = 0,
+        .snapLen = g_hpmEnetPcap.cfg.snapLen,
+        .linkType = HPM_ENET_PCAP_LINKTYPE_ETH,
+    };
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0);
+
+    if (fd < 0) {
+        printf("Err: pcap: cannot create %s\n", path);
+        return -1;
+    }
+    if (write(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)) {
+        printf("Err: pcap: cannot write %s\n", path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static VOID *HpmEnetPcapSinkTask(UINT32 arg)
+{
+    struct HpmEnetPcap *pcap = &g_hpmEnetPcap;
+    int fd = -1;
+    int stop = 0;
+    (void)arg;
+
+    if (pcap->cfg.sink == HPM_ENET_PCAP_SINK_FILE) {
+        fd = HpmEnetPcapOpen(pcap->path);
+        if (fd < 0) {
+            g_hpmEnetPcapActive = 0;
+            pcap->sinkRunning = 0;
+            return NULL;
+        }
+    }
+
+    /* one more round after the stop picks up what was captured meanwhile */
+    while (!stop) {
+        stop = !g_hpmEnetPcapActive;
+        if (fd >= 0) {
+            (void)HpmEnetPcapDrain(HpmEnetPcapFileWriter, &fd);
+        } else {
+            (void)HpmEnetPcapDrain(HpmEnetPcapUartWriter, NULL);
+        }
+        if (!stop) {
+            LOS_TaskDelay(HPM_ENET_PCAP_FLUSH_TICKS);
+        }
+    }
+
+    if (fd >= 0) {
+        /* littlefs commits the file on close */
+        close(fd);
+    }
+    pcap->sinkRunning = 0;
+    return NULL;
+}
+
+int HpmEnetPcapStart(const struct HpmEnetPcapConfig *cfg)
+{
+    struct HpmEnetPcap *pcap = &g_hpmEnetPcap;
+    TSK_INIT_PARAM_S task = {0};
+    UINT32 taskID;
+
+    if (g_hpmEnetPcapActive || pcap->sinkRunning) {
+        printf("Err: pcap: a capture is running\n");
+        return -1;
+    }
+
+    pcap->cfg = *cfg;
+    if ((pcap->cfg.snapLen == 0) || (pcap->cfg.snapLen > HPM_ENET_PCAP_SNAPLEN_MAX)) {
+        pcap->cfg.snapLen = HPM_ENET_PCAP_SNAPLEN_MAX;
+    }
+    snprintf(pcap->path, sizeof(pcap->path), "%s", (cfg->path != NULL) ? cfg->path : HPM_ENET_PCAP_PATH);
+    pcap->cfg.path = pcap->path;
+    pcap->head = 0;
+    pcap->tail = 0;
+    memset(&pcap->stats, 0, sizeof(pcap->stats));
+    for (uint32_t i = 0; i < HPM_ENET_PCAP_SLOTS; i++) {
+        pcap->slots[i].ready = 0;
+    }
+
+    if (pcap->cfg.sink != HPM_ENET_PCAP_SINK_RING) {
+        pcap->sinkRunning = 1;
+        task.pfnTaskEntry = (TSK_ENTRY_FUNC)HpmEnetPcapSinkTask;
+        task.uwStackSize = HPM_ENET_PCAP_STACK_SIZE;
+        task.pcName = "pcap";
+        task.usTaskPrio = HPM_ENET_PCAP_PRIO;
+        task.uwResved = LOS_TASK_STATUS_DETACHED;
+        if (LOS_TaskCreate(&taskID, &task) != LOS_OK) {
+            pcap->sinkRunning = 0;
+            return -1;
+        }
+    }
+
+    HPM_ENET_PCAP_FENCE();
+    g_hpmEnetPcapActive = 1;
+    return 0;
+}
+
+void HpmEnetPcapStop(void)
+{
+    g_hpmEnetPcapActive = 0;
+}
+
+int HpmEnetPcapSave(const char *path)
+{
+    uint32_t num;
+    int fd;
+
+    if (g_hpmEnetPcap.sinkRunning) {
+        return -1;
+    }
+    fd = HpmEnetPcapOpen((path != NULL) ? path : HPM_ENET_PCAP_PATH);
+    if (fd < 0) {
+        return -1;
+    }
+    num = HpmEnetPcapDrain(HpmEnetPcapFileWriter, &fd);
+    if (close(fd) != 0) {
+        return -1;
+    }
+    return (int)num;
+}
+
+void HpmEnetPcapGetStats(struct HpmEnetPcapStats *stats)
+{
+    memcpy(stats, &g_hpmEnetPcap.stats, sizeof(*stats));
+    stats->pending = g_hpmEnetPcap.head - g_hpmEnetPcap.tail;
+}
+
+#ifdef LOSCFG_SHELL
+static void HpmEnetPcapUsage(void)
+{
+    printf("usage: pcap start [-i ifname] [-s snaplen] [-w [path] | -u] [rx | tx] [type <ethertype>]\n"
+           "                  [proto <n>] [host <ip>] [port <n>]\n"
+           "       pcap stop | save [path] | dump\n");
+}
+
+static int HpmEnetPcapParse(UINT32 argc, const CHAR **argv, struct HpmEnetPcapConfig *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->sink = HPM_ENET_PCAP_SINK_RING;
+
+    for (UINT32 i = 0; i < argc; i++) {
+        const char *opt = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        ip_addr_t addr;
+
+        if (strcmp(opt, "-w") == 0) {
+            cfg->sink = HPM_ENET_PCAP_SINK_FILE;
+            if ((val != NULL) && (val[0] == '/')) {
+                cfg->path = val;
+                i++;
+            }
+        } else if (strcmp(opt, "-u") == 0) {
+            cfg->sink = HPM_ENET_PCAP_SINK_UART;
+        } else if (strcmp(opt, "rx") == 0) {
+            cfg->filter.dirs |= HPM_ENET_PCAP_RX;
+        } else if (strcmp(opt, "tx") == 0) {
+            cfg->filter.dirs |= HPM_ENET_PCAP_TX;
+        } else if (val == NULL) {
+            return -1;
+        } else if (strcmp(opt, "-i") == 0) {
+            cfg->filter.dev = HpmEnetDeviceGet(val);
+            if (cfg->filter.dev == NULL) {
+                printf("pcap: no device %s\n", val);
+                return -1;
+            }
+            i++;
+        } else if (strcmp(opt, "-s") == 0) {
+            cfg->snapLen = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(opt, "type") == 0) {
+            cfg->filter.etherType = (uint16_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(opt, "proto") == 0) {
+            cfg->filter.proto = (uint8_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(opt, "port") == 0) {
+            cfg->filter.port = (uint16_t)strtoul(argv[++i], NULL, 0);
+        } else if ((strcmp(opt, "host") == 0) && ipaddr_aton(val, &addr)) {
+            cfg->filter.ip = ip4_addr_get_u32(ip_2_ip4(&addr));
+            i++;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static UINT32 HpmEnetPcapCmd(UINT32 argc, const CHAR **argv)
+{
+    struct HpmEnetPcapConfig cfg;
+    struct HpmEnetPcapStats stats;
+
+    if (argc == 0) {
+        HpmEnetPcapGetStats(&stats);
+        printf("pcap: %s, snaplen %u, captured %u, filtered %u, dropped %u, exported %u, pending %u\n",
+               g_hpmEnetPcapActive ? "capturing" : "stopped", g_hpmEnetPcap.cfg.snapLen, stats.captured,
+               stats.filtered, stats.dropped, stats.exported, stats.pending);
+        return 0;
+    }
+
+    if (strcmp(argv[0], "start") == 0) {
+        if (HpmEnetPcapParse(argc - 1, argv + 1, &cfg) != 0) {
+            HpmEnetPcapUsage();
+            return 1;
+        }
+        return (HpmEnetPcapStart(&cfg) == 0) ? 0 : 1;
+    } else if (strcmp(argv[0], "stop") == 0) {
+        HpmEnetPcapStop();
+    } else if (strcmp(argv[0], "save") == 0) {
+        int num = HpmEnetPcapSave((argc > 1) ? argv[1] : NULL);
+        if (num < 0) {
+            printf("pcap: save failed, or a capture streams to a file or the UART\n");
+            return 1;
+        }
+        printf("pcap: %d frames saved\n", num);
+    } else if (strcmp(argv[0], "dump") == 0) {
+        if (g_hpmEnetPcap.sinkRunning) {
+            printf("pcap: a capture streams to a file or the UART\n");
+            return 1;
+        }
+        (void)HpmEnetPcapDrain(HpmEnetPcapUartWriter, NULL);
+    } else {
+        HpmEnetPcapUsage();
+        return 1;
+    }
+    return 0;
+}
+
+static void HpmEnetPcapShellReg(void)
+{
+    osCmdReg(CMD_TYPE_EX, "pcap", XARGS, (CmdCallBackFunc)HpmEnetPcapCmd);
+}
+
+APP_FEATURE_INIT(HpmEnetPcapShellReg);
+#endif
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HPM_ENET_PCAP_H
+#define HPM_ENET_PCAP_H
+
+#include <stdint.h>
+#include "lwip/pbuf.h"
+#include "hpm_lwip.h"
+
+/*
+ * Packet capture at the MAC: every frame received (lwIP, raw EtherType and bridged alike) and
+ * every frame handed to the TX descriptors, truncated to the snaplen, goes through the filter
+ * into a ring of fixed slots. Producers only take a slot index with interrupts locked, the copy
+ * runs unlocked. A full ring drops the capture, never the frame. The ring is exported as a pcap
+ * file, streamed to a file while capturing, or printed in text2pcap hex for a UART console:
+ *     text2pcap -D -t "%s." uart.log capture.pcap
+ * Idle, each hook is one not-taken branch on g_hpmEnetPcapActive.
+ */
+
+#define HPM_ENET_PCAP_SLOTS         64  /* power of 2 */
+#define HPM_ENET_PCAP_SNAPLEN_MAX   128 /* bytes kept of a frame at most, sizes the slots */
+#define HPM_ENET_PCAP_PATH          "/data/capture.pcap"
+#define HPM_ENET_PCAP_STACK_SIZE    4096
+#define HPM_ENET_PCAP_PRIO          20
+#define HPM_ENET_PCAP_FLUSH_TICKS   100
+
+#define HPM_ENET_PCAP_RX    1U
+#define HPM_ENET_PCAP_TX    2U
+
+enum HpmEnetPcapSink {
+    HPM_ENET_PCAP_SINK_RING, /* kept until "pcap save" or "pcap dump" */
+    HPM_ENET_PCAP_SINK_FILE,
+    HPM_ENET_PCAP_SINK_UART,
+};
+
+/* Any field left 0 matches everything */
+struct HpmEnetPcapFilter {
+    struct HpmEnetDevice *dev;
+    uint32_t dirs; /* HPM_ENET_PCAP_RX | HPM_ENET_PCAP_TX, 0: both */
+    uint16_t etherType; /* host order, behind one VLAN tag as well */
+    uint8_t proto; /* IPv4 protocol */
+    uint32_t ip; /* IPv4 source or destination, network order as in ip4_addr_t */
+    uint16_t port; /* TCP/UDP source or destination, host order */
+};
+
+struct HpmEnetPcapConfig {
+    struct HpmEnetPcapFilter filter;
+    uint32_t snapLen;
+    enum HpmEnetPcapSink sink;
+    const char *path; /* HPM_ENET_PCAP_SINK_FILE, NULL: HPM_ENET_PCAP_PATH */
+};
+
+struct HpmEnetPcapStats {
+    uint32_t captured;
+    uint32_t filtered; /* did not match */
+    uint32_t dropped; /* ring full */
+    uint32_t exported;
+    uint32_t pending; /* in the ring now */
+};
+
+#if HPM_ENET_PCAP_ENABLE
+extern volatile uint32_t g_hpmEnetPcapActive;
+
+void HpmEnetPcapCaptureBuf(struct HpmEnetDevice *dev, uint32_t dir, const uint8_t *frame, uint32_t len);
+void HpmEnetPcapCapturePbuf(struct HpmEnetDevice *dev, uint32_t dir, struct pbuf *p);
+
+/* The hooks of ethernetif.c, frame without CRC */
+static inline void HpmEnetPcapBuf(struct HpmEnetDevice *dev, uint32_t dir, const uint8_t *frame, uint32_t len)
+{
+    if (__builtin_expect(g_hpmEnetPcapActive != 0, 0)) {
+        HpmEnetPcapCaptureBuf(dev, dir, frame, len);
+    }
+}
+
+static inline void HpmEnetPcapPbuf(struct HpmEnetDevice *dev, uint32_t dir, struct pbuf *p)
+{
+    if (__builtin_expect(g_hpmEnetPcapActive != 0, 0)) {
+        HpmEnetPcapCapturePbuf(dev, dir, p);
+    }
+}
+#else
+#define g_hpmEnetPcapActive 0U
+#define HpmEnetPcapBuf(dev, dir, frame, len)
+#define HpmEnetPcapPbuf(dev, dir, p)
+#endif
+
+/* Start capturing into an empty ring, a FILE or UART sink gets a task that drains it */
+int HpmEnetPcapStart(const struct HpmEnetPcapConfig *cfg);
+/* Stop capturing, a sink task drains what is left and exits */
+void HpmEnetPcapStop(void);
+/* Write what the ring holds to a new pcap file, -1 while a sink task owns the ring */
+int HpmEnetPcapSave(const char *path);
+void HpmEnetPcapGetStats(struct HpmEnetPcapStats *stats);
+
+#endif
@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <los_interrupt.h>
+#include <los_mux.h>
+#include "lwip/prot/ethernet.h"
+#include "hpm_mchtmr_drv.h"
+#include "ethernetif.h"
+#include "hpm_enet_qos.h"
+#include "ohos_init.h"
+#ifdef LOSCFG_SHELL
+#include "shcmd.h"
+#endif
+
+#if HPM_ENET_QOS_ENABLE
+
+#define HPM_ENET_QOS_DEVICES    2
+#define HPM_ENET_QOS_QUANTUM    (HPM_ENET_MAX_MTU + 18U) /* one weight unit sends at least one frame */
+#define HPM_ENET_QOS_DEFAULT    2 /* best effort, for frames without a priority */
+
+struct HpmEnetQosEntry {
+    struct pbuf *p;
+    uint32_t stamp; /* MCHTMR0 count it was queued at */
+};
+
+struct HpmEnetQosQueue {
+    struct HpmEnetQosEntry frames[HPM_ENET_QOS_QUEUE_LEN];
+    uint32_t head;
+    uint32_t count;
+    uint32_t deficit; /* bytes the class may still send this round */
+    struct HpmEnetQosStats stats;
+};
+
+/* all of it is guarded by dev->txMux */
+struct HpmEnetQos {
+    struct HpmEnetDevice *dev;
+    struct HpmEnetQosQueue queues[HPM_ENET_QOS_CLASSES];
+    uint32_t waiting;
+    uint32_t rr; /* class whose round it is among the weighted ones */
+};
+
+static const uint8_t g_hpmEnetQosPrioClass[8] = HPM_ENET_QOS_PRIO_CLASSES;
+static uint32_t g_hpmEnetQosWeights[HPM_ENET_QOS_CLASSES] = HPM_ENET_QOS_WEIGHTS;
+static struct HpmEnetQos g_hpmEnetQos[HPM_ENET_QOS_DEVICES];
+
+static struct HpmEnetQos *HpmEnetQosOf(struct HpmEnetDevice *dev)
+{
+    for (uint32_t i = 0; i < HPM_ENET_QOS_DEVICES; i++) {
+        if (g_hpmEnetQos[i].dev == dev) {
+            return &g_hpmEnetQos[i];
+        }
+    }
+    return NULL;
+}
+
+/* lwIP puts all headers into the first pbuf, nothing else is looked at */
+static uint32_t HpmEnetQosClassify(const struct pbuf *p)
+{
+    const uint8_t *frame = (const uint8_t *)p->payload;
+    uint16_t type;
+
+    if (p->len < SIZEOF_ETH_HDR + 2U) {
+        return HPM_ENET_QOS_DEFAULT;
+    }
+    type = (uint16_t)((frame[12] << 8) | frame[13]);
+    switch (type) {
+        case ETHTYPE_VLAN:
+            /* PCP */
+            return g_hpmEnetQosPrioClass[frame[14] >> 5];
+        case ETHTYPE_IP:
+            /* class selector of the DSCP in the TOS byte */
+            return g_hpmEnetQosPrioClass[frame[15] >> 5];
+        case ETHTYPE_IPV6:
+            /* traffic class straddles the first two bytes */
+            return g_hpmEnetQosPrioClass[(frame[14] >> 1) & 0x7U];
+        case ETHTYPE_ARP:
+            /* address resolution holds up everything else to that host */
+            return 1;
+        default:
+            return HPM_ENET_QOS_DEFAULT;
+    }
+}
+
+/* Next class to send from, -1 if nothing waits */
+static int HpmEnetQosPick(struct HpmEnetQos *qos)
+{
+    for (uint32_t c = 0; c < HPM_ENET_QOS_CLASSES; c++) {
+        if ((g_hpmEnetQosWeights[c] == 0) && (qos->queues[c].count != 0)) {
+            return (int)c;
+        }
+    }
+
+    for (uint32_t n = 0; n < 2U * HPM_ENET_QOS_CLASSES; n++) {
+        uint32_t c = qos->rr;
+        struct HpmEnetQosQueue *queue = &qos->queues[c];
+
+        if ((g_hpmEnetQosWeights[c] != 0) && (queue->count != 0)) {
+            uint32_t len = queue->frames[queue->head].p->tot_len;
+            if (queue->deficit >= len) {
+                queue->deficit -= len;
+                return (int)c;
+            }
+        } else {
+            /* an idle class does not save up */
+            queue->deficit = 0;
+        }
+
+        /* round over for this class, the next one gets its quantum */
+        qos->rr = (c + 1U) % HPM_ENET_QOS_CLASSES;
+        queue = &qos->queues[qos->rr];
+        if (queue->count != 0) {
+            queue->deficit += g_hpmEnetQosWeights[qos->rr] * HPM_ENET_QOS_QUANTUM;
+        }
+    }
+    return -1;
+}
+
+/* TX complete wakes the RX task only while frames wait */
+static void HpmEnetQosTxIrq(struct HpmEnetDevice *dev, int enable)
+{
+    uint32_t intSave = LOS_IntLock();
+    if (enable) {
+        /* NIE as well, an offloaded MAC runs without DMA interrupts otherwise */
+        dev->base->DMA_INTR_EN |= ENET_DMA_INTR_EN_NIE_SET(1) | ENET_DMA_INTR_EN_TIE_MASK;
+    } else {
+        dev->base->DMA_INTR_EN &= ~ENET_DMA_INTR_EN_TIE_MASK;
+    }
+    LOS_IntRestore(intSave);
+}
+
+static void HpmEnetQosDrain(struct HpmEnetQos *qos)
+{
+    struct HpmEnetDevice *dev = qos->dev;
+
+    /* room for the largest frame, whichever class comes next */
+    while ((qos->waiting != 0) && ethernetif_tx_ready(dev, HPM_ENET_MAX_MTU + 18U)) {
+        int c = HpmEnetQosPick(qos);
+        if (c < 0) {
+            break;
+        }
+
+        struct HpmEnetQosQueue *queue = &qos->queues[c];
+        struct HpmEnetQosEntry *entry = &queue->frames[queue->head];
+        uint32_t delay = (uint32_t)mchtmr_get_count(HPM_MCHTMR) - entry->stamp;
+
+        if (ethernetif_copy_output(dev, entry->p) != ERR_OK) {
+            queue->stats.dropped++;
+        }
+        pbuf_free(entry->p);
+        entry->p = NULL;
+        queue->head = (queue->head + 1U) % HPM_ENET_QOS_QUEUE_LEN;
+        queue->count--;
+        qos->waiting--;
+
+        queue->stats.depth = queue->count;
+        queue->stats.maxDelayTicks = (delay > queue->stats.maxDelayTicks) ? delay : queue->stats.maxDelayTicks;
+        queue->stats.totalDelayTicks += delay;
+    }
+    HpmEnetQosTxIrq(dev, qos->waiting != 0);
+}
+
+void HpmEnetQosInit(struct HpmEnetDevice *dev)
+{
+    for (uint32_t i = 0; i < HPM_ENET_QOS_DEVICES; i++) {
+        if ((g_hpmEnetQos[i].dev == NULL) || (g_hpmEnetQos[i].dev == dev)) {
+            memset(&g_hpmEnetQos[i], 0, sizeof(g_hpmEnetQos[i]));
+            g_hpmEnetQos[i].dev = dev;
+            return;
+        }
+    }
+    printf("Err: %s: no traffic classes left\n", dev->name);
+}
+
+err_t HpmEnetQosOutput(struct HpmEnetDevice *dev, struct pbuf *p)
+{
+    struct HpmEnetQos *qos = HpmEnetQosOf(dev);
+    uint32_t c = HpmEnetQosClassify(p);
+    struct HpmEnetQosQueue *queue = NULL;
+    struct pbuf *q = NULL;
+    err_t err = ERR_OK;
+
+    LOS_MuxPend(dev->txMux, LOS_WAIT_FOREVER);
+    if ((qos == NULL) || ((qos->waiting == 0) && ethernetif_tx_ready(dev, p->tot_len))) {
+        err = ethernetif_copy_output(dev, p);
+        if (qos != NULL) {
+            qos->queues[c].stats.direct++;
+        }
+        LOS_MuxPost(dev->txMux);
+        return err;
+    }
+
+    queue = &qos->queues[c];
+    if (queue->count < HPM_ENET_QOS_QUEUE_LEN) {
+        /*
+         * lwIP frees p when we return, TCP does not retransmit a segment while it is referenced.
+         * PBUF_REF data (UDP sendto) is the caller's again once we return, so that is copied.
+         */
+        if (PBUF_NEEDS_COPY(p)) {
+            q = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+        } else {
+            pbuf_ref(p);
+            q = p;
+        }
+    }
+    if (q != NULL) {
+        struct HpmEnetQosEntry *entry = &queue->frames[(queue->head + queue->count) % HPM_ENET_QOS_QUEUE_LEN];
+        entry->p = q;
+        entry->stamp = (uint32_t)mchtmr_get_count(HPM_MCHTMR);
+        queue->count++;
+        qos->waiting++;
+        queue->stats.queued++;
+        queue->stats.depth = queue->count;
+        queue->stats.maxDepth = (queue->count > queue->stats.maxDepth) ? queue->count : queue->stats.maxDepth;
+    } else {
+        queue->stats.dropped++;
+        err = ERR_MEM;
+    }
+    HpmEnetQosDrain(qos);
+    LOS_MuxPost(dev->txMux);
+    return err;
+}
+
+void HpmEnetQosKick(struct HpmEnetDevice *dev)
+{
+    struct HpmEnetQos *qos = HpmEnetQosOf(dev);
+
+    if ((qos == NULL) || (qos->waiting == 0)) {
+        return;
+    }
+    LOS_MuxPend(dev->txMux, LOS_WAIT_FOREVER);
+    HpmEnetQosDrain(qos);
+    LOS_MuxPost(dev->txMux);
+}
+
+int HpmEnetQosGetStats(struct HpmEnetDevice *dev, uint32_t cls, struct HpmEnetQosStats *stats)
+{
+    struct HpmEnetQos *qos = HpmEnetQosOf(dev);
+
+    if ((qos == NULL) || (cls >= HPM_ENET_QOS_CLASSES)) {
+        return -1;
+    }
+    LOS_MuxPend(dev->txMux, LOS_WAIT_FOREVER);
+    memcpy(stats, &qos->queues[cls].stats, sizeof(*stats));
+    LOS_MuxPost(dev->txMux);
+    return 0;
+}
+
+void HpmEnetQosResetStats(struct HpmEnetDevice *dev)
+{
+    struct HpmEnetQos *qos = HpmEnetQosOf(dev);
+
+    if (qos == NULL) {
+        return;
+    }
+    LOS_MuxPend(dev->txMux, LOS_WAIT_FOREVER);
+    for (uint32_t c = 0; c < HPM_ENET_QOS_CLASSES; c++) {
+        memset(&qos->queues[c].stats, 0, sizeof(qos->queues[c].stats));
+        /* frames still waiting count as queued after the reset */
+        qos->queues[c].stats.depth = qos->queues[c].count;
+        qos->queues[c].stats.queued = qos->queues[c].count;
+    }
+    LOS_MuxPost(dev->txMux);
+}
+
+int HpmEnetQosSetWeight(uint32_t cls, uint32_t weight)
+{
+    if (cls >= HPM_ENET_QOS_CLASSES) {
+        return -1;
+    }
+    g_hpmEnetQosWeights[cls] = weight;
+    return 0;
+}
+
+#ifdef LOSCFG_SHELL
+static void HpmEnetQosShow(struct HpmEnetDevice *dev)
+{
+    uint32_t ticksPerUs = clock_get_frequency(clock_mchtmr0) / 1000000U;
+    struct HpmEnetQosStats stats;
+
+    printf("%s:\n", dev->name);
+    printf("  class weight depth  max     direct     queued    dropped  delay avg/max us\n");
+    for (uint32_t c = 0; c < HPM_ENET_QOS_CLASSES; c++) {
+        if (HpmEnetQosGetStats(dev, c, &stats) != 0) {
+            return;
+        }
+        uint32_t sent = stats.queued - stats.depth;
+        uint32_t avg = (sent == 0) ? 0 : (uint32_t)(stats.totalDelayTicks / sent);
+        printf("  %5u %6u %5u %4u %10u %10u %10u  %u / %u\n", c, g_hpmEnetQosWeights[c], stats.depth,
+               stats.maxDepth, stats.direct, stats.queued, stats.dropped, avg / ticksPerUs,
+               stats.maxDelayTicks / ticksPerUs);
+    }
+}
+
+static UINT32 HpmEnetQosCmd(UINT32 argc, const CHAR **argv)
+{
+    const char *names[] = { "geth", "eth" };
+
+    if ((argc == 3) && (strcmp(argv[0], "weight") == 0)) {
+        if (HpmEnetQosSetWeight((uint32_t)strtoul(argv[1], NULL, 0), (uint32_t)strtoul(argv[2], NULL, 0)) != 0) {
+            printf("qos: no class %s\n", argv[1]);
+            return 1;
+        }
+        return 0;
+    }
+    if ((argc > 0) && (strcmp(argv[0], "reset") != 0)) {
+        printf("usage: qos [reset | weight <class> <weight, 0: strict>]\n");
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        struct HpmEnetDevice *dev = HpmEnetDeviceGet(names[i]);
+        if (dev == NULL) {
+            continue;
+        }
+        if (argc > 0) {
+            HpmEnetQosResetStats(dev);
+        } else {
+            HpmEnetQosShow(dev);
+        }
+    }
+    return 0;
+}
+
+static void HpmEnetQosShellReg(void)
+{
+    osCmdReg(CMD_TYPE_EX, "qos", XARGS, (CmdCallBackFunc)HpmEnetQosCmd);
+}
+
+APP_FEATURE_INIT(HpmEnetQosShellReg);
+#endif
+
+#endif
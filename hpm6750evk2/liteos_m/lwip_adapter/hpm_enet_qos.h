@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HPM_ENET_QOS_H
+#define HPM_ENET_QOS_H
+
+#include <stdint.h>
+#include "lwip/pbuf.h"
+#include "hpm_lwip.h"
+
+/*
+ * Software traffic classes in front of the TX descriptor ring. Every frame lwIP sends gets a
+ * class from its 802.1Q PCP or, untagged, from the class selector of its IPv4/IPv6 DSCP (set per
+ * socket with IP_TOS, e.g. 0xB8 for EF). A frame goes to the DMA at once while nothing waits and
+ * a descriptor is free, otherwise it is queued (pbuf_ref, no copy) in its class. Queues drain
+ * when the output path runs again and on the TX complete interrupt, which is only enabled while
+ * frames wait. Classes with weight 0 are strict priority in class order, the others share what
+ * is left by deficit round robin. Raw and bridged frames (ethernetif_tx_frame()) skip the queues.
+ */
+
+#define HPM_ENET_QOS_CLASSES    4
+#define HPM_ENET_QOS_QUEUE_LEN  16  /* frames per class and device */
+
+/* Class of an 802.1Q PCP or DSCP class selector (DSCP >> 3), 0 is served first */
+#define HPM_ENET_QOS_PRIO_CLASSES   { 2, 3, 2, 1, 1, 0, 0, 0 }
+/* Default weight of each class, 0: strict priority */
+#define HPM_ENET_QOS_WEIGHTS        { 0, 0, 4, 1 }
+
+struct HpmEnetQosStats {
+    uint32_t depth; /* frames waiting now */
+    uint32_t maxDepth;
+    uint32_t direct; /* straight to the DMA, nothing was waiting */
+    uint32_t queued;
+    uint32_t dropped; /* queue full, no memory for a copy, or refused by the TX ring when dequeued */
+    uint32_t maxDelayTicks; /* queued until handed to the DMA, MCHTMR0 ticks */
+    uint64_t totalDelayTicks;
+};
+
+/* Called by ethernetif_recv_start() before the device sends */
+void HpmEnetQosInit(struct HpmEnetDevice *dev);
+
+/* linkoutput of dev: send or queue p by its class */
+err_t HpmEnetQosOutput(struct HpmEnetDevice *dev, struct pbuf *p);
+
+/* Move waiting frames into free TX descriptors, from the RX task after a TX complete interrupt */
+void HpmEnetQosKick(struct HpmEnetDevice *dev);
+
+int HpmEnetQosGetStats(struct HpmEnetDevice *dev, uint32_t cls, struct HpmEnetQosStats *stats);
+void HpmEnetQosResetStats(struct HpmEnetDevice *dev);
+int HpmEnetQosSetWeight(uint32_t cls, uint32_t weight);
+
+#endif
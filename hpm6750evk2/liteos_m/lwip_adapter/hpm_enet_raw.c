@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <los_interrupt.h>
+#include "lwip/prot/ethernet.h"
+#include "hpm_dma_buf.h"
+#include "hpm_ipc.h"
+#include "ethernetif.h"
+#include "hpm_enet_offload.h"
+#include "hpm_enet_raw.h"
+
+#define HPM_ENET_RAW_FENCE()    __atomic_thread_fence(__ATOMIC_SEQ_CST) /* fence rw, rw */
+
+struct HpmEnetRawEntry {
+    volatile uint16_t etherType; /* 0: free, set last so a reader never sees a half entry */
+    HpmEnetRawHandler handler;
+    void *arg;
+};
+
+static struct HpmEnetRawEntry g_hpmEnetRawTable[HPM_ENET_RAW_MAX_TYPES];
+static volatile uint32_t g_hpmEnetRawRxFrames;
+static volatile uint32_t g_hpmEnetRawTxFrames;
+
+int HpmEnetRawRegister(uint16_t etherType, HpmEnetRawHandler handler, void *arg)
+{
+    struct HpmEnetRawEntry *entry = NULL;
+
+    if ((etherType == 0) || (handler == NULL)) {
+        return -1;
+    }
+
+    uint32_t intSave = LOS_IntLock();
+    for (uint32_t i = 0; i < HPM_ENET_RAW_MAX_TYPES; i++) {
+        if (g_hpmEnetRawTable[i].etherType == etherType) {
+            LOS_IntRestore(intSave);
+            return -1;
+        }
+        if ((entry == NULL) && (g_hpmEnetRawTable[i].etherType == 0)) {
+            entry = &g_hpmEnetRawTable[i];
+        }
+    }
+    if (entry == NULL) {
+        LOS_IntRestore(intSave);
+        return -1;
+    }
+    entry->handler = handler;
+    entry->arg = arg;
+    HPM_ENET_RAW_FENCE();
+    entry->etherType = etherType;
+    LOS_IntRestore(intSave);
+
+#if HPM_ENET_OFFLOAD_ENABLE
+    /* CPU1 filters by EtherType before CPU0 sees the frame */
+    if (HpmEnetOffloadAcceptType(etherType) != 0) {
+        printf("Err: EtherType 0x%04x not accepted by the RX offload\n", etherType);
+    }
+#endif
+    return 0;
+}
+
+int HpmEnetRawUnregister(uint16_t etherType)
+{
+    int ret = -1;
+
+    uint32_t intSave = LOS_IntLock();
+    for (uint32_t i = 0; i < HPM_ENET_RAW_MAX_TYPES; i++) {
+        if (g_hpmEnetRawTable[i].etherType == etherType) {
+            g_hpmEnetRawTable[i].etherType = 0;
+            ret = 0;
+        }
+    }
+    LOS_IntRestore(intSave);
+    return ret;
+}
+
+void HpmEnetRawQueue(struct HpmEnetDevice *dev, const uint8_t *frame, uint32_t len, void *arg)
+{
+    (void)dev;
+    (void)HpmIpcRingSend((struct HpmIpcRing *)arg, frame, len);
+}
+
+int HpmEnetRawInput(struct HpmEnetDevice *dev, const uint8_t *frame, uint32_t len)
+{
+    uint16_t type;
+
+    if (len < SIZEOF_ETH_HDR) {
+        return 0;
+    }
+    type = (uint16_t)((frame[12] << 8) | frame[13]);
+    if ((type == ETHTYPE_VLAN) && (len >= SIZEOF_ETH_HDR + 4U)) {
+        type = (uint16_t)((frame[16] << 8) | frame[17]);
+    }
+
+    for (uint32_t i = 0; i < HPM_ENET_RAW_MAX_TYPES; i++) {
+        struct HpmEnetRawEntry *entry = &g_hpmEnetRawTable[i];
+        if (entry->etherType == type) {
+            HPM_ENET_RAW_FENCE();
+            /* the driver synced only the header to look at the EtherType */
+            if (dev->buffCached) {
+                HpmDmaSyncForCpu(frame, len);
+            }
+            entry->handler(dev, frame, len, entry->arg);
+            g_hpmEnetRawRxFrames++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int HpmEnetRawSend(struct HpmEnetDevice *dev, const void *frame, uint32_t len)
+{
+    if ((len < SIZEOF_ETH_HDR) || (ethernetif_tx_frame(dev, frame, len) != 0)) {
+        return -1;
+    }
+    g_hpmEnetRawTxFrames++;
+    return 0;
+}
+
+void HpmEnetRawGetStats(uint32_t *rxFrames, uint32_t *txFrames)
+{
+    *rxFrames = g_hpmEnetRawRxFrames;
+    *txFrames = g_hpmEnetRawTxFrames;
+}
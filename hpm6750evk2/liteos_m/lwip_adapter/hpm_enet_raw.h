@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HPM_ENET_RAW_H
+#define HPM_ENET_RAW_H
+
+#include <stdint.h>
+#include "hpm_lwip.h"
+
+/*
+ * Raw Ethernet fast path for protocols without IP. Frames whose EtherType (the inner one of a
+ * VLAN tagged frame) is registered here never reach lwIP: the RX task of the MAC hands them to the
+ * handler straight from the DMA buffer, before any pbuf is allocated, and gives the descriptor
+ * back after the handler returned. HpmEnetRawSend() copies a frame into the next TX descriptor.
+ *
+ * Handlers run in the RX task of the MAC and must not block. HpmEnetRawQueue is a handler that
+ * copies the frame into an HpmIpcRing (hpm_ipc.h) for an application task to poll, lock free.
+ */
+
+#define HPM_ENET_RAW_MAX_TYPES  8
+
+typedef void (*HpmEnetRawHandler)(struct HpmEnetDevice *dev, const uint8_t *frame, uint32_t len, void *arg);
+
+/* Deliver frames of etherType to handler; 0 on success, -1 if taken or the table is full */
+int HpmEnetRawRegister(uint16_t etherType, HpmEnetRawHandler handler, void *arg);
+int HpmEnetRawUnregister(uint16_t etherType);
+
+/* Handler queueing a copy of the frame into the HpmIpcRing given as arg, full rings drop */
+void HpmEnetRawQueue(struct HpmEnetDevice *dev, const uint8_t *frame, uint32_t len, void *arg);
+
+/*
+ * Send a complete frame (destination MAC up to the payload, no CRC) of up to one TX buffer.
+ * 0 on success, -1 if it does not fit or the MAC still owns the next descriptor.
+ */
+int HpmEnetRawSend(struct HpmEnetDevice *dev, const void *frame, uint32_t len);
+
+/* Called by the RX task with at least the Ethernet header synced: 1 if a handler took the frame */
+int HpmEnetRawInput(struct HpmEnetDevice *dev, const uint8_t *frame, uint32_t len);
+
+/* Frames handed to raw handlers and raw frames sent */
+void HpmEnetRawGetStats(uint32_t *rxFrames, uint32_t *txFrames);
+
+#endif
@@ -0,0 +1,541 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <los_task.h>
+#include <los_tick.h>
+#ifdef LOSCFG_BASE_CORE_CPUP
+#include <los_cpup.h>
+#endif
+#include "lwip/apps/lwiperf.h"
+#include "lwip/priv/tcpip_priv.h"
+#include "lwip/sockets.h"
+#include "lwip/stats.h"
+#include "hpm_lwip.h"
+#include "hpm_iperf.h"
+#include "ohos_init.h"
+#ifdef LOSCFG_SHELL
+#include "shcmd.h"
+#endif
+
+/*
+ * lwiperf and the session table are only touched from the tcpip thread: the shell side goes
+ * through tcpip_api_call(), the reports come from lwIP callbacks.
+ */
+
+#define HPM_IPERF_UDP_RCV_TIMEOUT_MS    200
+#define HPM_IPERF_UDP_FIN_TRIES         3
+#define HPM_IPERF_CPU_NONE              UINT32_MAX
+
+enum HpmIperfOp {
+    HPM_IPERF_OP_SERVER,
+    HPM_IPERF_OP_CLIENT,
+    HPM_IPERF_OP_STOP,
+};
+
+struct HpmIperfSession {
+    void *handle;
+    int client;
+    const char *ifname;
+    uint32_t rexmit; /* TCP retransmits when the current run started */
+};
+
+struct HpmIperfCall {
+    struct tcpip_api_call_data call;
+    enum HpmIperfOp op;
+    ip_addr_t addr;
+    const char *ifname;
+};
+
+/* iperf 2 UDP datagram header, network order; the last datagram carries the negated id */
+struct HpmIperfUdpHdr {
+    int32_t id;
+    uint32_t sec;
+    uint32_t usec;
+};
+
+struct HpmIperfUdpStats {
+    uint32_t packets;
+    uint64_t bytes;
+    uint32_t lost;
+    uint32_t outOfOrder;
+    uint32_t sendErrors;
+    uint32_t ms;
+};
+
+struct HpmIperfUdp {
+    volatile int running;
+    volatile int stop;
+    struct HpmIperfUdpCfg cfg;
+};
+
+static struct HpmIperfSession g_hpmIperfSessions[HPM_IPERF_MAX_SESSIONS];
+static struct HpmIperfUdp g_hpmIperfUdp;
+
+static uint32_t HpmIperfRexmit(void)
+{
+#if LWIP_STATS && TCP_STATS
+    return lwip_stats.tcp.rexmit;
+#else
+    return 0;
+#endif
+}
+
+/* Load of the whole system over the last run, in permille */
+static uint32_t HpmIperfCpuLoad(uint32_t ms)
+{
+#ifdef LOSCFG_BASE_CORE_CPUP
+    return LOS_HistorySysCpuUsage((ms >= 10000U) ? CPUP_LAST_TEN_SECONDS : CPUP_LAST_ONE_SECONDS);
+#else
+    (void)ms;
+    return HPM_IPERF_CPU_NONE;
+#endif
+}
+
+static void HpmIperfPrintCpu(uint32_t ms)
+{
+    uint32_t load = HpmIperfCpuLoad(ms);
+
+    if (load != HPM_IPERF_CPU_NONE) {
+        printf(", CPU %u.%u%%", load / 10U, load % 10U);
+    }
+    printf("\n");
+}
+
+static const char *HpmIperfReportName(enum lwiperf_report_type type)
+{
+    switch (type) {
+        case LWIPERF_TCP_DONE_SERVER:
+            return "server done";
+        case LWIPERF_TCP_DONE_CLIENT:
+            return "client done";
+        case LWIPERF_TCP_ABORTED_LOCAL:
+            return "aborted";
+        case LWIPERF_TCP_ABORTED_LOCAL_DATAERROR:
+            return "data error";
+        case LWIPERF_TCP_ABORTED_LOCAL_TXERROR:
+            return "send error";
+        default:
+            return "aborted by peer";
+    }
+}
+
+static void HpmIperfTcpReport(void *arg, enum lwiperf_report_type type, const ip_addr_t *localAddr,
+                              u16_t localPort, const ip_addr_t *remoteAddr, u16_t remotePort, u32_t bytes,
+                              u32_t ms, u32_t kbps)
+{
+    struct HpmIperfSession *session = (struct HpmIperfSession *)arg;
+    uint32_t rexmit = HpmIperfRexmit();
+    (void)localAddr;
+    (void)localPort;
+    (void)remotePort;
+
+    printf("iperf tcp %s %s: %u bytes in %u ms, %u kbit/s", HpmIperfReportName(type), ipaddr_ntoa(remoteAddr),
+           bytes, ms, kbps);
+#if LWIP_STATS && TCP_STATS
+    printf(", %u retransmits", rexmit - session->rexmit);
+#endif
+    HpmIperfPrintCpu(ms);
+
+    session->rexmit = rexmit;
+    /* a client session is gone after its report, a server keeps listening */
+    if (session->client) {
+        session->handle = NULL;
+    }
+}
+
+static struct HpmIperfSession *HpmIperfSessionAlloc(void)
+{
+    for (uint32_t i = 0; i < HPM_IPERF_MAX_SESSIONS; i++) {
+        if (g_hpmIperfSessions[i].handle == NULL) {
+            return &g_hpmIperfSessions[i];
+        }
+    }
+    return NULL;
+}
+
+static err_t HpmIperfCallFn(struct tcpip_api_call_data *data)
+{
+    struct HpmIperfCall *call = (struct HpmIperfCall *)data;
+    struct HpmIperfSession *session = NULL;
+
+    if (call->op == HPM_IPERF_OP_STOP) {
+        for (uint32_t i = 0; i < HPM_IPERF_MAX_SESSIONS; i++) {
+            if (g_hpmIperfSessions[i].handle != NULL) {
+                lwiperf_abort(g_hpmIperfSessions[i].handle);
+                g_hpmIperfSessions[i].handle = NULL;
+            }
+        }
+        return ERR_OK;
+    }
+
+    session = HpmIperfSessionAlloc();
+    if (session == NULL) {
+        return ERR_MEM;
+    }
+    session->client = (call->op == HPM_IPERF_OP_CLIENT);
+    session->ifname = call->ifname;
+    session->rexmit = HpmIperfRexmit();
+    if (session->client) {
+        session->handle = lwiperf_start_tcp_client(&call->addr, HPM_IPERF_PORT, LWIPERF_CLIENT,
+                                                   HpmIperfTcpReport, session);
+    } else {
+        session->handle = lwiperf_start_tcp_server(&call->addr, HPM_IPERF_PORT, HpmIperfTcpReport, session);
+    }
+    return (session->handle != NULL) ? ERR_OK : ERR_CONN;
+}
+
+static int HpmIperfIfAddr(const char *ifname, ip_addr_t *addr)
+{
+    struct HpmEnetDevice *dev = NULL;
+
+    if (ifname == NULL) {
+        ip_addr_set_any(0, addr);
+        return 0;
+    }
+    dev = HpmEnetDeviceGet(ifname);
+    if (dev == NULL) {
+        printf("iperf: no interface %s\n", ifname);
+        return -1;
+    }
+    ip_addr_copy(*addr, *netif_ip_addr4(&dev->netif));
+    return 0;
+}
+
+int HpmIperfTcpServerStart(const char *ifname)
+{
+    struct HpmIperfCall call;
+
+    call.op = HPM_IPERF_OP_SERVER;
+    if (HpmIperfIfAddr(ifname, &call.addr) != 0) {
+        return -1;
+    }
+    call.ifname = (ifname != NULL) ? HpmEnetDeviceGet(ifname)->name : NULL;
+    return (tcpip_api_call(HpmIperfCallFn, &call.call) == ERR_OK) ? 0 : -1;
+}
+
+int HpmIperfTcpClientStart(const ip_addr_t *remote)
+{
+    struct HpmIperfCall call;
+
+    call.op = HPM_IPERF_OP_CLIENT;
+    call.ifname = NULL;
+    ip_addr_copy(call.addr, *remote);
+    return (tcpip_api_call(HpmIperfCallFn, &call.call) == ERR_OK) ? 0 : -1;
+}
+
+void HpmIperfTcpStopAll(void)
+{
+    struct HpmIperfCall call;
+
+    call.op = HPM_IPERF_OP_STOP;
+    (void)tcpip_api_call(HpmIperfCallFn, &call.call);
+}
+
+static uint32_t HpmIperfMs(UINT64 ticks)
+{
+    return (uint32_t)(ticks * 1000U / LOSCFG_BASE_CORE_TICK_PER_SECOND);
+}
+
+static void HpmIperfUdpStamp(struct HpmIperfUdpHdr *hdr, int32_t id)
+{
+    UINT64 ticks = LOS_TickCountGet();
+
+    hdr->id = (int32_t)lwip_htonl((uint32_t)id);
+    hdr->sec = lwip_htonl((uint32_t)(ticks / LOSCFG_BASE_CORE_TICK_PER_SECOND));
+    hdr->usec = lwip_htonl((uint32_t)(ticks % LOSCFG_BASE_CORE_TICK_PER_SECOND * 1000000U /
+                                      LOSCFG_BASE_CORE_TICK_PER_SECOND));
+}
+
+/* Paced by the tick: each tick sends what the rate allows up to then, pps 0 sends back to back */
+static void HpmIperfUdpSend(struct HpmIperfUdp *udp, int sock, uint8_t *buf, struct HpmIperfUdpStats *stats)
+{
+    const struct HpmIperfUdpCfg *cfg = &udp->cfg;
+    struct sockaddr_in to;
+    UINT64 start = LOS_TickCountGet();
+    UINT64 end = start + (UINT64)cfg->seconds * LOSCFG_BASE_CORE_TICK_PER_SECOND;
+    UINT64 now = start;
+    int32_t id = 0;
+
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_port = lwip_htons(cfg->port);
+    to.sin_addr.s_addr = ip4_addr_get_u32(ip_2_ip4(&cfg->remote));
+
+    while (!udp->stop && (now < end)) {
+        uint64_t allowed = (cfg->pps == 0) ? UINT64_MAX :
+                           ((uint64_t)cfg->pps * (now - start) / LOSCFG_BASE_CORE_TICK_PER_SECOND + 1U);
+        int yield = (cfg->pps != 0);
+
+        while (((uint64_t)id < allowed) && !udp->stop && (LOS_TickCountGet() < end)) {
+            HpmIperfUdpStamp((struct HpmIperfUdpHdr *)buf, id);
+            if (lwip_sendto(sock, buf, cfg->len, 0, (struct sockaddr *)&to, sizeof(to)) < 0) {
+                /* out of pbufs or TX descriptors, give the stack a tick */
+                stats->sendErrors++;
+                yield = 1;
+                break;
+            }
+            stats->packets++;
+            stats->bytes += cfg->len;
+            id++;
+        }
+        if (yield) {
+            LOS_TaskDelay(1);
+        }
+        now = LOS_TickCountGet();
+    }
+    stats->ms = HpmIperfMs(LOS_TickCountGet() - start);
+
+    for (uint32_t i = 0; i < HPM_IPERF_UDP_FIN_TRIES; i++) {
+        HpmIperfUdpStamp((struct HpmIperfUdpHdr *)buf, -id);
+        (void)lwip_sendto(sock, buf, cfg->len, 0, (struct sockaddr *)&to, sizeof(to));
+    }
+}
+
+/* Counts until the sender's last datagram, iperf stop, or cfg->seconds after the first datagram */
+static void HpmIperfUdpRecv(struct HpmIperfUdp *udp, int sock, uint8_t *buf, struct HpmIperfUdpStats *stats)
+{
+    const struct HpmIperfUdpCfg *cfg = &udp->cfg;
+    UINT64 first = 0;
+    UINT64 last = 0;
+    int32_t expected = 0;
+    int32_t maxId = -1;
+
+    while (!udp->stop) {
+        int len = lwip_recv(sock, buf, cfg->len, 0);
+        UINT64 now = LOS_TickCountGet();
+
+        if ((stats->packets != 0) && (now - first >= (UINT64)cfg->seconds * LOSCFG_BASE_CORE_TICK_PER_SECOND)) {
+            break;
+        }
+        if (len < (int)sizeof(struct HpmIperfUdpHdr)) {
+            continue;
+        }
+
+        int32_t id = (int32_t)lwip_ntohl((uint32_t)((struct HpmIperfUdpHdr *)buf)->id);
+        if (id < 0) {
+            break;
+        }
+        if (stats->packets == 0) {
+            first = now;
+        }
+        last = now;
+        stats->packets++;
+        stats->bytes += (uint32_t)len;
+        if (id < expected) {
+            stats->outOfOrder++;
+        }
+        expected = id + 1;
+        maxId = (id > maxId) ? id : maxId;
+    }
+    stats->ms = HpmIperfMs(last - first);
+    if ((uint32_t)(maxId + 1) > stats->packets) {
+        stats->lost = (uint32_t)(maxId + 1) - stats->packets;
+    }
+}
+
+static void HpmIperfUdpReport(const struct HpmIperfUdpCfg *cfg, const struct HpmIperfUdpStats *stats)
+{
+    uint32_t ms = (stats->ms == 0) ? 1U : stats->ms;
+
+    printf("iperf udp %s: %u packets, %llu bytes in %u ms, %llu pps, %llu kbit/s", cfg->server ? "received" : "sent",
+           stats->packets, (unsigned long long)stats->bytes, stats->ms,
+           (unsigned long long)stats->packets * 1000U / ms, (unsigned long long)stats->bytes * 8U / ms);
+    if (cfg->server) {
+        uint32_t sent = stats->packets + stats->lost;
+        uint32_t permille = (sent == 0) ? 0 : (uint32_t)((uint64_t)stats->lost * 1000U / sent);
+        printf(", lost %u (%u.%u%%), out of order %u", stats->lost, permille / 10U, permille % 10U,
+               stats->outOfOrder);
+    } else {
+        printf(", send errors %u", stats->sendErrors);
+    }
+    HpmIperfPrintCpu(stats->ms);
+}
+
+static VOID *HpmIperfUdpTask(UINT32 arg)
+{
+    struct HpmIperfUdp *udp = (struct HpmIperfUdp *)arg;
+    struct HpmIperfUdpCfg *cfg = &udp->cfg;
+    struct HpmIperfUdpStats stats;
+    struct sockaddr_in local;
+    uint8_t *buf = (uint8_t *)malloc(cfg->len);
+    int sock = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+
+    memset(&stats, 0, sizeof(stats));
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_port = cfg->server ? lwip_htons(cfg->port) : 0;
+    local.sin_addr.s_addr = ip4_addr_get_u32(ip_2_ip4(&cfg->local));
+    if ((buf == NULL) || (sock < 0) || (lwip_bind(sock, (struct sockaddr *)&local, sizeof(local)) != 0)) {
+        printf("iperf udp: no socket or buffer\n");
+    } else {
+        memset(buf, 0, cfg->len);
+        if (cfg->server) {
+            struct timeval timeout = {0, HPM_IPERF_UDP_RCV_TIMEOUT_MS * 1000};
+            (void)lwip_setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            HpmIperfUdpRecv(udp, sock, buf, &stats);
+        } else {
+            HpmIperfUdpSend(udp, sock, buf, &stats);
+        }
+        HpmIperfUdpReport(cfg, &stats);
+    }
+
+    if (sock >= 0) {
+        lwip_close(sock);
+    }
+    free(buf);
+    udp->running = 0;
+    return NULL;
+}
+
+int HpmIperfUdpStart(const struct HpmIperfUdpCfg *cfg)
+{
+    struct HpmIperfUdp *udp = &g_hpmIperfUdp;
+    TSK_INIT_PARAM_S task = {0};
+    UINT32 taskID;
+
+    if (udp->running || (cfg->len < sizeof(struct HpmIperfUdpHdr)) || (cfg->seconds == 0)) {
+        return -1;
+    }
+    udp->running = 1;
+    udp->stop = 0;
+    udp->cfg = *cfg;
+
+    task.pfnTaskEntry = (TSK_ENTRY_FUNC)HpmIperfUdpTask;
+    task.uwStackSize = HPM_IPERF_UDP_STACK_SIZE;
+    task.pcName = "iperf_udp";
+    task.usTaskPrio = HPM_IPERF_UDP_PRIO;
+    task.uwArg = (UINTPTR)udp;
+    task.uwResved = LOS_TASK_STATUS_DETACHED;
+    if (LOS_TaskCreate(&taskID, &task) != LOS_OK) {
+        udp->running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void HpmIperfUdpStop(void)
+{
+    g_hpmIperfUdp.stop = 1;
+}
+
+#ifdef LOSCFG_SHELL
+static void HpmIperfShow(void)
+{
+    uint32_t num = 0;
+
+    for (uint32_t i = 0; i < HPM_IPERF_MAX_SESSIONS; i++) {
+        struct HpmIperfSession *session = &g_hpmIperfSessions[i];
+        if (session->handle != NULL) {
+            printf("tcp %s %s\n", session->client ? "client" : "server",
+                   (session->ifname != NULL) ? session->ifname : "any");
+            num++;
+        }
+    }
+    if (g_hpmIperfUdp.running) {
+        printf("udp %s\n", g_hpmIperfUdp.cfg.server ? "server" : "client");
+        num++;
+    }
+    if (num == 0) {
+        printf("no iperf session\n");
+    }
+}
+
+static void HpmIperfUsage(void)
+{
+    printf("usage: iperf [-u] -s [-B ifname] [-t seconds]\n"
+           "       iperf [-u] -c ip [-B ifname] [-t seconds] [-l len] [-b pps]\n"
+           "       iperf stop\n"
+           "TCP uses port %u, runs 10 s as a client; -t, -l and -b apply to UDP\n", HPM_IPERF_PORT);
+}
+
+static UINT32 HpmIperfCmd(UINT32 argc, const CHAR **argv)
+{
+    struct HpmIperfUdpCfg cfg;
+    const char *ifname = NULL;
+    const char *remote = NULL;
+    int udp = 0;
+    int server = 0;
+    int ret;
+
+    if (argc == 0) {
+        HpmIperfShow();
+        return 0;
+    }
+    if (strcmp(argv[0], "stop") == 0) {
+        HpmIperfTcpStopAll();
+        HpmIperfUdpStop();
+        return 0;
+    }
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.port = HPM_IPERF_PORT;
+    cfg.len = HPM_IPERF_UDP_LEN;
+    cfg.seconds = HPM_IPERF_UDP_SECONDS;
+    for (UINT32 i = 0; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "-u") == 0) {
+            udp = 1;
+        } else if (strcmp(argv[i], "-s") == 0) {
+            server = 1;
+        } else if ((strcmp(argv[i], "-c") == 0) && (value != NULL)) {
+            remote = value;
+            i++;
+        } else if ((strcmp(argv[i], "-B") == 0) && (value != NULL)) {
+            ifname = value;
+            i++;
+        } else if ((strcmp(argv[i], "-t") == 0) && (value != NULL)) {
+            cfg.seconds = (uint32_t)strtoul(value, NULL, 0);
+            i++;
+        } else if ((strcmp(argv[i], "-l") == 0) && (value != NULL)) {
+            cfg.len = (uint32_t)strtoul(value, NULL, 0);
+            i++;
+        } else if ((strcmp(argv[i], "-b") == 0) && (value != NULL)) {
+            cfg.pps = (uint32_t)strtoul(value, NULL, 0);
+            i++;
+        } else {
+            HpmIperfUsage();
+            return 1;
+        }
+    }
+    if ((server == (remote != NULL)) || ((remote != NULL) && !ipaddr_aton(remote, &cfg.remote))) {
+        HpmIperfUsage();
+        return 1;
+    }
+
+    if (!udp) {
+        ret = server ? HpmIperfTcpServerStart(ifname) : HpmIperfTcpClientStart(&cfg.remote);
+    } else if (HpmIperfIfAddr(ifname, &cfg.local) != 0) {
+        ret = -1;
+    } else {
+        cfg.server = server;
+        ret = HpmIperfUdpStart(&cfg);
+    }
+    if (ret != 0) {
+        printf("iperf: not started (sessions busy, bad interface or -l below %u)\n",
+               (uint32_t)sizeof(struct HpmIperfUdpHdr));
+        return 1;
+    }
+    return 0;
+}
+
+static void HpmIperfShellReg(void)
+{
+    osCmdReg(CMD_TYPE_EX, "iperf", XARGS, (CmdCallBackFunc)HpmIperfCmd);
+}
+
+APP_FEATURE_INIT(HpmIperfShellReg);
+#endif
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HPM_IPERF_H
+#define HPM_IPERF_H
+
+#include <stdint.h>
+#include "lwip/ip_addr.h"
+
+/*
+ * Network benchmark service. TCP runs lwiperf, so it talks to a stock iperf 2 ("iperf -c <board>"
+ * or "iperf -s" on the host); a run reports bandwidth, TCP retransmits and CPU load when it ends.
+ * UDP is a socket loop sending and counting iperf 2 datagrams (sequence number and timestamp),
+ * for packets-per-second figures with "iperf -u" on the host.
+ */
+
+#define HPM_IPERF_PORT              5001
+#define HPM_IPERF_MAX_SESSIONS      4
+#define HPM_IPERF_UDP_LEN           1470
+#define HPM_IPERF_UDP_SECONDS       10
+#define HPM_IPERF_UDP_STACK_SIZE    4096
+#define HPM_IPERF_UDP_PRIO          6
+
+struct HpmIperfUdpCfg {
+    int server; /* 1: count datagrams received on the port, 0: send to remote */
+    ip_addr_t local; /* any address for all interfaces */
+    ip_addr_t remote;
+    uint16_t port;
+    uint32_t len;
+    uint32_t pps; /* 0: as fast as the stack takes them */
+    uint32_t seconds;
+};
+
+/* TCP server on port HPM_IPERF_PORT of the address of ifname, NULL for all interfaces */
+int HpmIperfTcpServerStart(const char *ifname);
+
+/* TCP client sending to remote for 10 s, the lwiperf default */
+int HpmIperfTcpClientStart(const ip_addr_t *remote);
+
+/* Abort every TCP session, servers included */
+void HpmIperfTcpStopAll(void);
+
+/* Run one UDP session in its own task, the result is printed when it ends */
+int HpmIperfUdpStart(const struct HpmIperfUdpCfg *cfg);
+void HpmIperfUdpStop(void);
+
+#endif
@@ -14,11 +14,48 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "lwip/tcpip.h"
 #include "ohos_init.h"
 #include "hpm_lwip.h"
 #include "ethernetif.h"
 #include "lwip/tcpip.h"
+#include "hpm_enet_offload.h"
+#include "hpm_enet_bridge.h"
+#include "hpm_clock_mgr.h"
+#include "hpm_lowpower.h"
+#include "hpm_boottime.h"
+#include "hpm_mchtmr_drv.h"
+#include <los_interrupt.h>
+#include <los_task.h>
+#ifdef LOSCFG_SHELL
+#include "shcmd.h"
+#endif
+
+/*
+ * CPU1 hands the ENET1 descriptors back as soon as it copied the frame out, so the offloaded MAC
+ * gets along with fewer of them; the memory saved holds the shared ring instead.
+ */
+#if HPM_ENET_OFFLOAD_ENABLE
+#define ENET1_RX_BUFF_COUNT HPM_ENET_OFFLOAD_RX_BUFF_COUNT
+#else
+#define ENET1_RX_BUFF_COUNT ENET_RX_BUFF_COUNT
+#endif
+
+/* CPU1 does not run with the data cache on, the offloaded MAC keeps its buffers noncacheable */
+#if HPM_ENET_OFFLOAD_ENABLE || !HPM_ENET1_BUFF_CACHED
+#define ENET1_BUFF_CACHED   0
+#define ENET1_BUFF_ATTR     ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(ENET_SOC_BUFF_ADDR_ALIGNMENT)
+#else
+#define ENET1_BUFF_CACHED   1
+#define ENET1_BUFF_ATTR     ATTR_DMA_BUF
+#endif
+
+#if HPM_ENET0_BUFF_CACHED
+#define ENET0_BUFF_ATTR     ATTR_DMA_BUF
+#else
+#define ENET0_BUFF_ATTR     ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(ENET_SOC_BUFF_ADDR_ALIGNMENT)
+#endif
 
 
 static ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(ENET_SOC_DESC_ADDR_ALIGNMENT)
@@ -27,22 +64,22 @@ __RW enet_rx_desc_t rxDescTab0[ENET_RX_BUFF_COUNT] ; /* Ethernet Rx DMA Descript
 static ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(ENET_SOC_DESC_ADDR_ALIGNMENT)
 __RW enet_tx_desc_t txDescTab0[ENET_TX_BUFF_COUNT] ; /* Ethernet Tx DMA Descriptor */
 
-static ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(ENET_SOC_BUFF_ADDR_ALIGNMENT)
+static ENET0_BUFF_ATTR
 __RW uint8_t rxBuff0[ENET_RX_BUFF_COUNT][ENET_RX_BUFF_SIZE]; /* Ethernet Receive Buffer */
 
-static ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(ENET_SOC_BUFF_ADDR_ALIGNMENT)
+static ENET0_BUFF_ATTR
 __RW uint8_t txBuff0[ENET_TX_BUFF_COUNT][ENET_TX_BUFF_SIZE]; /* Ethernet Transmit Buffer */
 
 static ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(ENET_SOC_DESC_ADDR_ALIGNMENT)
-__RW enet_rx_desc_t rxDescTab1[ENET_RX_BUFF_COUNT] ; /* Ethernet Rx DMA Descriptor */
+__RW enet_rx_desc_t rxDescTab1[ENET1_RX_BUFF_COUNT] ; /* Ethernet Rx DMA Descriptor */
 
 static ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(ENET_SOC_DESC_ADDR_ALIGNMENT)
 __RW enet_tx_desc_t txDescTab1[ENET_TX_BUFF_COUNT] ; /* Ethernet Tx DMA Descriptor */
 
-static ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(ENET_SOC_BUFF_ADDR_ALIGNMENT)
-__RW uint8_t rxBuff1[ENET_RX_BUFF_COUNT][ENET_RX_BUFF_SIZE]; /* Ethernet Receive Buffer */
+static ENET1_BUFF_ATTR
+__RW uint8_t rxBuff1[ENET1_RX_BUFF_COUNT][ENET_RX_BUFF_SIZE]; /* Ethernet Receive Buffer */
 
-static ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(ENET_SOC_BUFF_ADDR_ALIGNMENT)
+static ENET1_BUFF_ATTR
 __RW uint8_t txBuff1[ENET_TX_BUFF_COUNT][ENET_TX_BUFF_SIZE]; /* Ethernet Transmit Buffer */
 
 
@@ -53,11 +90,16 @@ struct HpmEnetDevice enetDev[2] = {
         .name = "geth",
         .base = BOARD_ENET_RGMII,
         .irqNum = IRQn_ENET0,
+        .clock = clock_eth0,
+        .buffCached = HPM_ENET0_BUFF_CACHED,
         .infType = enet_inf_rgmii,
         .macAddr = {0x98, 0x2C, 0xBC, 0xB1, 0x9F, 0x15},
         .ip = {192, 168, 2, 35},
         .netmask = {255, 255, 255, 0},
         .gw = {192, 168, 1, 1},
+        .rxTaskPrio = HPM_ENET_RX_TASK_PRIO,
+        .rxTaskStack = HPM_ENET_RX_TASK_STACK,
+        .rxBudget = HPM_ENET_RX_BUDGET,
         .desc = {
             .tx_desc_list_head = txDescTab0,
             .rx_desc_list_head = rxDescTab0,
@@ -80,11 +122,18 @@ struct HpmEnetDevice enetDev[2] = {
         .name = "eth",
         .base = BOARD_ENET_RMII,
         .irqNum = IRQn_ENET1,
+        .clock = clock_eth1,
+        .buffCached = ENET1_BUFF_CACHED,
+        .mtu = HPM_ENET_MTU,
         .infType = enet_inf_rmii,
         .macAddr = {0x98, 0x2C, 0xBC, 0xB1, 0x9F, 0x17},
         .ip = {192, 168, 1, 88},
         .netmask = {255, 255, 255, 0},
         .gw = {192, 168, 1, 1},
+        .offload = HPM_ENET_OFFLOAD_ENABLE,
+        .rxTaskPrio = HPM_ENET_RX_TASK_PRIO,
+        .rxTaskStack = HPM_ENET_RX_TASK_STACK,
+        .rxBudget = HPM_ENET_RX_BUDGET,
         .desc = {
             .tx_desc_list_head = txDescTab1,
             .rx_desc_list_head = rxDescTab1,
@@ -95,13 +144,36 @@ struct HpmEnetDevice enetDev[2] = {
             },
              .rx_buff_cfg = {
                 .buffer = (uint32_t)rxBuff1,
-                .count = ENET_RX_BUFF_COUNT,
+                .count = ENET1_RX_BUFF_COUNT,
                 .size = ENET_RX_BUFF_SIZE,
             },
         },
     },
 };
 
+static uint64_t g_hpmEnetRxSince; /* MCHTMR0 count the RX statistics start from */
+
+struct HpmEnetDevice *HpmEnetDeviceGet(const char *name)
+{
+    for (uint32_t i = 0; i < sizeof(enetDev) / sizeof(enetDev[0]); i++) {
+        if (enetDev[i].isEnable && (strcmp(enetDev[i].name, name) == 0)) {
+            return &enetDev[i];
+        }
+    }
+    return NULL;
+}
+
+/* A smaller MTU than the standard one is taken as is, the MAC passes no larger frames */
+static void enetMtuInit(struct HpmEnetDevice *dev)
+{
+    uint16_t mtu = (dev->mtu != 0) ? dev->mtu : HPM_ENET_MTU;
+
+    if (mtu > HPM_ENET_MAX_MTU) {
+        printf("Err: %s: MTU %u above %u\n", dev->name, mtu, HPM_ENET_MAX_MTU);
+        mtu = HPM_ENET_MAX_MTU;
+    }
+    dev->mtu = mtu;
+}
 
 void enetDevInit(struct HpmEnetDevice *dev)
 {
@@ -109,6 +181,10 @@ void enetDevInit(struct HpmEnetDevice *dev)
         return 0;
     }
 
+    HpmClockGet(dev->clock);
+    HpmClockGet(clock_gpio); /* PHY reset pin */
+    /* RX DMA runs for as long as the MAC is up */
+    HpmLowPowerBusyGet();
     board_init_enet_pins(dev->base);
     board_reset_enet_phy(dev->base);
 
@@ -122,6 +198,11 @@ void enetDevInit(struct HpmEnetDevice *dev)
 
     memset(dev->desc.rx_desc_list_head, 0x00, sizeof(enet_rx_desc_t) * dev->desc.rx_buff_cfg.count);
     memset(dev->desc.tx_desc_list_head, 0x00, sizeof(enet_tx_desc_t) * dev->desc.tx_buff_cfg.count);
+    if (dev->buffCached) {
+        /* no dirty line of the startup clearing may be evicted over a received frame later */
+        HpmDmaSyncForDevice((void *)dev->desc.rx_buff_cfg.buffer, dev->desc.rx_buff_cfg.count * dev->desc.rx_buff_cfg.size);
+        HpmDmaSyncForDevice((void *)dev->desc.tx_buff_cfg.buffer, dev->desc.tx_buff_cfg.count * dev->desc.tx_buff_cfg.size);
+    }
     
     enet_mac_config_t macCfg;
     macCfg.mac_addr_high[0] = dev->macAddr[5];
@@ -139,12 +220,17 @@ void enetDevInit(struct HpmEnetDevice *dev)
 
     uint32_t dmaIntEnable = ENET_DMA_INTR_EN_NIE_SET(1)   /* Enable normal interrupt summary */
                             | ENET_DMA_INTR_EN_RIE_SET(1);  /* Enable receive interrupt */ 
+    if (dev->offload) {
+        /* CPU1 polls the RX descriptors, CPU0 hears about frames through the mailbox */
+        dmaIntEnable = 0;
+    }
     enet_controller_init(dev->base, dev->infType, &dev->desc, &macCfg, dmaIntEnable);
     dev->base->INTR_MASK |= 0xFFFFFFFF;
     dev->base->MMC_INTR_MASK_RX |= 0xFFFFFFFF;
     dev->base->MMC_INTR_MASK_TX |= 0xFFFFFFFF;
     dev->base->MMC_IPC_INTR_MASK_RX |= 0xFFFFFFFF;
     enet_disable_lpi_interrupt(dev->base);
+    enetMtuInit(dev);
 
     if (dev->infType == enet_inf_rgmii) {
         rtl8211_config_t phyConfig;
@@ -160,6 +246,23 @@ void enetDevInit(struct HpmEnetDevice *dev)
         rtl8201_basic_mode_init(dev->base, &phyConfig);
     }
 
+#if HPM_ENET_OFFLOAD_ENABLE
+    if (dev->offload && (HpmEnetOffloadStart(dev) != 0)) {
+        dev->offload = 0;
+        dev->base->DMA_INTR_EN |= ENET_DMA_INTR_EN_NIE_SET(1) | ENET_DMA_INTR_EN_RIE_SET(1);
+    }
+#endif
+
+#if HPM_ENET_BRIDGE_ENABLE
+    HpmEnetBridgeAddPort(dev);
+    if (!dev->isDefault) {
+        /* a bridge port without a netif of its own, its frames go up through the bridge netif */
+        dev->netif.state = dev;
+        ethernetif_recv_start(&dev->netif);
+        return;
+    }
+#endif
+
     ip_addr_t ipaddr;
     ip_addr_t netmask;
     ip_addr_t gw;
@@ -178,15 +281,91 @@ void enetDevInit(struct HpmEnetDevice *dev)
 }
 
 
+void HpmEnetRxShow(void)
+{
+    uint64_t span = mchtmr_get_count(HPM_MCHTMR) - g_hpmEnetRxSince;
+    uint32_t ticksPerUs = clock_get_frequency(clock_mchtmr0) / 1000000U;
+
+    printf("%-5s %4s %6s %6s %10s %8s %10s %8s %10s %10s %6s\n", "dev", "prio", "budget", "shared", "frames",
+           "no mem", "wakeups", "over", "busy us", "max us", "load");
+    for (uint32_t i = 0; i < sizeof(enetDev) / sizeof(enetDev[0]); i++) {
+        struct HpmEnetDevice *dev = &enetDev[i];
+        const struct HpmEnetRxStats *stats = &dev->rxStats;
+        uint32_t permille = (span == 0) ? 0 : (uint32_t)(stats->busyTicks * 1000U / span);
+        if (!dev->isEnable) {
+            continue;
+        }
+        printf("%-5s %4u %6u %6s %10u %8u %10u %8u %10u %10u %3u.%u%%\n", dev->name, dev->rxTaskPrio,
+               dev->rxBudget, dev->rxShared ? "yes" : "no", stats->frames, stats->noMem, stats->wakeups,
+               stats->overBudget,
+               (uint32_t)(stats->busyTicks / ticksPerUs), stats->maxRoundTicks / ticksPerUs, permille / 10U, permille % 10U);
+    }
+}
+
+void HpmEnetRxReset(void)
+{
+    uint32_t intSave = LOS_IntLock();
+    for (uint32_t i = 0; i < sizeof(enetDev) / sizeof(enetDev[0]); i++) {
+        memset(&enetDev[i].rxStats, 0, sizeof(enetDev[i].rxStats));
+    }
+    g_hpmEnetRxSince = mchtmr_get_count(HPM_MCHTMR);
+    LOS_IntRestore(intSave);
+}
+
 void HpmLwipInit(void)
 {
     printf("HpmLwipInit...\n");
 
+    g_hpmEnetRxSince = mchtmr_get_count(HPM_MCHTMR);
+
     tcpip_init(NULL, NULL);
 
     enetDevInit(&enetDev[0]);
     enetDevInit(&enetDev[1]);
+    HpmBootMark("network");
 }
 
 
 APP_SERVICE_INIT(HpmLwipInit);
+
+#ifdef LOSCFG_SHELL
+static UINT32 HpmEnetRxCmd(UINT32 argc, const CHAR **argv)
+{
+    struct HpmEnetDevice *dev = NULL;
+    uint32_t value;
+
+    if (argc == 0) {
+        HpmEnetRxShow();
+        return 0;
+    }
+    if ((argc == 1) && (strcmp(argv[0], "reset") == 0)) {
+        HpmEnetRxReset();
+        return 0;
+    }
+    dev = (argc == 3) ? HpmEnetDeviceGet(argv[0]) : NULL;
+    if (dev == NULL) {
+        printf("usage: enetrx [reset]\n"
+               "       enetrx <geth|eth> prio <0-31>|budget <frames>\n"
+               "a shared RX task takes the priority of the last of its devices set\n");
+        return 1;
+    }
+
+    value = (uint32_t)strtoul(argv[2], NULL, 0);
+    if ((strcmp(argv[1], "budget") == 0) && (value != 0)) {
+        dev->rxBudget = value;
+    } else if ((strcmp(argv[1], "prio") == 0) && (LOS_TaskPriSet(dev->rxTaskId, (UINT16)value) == LOS_OK)) {
+        dev->rxTaskPrio = (uint16_t)value;
+    } else {
+        printf("enetrx: bad setting %s %s\n", argv[1], argv[2]);
+        return 1;
+    }
+    return 0;
+}
+
+static void HpmEnetRxShellReg(void)
+{
+    osCmdReg(CMD_TYPE_EX, "enetrx", XARGS, (CmdCallBackFunc)HpmEnetRxCmd);
+}
+
+APP_FEATURE_INIT(HpmEnetRxShellReg);
+#endif
@@ -20,14 +20,72 @@
 #include "hpm_rtl8201.h"
 #include "hpm_rtl8201_regs.h"
 #include "board.h"
+#include "hpm_dma_buf.h"
 
 #include "lwip/err.h"
 #include "lwip/netif.h"
 
-#define ENET_TX_BUFF_COUNT  (10)
-#define ENET_RX_BUFF_COUNT  (64)
-#define ENET_RX_BUFF_SIZE   ENET_MAX_FRAME_SIZE
-#define ENET_TX_BUFF_SIZE   ENET_MAX_FRAME_SIZE
+/* set in lwipopts.h, the lwIP pools are sized from them */
+#define ENET_TX_BUFF_COUNT  (HPM_ENET_TX_BUFF_COUNT)
+#define ENET_RX_BUFF_COUNT  (HPM_ENET_RX_BUFF_COUNT)
+/* whole cache lines, so the buffers may also live in cacheable memory */
+#define ENET_RX_BUFF_SIZE   HPM_DMA_BUF_ALIGN_UP(ENET_MAX_FRAME_SIZE)
+#define ENET_TX_BUFF_SIZE   HPM_DMA_BUF_ALIGN_UP(ENET_MAX_FRAME_SIZE)
+
+/*
+ * 1: the RX/TX buffers of the device are cacheable and kept coherent with hpm_dma_buf.h, the
+ * driver copies in and out of them at cache speed. 0: noncacheable region, no maintenance.
+ * The descriptors are noncacheable either way.
+ */
+#define HPM_ENET0_BUFF_CACHED   1
+#define HPM_ENET1_BUFF_CACHED   1
+
+/*
+ * MTU of a device without one in the enetDev table, and the largest one it may set. The MAC runs
+ * with neither 2K packets nor jumbo frames enabled and drops frames above the standard size.
+ */
+#define HPM_ENET_MTU            1500
+#define HPM_ENET_MAX_MTU        HPM_ENET_MTU
+
+/*
+ * 1: CPU1 takes over RX of the "eth" (ENET1) MAC, see hpm_enet_offload.h. Its RX/TX buffers and the
+ * ring to CPU0 then take about 64 KB of the noncacheable region, the default hpm_noncacheable_max_kb
+ * in BUILD.gn leaves room for that. A MAC with HPM_ENET*_BUFF_CACHED 0 needs it raised by about
+ * 115 KB (its full rings).
+ */
+#define HPM_ENET_OFFLOAD_ENABLE 0
+
+/* 1: "geth" and "eth" form one L2 bridge with the netif of "geth", see hpm_enet_bridge.h */
+#define HPM_ENET_BRIDGE_ENABLE  0
+
+/* 1: lwIP output goes through software traffic classes, see hpm_enet_qos.h */
+#define HPM_ENET_QOS_ENABLE     0
+
+/* 1: the "pcap" capture is built in, idle it costs one branch per frame, see hpm_enet_pcap.h */
+#define HPM_ENET_PCAP_ENABLE    1
+
+/*
+ * RX task of a device when its entry in the enetDev table of hpm_lwip.c leaves the field at 0.
+ * A round takes up to the budget of frames off the ring, bridged and raw ones included, then the
+ * task yields to the other tasks of its priority, the other MAC included, before it goes on.
+ */
+#define HPM_ENET_RX_TASK_PRIO   3
+#define HPM_ENET_RX_TASK_STACK  4096
+#define HPM_ENET_RX_BUDGET      32
+
+#if HPM_ENET_BRIDGE_ENABLE && HPM_ENET_OFFLOAD_ENABLE
+#error "the bridge forwards from the RX descriptors, which the RX offload hands to CPU1"
+#endif
+
+struct HpmEnetRxStats {
+    uint32_t wakeups; /* the RX task woke up for the device */
+    uint32_t rounds;
+    uint32_t overBudget; /* rounds that ended with frames left */
+    uint32_t frames; /* taken off the ring: to lwIP, bridged, to a raw handler, or counted in noMem */
+    uint32_t noMem; /* dropped, no pool pbufs for the whole frame */
+    uint64_t busyTicks; /* MCHTMR0 ticks spent in the rounds, independent of the CPU clock */
+    uint32_t maxRoundTicks;
+};
 
 struct HpmEnetDevice {
     int isEnable;
@@ -40,11 +98,34 @@ struct HpmEnetDevice {
     uint8_t netmask[4];
     ENET_Type * base;
     uint32_t irqNum;
+    clock_name_t clock; /* taken in enetDevInit(), a disabled device leaves it off */
     enet_inf_type_t infType;
     enet_desc_t desc;
     enet_mac_config_t mac;
     uint32_t rxSemHandle;
+    int offload; /* RX descriptors are owned by CPU1 */
+    int buffCached; /* RX/TX buffers in cacheable memory, see HPM_ENET0_BUFF_CACHED */
+    uint16_t mtu; /* 0: HPM_ENET_MTU, up to HPM_ENET_MAX_MTU */
+    uint32_t txMux; /* TX descriptors and traffic classes, shared by lwIP, the bridge and HpmEnetRawSend() */
+    uint16_t rxTaskPrio; /* 0: HPM_ENET_RX_TASK_PRIO */
+    uint32_t rxTaskStack; /* 0: HPM_ENET_RX_TASK_STACK */
+    uint32_t rxBudget; /* frames per round, 0: HPM_ENET_RX_BUDGET */
+    int rxShared; /* polled by the one "enet_rx" task of all such devices, with the settings of the first */
+    uint32_t rxTaskId;
+    struct HpmEnetRxStats rxStats;
 };
 
+/* Enabled device called name ("geth", "eth"), NULL if there is none */
+struct HpmEnetDevice *HpmEnetDeviceGet(const char *name);
+
+/* RX task statistics of every device, "enetrx" in the shell */
+void HpmEnetRxShow(void);
+void HpmEnetRxReset(void);
+
+/* Use and high watermark of every lwIP pool and the heap, "lwipmem" in the shell; HPM_LWIP_STATS builds */
+void HpmLwipMemShow(void);
+/* Restart the high watermarks from the current use */
+void HpmLwipMemReset(void);
+
 #endif
 
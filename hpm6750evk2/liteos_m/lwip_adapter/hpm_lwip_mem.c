@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "lwip/opt.h"
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+#include "lwip/tcp.h"
+#include "hpm_lwip.h"
+#include "ohos_init.h"
+#ifdef LOSCFG_SHELL
+#include "shcmd.h"
+#endif
+
+/* Settings lwIP does not check itself or would only complain about at runtime */
+#if (TCP_WND > 0xffff) && !LWIP_WND_SCALE
+#error "TCP_WND above 64 KB needs LWIP_WND_SCALE"
+#endif
+#if LWIP_WND_SCALE && ((TCP_WND >> TCP_RCV_SCALE) > 0xffff)
+#error "TCP_WND does not fit the window field with TCP_RCV_SCALE"
+#endif
+#if TCP_SND_QUEUELEN < (2 * (TCP_SND_BUF / TCP_MSS))
+#error "TCP_SND_QUEUELEN cannot queue a full TCP_SND_BUF"
+#endif
+#if !MEMP_MEM_MALLOC && (MEMP_NUM_TCP_SEG < TCP_SND_QUEUELEN)
+#error "MEMP_NUM_TCP_SEG is below TCP_SND_QUEUELEN"
+#endif
+#if !MEM_LIBC_MALLOC && (MEM_SIZE < TCP_SND_BUF)
+#error "MEM_SIZE cannot hold TCP_SND_BUF"
+#endif
+#if HPM_LWIP_THROUGHPUT_PROFILE
+#if TCP_WND > (PBUF_POOL_SIZE * TCP_MSS)
+#error "PBUF_POOL_SIZE cannot hold a full TCP_WND"
+#endif
+#if PBUF_POOL_SIZE <= ENET_RX_BUFF_COUNT
+#error "PBUF_POOL_SIZE cannot take a full RX ring"
+#endif
+#if MEMP_NUM_TCPIP_MSG_INPKT < ENET_RX_BUFF_COUNT
+#error "MEMP_NUM_TCPIP_MSG_INPKT cannot queue a full RX ring"
+#endif
+#endif
+
+#if LWIP_STATS && MEM_STATS && MEMP_STATS
+/* in memp_t order, the names lwIP keeps in the pools need LWIP_DEBUG */
+static const char *const g_hpmLwipPoolNames[] = {
+#define LWIP_MEMPOOL(name, num, size, desc) desc,
+#include "lwip/priv/memp_std.h"
+};
+
+void HpmLwipMemShow(void)
+{
+    printf("profile %s, TCP_MSS %u, TCP_WND %u, TCP_SND_BUF %u, PBUF_POOL_SIZE %u, MEM_SIZE %u\n",
+           HPM_LWIP_THROUGHPUT_PROFILE ? "throughput" : "small", (uint32_t)TCP_MSS, (uint32_t)TCP_WND, (uint32_t)TCP_SND_BUF,
+           (uint32_t)PBUF_POOL_SIZE, (uint32_t)MEM_SIZE);
+    printf("%-20s %6s %6s %6s %6s %6s\n", "pool", "size", "num", "used", "max", "err");
+    for (uint32_t i = 0; i < MEMP_MAX; i++) {
+        const struct stats_mem *stats = lwip_stats.memp[i];
+#if MEMP_MEM_MALLOC
+        uint32_t size = 0;
+        uint32_t num = 0;
+#else
+        uint32_t size = memp_pools[i]->size;
+        uint32_t num = memp_pools[i]->num;
+#endif
+        if (stats == NULL) {
+            continue;
+        }
+        printf("%-20s %6u %6u %6u %6u %6u%s\n", g_hpmLwipPoolNames[i], size, num, (uint32_t)stats->used,
+               (uint32_t)stats->max, (uint32_t)stats->err, ((num != 0) && (stats->max >= num)) ? " full" : "");
+    }
+    printf("%-20s %6s %6u %6u %6u %6u\n", "heap", "", (uint32_t)lwip_stats.mem.avail, (uint32_t)lwip_stats.mem.used,
+           (uint32_t)lwip_stats.mem.max, (uint32_t)lwip_stats.mem.err);
+}
+
+/* Restart the high watermarks from the current use, e.g. before a benchmark run */
+void HpmLwipMemReset(void)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    for (uint32_t i = 0; i < MEMP_MAX; i++) {
+        if (lwip_stats.memp[i] != NULL) {
+            lwip_stats.memp[i]->max = lwip_stats.memp[i]->used;
+            lwip_stats.memp[i]->err = 0;
+        }
+    }
+    lwip_stats.mem.max = lwip_stats.mem.used;
+    lwip_stats.mem.err = 0;
+    SYS_ARCH_UNPROTECT(lev);
+}
+
+#ifdef LOSCFG_SHELL
+static UINT32 HpmLwipMemCmd(UINT32 argc, const CHAR **argv)
+{
+    if ((argc > 0) && (strcmp(argv[0], "reset") == 0)) {
+        HpmLwipMemReset();
+        return 0;
+    }
+    if (argc > 0) {
+        printf("usage: lwipmem [reset]\n");
+        return 1;
+    }
+    HpmLwipMemShow();
+    return 0;
+}
+
+static void HpmLwipMemShellReg(void)
+{
+    osCmdReg(CMD_TYPE_EX, "lwipmem", XARGS, (CmdCallBackFunc)HpmLwipMemCmd);
+}
+
+APP_FEATURE_INIT(HpmLwipMemShellReg);
+#endif
+#endif /* LWIP_STATS && MEM_STATS && MEMP_STATS */
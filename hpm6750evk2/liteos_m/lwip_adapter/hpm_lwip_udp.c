@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <los_interrupt.h>
+#include "lwip/priv/tcpip_priv.h"
+#include "lwip/udp.h"
+#include "hpm_lwip.h"
+#include "hpm_lwip_udp.h"
+#include "ohos_init.h"
+#ifdef LOSCFG_SHELL
+#include "shcmd.h"
+#endif
+
+/* The endpoint table and the pcbs are only touched from the tcpip thread, see HpmLwipUdpCallFn() */
+
+enum HpmLwipUdpOp {
+    HPM_LWIP_UDP_OP_OPEN,
+    HPM_LWIP_UDP_OP_CLOSE,
+    HPM_LWIP_UDP_OP_SEND,
+};
+
+struct HpmLwipUdp {
+    struct udp_pcb *pcb;
+    uint16_t localPort;
+    HpmLwipUdpHandler handler;
+    void *arg;
+    struct HpmLwipUdpStats stats;
+};
+
+struct HpmLwipUdpCall {
+    struct tcpip_api_call_data call;
+    enum HpmLwipUdpOp op;
+    struct HpmLwipUdp *ep;
+    const struct HpmLwipUdpCfg *cfg;
+    ip_addr_t local;
+    struct pbuf *p;
+    const ip_addr_t *addr; /* NULL: the connected remote */
+    uint16_t port;
+};
+
+static struct HpmLwipUdp g_hpmLwipUdpEps[HPM_LWIP_UDP_MAX_ENDPOINTS];
+
+static void HpmLwipUdpRecv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    struct HpmLwipUdp *ep = (struct HpmLwipUdp *)arg;
+    uint32_t len = p->tot_len; /* the handler may free p */
+    (void)pcb;
+
+    if ((ep->handler != NULL) && (ep->handler(ep, p, addr, port, ep->arg) == 0)) {
+        ep->stats.rxPackets++;
+        ep->stats.rxBytes += len;
+        return;
+    }
+    ep->stats.rxDropped++;
+    pbuf_free(p);
+}
+
+static err_t HpmLwipUdpOpenFn(struct HpmLwipUdpCall *call)
+{
+    const struct HpmLwipUdpCfg *cfg = call->cfg;
+    struct HpmLwipUdp *ep = NULL;
+    struct udp_pcb *pcb = NULL;
+
+    for (uint32_t i = 0; i < HPM_LWIP_UDP_MAX_ENDPOINTS; i++) {
+        if (g_hpmLwipUdpEps[i].pcb == NULL) {
+            ep = &g_hpmLwipUdpEps[i];
+            break;
+        }
+    }
+    if (ep == NULL) {
+        return ERR_MEM;
+    }
+    pcb = udp_new();
+    if (pcb == NULL) {
+        return ERR_MEM;
+    }
+    if ((udp_bind(pcb, &call->local, cfg->localPort) != ERR_OK) ||
+        ((cfg->remotePort != 0) && (udp_connect(pcb, &cfg->remote, cfg->remotePort) != ERR_OK))) {
+        udp_remove(pcb);
+        return ERR_USE;
+    }
+
+    memset(ep, 0, sizeof(*ep));
+    ep->pcb = pcb;
+    ep->localPort = pcb->local_port;
+    ep->handler = cfg->handler;
+    ep->arg = cfg->arg;
+    udp_recv(pcb, HpmLwipUdpRecv, ep);
+    call->ep = ep;
+    return ERR_OK;
+}
+
+static err_t HpmLwipUdpCallFn(struct tcpip_api_call_data *data)
+{
+    struct HpmLwipUdpCall *call = (struct HpmLwipUdpCall *)data;
+    struct HpmLwipUdp *ep = call->ep;
+    uint32_t len = 0;
+    err_t err = ERR_OK;
+
+    switch (call->op) {
+        case HPM_LWIP_UDP_OP_OPEN:
+            return HpmLwipUdpOpenFn(call);
+        case HPM_LWIP_UDP_OP_CLOSE:
+            udp_remove(ep->pcb);
+            ep->pcb = NULL;
+            return ERR_OK;
+        default:
+            break;
+    }
+
+    /* lwIP prepends the headers in place and takes them off again, p stays the caller's */
+    len = call->p->tot_len;
+    if (call->addr == NULL) {
+        err = udp_send(ep->pcb, call->p);
+    } else {
+        err = udp_sendto(ep->pcb, call->p, call->addr, call->port);
+    }
+    if (err == ERR_OK) {
+        ep->stats.txPackets++;
+        ep->stats.txBytes += len;
+    } else {
+        ep->stats.txErrors++;
+    }
+    return err;
+}
+
+struct HpmLwipUdp *HpmLwipUdpOpen(const struct HpmLwipUdpCfg *cfg)
+{
+    struct HpmLwipUdpCall call;
+
+    call.op = HPM_LWIP_UDP_OP_OPEN;
+    call.ep = NULL;
+    call.cfg = cfg;
+    if (cfg->ifname == NULL) {
+        ip_addr_set_any(0, &call.local);
+    } else {
+        struct HpmEnetDevice *dev = HpmEnetDeviceGet(cfg->ifname);
+        if (dev == NULL) {
+            printf("lwipudp: no interface %s\n", cfg->ifname);
+            return NULL;
+        }
+        ip_addr_copy(call.local, *netif_ip_addr4(&dev->netif));
+    }
+    if (tcpip_api_call(HpmLwipUdpCallFn, &call.call) != ERR_OK) {
+        printf("lwipudp: cannot open port %u\n", cfg->localPort);
+        return NULL;
+    }
+    return call.ep;
+}
+
+void HpmLwipUdpClose(struct HpmLwipUdp *ep)
+{
+    struct HpmLwipUdpCall call;
+
+    call.op = HPM_LWIP_UDP_OP_CLOSE;
+    call.ep = ep;
+    (void)tcpip_api_call(HpmLwipUdpCallFn, &call.call);
+}
+
+struct pbuf *HpmLwipUdpAlloc(struct HpmLwipUdp *ep, uint16_t len)
+{
+    struct pbuf *p = NULL;
+
+    if (len > HPM_LWIP_UDP_MAX_LEN) {
+        return NULL;
+    }
+    /* PBUF_RAM is one piece, PBUF_TRANSPORT reserves the UDP, IP and link headers in front */
+    p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+    if (p == NULL) {
+        uint32_t intSave = LOS_IntLock();
+        ep->stats.txNoMem++;
+        LOS_IntRestore(intSave);
+    }
+    return p;
+}
+
+static int HpmLwipUdpSendCall(struct HpmLwipUdp *ep, struct pbuf *p, const ip_addr_t *addr, uint16_t port)
+{
+    struct HpmLwipUdpCall call;
+    err_t err;
+
+    call.op = HPM_LWIP_UDP_OP_SEND;
+    call.ep = ep;
+    call.p = p;
+    call.addr = addr;
+    call.port = port;
+    err = tcpip_api_call(HpmLwipUdpCallFn, &call.call);
+    pbuf_free(p);
+    return (err == ERR_OK) ? 0 : -1;
+}
+
+int HpmLwipUdpSend(struct HpmLwipUdp *ep, struct pbuf *p)
+{
+    return HpmLwipUdpSendCall(ep, p, NULL, 0);
+}
+
+int HpmLwipUdpSendTo(struct HpmLwipUdp *ep, struct pbuf *p, const ip_addr_t *addr, uint16_t port)
+{
+    return HpmLwipUdpSendCall(ep, p, addr, port);
+}
+
+void HpmLwipUdpGetStats(struct HpmLwipUdp *ep, struct HpmLwipUdpStats *stats)
+{
+    memcpy(stats, &ep->stats, sizeof(*stats));
+}
+
+void HpmLwipUdpResetStats(struct HpmLwipUdp *ep)
+{
+    memset(&ep->stats, 0, sizeof(ep->stats));
+}
+
+#ifdef LOSCFG_SHELL
+static UINT32 HpmLwipUdpCmd(UINT32 argc, const CHAR **argv)
+{
+    int reset = (argc == 1) && (strcmp(argv[0], "reset") == 0);
+    uint32_t num = 0;
+
+    if ((argc > 0) && !reset) {
+        printf("usage: lwipudp [reset]\n");
+        return 1;
+    }
+    printf("%5s %10s %10s %8s %10s %10s %8s %8s\n", "port", "rx", "rx bytes", "rx drop", "tx", "tx bytes",
+           "tx nomem", "tx err");
+    for (uint32_t i = 0; i < HPM_LWIP_UDP_MAX_ENDPOINTS; i++) {
+        struct HpmLwipUdp *ep = &g_hpmLwipUdpEps[i];
+        struct HpmLwipUdpStats stats;
+        if (ep->pcb == NULL) {
+            continue;
+        }
+        HpmLwipUdpGetStats(ep, &stats);
+        printf("%5u %10u %10u %8u %10u %10u %8u %8u\n", ep->localPort, stats.rxPackets, stats.rxBytes,
+               stats.rxDropped, stats.txPackets, stats.txBytes, stats.txNoMem, stats.txErrors);
+        if (reset) {
+            HpmLwipUdpResetStats(ep);
+        }
+        num++;
+    }
+    if (num == 0) {
+        printf("no UDP endpoint\n");
+    }
+    return 0;
+}
+
+static void HpmLwipUdpShellReg(void)
+{
+    osCmdReg(CMD_TYPE_EX, "lwipudp", XARGS, (CmdCallBackFunc)HpmLwipUdpCmd);
+}
+
+APP_FEATURE_INIT(HpmLwipUdpShellReg);
+#endif
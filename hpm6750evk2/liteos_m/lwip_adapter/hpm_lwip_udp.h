@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HPM_LWIP_UDP_H
+#define HPM_LWIP_UDP_H
+
+#include <stdint.h>
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/udp.h"
+#include "hpm_lwip.h"
+
+/*
+ * Callback based UDP endpoints on the lwIP raw API, for high rate datagrams without the socket
+ * layer and its copies. A received datagram reaches the handler as the pbuf the driver filled,
+ * payload first; HpmLwipUdpAlloc() returns one contiguous pbuf with room for the UDP, IP and
+ * Ethernet headers in front, lwIP prepends them in place and the driver copies the whole frame
+ * into its TX buffer in one go. The MAC inserts the checksums, the payload is written once by
+ * the application and copied once by the driver in either direction.
+ *
+ * Handlers run in the tcpip thread and must not block. Open, close and send may be called from
+ * any task, they go through tcpip_api_call(), which is a direct call with LWIP_TCPIP_CORE_LOCKING.
+ */
+
+#define HPM_LWIP_UDP_MAX_ENDPOINTS  8
+/* one unfragmented datagram on the largest MTU, lwIP fragments it on a device with a smaller one */
+#define HPM_LWIP_UDP_MAX_LEN        (HPM_ENET_MAX_MTU - IP_HLEN - UDP_HLEN)
+
+struct HpmLwipUdp;
+
+/*
+ * Return 0 to keep p, it is freed with pbuf_free() later, from any task. Anything else drops
+ * it, the endpoint frees it and counts rxDropped. p may be a chain if the datagram is larger
+ * than PBUF_POOL_BUFSIZE.
+ */
+typedef int (*HpmLwipUdpHandler)(struct HpmLwipUdp *ep, struct pbuf *p, const ip_addr_t *addr, uint16_t port,
+                                 void *arg);
+
+struct HpmLwipUdpCfg {
+    const char *ifname; /* bind to the address of this interface, NULL for all interfaces */
+    uint16_t localPort; /* 0: any free port */
+    ip_addr_t remote; /* destination of HpmLwipUdpSend() */
+    uint16_t remotePort; /* 0: not connected, only HpmLwipUdpSendTo() and datagrams from anyone */
+    HpmLwipUdpHandler handler; /* NULL: send only, received datagrams are dropped */
+    void *arg;
+};
+
+struct HpmLwipUdpStats {
+    uint32_t rxPackets;
+    uint32_t rxBytes;
+    uint32_t rxDropped; /* refused by the handler or no handler */
+    uint32_t txPackets;
+    uint32_t txBytes;
+    uint32_t txNoMem; /* HpmLwipUdpAlloc() failed */
+    uint32_t txErrors; /* refused by lwIP or the driver: no route, no ARP entry yet, TX ring full */
+};
+
+/* Endpoint bound as cfg says, NULL if the table is full, the port is taken or ifname is unknown */
+struct HpmLwipUdp *HpmLwipUdpOpen(const struct HpmLwipUdpCfg *cfg);
+/* No handler call follows once this returned */
+void HpmLwipUdpClose(struct HpmLwipUdp *ep);
+
+/* Datagram of len payload bytes, up to HPM_LWIP_UDP_MAX_LEN, to be filled at p->payload */
+struct pbuf *HpmLwipUdpAlloc(struct HpmLwipUdp *ep, uint16_t len);
+
+/* Send p and free it, also on error: 0 on success, -1 on error */
+int HpmLwipUdpSend(struct HpmLwipUdp *ep, struct pbuf *p);
+int HpmLwipUdpSendTo(struct HpmLwipUdp *ep, struct pbuf *p, const ip_addr_t *addr, uint16_t port);
+
+void HpmLwipUdpGetStats(struct HpmLwipUdp *ep, struct HpmLwipUdpStats *stats);
+void HpmLwipUdpResetStats(struct HpmLwipUdp *ep);
+
+#endif
@@ -16,6 +16,19 @@
 #define HPMICRO_LWIPOPTS_H
 
 #include "lwip/lwipopts.h"
+
+/* DMA descriptors of each MAC, hpm_lwip.h allocates the rings, the profile below sizes from them */
+#define HPM_ENET_RX_BUFF_COUNT 64
+#define HPM_ENET_TX_BUFF_COUNT 10
+
+/*
+ * 1: throughput profile for bulk TCP. The receive window and the send buffer cover one full RX
+ * ring of segments (window scaling takes the window past 64 KB), the pbuf pool holds that window
+ * and a quarter ring more, the segment and tcpip message pools follow. hpm_lwip_mem.c checks the
+ * result at compile time. 0: the small footprint settings below.
+ */
+#define HPM_LWIP_THROUGHPUT_PROFILE 0
+
 #undef MEM_SIZE
 #define MEM_SIZE 128*1024
 
@@ -39,6 +52,66 @@
 #undef LWIP_CONFIG_NUM_SOCKETS
 #define LWIP_CONFIG_NUM_SOCKETS 16
 
+#if HPM_LWIP_THROUGHPUT_PROFILE
+#undef TCP_MSS
+#define TCP_MSS 1460
+
+#undef LWIP_WND_SCALE
+#define LWIP_WND_SCALE 1
+#undef TCP_RCV_SCALE
+#define TCP_RCV_SCALE 1
+
+#undef TCP_WND
+#define TCP_WND (HPM_ENET_RX_BUFF_COUNT * TCP_MSS)
+#undef TCP_SND_BUF
+#define TCP_SND_BUF TCP_WND
+#undef TCP_SND_QUEUELEN
+#define TCP_SND_QUEUELEN ((4 * TCP_SND_BUF + TCP_MSS - 1) / TCP_MSS)
+
+#undef PBUF_POOL_SIZE
+#define PBUF_POOL_SIZE (HPM_ENET_RX_BUFF_COUNT + HPM_ENET_RX_BUFF_COUNT / 4)
+/* queued segments of the send buffer plus an out of order window */
+#undef MEMP_NUM_TCP_SEG
+#define MEMP_NUM_TCP_SEG (TCP_SND_QUEUELEN + HPM_ENET_RX_BUFF_COUNT)
+/* every received frame is one message to the tcpip thread, both MACs may fill their ring */
+#undef MEMP_NUM_TCPIP_MSG_INPKT
+#define MEMP_NUM_TCPIP_MSG_INPKT (2 * HPM_ENET_RX_BUFF_COUNT)
+#undef TCPIP_MBOX_SIZE
+#define TCPIP_MBOX_SIZE (2 * HPM_ENET_RX_BUFF_COUNT)
+#undef DEFAULT_TCP_RECVMBOX_SIZE
+#define DEFAULT_TCP_RECVMBOX_SIZE (TCP_WND / TCP_MSS)
+
+/* the send buffer of one bulk sender on top of what the small profile has */
+#undef MEM_SIZE
+#define MEM_SIZE (TCP_SND_BUF + 128 * 1024)
+#endif
+
+/*
+ * 1: pool use and high watermarks for the "lwipmem" shell command, TCP retransmits for "iperf".
+ * The counters cost RAM and work per packet, by default only shell builds keep them.
+ */
+#ifndef HPM_LWIP_STATS
+#ifdef LOSCFG_SHELL
+#define HPM_LWIP_STATS 1
+#else
+#define HPM_LWIP_STATS 0
+#endif
+#endif
+
+#undef LWIP_STATS
+#undef MEM_STATS
+#undef MEMP_STATS
+#undef TCP_STATS
+#if HPM_LWIP_STATS
+#define LWIP_STATS 1
+#define MEM_STATS 1
+#define MEMP_STATS 1
+#define TCP_STATS 1
+#else
+/* lwIP/opt.h turns the per-module counters off with it */
+#define LWIP_STATS 0
+#endif
+
 
 /*
 Some MCUs allow computing and verifying the IP, UDP, TCP and ICMP checksums by hardware:
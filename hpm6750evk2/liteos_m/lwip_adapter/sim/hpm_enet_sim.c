@@ -0,0 +1,842 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+#include <los_interrupt.h>
+#include "hpm_dma_buf.h"
+#include "hpm_enet_sim.h"
+
+#define SIM_MAC_NUM             2U
+#define SIM_PCAP_MAGIC          0xA1B2C3D4U
+#define SIM_PCAP_MAGIC_SWAPPED  0xD4C3B2A1U
+#define SIM_PCAP_MAGIC_NS       0xA1B23C4DU
+#define SIM_PCAP_MAGIC_NS_SWAP  0x4D3CB2A1U
+#define SIM_PCAP_LINKTYPE_ETH   1U
+#define SIM_FRAME_MAX           16384U
+#define SIM_WIRE_OVERHEAD       20U /* preamble, SFD and inter-frame gap */
+#define SIM_WIRE_MIN_FRAME      64U
+#define SIM_POLL_MS             100
+#define SIM_RING_WAIT_NS        20000U
+#define SIM_ETH_HDR             14U
+
+#define SIM_PTR(addr)           ((uint8_t *)(uintptr_t)(addr))
+#define SIM_ADDR(ptr)           ((uint32_t)(uintptr_t)(ptr))
+
+struct SimPcapHdr {
+    uint32_t magic;
+    uint16_t versionMajor;
+    uint16_t versionMinor;
+    int32_t thisZone;
+    uint32_t sigFigs;
+    uint32_t snapLen;
+    uint32_t linkType;
+};
+
+struct SimPcapRec {
+    uint32_t sec;
+    uint32_t usec;
+    uint32_t inclLen;
+    uint32_t origLen;
+};
+
+struct SimMac {
+    ENET_Type *base;
+    uint32_t irqNum;
+    struct HpmEnetSimCfg cfg;
+    int attached;
+    volatile int running;
+    int rxStarted; /* there is a backend to receive from */
+    uint8_t addr[6];
+
+    int tapFd;
+    FILE *replay;
+    int replaySwapped;
+    FILE *capture;
+
+    enet_rx_desc_t *rxHead;
+    uint32_t rxCount;
+    uint32_t rxSize;
+    enet_rx_desc_t *rxCur;
+    uint32_t rxReclaim; /* oldest descriptor held by the driver */
+    uint32_t rxHeld;
+    uint64_t *rxStamp;
+    uint64_t rxWireFree;
+
+    enet_tx_desc_t *txHead;
+    uint32_t txCount;
+    enet_tx_desc_t *txCur;
+    uint64_t *txStamp;
+    uint64_t txWireFree;
+    int txKick;
+    pthread_mutex_t txLock;
+    pthread_cond_t txCond;
+
+    pthread_mutex_t lock; /* stats and the RX reclaim state */
+    struct HpmEnetSimStats stats;
+    pthread_t rxThread;
+    pthread_t txThread;
+    uint8_t rxFrame[SIM_FRAME_MAX];
+    uint8_t txFrame[SIM_FRAME_MAX];
+};
+
+ENET_Type g_hpmEnetSimRegs[SIM_MAC_NUM];
+static struct SimMac g_simMacs[SIM_MAC_NUM];
+
+uint64_t HpmEnetSimNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void SimSleepUntil(uint64_t ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)(ns / 1000000000ULL);
+    ts.tv_nsec = (long)(ns % 1000000000ULL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+static struct SimMac *SimMacOf(ENET_Type *base)
+{
+    for (uint32_t i = 0; i < SIM_MAC_NUM; i++) {
+        if (base == &g_hpmEnetSimRegs[i]) {
+            return &g_simMacs[i];
+        }
+    }
+    return NULL;
+}
+
+static uint32_t SimSwap32(uint32_t v, int swap)
+{
+    return swap ? __builtin_bswap32(v) : v;
+}
+
+/* Raise one DMA_STATUS event if the MAC has it enabled; 1 if the handler ran */
+static int SimIrq(struct SimMac *mac, uint32_t status, uint32_t enable)
+{
+    int ran = 0;
+
+    uint32_t intSave = LOS_IntLock();
+    if ((mac->base->DMA_INTR_EN & ENET_DMA_INTR_EN_NIE_MASK) && (mac->base->DMA_INTR_EN & enable)) {
+        mac->base->DMA_STATUS = status;
+        ran = HpmSimHwiRaise(HPM2LITEOS_IRQ(mac->irqNum));
+        mac->base->DMA_STATUS = 0;
+    }
+    LOS_IntRestore(intSave);
+    if (ran) {
+        pthread_mutex_lock(&mac->lock);
+        mac->stats.irqs++;
+        pthread_mutex_unlock(&mac->lock);
+    }
+    return ran;
+}
+
+/* Wire time of a frame of len bytes without CRC, 0 without a line rate */
+static uint64_t SimWireNs(const struct SimMac *mac, uint32_t len)
+{
+    uint32_t bytes = len + 4U;
+
+    if (mac->cfg.lineRateMbps == 0) {
+        return 0;
+    }
+    bytes = (bytes < SIM_WIRE_MIN_FRAME) ? SIM_WIRE_MIN_FRAME : bytes;
+    return (uint64_t)(bytes + SIM_WIRE_OVERHEAD) * 8000U / mac->cfg.lineRateMbps;
+}
+
+/* Wait until the wire described by *wireFree takes the next frame, then book it */
+static void SimWirePace(const struct SimMac *mac, uint64_t *wireFree, uint32_t len)
+{
+    uint64_t wireNs = SimWireNs(mac, len);
+    uint64_t now = HpmEnetSimNow();
+
+    if (wireNs == 0) {
+        return;
+    }
+    if (*wireFree > now) {
+        SimSleepUntil(*wireFree);
+        now = *wireFree;
+    }
+    *wireFree = now + wireNs;
+}
+
+static uint32_t SimSum(const uint8_t *data, uint32_t len, uint32_t sum)
+{
+    for (uint32_t i = 0; i + 1U < len; i += 2U) {
+        sum += (uint32_t)((data[i] << 8) | data[i + 1U]);
+    }
+    if (len & 1U) {
+        sum += (uint32_t)data[len - 1U] << 8;
+    }
+    return sum;
+}
+
+static uint16_t SimFold(uint32_t sum)
+{
+    while (sum >> 16) {
+        sum = (sum & 0xFFFFU) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+static void SimPut16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+/* Checksum insertion of cic 3: IPv4 header and the TCP, UDP or ICMP checksum of unfragmented packets */
+static void SimInsertChecksums(uint8_t *frame, uint32_t len)
+{
+    uint32_t off = SIM_ETH_HDR;
+    uint16_t type;
+    uint8_t *ip = NULL;
+    uint8_t *l4 = NULL;
+    uint32_t ihl;
+    uint32_t total;
+    uint32_t l4Len;
+    uint32_t csumOff;
+    uint32_t sum = 0;
+
+    if (len < SIM_ETH_HDR + 20U) {
+        return;
+    }
+    type = (uint16_t)((frame[12] << 8) | frame[13]);
+    if ((type == 0x8100U) && (len >= SIM_ETH_HDR + 24U)) {
+        type = (uint16_t)((frame[16] << 8) | frame[17]);
+        off += 4U;
+    }
+    if (type != 0x0800U) {
+        return;
+    }
+
+    ip = frame + off;
+    ihl = (ip[0] & 0x0FU) * 4U;
+    total = (uint32_t)((ip[2] << 8) | ip[3]);
+    if (((ip[0] >> 4) != 4U) || (ihl < 20U) || (total < ihl) || (off + total > len)) {
+        return;
+    }
+    SimPut16(ip + 10, 0);
+    SimPut16(ip + 10, SimFold(SimSum(ip, ihl, 0)));
+
+    /* fragments carry no complete L4 payload, the DMA leaves them alone */
+    if ((((ip[6] & 0x3FU) << 8) | ip[7]) != 0) {
+        return;
+    }
+    l4 = ip + ihl;
+    l4Len = total - ihl;
+    switch (ip[9]) {
+        case 1: /* ICMP */
+            csumOff = 2U;
+            break;
+        case 6: /* TCP */
+            csumOff = 16U;
+            break;
+        case 17: /* UDP */
+            csumOff = 6U;
+            break;
+        default:
+            return;
+    }
+    if (l4Len < csumOff + 2U) {
+        return;
+    }
+    SimPut16(l4 + csumOff, 0);
+    if (ip[9] != 1) {
+        sum = SimSum(ip + 12, 8U, 0);
+        sum += ip[9];
+        sum += l4Len;
+    }
+    uint16_t csum = SimFold(SimSum(l4, l4Len, sum));
+    if ((ip[9] == 17) && (csum == 0)) {
+        csum = 0xFFFFU;
+    }
+    SimPut16(l4 + csumOff, csum);
+}
+
+static void SimPcapWrite(FILE *file, const uint8_t *frame, uint32_t len)
+{
+    struct timespec ts;
+    struct SimPcapRec rec;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    rec.sec = (uint32_t)ts.tv_sec;
+    rec.usec = (uint32_t)(ts.tv_nsec / 1000);
+    rec.inclLen = len;
+    rec.origLen = len;
+    if ((fwrite(&rec, sizeof(rec), 1, file) != 1) || (fwrite(frame, 1, len, file) != len)) {
+        printf("Err: enet sim: capture write failed\n");
+    }
+}
+
+static int SimTapOpen(const char *name)
+{
+    struct ifreq ifr;
+    int fd = open("/dev/net/tun", O_RDWR);
+
+    if (fd < 0) {
+        printf("Err: enet sim: /dev/net/tun: %s\n", strerror(errno));
+        return -1;
+    }
+    memset(&ifr, 0, sizeof(ifr));
+    ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", name);
+    if (ioctl(fd, TUNSETIFF, &ifr) < 0) {
+        printf("Err: enet sim: attach %s: %s\n", name, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static FILE *SimReplayOpen(const char *path, int *swapped)
+{
+    struct SimPcapHdr hdr;
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL) {
+        printf("Err: enet sim: %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    if (fread(&hdr, sizeof(hdr), 1, file) != 1) {
+        hdr.magic = 0;
+    }
+    *swapped = (hdr.magic == SIM_PCAP_MAGIC_SWAPPED) || (hdr.magic == SIM_PCAP_MAGIC_NS_SWAP);
+    if (((hdr.magic != SIM_PCAP_MAGIC) && (hdr.magic != SIM_PCAP_MAGIC_NS) && !*swapped) ||
+        (SimSwap32(hdr.linkType, *swapped) != SIM_PCAP_LINKTYPE_ETH)) {
+        printf("Err: enet sim: %s is not an Ethernet pcap file\n", path);
+        fclose(file);
+        return NULL;
+    }
+    return file;
+}
+
+static FILE *SimCaptureOpen(const char *path)
+{
+    struct SimPcapHdr hdr = {SIM_PCAP_MAGIC, 2, 4, 0, 0, SIM_FRAME_MAX, SIM_PCAP_LINKTYPE_ETH};
+    FILE *file = fopen(path, "wb");
+
+    if ((file == NULL) || (fwrite(&hdr, sizeof(hdr), 1, file) != 1)) {
+        printf("Err: enet sim: %s: %s\n", path, strerror(errno));
+        if (file != NULL) {
+            fclose(file);
+        }
+        return NULL;
+    }
+    return file;
+}
+
+/* Account the RX descriptors the driver gave back since the last call, caller holds mac->lock */
+static void SimRxReclaim(struct SimMac *mac)
+{
+    uint64_t now = HpmEnetSimNow();
+
+    while (mac->rxHeld > 0) {
+        enet_rx_desc_t *desc = &mac->rxHead[mac->rxReclaim];
+        if (desc->rdes0_bm.own == 0) {
+            break;
+        }
+        uint64_t held = now - mac->rxStamp[mac->rxReclaim];
+        mac->stats.rxHoldNsTotal += held;
+        mac->stats.rxHoldNsMax = (held > mac->stats.rxHoldNsMax) ? held : mac->stats.rxHoldNsMax;
+        mac->stats.rxReturned++;
+        mac->stats.rxLastReturnNs = now;
+        mac->rxReclaim = (mac->rxReclaim + 1U) % mac->rxCount;
+        mac->rxHeld--;
+    }
+}
+
+static int SimRxAccept(const struct SimMac *mac, const uint8_t *frame)
+{
+    /* group addresses and the own address pass the MAC filter, promiscuous mode passes all */
+    return (frame[0] & 1U) || (memcmp(frame, mac->addr, sizeof(mac->addr)) == 0) ||
+           (mac->base->MACFF & ENET_MACFF_PR_MASK);
+}
+
+/*
+ * Write one frame into the RX ring as the DMA does: split over as many descriptors as it takes,
+ * the length with CRC in the last one, ownership handed over first descriptor last. Returns 0
+ * when delivered, 1 when the ring is full, -1 when the MAC drops the frame anyway.
+ */
+static int SimRxDeliver(struct SimMac *mac, const uint8_t *frame, uint32_t len, int wait)
+{
+    enet_rx_desc_t *first = mac->rxCur;
+    enet_rx_desc_t *desc = first;
+    uint32_t need;
+    uint32_t left = len;
+    uint64_t now;
+
+    pthread_mutex_lock(&mac->lock);
+    if ((len < SIM_ETH_HDR) || (len + 4U > ENET_MAX_FRAME_SIZE)) {
+        mac->stats.rxOversize += (len >= SIM_ETH_HDR);
+        pthread_mutex_unlock(&mac->lock);
+        return -1;
+    }
+    if (!SimRxAccept(mac, frame)) {
+        mac->stats.rxFiltered++;
+        pthread_mutex_unlock(&mac->lock);
+        return -1;
+    }
+    SimRxReclaim(mac);
+    need = (len + mac->rxSize - 1U) / mac->rxSize;
+    for (uint32_t i = 0; i < need; i++) {
+        if (desc->rdes0_bm.own == 0) {
+            mac->stats.rxMissed += !wait;
+            pthread_mutex_unlock(&mac->lock);
+            return wait ? 1 : -1;
+        }
+        desc = (enet_rx_desc_t *)SIM_PTR(desc->rdes3_bm.next_desc);
+    }
+
+    now = HpmEnetSimNow();
+    desc = first;
+    for (uint32_t i = 0; i < need; i++) {
+        uint32_t chunk = (left > mac->rxSize) ? mac->rxSize : left;
+        uint32_t index = (uint32_t)(desc - mac->rxHead);
+
+        memcpy(SIM_PTR(desc->rdes2_bm.buffer1), frame + (len - left), chunk);
+        left -= chunk;
+        desc->rdes0_bm.fs = (i == 0);
+        desc->rdes0_bm.ls = (i == need - 1U);
+        desc->rdes0_bm.es = 0;
+        desc->rdes0_bm.fl = (i == need - 1U) ? (len + 4U) : 0;
+        mac->rxStamp[index] = now;
+        if (i != 0) {
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            desc->rdes0_bm.own = 0;
+        }
+        mac->rxCur = (enet_rx_desc_t *)SIM_PTR(desc->rdes3_bm.next_desc);
+        desc = mac->rxCur;
+    }
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    first->rdes0_bm.own = 0;
+
+    mac->rxHeld += need;
+    mac->stats.rxHeldMax = (mac->rxHeld > mac->stats.rxHeldMax) ? mac->rxHeld : mac->stats.rxHeldMax;
+    if (mac->stats.rxFrames == 0) {
+        mac->stats.rxFirstNs = now;
+    }
+    mac->stats.rxFrames++;
+    mac->stats.rxBytes += len;
+    pthread_mutex_unlock(&mac->lock);
+
+    (void)SimIrq(mac, ENET_DMA_STATUS_RI_MASK, ENET_DMA_INTR_EN_RIE_MASK);
+    return 0;
+}
+
+/* Next frame of the replay file, its length or 0 at the end */
+static uint32_t SimReplayNext(struct SimMac *mac)
+{
+    struct SimPcapRec rec;
+
+    while (fread(&rec, sizeof(rec), 1, mac->replay) == 1) {
+        uint32_t incl = SimSwap32(rec.inclLen, mac->replaySwapped);
+        uint32_t orig = SimSwap32(rec.origLen, mac->replaySwapped);
+        if ((incl > SIM_FRAME_MAX) || (fread(mac->rxFrame, 1, incl, mac->replay) != incl)) {
+            break;
+        }
+        /* a frame cut by the snap length would reach lwIP malformed */
+        if (incl == orig) {
+            return incl;
+        }
+    }
+    return 0;
+}
+
+static void *SimRxMain(void *arg)
+{
+    struct SimMac *mac = (struct SimMac *)arg;
+    struct pollfd pfd;
+
+    while (mac->running) {
+        uint32_t len = 0;
+
+        if (mac->tapFd >= 0) {
+            pfd.fd = mac->tapFd;
+            pfd.events = POLLIN;
+            if (poll(&pfd, 1, SIM_POLL_MS) <= 0) {
+                continue;
+            }
+            ssize_t n = read(mac->tapFd, mac->rxFrame, sizeof(mac->rxFrame));
+            if (n <= 0) {
+                continue;
+            }
+            len = (uint32_t)n;
+        } else {
+            len = SimReplayNext(mac);
+            if (len == 0) {
+                pthread_mutex_lock(&mac->lock);
+                mac->stats.replayDone = 1;
+                pthread_mutex_unlock(&mac->lock);
+                break;
+            }
+        }
+
+        SimWirePace(mac, &mac->rxWireFree, len);
+        /* an unpaced replay waits for the driver instead of dropping */
+        while (mac->running && (SimRxDeliver(mac, mac->rxFrame, len, mac->cfg.lineRateMbps == 0) == 1)) {
+            SimSleepUntil(HpmEnetSimNow() + SIM_RING_WAIT_NS);
+        }
+    }
+    return NULL;
+}
+
+/* Transmit the frame starting at mac->txCur, all its descriptors are owned by the DMA */
+static void SimTxFrame(struct SimMac *mac)
+{
+    enet_tx_desc_t *first = mac->txCur;
+    enet_tx_desc_t *desc = first;
+    uint32_t index = (uint32_t)(first - mac->txHead);
+    uint32_t len = 0;
+    uint32_t segs = 0;
+    int cic = first->tdes0_bm.cic;
+    int ic = 0;
+
+    while (1) {
+        uint32_t chunk = desc->tdes1_bm.tbs1;
+        if (len + chunk <= SIM_FRAME_MAX) {
+            memcpy(mac->txFrame + len, SIM_PTR(desc->tdes2_bm.buffer1), chunk);
+        }
+        len += chunk;
+        segs++;
+        ic = desc->tdes0_bm.ic;
+        if (desc->tdes0_bm.ls || (segs == mac->txCount)) {
+            break;
+        }
+        desc = (enet_tx_desc_t *)SIM_PTR(desc->tdes3_bm.next_desc);
+    }
+    /* the length handed over counts the CRC the MAC appends */
+    len = (len > SIM_FRAME_MAX) ? SIM_FRAME_MAX : len;
+    len = (len >= 4U) ? (len - 4U) : 0;
+
+    if (cic == 3) {
+        SimInsertChecksums(mac->txFrame, len);
+    }
+    SimWirePace(mac, &mac->txWireFree, len);
+    if ((mac->tapFd >= 0) && (write(mac->tapFd, mac->txFrame, len) != (ssize_t)len)) {
+        printf("Err: enet sim: TAP write: %s\n", strerror(errno));
+    }
+    if (mac->capture != NULL) {
+        SimPcapWrite(mac->capture, mac->txFrame, len);
+    }
+
+    uint64_t queued = HpmEnetSimNow() - mac->txStamp[index];
+    desc = first;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (uint32_t i = 0; i < segs; i++) {
+        desc->tdes0_bm.own = 0;
+        desc = (enet_tx_desc_t *)SIM_PTR(desc->tdes3_bm.next_desc);
+    }
+    mac->txCur = desc;
+
+    pthread_mutex_lock(&mac->lock);
+    mac->stats.txFrames++;
+    mac->stats.txBytes += len;
+    mac->stats.txQueueNsTotal += queued;
+    mac->stats.txQueueNsMax = (queued > mac->stats.txQueueNsMax) ? queued : mac->stats.txQueueNsMax;
+    pthread_mutex_unlock(&mac->lock);
+
+    if (ic) {
+        (void)SimIrq(mac, ENET_DMA_STATUS_TI_MASK, ENET_DMA_INTR_EN_TIE_MASK);
+    }
+}
+
+static void *SimTxMain(void *arg)
+{
+    struct SimMac *mac = (struct SimMac *)arg;
+
+    while (1) {
+        pthread_mutex_lock(&mac->txLock);
+        while (!mac->txKick && mac->running) {
+            pthread_cond_wait(&mac->txCond, &mac->txLock);
+        }
+        mac->txKick = 0;
+        pthread_mutex_unlock(&mac->txLock);
+        if (!mac->running) {
+            break;
+        }
+
+        while (mac->txCur->tdes0_bm.own) {
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            SimTxFrame(mac);
+        }
+    }
+    return NULL;
+}
+
+static void SimTxKick(struct SimMac *mac)
+{
+    pthread_mutex_lock(&mac->txLock);
+    mac->txKick = 1;
+    pthread_cond_signal(&mac->txCond);
+    pthread_mutex_unlock(&mac->txLock);
+}
+
+int HpmEnetSimAttach(ENET_Type *base, uint32_t irqNum, const struct HpmEnetSimCfg *cfg)
+{
+    struct SimMac *mac = SimMacOf(base);
+
+    if ((mac == NULL) || mac->attached) {
+        return -1;
+    }
+    memset(mac, 0, offsetof(struct SimMac, rxFrame));
+    mac->base = base;
+    mac->irqNum = irqNum;
+    mac->cfg = *cfg;
+    mac->tapFd = -1;
+
+    if (cfg->tap != NULL) {
+        mac->tapFd = SimTapOpen(cfg->tap);
+        if (mac->tapFd < 0) {
+            return -1;
+        }
+    } else if (cfg->replay != NULL) {
+        mac->replay = SimReplayOpen(cfg->replay, &mac->replaySwapped);
+        if (mac->replay == NULL) {
+            return -1;
+        }
+    }
+    if (cfg->capture != NULL) {
+        mac->capture = SimCaptureOpen(cfg->capture);
+        if (mac->capture == NULL) {
+            HpmEnetSimStop(base);
+            return -1;
+        }
+    }
+    pthread_mutex_init(&mac->lock, NULL);
+    pthread_mutex_init(&mac->txLock, NULL);
+    pthread_cond_init(&mac->txCond, NULL);
+    mac->attached = 1;
+    return 0;
+}
+
+void HpmEnetSimStop(ENET_Type *base)
+{
+    struct SimMac *mac = SimMacOf(base);
+
+    if (mac == NULL) {
+        return;
+    }
+    if (mac->running) {
+        mac->running = 0;
+        SimTxKick(mac);
+        if (mac->rxStarted) {
+            pthread_join(mac->rxThread, NULL);
+        }
+        pthread_join(mac->txThread, NULL);
+    }
+    if (mac->tapFd >= 0) {
+        close(mac->tapFd);
+        mac->tapFd = -1;
+    }
+    if (mac->replay != NULL) {
+        fclose(mac->replay);
+        mac->replay = NULL;
+    }
+    if (mac->capture != NULL) {
+        fclose(mac->capture);
+        mac->capture = NULL;
+    }
+}
+
+int HpmEnetSimGetStats(ENET_Type *base, struct HpmEnetSimStats *stats)
+{
+    struct SimMac *mac = SimMacOf(base);
+
+    if ((mac == NULL) || !mac->attached) {
+        return -1;
+    }
+    pthread_mutex_lock(&mac->lock);
+    if (mac->rxStamp != NULL) {
+        SimRxReclaim(mac);
+    }
+    *stats = mac->stats;
+    stats->rxHeld = mac->rxHeld;
+    pthread_mutex_unlock(&mac->lock);
+    return 0;
+}
+
+hpm_stat_t enet_controller_init(ENET_Type *ptr, enet_inf_type_t inf_type, enet_desc_t *desc,
+                                enet_mac_config_t *config, uint32_t intr)
+{
+    struct SimMac *mac = SimMacOf(ptr);
+    enet_rx_desc_t *rx = desc->rx_desc_list_head;
+    enet_tx_desc_t *tx = desc->tx_desc_list_head;
+    uint32_t rxCount = desc->rx_buff_cfg.count;
+    uint32_t txCount = desc->tx_buff_cfg.count;
+    (void)inf_type;
+
+    if ((mac == NULL) || !mac->attached || mac->running) {
+        return status_invalid_argument;
+    }
+
+    for (uint32_t i = 0; i < rxCount; i++) {
+        memset(&rx[i], 0, sizeof(rx[i]));
+        rx[i].rdes1_bm.rch = 1;
+        rx[i].rdes1_bm.rbs1 = desc->rx_buff_cfg.size;
+        rx[i].rdes2_bm.buffer1 = desc->rx_buff_cfg.buffer + i * desc->rx_buff_cfg.size;
+        rx[i].rdes3_bm.next_desc = SIM_ADDR(&rx[(i + 1U) % rxCount]);
+        rx[i].rdes0_bm.own = 1;
+    }
+    for (uint32_t i = 0; i < txCount; i++) {
+        memset(&tx[i], 0, sizeof(tx[i]));
+        tx[i].tdes0_bm.tch = 1;
+        tx[i].tdes2_bm.buffer1 = desc->tx_buff_cfg.buffer + i * desc->tx_buff_cfg.size;
+        tx[i].tdes3_bm.next_desc = SIM_ADDR(&tx[(i + 1U) % txCount]);
+    }
+    desc->rx_desc_list_cur = rx;
+    desc->tx_desc_list_cur = tx;
+    memset(&desc->rx_frame_info, 0, sizeof(desc->rx_frame_info));
+
+    /* mac_addr_low holds bytes 0-3, mac_addr_high bytes 4-5, as hpm_lwip.c packs them */
+    for (uint32_t i = 0; i < 4U; i++) {
+        mac->addr[i] = (uint8_t)(config->mac_addr_low[0] >> (8U * i));
+    }
+    mac->addr[4] = (uint8_t)config->mac_addr_high[0];
+    mac->addr[5] = (uint8_t)(config->mac_addr_high[0] >> 8);
+
+    mac->rxHead = rx;
+    mac->rxCount = rxCount;
+    mac->rxSize = desc->rx_buff_cfg.size;
+    mac->rxCur = rx;
+    mac->txHead = tx;
+    mac->txCount = txCount;
+    mac->txCur = tx;
+    mac->rxStamp = calloc(rxCount, sizeof(uint64_t));
+    mac->txStamp = calloc(txCount, sizeof(uint64_t));
+    if ((mac->rxStamp == NULL) || (mac->txStamp == NULL)) {
+        return status_fail;
+    }
+
+    ptr->MACCFG = 0;
+    ptr->MACFF = 0;
+    ptr->DMA_STATUS = 0;
+    ptr->DMA_INTR_EN = intr;
+    mac->running = 1;
+    mac->rxStarted = (mac->tapFd >= 0) || (mac->replay != NULL);
+    if (mac->rxStarted) {
+        pthread_create(&mac->rxThread, NULL, SimRxMain, mac);
+    }
+    pthread_create(&mac->txThread, NULL, SimTxMain, mac);
+    return status_success;
+}
+
+enet_frame_t enet_get_received_frame_interrupt(enet_rx_desc_t **parent_rx_desc_list_cur,
+                                               enet_rx_frame_info_t *rx_frame_info, uint32_t rx_desc_count)
+{
+    enet_frame_t frame = {0, 0, 0};
+    uint32_t desc_scan_counter = 0;
+    enet_rx_desc_t *rx_desc_list_cur = *parent_rx_desc_list_cur;
+
+    /* scan the descriptors owned by the CPU, same walk as the hpm_sdk driver */
+    while ((rx_desc_list_cur->rdes0_bm.own == 0) && (desc_scan_counter < rx_desc_count)) {
+        desc_scan_counter++;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if ((rx_desc_list_cur->rdes0_bm.fs == 1) && (rx_desc_list_cur->rdes0_bm.ls == 0)) {
+            /* first segment */
+            rx_frame_info->fs_rx_desc = rx_desc_list_cur;
+            rx_frame_info->seg_count = 1;
+        } else if ((rx_desc_list_cur->rdes0_bm.ls == 0) && (rx_desc_list_cur->rdes0_bm.fs == 0)) {
+            /* intermediate segment */
+            rx_frame_info->seg_count++;
+        } else {
+            /* last segment */
+            rx_frame_info->ls_rx_desc = rx_desc_list_cur;
+            rx_frame_info->seg_count++;
+            if (rx_frame_info->seg_count == 1) {
+                rx_frame_info->fs_rx_desc = rx_desc_list_cur;
+            }
+            frame.length = rx_desc_list_cur->rdes0_bm.fl - 4U;
+            frame.buffer = rx_frame_info->fs_rx_desc->rdes2_bm.buffer1;
+            frame.rx_desc = rx_frame_info->fs_rx_desc;
+            *parent_rx_desc_list_cur = (enet_rx_desc_t *)SIM_PTR(rx_desc_list_cur->rdes3_bm.next_desc);
+            return frame;
+        }
+        rx_desc_list_cur = (enet_rx_desc_t *)SIM_PTR(rx_desc_list_cur->rdes3_bm.next_desc);
+        *parent_rx_desc_list_cur = rx_desc_list_cur;
+    }
+    return frame;
+}
+
+uint32_t enet_prepare_transmission_descriptors(ENET_Type *ptr, enet_tx_desc_t **parent_tx_desc_list_cur,
+                                               uint16_t frame_length, uint16_t tx_buff_size)
+{
+    struct SimMac *mac = SimMacOf(ptr);
+    enet_tx_desc_t *first = *parent_tx_desc_list_cur;
+    enet_tx_desc_t *desc = first;
+    uint32_t buf_count;
+    uint32_t size = frame_length;
+
+    if ((mac == NULL) || !mac->running || (frame_length == 0) || (first->tdes0_bm.own != 0)) {
+        return ENET_ERROR;
+    }
+
+    buf_count = (frame_length + tx_buff_size - 1U) / tx_buff_size;
+    mac->txStamp[first - mac->txHead] = HpmEnetSimNow();
+    for (uint32_t i = 0; i < buf_count; i++) {
+        desc->tdes0_bm.fs = (i == 0);
+        desc->tdes0_bm.ls = (i == buf_count - 1U);
+        desc->tdes0_bm.ic = (i == buf_count - 1U);
+        desc->tdes0_bm.cic = 3;
+        desc->tdes1_bm.tbs1 = (size > tx_buff_size) ? tx_buff_size : size;
+        size -= desc->tdes1_bm.tbs1;
+        /* the first descriptor goes to the DMA last, once the whole chain is valid */
+        if (i != 0) {
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            desc->tdes0_bm.own = 1;
+        }
+        desc = (enet_tx_desc_t *)SIM_PTR(desc->tdes3_bm.next_desc);
+    }
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    first->tdes0_bm.own = 1;
+    *parent_tx_desc_list_cur = desc;
+
+    ptr->DMA_TX_POLL_DEMAND = 1;
+    SimTxKick(mac);
+    return ENET_SUCCESS;
+}
+
+void enet_disable_lpi_interrupt(ENET_Type *ptr)
+{
+    (void)ptr;
+}
+
+/* Host caches are coherent with the engine threads, the driver's cache maintenance is a no-op */
+void HpmDmaSyncForCpu(const void *addr, uint32_t size)
+{
+    (void)addr;
+    (void)size;
+}
+
+void HpmDmaSyncForDevice(const void *addr, uint32_t size)
+{
+    (void)addr;
+    (void)size;
+}
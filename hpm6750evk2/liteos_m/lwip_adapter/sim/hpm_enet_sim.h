@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HPM_ENET_SIM_H
+#define HPM_ENET_SIM_H
+
+#include <stdint.h>
+#include "hpm_enet_drv.h"
+
+/*
+ * Simulated ENET DMA for running ethernetif.c on a Linux host.
+ *
+ * Each MAC gets an RX and a TX engine thread working on the same descriptor rings the driver
+ * sets up, with the ownership handshake, frame splitting over several buffers, the CRC counted
+ * in the lengths and the checksum insertion (cic 3) of the real DMA. RX frames come from a TAP
+ * interface or a pcap file, TX frames go to the TAP interface and/or a pcap file. Interrupts are
+ * raised through the los_interrupt.h shim, one DMA_STATUS event per call.
+ *
+ * With a line rate both directions are paced like the wire, and RX drops a frame when no
+ * descriptor is free, as the MAC would. Without one the replay waits for free descriptors, so it
+ * measures how fast the driver and lwIP consume frames.
+ */
+
+struct HpmEnetSimCfg {
+    const char *tap; /* TAP interface to attach, created with "ip tuntap add <name> mode tap" */
+    const char *replay; /* pcap file played into RX, used when there is no TAP */
+    const char *capture; /* pcap file every transmitted frame is written to */
+    uint32_t lineRateMbps; /* 0: unlimited */
+};
+
+struct HpmEnetSimStats {
+    uint64_t rxFrames;
+    uint64_t rxBytes;
+    uint64_t rxMissed; /* no free RX descriptor */
+    uint64_t rxFiltered; /* not for the MAC address and not promiscuous */
+    uint64_t rxOversize;
+    uint64_t txFrames;
+    uint64_t txBytes;
+    uint64_t irqs;
+    uint32_t rxHeld; /* RX descriptors the driver holds now */
+    uint32_t rxHeldMax; /* and the most it held at once */
+    uint64_t rxReturned; /* RX descriptors the driver gave back */
+    uint64_t rxHoldNsTotal; /* handed to the driver until given back */
+    uint64_t rxHoldNsMax;
+    uint64_t txQueueNsTotal; /* handed to the DMA until on the wire */
+    uint64_t txQueueNsMax;
+    uint64_t rxFirstNs; /* HpmEnetSimNow() of the first RX frame */
+    uint64_t rxLastReturnNs; /* and of the last RX descriptor given back */
+    int replayDone;
+};
+
+/* Monotonic time in ns, the time base of the stats */
+uint64_t HpmEnetSimNow(void);
+
+/* Connect the MAC at base to its backends; before enet_controller_init() starts the engines */
+int HpmEnetSimAttach(ENET_Type *base, uint32_t irqNum, const struct HpmEnetSimCfg *cfg);
+
+/* Stop the engines of base and close its backends */
+void HpmEnetSimStop(ENET_Type *base);
+
+int HpmEnetSimGetStats(ENET_Type *base, struct HpmEnetSimStats *stats);
+
+#endif
@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host runner for ethernetif.c on top of the simulated ENET DMA.
+ *
+ * It stands in for hpm_lwip.c: same devices, rings and addresses, minus the board, clock and PHY
+ * calls. With -t the MACs attach to TAP interfaces and lwIP runs an iperf server, so the host can
+ * measure throughput (iperf -c) and latency (ping) through the real adapter. With -r a pcap file
+ * is replayed into geth and the run reports how fast the driver and lwIP took the frames, the
+ * time descriptors were held, and the lwIP pool high watermarks, which is what regressions
+ * are meant to compare.
+ *
+ * This describes the design: the runner has never been linked or run, see BUILD.gn.
+ */
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lwip/tcpip.h"
+#include "lwip/apps/lwiperf.h"
+#include "hpm_lwip.h"
+#include "ethernetif.h"
+#include "hpm_enet_sim.h"
+#include <los_sem.h>
+#include <los_task.h>
+#include <los_tick.h>
+
+#define SIM_DEV_NUM         2U
+#define SIM_SETTLE_TICKS    200U
+#define SIM_POLL_TICKS      10U
+#define SIM_REPLAY_TIMEOUT  (60U * LOSCFG_BASE_CORE_TICK_PER_SECOND)
+
+static ATTR_ALIGN(ENET_SOC_DESC_ADDR_ALIGNMENT) enet_rx_desc_t g_simRxDesc[SIM_DEV_NUM][ENET_RX_BUFF_COUNT];
+static ATTR_ALIGN(ENET_SOC_DESC_ADDR_ALIGNMENT) enet_tx_desc_t g_simTxDesc[SIM_DEV_NUM][ENET_TX_BUFF_COUNT];
+static ATTR_DMA_BUF uint8_t g_simRxBuff[SIM_DEV_NUM][ENET_RX_BUFF_COUNT][ENET_RX_BUFF_SIZE];
+static ATTR_DMA_BUF uint8_t g_simTxBuff[SIM_DEV_NUM][ENET_TX_BUFF_COUNT][ENET_TX_BUFF_SIZE];
+
+static struct HpmEnetDevice g_simDevs[SIM_DEV_NUM] = {
+    [0] = {
+        .isDefault = 1,
+        .name = "geth",
+        .base = HPM_ENET0,
+        .irqNum = IRQn_ENET0,
+        .infType = enet_inf_rgmii,
+        .buffCached = 1,
+        .macAddr = {0x98, 0x2C, 0xBC, 0xB1, 0x9F, 0x15},
+        .ip = {192, 168, 2, 35},
+        .netmask = {255, 255, 255, 0},
+        .gw = {192, 168, 1, 1},
+    },
+    [1] = {
+        .isDefault = 0,
+        .name = "eth",
+        .base = HPM_ENET1,
+        .irqNum = IRQn_ENET1,
+        .infType = enet_inf_rmii,
+        .buffCached = 1,
+        .macAddr = {0x98, 0x2C, 0xBC, 0xB1, 0x9F, 0x17},
+        .ip = {192, 168, 1, 88},
+        .netmask = {255, 255, 255, 0},
+        .gw = {192, 168, 1, 1},
+    },
+};
+
+static volatile sig_atomic_t g_simInterrupted;
+
+struct HpmEnetDevice *HpmEnetDeviceGet(const char *name)
+{
+    for (uint32_t i = 0; i < SIM_DEV_NUM; i++) {
+        if (g_simDevs[i].isEnable && (strcmp(g_simDevs[i].name, name) == 0)) {
+            return &g_simDevs[i];
+        }
+    }
+    return NULL;
+}
+
+static void SimSigint(int sig)
+{
+    (void)sig;
+    g_simInterrupted = 1;
+}
+
+static void SimTcpipReady(void *arg)
+{
+    LOS_SemPost((UINT32)(uintptr_t)arg);
+}
+
+/* enetDevInit() of hpm_lwip.c without the board: rings, MAC address, controller, netif */
+static int SimDevInit(struct HpmEnetDevice *dev, uint32_t index, const struct HpmEnetSimCfg *cfg)
+{
+    enet_mac_config_t macCfg;
+    ip_addr_t ipaddr;
+    ip_addr_t netmask;
+    ip_addr_t gw;
+
+    /* descriptors hold 32-bit addresses as on the SoC, the non-PIE link keeps .bss below 4 GB */
+    if (((uintptr_t)&g_simRxDesc[index + 1U] > UINT32_MAX) || ((uintptr_t)&g_simTxDesc[index + 1U] > UINT32_MAX) ||
+        ((uintptr_t)&g_simRxBuff[index + 1U] > UINT32_MAX) || ((uintptr_t)&g_simTxBuff[index + 1U] > UINT32_MAX)) {
+        printf("sim: DMA memory above 4 GB, link with -no-pie\n");
+        return -1;
+    }
+    if (HpmEnetSimAttach(dev->base, dev->irqNum, cfg) != 0) {
+        return -1;
+    }
+    dev->desc.rx_desc_list_head = g_simRxDesc[index];
+    dev->desc.tx_desc_list_head = g_simTxDesc[index];
+    dev->desc.rx_buff_cfg.buffer = (uint32_t)(uintptr_t)g_simRxBuff[index];
+    dev->desc.rx_buff_cfg.count = ENET_RX_BUFF_COUNT;
+    dev->desc.rx_buff_cfg.size = ENET_RX_BUFF_SIZE;
+    dev->desc.tx_buff_cfg.buffer = (uint32_t)(uintptr_t)g_simTxBuff[index];
+    dev->desc.tx_buff_cfg.count = ENET_TX_BUFF_COUNT;
+    dev->desc.tx_buff_cfg.size = ENET_TX_BUFF_SIZE;
+
+    memset(&macCfg, 0, sizeof(macCfg));
+    macCfg.mac_addr_high[0] = ((uint32_t)dev->macAddr[5] << 8) | dev->macAddr[4];
+    macCfg.mac_addr_low[0] = ((uint32_t)dev->macAddr[3] << 24) | ((uint32_t)dev->macAddr[2] << 16) |
+                             ((uint32_t)dev->macAddr[1] << 8) | dev->macAddr[0];
+    macCfg.valid_max_count = 1;
+    if (enet_controller_init(dev->base, dev->infType, &dev->desc, &macCfg,
+                             ENET_DMA_INTR_EN_NIE_SET(1) | ENET_DMA_INTR_EN_RIE_SET(1)) != status_success) {
+        return -1;
+    }
+    dev->isEnable = 1;
+    dev->mtu = (dev->mtu == 0) ? HPM_ENET_MTU : dev->mtu;
+    if (dev->mtu > HPM_ENET_MAX_MTU) {
+        printf("%s: MTU %u above %u\n", dev->name, dev->mtu, HPM_ENET_MAX_MTU);
+        dev->mtu = HPM_ENET_MAX_MTU;
+    }
+
+    IP_ADDR4(&ipaddr, dev->ip[0], dev->ip[1], dev->ip[2], dev->ip[3]);
+    IP_ADDR4(&netmask, dev->netmask[0], dev->netmask[1], dev->netmask[2], dev->netmask[3]);
+    IP_ADDR4(&gw, dev->gw[0], dev->gw[1], dev->gw[2], dev->gw[3]);
+    LOCK_TCPIP_CORE();
+    netif_add(&dev->netif, &ipaddr, &netmask, &gw, dev, ethernetif_init, tcpip_input);
+    if (dev->isDefault) {
+        netif_set_default(&dev->netif);
+    }
+    netif_set_up(&dev->netif);
+    UNLOCK_TCPIP_CORE();
+    return 0;
+}
+
+static void SimIperfReport(void *arg, enum lwiperf_report_type reportType, const ip_addr_t *localAddr,
+                           u16_t localPort, const ip_addr_t *remoteAddr, u16_t remotePort, u32_t bytes,
+                           u32_t ms, u32_t kbps)
+{
+    (void)arg;
+    (void)localAddr;
+    (void)localPort;
+    (void)remotePort;
+    printf("iperf: %s from %s, %u bytes in %u ms, %u kbit/s\n",
+           (reportType == LWIPERF_TCP_DONE_SERVER) ? "done" : "aborted", ipaddr_ntoa(remoteAddr), bytes, ms, kbps);
+}
+
+static int SimReplayDrained(const struct HpmEnetDevice *dev)
+{
+    struct HpmEnetSimStats stats;
+
+    if (HpmEnetSimGetStats(dev->base, &stats) != 0) {
+        return 1;
+    }
+    return stats.replayDone && (stats.rxHeld == 0);
+}
+
+static void SimReport(const struct HpmEnetDevice *dev)
+{
+    struct HpmEnetSimStats stats;
+
+    if (!dev->isEnable || (HpmEnetSimGetStats(dev->base, &stats) != 0)) {
+        return;
+    }
+    printf("%s: rx %llu frames %llu bytes, missed %llu, filtered %llu, oversize %llu\n", dev->name,
+           (unsigned long long)stats.rxFrames, (unsigned long long)stats.rxBytes,
+           (unsigned long long)stats.rxMissed, (unsigned long long)stats.rxFiltered,
+           (unsigned long long)stats.rxOversize);
+    printf("%s: tx %llu frames %llu bytes, %llu interrupts\n", dev->name, (unsigned long long)stats.txFrames,
+           (unsigned long long)stats.txBytes, (unsigned long long)stats.irqs);
+    if (stats.rxReturned != 0) {
+        printf("  rx descriptors held: max %u of %u, avg %llu us, max %llu us\n", stats.rxHeldMax,
+               dev->desc.rx_buff_cfg.count, (unsigned long long)(stats.rxHoldNsTotal / stats.rxReturned / 1000U),
+               (unsigned long long)(stats.rxHoldNsMax / 1000U));
+    }
+    if (stats.txFrames != 0) {
+        printf("  tx queued: avg %llu us, max %llu us\n",
+               (unsigned long long)(stats.txQueueNsTotal / stats.txFrames / 1000U),
+               (unsigned long long)(stats.txQueueNsMax / 1000U));
+    }
+    uint32_t ticksPerUs = clock_get_frequency(clock_mchtmr0) / 1000000U;
+    printf("  rx task: %u frames in %u rounds, %u over budget, busy %llu us, longest round %u us\n",
+           dev->rxStats.frames, dev->rxStats.rounds, dev->rxStats.overBudget,
+           (unsigned long long)(dev->rxStats.busyTicks / ticksPerUs), dev->rxStats.maxRoundTicks / ticksPerUs);
+    uint64_t ns = stats.rxLastReturnNs - stats.rxFirstNs;
+    if ((stats.rxReturned != 0) && (ns != 0)) {
+        printf("  rx consumed: %llu frames/s, %llu Mbit/s\n",
+               (unsigned long long)(stats.rxFrames * 1000000000ULL / ns),
+               (unsigned long long)(stats.rxBytes * 8000ULL / ns));
+    }
+}
+
+static void SimUsage(const char *prog)
+{
+    printf("usage: %s [-t tap [-t tap]] [-r replay.pcap] [-w capture.pcap] [-b mbps] [-d seconds]\n"
+           "       [-n budget] [-s] [-m mtu]\n", prog);
+    printf("  -t  attach geth, then eth, to a TAP interface and run an iperf server\n");
+    printf("  -r  replay a pcap file into geth instead, report and exit once it is consumed\n");
+    printf("  -w  write the frames geth transmits to a pcap file\n");
+    printf("  -b  line rate of the simulated wire; replay then drops frames on a full ring\n");
+    printf("  -d  with -t, stop after this many seconds (default: on Ctrl-C)\n");
+    printf("  -n  RX budget of each device per round (default: %u)\n", HPM_ENET_RX_BUDGET);
+    printf("  -s  poll both devices from the one shared RX task\n");
+    printf("  -m  MTU of geth, up to %u\n", HPM_ENET_MAX_MTU);
+}
+
+int main(int argc, char **argv)
+{
+    struct HpmEnetSimCfg cfgs[SIM_DEV_NUM];
+    uint32_t taps = 0;
+    uint32_t seconds = 0;
+    UINT32 readySem;
+    int opt;
+    int ret = 0;
+
+    memset(cfgs, 0, sizeof(cfgs));
+    while ((opt = getopt(argc, argv, "t:r:w:b:d:n:m:sh")) != -1) {
+        switch (opt) {
+            case 't':
+                if (taps < SIM_DEV_NUM) {
+                    cfgs[taps++].tap = optarg;
+                }
+                break;
+            case 'r':
+                cfgs[0].replay = optarg;
+                break;
+            case 'w':
+                cfgs[0].capture = optarg;
+                break;
+            case 'b':
+                cfgs[0].lineRateMbps = (uint32_t)strtoul(optarg, NULL, 0);
+                cfgs[1].lineRateMbps = cfgs[0].lineRateMbps;
+                break;
+            case 'd':
+                seconds = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                for (uint32_t i = 0; i < SIM_DEV_NUM; i++) {
+                    g_simDevs[i].rxBudget = (uint32_t)strtoul(optarg, NULL, 0);
+                }
+                break;
+            case 'm':
+                g_simDevs[0].mtu = (uint16_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                for (uint32_t i = 0; i < SIM_DEV_NUM; i++) {
+                    g_simDevs[i].rxShared = 1;
+                }
+                break;
+            default:
+                SimUsage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+    if ((taps == 0) == (cfgs[0].replay == NULL)) {
+        SimUsage(argv[0]);
+        return 2;
+    }
+
+    (void)LOS_TickCountGet(); /* tick 0 */
+    signal(SIGINT, SimSigint);
+    LOS_BinarySemCreate(0, &readySem);
+    tcpip_init(SimTcpipReady, (void *)(uintptr_t)readySem);
+    LOS_SemPend(readySem, LOS_WAIT_FOREVER);
+
+    for (uint32_t i = 0; (i < SIM_DEV_NUM) && (ret == 0); i++) {
+        if ((i == 0) || (cfgs[i].tap != NULL)) {
+            ret = SimDevInit(&g_simDevs[i], i, &cfgs[i]);
+        }
+    }
+    if (ret != 0) {
+        printf("Err: device setup failed\n");
+        return 1;
+    }
+
+    if (taps != 0) {
+        LOCK_TCPIP_CORE();
+        lwiperf_start_tcp_server_default(SimIperfReport, NULL);
+        UNLOCK_TCPIP_CORE();
+        printf("geth %s, iperf server on port %u\n", ipaddr_ntoa(&g_simDevs[0].netif.ip_addr), LWIPERF_TCP_PORT_DEFAULT);
+        UINT64 end = LOS_TickCountGet() + (UINT64)seconds * LOSCFG_BASE_CORE_TICK_PER_SECOND;
+        while (!g_simInterrupted && ((seconds == 0) || (LOS_TickCountGet() < end))) {
+            LOS_TaskDelay(SIM_POLL_TICKS);
+        }
+    } else {
+        UINT64 end = LOS_TickCountGet() + SIM_REPLAY_TIMEOUT;
+        while (!g_simInterrupted && !SimReplayDrained(&g_simDevs[0]) && (LOS_TickCountGet() < end)) {
+            LOS_TaskDelay(SIM_POLL_TICKS);
+        }
+        if (!SimReplayDrained(&g_simDevs[0])) {
+            printf("Err: replay not consumed\n");
+            ret = 1;
+        }
+        /* let the replies of the last frames go out */
+        LOS_TaskDelay(SIM_SETTLE_TICKS);
+    }
+
+    for (uint32_t i = 0; i < SIM_DEV_NUM; i++) {
+        SimReport(&g_simDevs[i]);
+    }
+#if LWIP_STATS
+    HpmLwipMemShow();
+#endif
+    for (uint32_t i = 0; i < SIM_DEV_NUM; i++) {
+        if (g_simDevs[i].isEnable) {
+            HpmEnetSimStop(g_simDevs[i].base);
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Ring half of ../../ipc/hpm_ipc.c for the host: same slot layout and ordering, the RISC-V fences
+ * become C11 fences. There is no CPU1 and no mailbox, so nothing here notifies or starts a core.
+ */
+
+#include <string.h>
+#include "hpm_ipc.h"
+
+#define HPM_IPC_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+static inline uint8_t *HpmIpcSlot(struct HpmIpcRing *ring, uint32_t index)
+{
+    return ring->slots + (index % ring->slotNum) * HPM_IPC_SLOT_STRIDE(ring->slotSize);
+}
+
+void HpmIpcRingInit(struct HpmIpcRing *ring, uint8_t *slots, uint32_t slotSize, uint32_t slotNum)
+{
+    ring->head = 0;
+    ring->tail = 0;
+    ring->armed = 0;
+    ring->slotSize = slotSize;
+    ring->slotNum = slotNum;
+    ring->slots = slots;
+    ring->full = 0;
+}
+
+void *HpmIpcRingAcquire(struct HpmIpcRing *ring)
+{
+    uint32_t head = ring->head;
+
+    if (head - ring->tail >= ring->slotNum) {
+        ring->full++;
+        return NULL;
+    }
+    return HpmIpcSlot(ring, head) + 4U;
+}
+
+void HpmIpcRingCommit(struct HpmIpcRing *ring, uint32_t len)
+{
+    uint32_t head = ring->head;
+
+    *(uint32_t *)HpmIpcSlot(ring, head) = len;
+    HPM_IPC_FENCE();
+    ring->head = head + 1U;
+}
+
+void *HpmIpcRingPeek(struct HpmIpcRing *ring, uint32_t *len)
+{
+    uint32_t tail = ring->tail;
+    uint8_t *slot = NULL;
+
+    if (tail == ring->head) {
+        return NULL;
+    }
+    HPM_IPC_FENCE();
+    slot = HpmIpcSlot(ring, tail);
+    *len = *(uint32_t *)slot;
+    return slot + 4U;
+}
+
+void HpmIpcRingRelease(struct HpmIpcRing *ring)
+{
+    HPM_IPC_FENCE();
+    ring->tail = ring->tail + 1U;
+}
+
+int HpmIpcRingSend(struct HpmIpcRing *ring, const void *data, uint32_t len)
+{
+    void *slot = NULL;
+
+    if (len > ring->slotSize) {
+        return -1;
+    }
+    slot = HpmIpcRingAcquire(ring);
+    if (slot == NULL) {
+        return -1;
+    }
+    memcpy(slot, data, len);
+    HpmIpcRingCommit(ring, len);
+    return 0;
+}
+
+int HpmIpcRingRecv(struct HpmIpcRing *ring, void *data, uint32_t *len)
+{
+    uint32_t slotLen = 0;
+    void *slot = HpmIpcRingPeek(ring, &slotLen);
+
+    if ((slot == NULL) || (slotLen > *len)) {
+        return -1;
+    }
+    memcpy(data, slot, slotLen);
+    *len = slotLen;
+    HpmIpcRingRelease(ring);
+    return 0;
+}
+
+int HpmIpcRingArm(struct HpmIpcRing *ring)
+{
+    ring->armed = 1;
+    HPM_IPC_FENCE();
+    return ring->head != ring->tail;
+}
@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * LiteOS-M kernel calls of the lwIP adapter on pthreads.
+ *
+ * Semaphores and mutexes live in fixed tables and their handle is the table index, as on the
+ * target. LOS_IntLock() is one recursive mutex for the whole process; the DMA simulation takes it
+ * around every interrupt it raises, which gives handlers the same exclusion against locked task
+ * code they have on the single core target.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <los_interrupt.h>
+#include <los_mux.h>
+#include <los_sem.h>
+#include <los_task.h>
+#include <los_tick.h>
+
+#define SIM_SEM_NUM     64U
+#define SIM_MUX_NUM     64U
+#define SIM_NS_PER_TICK (1000000000ULL / LOSCFG_BASE_CORE_TICK_PER_SECOND)
+
+struct SimSem {
+    int used;
+    UINT32 count;
+    UINT32 maxCount;
+    pthread_cond_t cond;
+};
+
+struct SimMux {
+    int used;
+    pthread_mutex_t mutex;
+};
+
+struct SimHwi {
+    HWI_PROC_FUNC handler;
+    VOID *arg;
+    int enabled;
+};
+
+struct SimTask {
+    TSK_ENTRY_FUNC entry;
+    UINT32 arg;
+};
+
+static pthread_mutex_t g_simLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_simIntLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static struct SimSem g_simSems[SIM_SEM_NUM];
+static struct SimMux g_simMuxes[SIM_MUX_NUM];
+static struct SimHwi g_simHwis[HPM_SIM_HWI_NUM];
+static UINT32 g_simTaskNum;
+
+static struct timespec SimDeadline(UINT32 ticks)
+{
+    struct timespec ts;
+    uint64_t ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ns = (uint64_t)ts.tv_nsec + (uint64_t)ticks * SIM_NS_PER_TICK;
+    ts.tv_sec += (time_t)(ns / 1000000000ULL);
+    ts.tv_nsec = (long)(ns % 1000000000ULL);
+    return ts;
+}
+
+UINT64 LOS_TickCountGet(VOID)
+{
+    static uint64_t start;
+    struct timespec ts;
+    uint64_t ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    if (start == 0) {
+        start = ns;
+    }
+    return (ns - start) / SIM_NS_PER_TICK;
+}
+
+static void *SimTaskMain(void *arg)
+{
+    struct SimTask task = *(struct SimTask *)arg;
+
+    free(arg);
+    (void)task.entry(task.arg);
+    return NULL;
+}
+
+UINT32 LOS_TaskCreate(UINT32 *taskID, TSK_INIT_PARAM_S *initParam)
+{
+    struct SimTask *task = malloc(sizeof(*task));
+    pthread_attr_t attr;
+    pthread_t thread;
+    size_t stack = initParam->uwStackSize;
+
+    if (task == NULL) {
+        return LOS_ERRNO_TSK_NO_MEMORY;
+    }
+    task->entry = initParam->pfnTaskEntry;
+    task->arg = initParam->uwArg;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, (stack < HPM_SIM_TASK_STACK_MIN) ? HPM_SIM_TASK_STACK_MIN : stack);
+    if (pthread_create(&thread, &attr, SimTaskMain, task) != 0) {
+        pthread_attr_destroy(&attr);
+        free(task);
+        return LOS_ERRNO_TSK_NO_MEMORY;
+    }
+    pthread_attr_destroy(&attr);
+    if (initParam->pcName != NULL) {
+        char name[16];
+        snprintf(name, sizeof(name), "%s", initParam->pcName);
+        pthread_setname_np(thread, name);
+    }
+
+    pthread_mutex_lock(&g_simLock);
+    *taskID = ++g_simTaskNum;
+    pthread_mutex_unlock(&g_simLock);
+    return LOS_OK;
+}
+
+UINT32 LOS_TaskDelay(UINT32 tick)
+{
+    struct timespec ts = SimDeadline(tick);
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+    return LOS_OK;
+}
+
+UINT32 LOS_TaskYield(VOID)
+{
+    sched_yield();
+    return LOS_OK;
+}
+
+static UINT32 SimSemCreate(UINT16 count, UINT32 maxCount, UINT32 *semHandle)
+{
+    pthread_condattr_t attr;
+
+    pthread_mutex_lock(&g_simLock);
+    for (UINT32 i = 0; i < SIM_SEM_NUM; i++) {
+        struct SimSem *sem = &g_simSems[i];
+        if (sem->used) {
+            continue;
+        }
+        sem->used = 1;
+        sem->count = count;
+        sem->maxCount = maxCount;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&sem->cond, &attr);
+        pthread_condattr_destroy(&attr);
+        pthread_mutex_unlock(&g_simLock);
+        *semHandle = i;
+        return LOS_OK;
+    }
+    pthread_mutex_unlock(&g_simLock);
+    return LOS_ERRNO_SEM_ALL_BUSY;
+}
+
+UINT32 LOS_SemCreate(UINT16 count, UINT32 *semHandle)
+{
+    return SimSemCreate(count, 0xFFFEU, semHandle);
+}
+
+UINT32 LOS_BinarySemCreate(UINT16 count, UINT32 *semHandle)
+{
+    return SimSemCreate(count, 1U, semHandle);
+}
+
+UINT32 LOS_SemDelete(UINT32 semHandle)
+{
+    if ((semHandle >= SIM_SEM_NUM) || !g_simSems[semHandle].used) {
+        return LOS_ERRNO_SEM_INVALID;
+    }
+    pthread_mutex_lock(&g_simLock);
+    pthread_cond_destroy(&g_simSems[semHandle].cond);
+    g_simSems[semHandle].used = 0;
+    pthread_mutex_unlock(&g_simLock);
+    return LOS_OK;
+}
+
+UINT32 LOS_SemPend(UINT32 semHandle, UINT32 timeout)
+{
+    struct SimSem *sem = NULL;
+    struct timespec ts = SimDeadline(timeout);
+    UINT32 ret = LOS_OK;
+
+    if ((semHandle >= SIM_SEM_NUM) || !g_simSems[semHandle].used) {
+        return LOS_ERRNO_SEM_INVALID;
+    }
+    sem = &g_simSems[semHandle];
+
+    pthread_mutex_lock(&g_simLock);
+    while ((sem->count == 0) && (ret == LOS_OK)) {
+        if (timeout == LOS_NO_WAIT) {
+            ret = LOS_ERRNO_SEM_UNAVAILABLE;
+        } else if (timeout == LOS_WAIT_FOREVER) {
+            pthread_cond_wait(&sem->cond, &g_simLock);
+        } else if (pthread_cond_timedwait(&sem->cond, &g_simLock, &ts) == ETIMEDOUT) {
+            ret = (sem->count == 0) ? LOS_ERRNO_SEM_TIMEOUT : LOS_OK;
+        }
+    }
+    if (ret == LOS_OK) {
+        sem->count--;
+    }
+    pthread_mutex_unlock(&g_simLock);
+    return ret;
+}
+
+UINT32 LOS_SemPost(UINT32 semHandle)
+{
+    struct SimSem *sem = NULL;
+
+    if ((semHandle >= SIM_SEM_NUM) || !g_simSems[semHandle].used) {
+        return LOS_ERRNO_SEM_INVALID;
+    }
+    sem = &g_simSems[semHandle];
+
+    pthread_mutex_lock(&g_simLock);
+    if (sem->count < sem->maxCount) {
+        sem->count++;
+        pthread_cond_signal(&sem->cond);
+    }
+    pthread_mutex_unlock(&g_simLock);
+    return LOS_OK;
+}
+
+UINT32 LOS_MuxCreate(UINT32 *muxHandle)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutex_lock(&g_simLock);
+    for (UINT32 i = 0; i < SIM_MUX_NUM; i++) {
+        struct SimMux *mux = &g_simMuxes[i];
+        if (mux->used) {
+            continue;
+        }
+        mux->used = 1;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&mux->mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+        pthread_mutex_unlock(&g_simLock);
+        *muxHandle = i;
+        return LOS_OK;
+    }
+    pthread_mutex_unlock(&g_simLock);
+    return LOS_ERRNO_MUX_ALL_BUSY;
+}
+
+UINT32 LOS_MuxDelete(UINT32 muxHandle)
+{
+    if ((muxHandle >= SIM_MUX_NUM) || !g_simMuxes[muxHandle].used) {
+        return LOS_ERRNO_MUX_INVALID;
+    }
+    pthread_mutex_lock(&g_simLock);
+    pthread_mutex_destroy(&g_simMuxes[muxHandle].mutex);
+    g_simMuxes[muxHandle].used = 0;
+    pthread_mutex_unlock(&g_simLock);
+    return LOS_OK;
+}
+
+UINT32 LOS_MuxPend(UINT32 muxHandle, UINT32 timeout)
+{
+    struct timespec ts = SimDeadline(timeout);
+    pthread_mutex_t *mutex = NULL;
+
+    if ((muxHandle >= SIM_MUX_NUM) || !g_simMuxes[muxHandle].used) {
+        return LOS_ERRNO_MUX_INVALID;
+    }
+    mutex = &g_simMuxes[muxHandle].mutex;
+
+    if (timeout == LOS_WAIT_FOREVER) {
+        pthread_mutex_lock(mutex);
+    } else if (timeout == LOS_NO_WAIT) {
+        if (pthread_mutex_trylock(mutex) != 0) {
+            return LOS_ERRNO_MUX_TIMEOUT;
+        }
+    } else if (pthread_mutex_clocklock(mutex, CLOCK_MONOTONIC, &ts) != 0) {
+        return LOS_ERRNO_MUX_TIMEOUT;
+    }
+    return LOS_OK;
+}
+
+UINT32 LOS_MuxPost(UINT32 muxHandle)
+{
+    if ((muxHandle >= SIM_MUX_NUM) || !g_simMuxes[muxHandle].used) {
+        return LOS_ERRNO_MUX_INVALID;
+    }
+    pthread_mutex_unlock(&g_simMuxes[muxHandle].mutex);
+    return LOS_OK;
+}
+
+UINT32 LOS_IntLock(VOID)
+{
+    pthread_mutex_lock(&g_simIntLock);
+    return 0;
+}
+
+VOID LOS_IntRestore(UINT32 intSave)
+{
+    (VOID)intSave;
+    pthread_mutex_unlock(&g_simIntLock);
+}
+
+UINT32 LOS_HwiCreate(UINT32 hwiNum, HWI_PRIOR_T hwiPrio, HWI_MODE_T mode, HWI_PROC_FUNC handler,
+                     HwiIrqParam *irqParam)
+{
+    (VOID)hwiPrio;
+    (VOID)mode;
+
+    if (hwiNum >= HPM_SIM_HWI_NUM) {
+        return OS_ERRNO_HWI_NUM_INVALID;
+    }
+    UINT32 intSave = LOS_IntLock();
+    g_simHwis[hwiNum].handler = handler;
+    g_simHwis[hwiNum].arg = (irqParam != NULL) ? irqParam->pDevId : NULL;
+    LOS_IntRestore(intSave);
+    return LOS_OK;
+}
+
+UINT32 LOS_HwiDelete(UINT32 hwiNum, HwiIrqParam *irqParam)
+{
+    (VOID)irqParam;
+
+    if (hwiNum >= HPM_SIM_HWI_NUM) {
+        return OS_ERRNO_HWI_NUM_INVALID;
+    }
+    UINT32 intSave = LOS_IntLock();
+    g_simHwis[hwiNum].handler = NULL;
+    g_simHwis[hwiNum].enabled = 0;
+    LOS_IntRestore(intSave);
+    return LOS_OK;
+}
+
+static UINT32 SimHwiSetEnabled(UINT32 hwiNum, int enabled)
+{
+    if (hwiNum >= HPM_SIM_HWI_NUM) {
+        return OS_ERRNO_HWI_NUM_INVALID;
+    }
+    UINT32 intSave = LOS_IntLock();
+    g_simHwis[hwiNum].enabled = enabled;
+    LOS_IntRestore(intSave);
+    return LOS_OK;
+}
+
+UINT32 LOS_HwiEnable(UINT32 hwiNum)
+{
+    return SimHwiSetEnabled(hwiNum, 1);
+}
+
+UINT32 LOS_HwiDisable(UINT32 hwiNum)
+{
+    return SimHwiSetEnabled(hwiNum, 0);
+}
+
+int HpmSimHwiRaise(UINT32 hwiNum)
+{
+    struct SimHwi *hwi = NULL;
+
+    if (hwiNum >= HPM_SIM_HWI_NUM) {
+        return 0;
+    }
+    hwi = &g_simHwis[hwiNum];
+    if ((hwi->handler == NULL) || !hwi->enabled) {
+        return 0;
+    }
+    hwi->handler(hwi->arg);
+    return 1;
+}
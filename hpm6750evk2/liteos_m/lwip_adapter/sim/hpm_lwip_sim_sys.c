@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * lwIP sys_arch on pthreads for the host sim. Semaphores and mailboxes use CLOCK_MONOTONIC
+ * timeouts in milliseconds as lwIP expects, sys_arch_protect() shares LOS_IntLock() with the
+ * adapter so lwIP's critical sections also keep the simulated interrupts out.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lwip/opt.h"
+#include "lwip/sys.h"
+#include <los_interrupt.h>
+#include <los_task.h>
+#include <los_tick.h>
+
+struct sys_sem {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    u32_t count;
+};
+
+struct sys_mbox {
+    pthread_mutex_t mutex;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    u32_t head;
+    u32_t tail;
+    u32_t size;
+    void **msgs;
+};
+
+struct SimThread {
+    lwip_thread_fn fn;
+    void *arg;
+};
+
+static void SimCondInit(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static uint64_t SimNowMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000U + (uint64_t)ts.tv_nsec / 1000000U;
+}
+
+/* Wait on cond until the deadline, returns 0 on timeout */
+static int SimCondWait(pthread_cond_t *cond, pthread_mutex_t *mutex, u32_t timeout)
+{
+    struct timespec ts;
+    uint64_t ns;
+
+    if (timeout == 0) {
+        pthread_cond_wait(cond, mutex);
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ns = (uint64_t)ts.tv_nsec + (uint64_t)timeout * 1000000U;
+    ts.tv_sec += (time_t)(ns / 1000000000U);
+    ts.tv_nsec = (long)(ns % 1000000000U);
+    return pthread_cond_timedwait(cond, mutex, &ts) != ETIMEDOUT;
+}
+
+void sys_init(void)
+{
+}
+
+u32_t sys_now(void)
+{
+    return (u32_t)LOS_TickCountGet();
+}
+
+sys_prot_t sys_arch_protect(void)
+{
+    return (sys_prot_t)LOS_IntLock();
+}
+
+void sys_arch_unprotect(sys_prot_t pval)
+{
+    LOS_IntRestore((UINT32)pval);
+}
+
+err_t sys_sem_new(sys_sem_t *sem, u8_t count)
+{
+    struct sys_sem *s = calloc(1, sizeof(*s));
+
+    if (s == NULL) {
+        return ERR_MEM;
+    }
+    pthread_mutex_init(&s->mutex, NULL);
+    SimCondInit(&s->cond);
+    s->count = count;
+    *sem = s;
+    return ERR_OK;
+}
+
+void sys_sem_free(sys_sem_t *sem)
+{
+    pthread_cond_destroy(&(*sem)->cond);
+    pthread_mutex_destroy(&(*sem)->mutex);
+    free(*sem);
+    *sem = NULL;
+}
+
+void sys_sem_signal(sys_sem_t *sem)
+{
+    struct sys_sem *s = *sem;
+
+    pthread_mutex_lock(&s->mutex);
+    s->count++;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+}
+
+u32_t sys_arch_sem_wait(sys_sem_t *sem, u32_t timeout)
+{
+    struct sys_sem *s = *sem;
+    uint64_t start = SimNowMs();
+
+    pthread_mutex_lock(&s->mutex);
+    while (s->count == 0) {
+        if (!SimCondWait(&s->cond, &s->mutex, timeout) && (s->count == 0)) {
+            pthread_mutex_unlock(&s->mutex);
+            return SYS_ARCH_TIMEOUT;
+        }
+    }
+    s->count--;
+    pthread_mutex_unlock(&s->mutex);
+    return (u32_t)(SimNowMs() - start);
+}
+
+err_t sys_mutex_new(sys_mutex_t *mutex)
+{
+    pthread_mutex_t *m = malloc(sizeof(*m));
+
+    if (m == NULL) {
+        return ERR_MEM;
+    }
+    pthread_mutex_init(m, NULL);
+    *mutex = m;
+    return ERR_OK;
+}
+
+void sys_mutex_free(sys_mutex_t *mutex)
+{
+    pthread_mutex_destroy(*mutex);
+    free(*mutex);
+    *mutex = NULL;
+}
+
+void sys_mutex_lock(sys_mutex_t *mutex)
+{
+    pthread_mutex_lock(*mutex);
+}
+
+void sys_mutex_unlock(sys_mutex_t *mutex)
+{
+    pthread_mutex_unlock(*mutex);
+}
+
+err_t sys_mbox_new(sys_mbox_t *mbox, int size)
+{
+    struct sys_mbox *m = calloc(1, sizeof(*m));
+
+    if ((m == NULL) || (size <= 0)) {
+        free(m);
+        return ERR_MEM;
+    }
+    m->msgs = calloc((size_t)size, sizeof(void *));
+    if (m->msgs == NULL) {
+        free(m);
+        return ERR_MEM;
+    }
+    pthread_mutex_init(&m->mutex, NULL);
+    SimCondInit(&m->notEmpty);
+    SimCondInit(&m->notFull);
+    m->size = (u32_t)size;
+    *mbox = m;
+    return ERR_OK;
+}
+
+void sys_mbox_free(sys_mbox_t *mbox)
+{
+    struct sys_mbox *m = *mbox;
+
+    pthread_cond_destroy(&m->notEmpty);
+    pthread_cond_destroy(&m->notFull);
+    pthread_mutex_destroy(&m->mutex);
+    free(m->msgs);
+    free(m);
+    *mbox = NULL;
+}
+
+static void SimMboxPut(struct sys_mbox *m, void *msg)
+{
+    m->msgs[m->head % m->size] = msg;
+    m->head++;
+    pthread_cond_signal(&m->notEmpty);
+}
+
+void sys_mbox_post(sys_mbox_t *mbox, void *msg)
+{
+    struct sys_mbox *m = *mbox;
+
+    pthread_mutex_lock(&m->mutex);
+    while (m->head - m->tail >= m->size) {
+        pthread_cond_wait(&m->notFull, &m->mutex);
+    }
+    SimMboxPut(m, msg);
+    pthread_mutex_unlock(&m->mutex);
+}
+
+err_t sys_mbox_trypost(sys_mbox_t *mbox, void *msg)
+{
+    struct sys_mbox *m = *mbox;
+    err_t ret = ERR_MEM;
+
+    pthread_mutex_lock(&m->mutex);
+    if (m->head - m->tail < m->size) {
+        SimMboxPut(m, msg);
+        ret = ERR_OK;
+    }
+    pthread_mutex_unlock(&m->mutex);
+    return ret;
+}
+
+err_t sys_mbox_trypost_fromisr(sys_mbox_t *mbox, void *msg)
+{
+    return sys_mbox_trypost(mbox, msg);
+}
+
+u32_t sys_arch_mbox_fetch(sys_mbox_t *mbox, void **msg, u32_t timeout)
+{
+    struct sys_mbox *m = *mbox;
+    uint64_t start = SimNowMs();
+
+    pthread_mutex_lock(&m->mutex);
+    while (m->head == m->tail) {
+        if (!SimCondWait(&m->notEmpty, &m->mutex, timeout) && (m->head == m->tail)) {
+            pthread_mutex_unlock(&m->mutex);
+            return SYS_ARCH_TIMEOUT;
+        }
+    }
+    if (msg != NULL) {
+        *msg = m->msgs[m->tail % m->size];
+    }
+    m->tail++;
+    pthread_cond_signal(&m->notFull);
+    pthread_mutex_unlock(&m->mutex);
+    return (u32_t)(SimNowMs() - start);
+}
+
+u32_t sys_arch_mbox_tryfetch(sys_mbox_t *mbox, void **msg)
+{
+    struct sys_mbox *m = *mbox;
+
+    pthread_mutex_lock(&m->mutex);
+    if (m->head == m->tail) {
+        pthread_mutex_unlock(&m->mutex);
+        return SYS_MBOX_EMPTY;
+    }
+    if (msg != NULL) {
+        *msg = m->msgs[m->tail % m->size];
+    }
+    m->tail++;
+    pthread_cond_signal(&m->notFull);
+    pthread_mutex_unlock(&m->mutex);
+    return 0;
+}
+
+static void *SimThreadMain(void *arg)
+{
+    struct SimThread thread = *(struct SimThread *)arg;
+
+    free(arg);
+    thread.fn(thread.arg);
+    return NULL;
+}
+
+sys_thread_t sys_thread_new(const char *name, lwip_thread_fn thread, void *arg, int stacksize, int prio)
+{
+    struct SimThread *t = malloc(sizeof(*t));
+    pthread_attr_t attr;
+    pthread_t id;
+    size_t stack = (stacksize > 0) ? (size_t)stacksize : 0;
+
+    (void)prio;
+    LWIP_ASSERT("sys_thread_new: out of memory", t != NULL);
+    t->fn = thread;
+    t->arg = arg;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, (stack < HPM_SIM_TASK_STACK_MIN) ? HPM_SIM_TASK_STACK_MIN : stack);
+    if (pthread_create(&id, &attr, SimThreadMain, t) != 0) {
+        LWIP_ASSERT("sys_thread_new: pthread_create failed", 0);
+    }
+    pthread_attr_destroy(&attr);
+    if (name != NULL) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%s", name);
+        pthread_setname_np(id, buf);
+    }
+    return id;
+}
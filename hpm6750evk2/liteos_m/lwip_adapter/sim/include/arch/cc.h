@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: lwIP compiler and platform glue for a Linux host */
+#ifndef HPM_SIM_ARCH_CC_H
+#define HPM_SIM_ARCH_CC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LWIP_PLATFORM_DIAG(x) do { printf x; } while (0)
+#define LWIP_PLATFORM_ASSERT(x) do { \
+        printf("lwIP assertion \"%s\" failed at line %d in %s\n", x, __LINE__, __FILE__); \
+        fflush(NULL); \
+        abort(); \
+    } while (0)
+
+#define LWIP_RAND() ((u32_t)rand())
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: lwIP OS abstraction types, implemented on pthreads in hpm_lwip_sim_sys.c */
+#ifndef HPM_SIM_ARCH_SYS_ARCH_H
+#define HPM_SIM_ARCH_SYS_ARCH_H
+
+#include <pthread.h>
+
+struct sys_sem;
+struct sys_mbox;
+
+typedef struct sys_sem *sys_sem_t;
+typedef pthread_mutex_t *sys_mutex_t;
+typedef struct sys_mbox *sys_mbox_t;
+typedef pthread_t sys_thread_t;
+typedef int sys_prot_t;
+
+#define SYS_SEM_NULL    NULL
+#define SYS_MBOX_NULL   NULL
+
+#define sys_sem_valid(sem)              (*(sem) != NULL)
+#define sys_sem_set_invalid(sem)        (*(sem) = NULL)
+#define sys_mutex_valid(mutex)          (*(mutex) != NULL)
+#define sys_mutex_set_invalid(mutex)    (*(mutex) = NULL)
+#define sys_mbox_valid(mbox)            (*(mbox) != NULL)
+#define sys_mbox_set_invalid(mbox)      (*(mbox) = NULL)
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: the board has nothing to set up around the simulated MACs */
+#ifndef HPM_SIM_BOARD_H
+#define HPM_SIM_BOARD_H
+
+#include "hpm_soc.h"
+#include "hpm_clock_drv.h"
+
+#define BOARD_ENET_RGMII HPM_ENET0
+#define BOARD_ENET_RMII  HPM_ENET1
+
+#endif
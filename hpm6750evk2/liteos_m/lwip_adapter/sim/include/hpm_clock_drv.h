@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: every clock runs at the 1 GHz of the hpm_csr_get_core_cycle() shim, MCHTMR0 at 24 MHz */
+#ifndef HPM_SIM_CLOCK_DRV_H
+#define HPM_SIM_CLOCK_DRV_H
+
+#include "hpm_common.h"
+
+#define HPM_SIM_CLOCK_HZ 1000000000U
+#define HPM_SIM_MCHTMR_HZ 24000000U
+
+typedef enum {
+    clock_cpu0,
+    clock_eth0,
+    clock_eth1,
+    clock_gpio,
+    clock_mchtmr0,
+} clock_name_t;
+
+static inline uint32_t clock_get_frequency(clock_name_t clock)
+{
+    return (clock == clock_mchtmr0) ? HPM_SIM_MCHTMR_HZ : HPM_SIM_CLOCK_HZ;
+}
+
+#endif
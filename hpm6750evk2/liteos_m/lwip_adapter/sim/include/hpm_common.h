@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: the subset of hpm_common.h used by the lwIP adapter */
+#ifndef HPM_SIM_COMMON_H
+#define HPM_SIM_COMMON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+typedef uint32_t hpm_stat_t;
+
+enum {
+    status_success = 0,
+    status_fail = 1,
+    status_invalid_argument = 2,
+    status_timeout = 3,
+};
+
+#define __I  volatile const
+#define __O  volatile
+#define __IO volatile
+#define __RW volatile
+
+/* one flat memory on the host: no sections to place things in, no noncacheable region */
+#define ATTR_PLACE_AT(section)
+#define ATTR_ALIGN(alignment) __attribute__((aligned(alignment)))
+#define ATTR_PLACE_AT_NONCACHEABLE_WITH_ALIGNMENT(alignment) ATTR_ALIGN(alignment)
+#define ATTR_RAMFUNC
+
+#ifndef ARRAY_SIZE
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#endif
+
+#endif
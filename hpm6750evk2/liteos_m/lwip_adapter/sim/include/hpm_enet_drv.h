@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host shim: the descriptor layout and the part of the hpm_sdk ENET driver the adapter uses,
+ * implemented by the simulated DMA engine in hpm_enet_sim.c. Buffer and next-descriptor fields
+ * are 32-bit like on the SoC, the sim links without PIE so its static rings and buffers have
+ * 32-bit addresses on a 64-bit host too.
+ */
+#ifndef HPM_SIM_ENET_DRV_H
+#define HPM_SIM_ENET_DRV_H
+
+#include "hpm_common.h"
+#include "hpm_soc.h"
+
+#define ENET_MAX_FRAME_SIZE             1524U
+#define ENET_SOC_DESC_ADDR_ALIGNMENT    16U
+#define ENET_SOC_BUFF_ADDR_ALIGNMENT    4U
+#define ENET_SOC_ADDR_MAX_COUNT         5U
+#define ENET_ERROR                      0U
+#define ENET_SUCCESS                    1U
+
+typedef enum {
+    enet_inf_mii = 0,
+    enet_inf_rmii = 1,
+    enet_inf_rgmii = 2,
+} enet_inf_type_t;
+
+typedef struct {
+    union {
+        uint32_t rdes0;
+        struct {
+            uint32_t ext_sts : 1;
+            uint32_t ce : 1;
+            uint32_t dbe : 1;
+            uint32_t re : 1;
+            uint32_t rwt : 1;
+            uint32_t ft : 1;
+            uint32_t lc : 1;
+            uint32_t ts_ip_gf : 1;
+            uint32_t ls : 1;
+            uint32_t fs : 1;
+            uint32_t vlan : 1;
+            uint32_t oe : 1;
+            uint32_t le : 1;
+            uint32_t saf : 1;
+            uint32_t dse : 1;
+            uint32_t es : 1;
+            uint32_t fl : 14;
+            uint32_t afm : 1;
+            uint32_t own : 1;
+        } rdes0_bm;
+    };
+    union {
+        uint32_t rdes1;
+        struct {
+            uint32_t rbs1 : 13;
+            uint32_t reserved0 : 1;
+            uint32_t rch : 1;
+            uint32_t rer : 1;
+            uint32_t rbs2 : 13;
+            uint32_t reserved1 : 2;
+            uint32_t dic : 1;
+        } rdes1_bm;
+    };
+    union {
+        uint32_t rdes2;
+        struct {
+            uint32_t buffer1;
+        } rdes2_bm;
+    };
+    union {
+        uint32_t rdes3;
+        struct {
+            uint32_t next_desc;
+        } rdes3_bm;
+    };
+} enet_rx_desc_t;
+
+typedef struct {
+    union {
+        uint32_t tdes0;
+        struct {
+            uint32_t db : 1;
+            uint32_t uf : 1;
+            uint32_t ed : 1;
+            uint32_t cc : 4;
+            uint32_t vf : 1;
+            uint32_t ec : 1;
+            uint32_t lc : 1;
+            uint32_t nc : 1;
+            uint32_t loc : 1;
+            uint32_t ipe : 1;
+            uint32_t ff : 1;
+            uint32_t jt : 1;
+            uint32_t es : 1;
+            uint32_t ihe : 1;
+            uint32_t ttss : 1;
+            uint32_t vlic : 2;
+            uint32_t tch : 1;
+            uint32_t ter : 1;
+            uint32_t cic : 2;
+            uint32_t crcr : 1;
+            uint32_t ttse : 1;
+            uint32_t dp : 1;
+            uint32_t dc : 1;
+            uint32_t fs : 1;
+            uint32_t ls : 1;
+            uint32_t ic : 1;
+            uint32_t own : 1;
+        } tdes0_bm;
+    };
+    union {
+        uint32_t tdes1;
+        struct {
+            uint32_t tbs1 : 13;
+            uint32_t reserved : 3;
+            uint32_t tbs2 : 13;
+            uint32_t saic : 3;
+        } tdes1_bm;
+    };
+    union {
+        uint32_t tdes2;
+        struct {
+            uint32_t buffer1;
+        } tdes2_bm;
+    };
+    union {
+        uint32_t tdes3;
+        struct {
+            uint32_t next_desc;
+        } tdes3_bm;
+    };
+} enet_tx_desc_t;
+
+typedef struct {
+    uint32_t buffer;
+    uint32_t count;
+    uint16_t size;
+} enet_buff_config_t;
+
+typedef struct {
+    enet_rx_desc_t *fs_rx_desc;
+    enet_rx_desc_t *ls_rx_desc;
+    uint32_t seg_count;
+} enet_rx_frame_info_t;
+
+typedef struct {
+    uint32_t length;
+    uint32_t buffer;
+    enet_rx_desc_t *rx_desc;
+} enet_frame_t;
+
+typedef struct {
+    enet_tx_desc_t *tx_desc_list_head;
+    enet_rx_desc_t *rx_desc_list_head;
+    enet_tx_desc_t *tx_desc_list_cur;
+    enet_rx_desc_t *rx_desc_list_cur;
+    enet_buff_config_t tx_buff_cfg;
+    enet_buff_config_t rx_buff_cfg;
+    enet_rx_frame_info_t rx_frame_info;
+} enet_desc_t;
+
+typedef struct {
+    uint32_t mac_addr_high[ENET_SOC_ADDR_MAX_COUNT];
+    uint32_t mac_addr_low[ENET_SOC_ADDR_MAX_COUNT];
+    uint8_t valid_max_count;
+} enet_mac_config_t;
+
+/* Chain the rings of desc, RX descriptors owned by the DMA, and start the engine of ptr */
+hpm_stat_t enet_controller_init(ENET_Type *ptr, enet_inf_type_t inf_type, enet_desc_t *desc,
+                                enet_mac_config_t *config, uint32_t intr);
+
+/* Next complete frame from the CPU owned RX descriptors, length 0 if there is none */
+enet_frame_t enet_get_received_frame_interrupt(enet_rx_desc_t **parent_rx_desc_list_cur,
+                                               enet_rx_frame_info_t *rx_frame_info, uint32_t rx_desc_count);
+
+/* Hand a frame of frame_length bytes (CRC included) in the buffers from *parent on to the DMA */
+uint32_t enet_prepare_transmission_descriptors(ENET_Type *ptr, enet_tx_desc_t **parent_tx_desc_list_cur,
+                                               uint16_t frame_length, uint16_t tx_buff_size);
+
+void enet_disable_lpi_interrupt(ENET_Type *ptr);
+
+#endif
@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: host caches are coherent, the sync calls of hpm_dma_buf.h do nothing */
+#ifndef HPM_SIM_L1C_DRV_H
+#define HPM_SIM_L1C_DRV_H
+
+#include "hpm_common.h"
+
+#define HPM_L1C_CACHELINE_SIZE 64U
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: MCHTMR0 counts the monotonic clock at the 24 MHz of the SoC */
+#ifndef HPM_SIM_MCHTMR_DRV_H
+#define HPM_SIM_MCHTMR_DRV_H
+
+#include <time.h>
+#include "hpm_common.h"
+#include "hpm_clock_drv.h"
+
+typedef struct {
+    uint32_t unused;
+} MCHTMR_Type;
+
+#define HPM_MCHTMR ((MCHTMR_Type *)0)
+
+static inline uint64_t mchtmr_get_count(MCHTMR_Type *ptr)
+{
+    struct timespec ts;
+
+    (void)ptr;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * HPM_SIM_MCHTMR_HZ + (uint64_t)ts.tv_nsec * (HPM_SIM_MCHTMR_HZ / 1000000U) / 1000U;
+}
+
+#endif
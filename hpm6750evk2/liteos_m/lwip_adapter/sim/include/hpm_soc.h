@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host shim: the two ENET MACs. Their registers are plain memory, hpm_enet_sim.c plays the DMA
+ * engine behind them and delivers DMA_STATUS events one per interrupt, cleared when the handler
+ * returns; the write-1-to-clear of the handler is not modelled.
+ */
+#ifndef HPM_SIM_SOC_H
+#define HPM_SIM_SOC_H
+
+#include "hpm_common.h"
+
+typedef struct {
+    __RW uint32_t MACCFG;
+    __RW uint32_t MACFF;
+    __RW uint32_t DMA_TX_POLL_DEMAND;
+    __RW uint32_t DMA_RX_POLL_DEMAND;
+    __RW uint32_t DMA_STATUS;
+    __RW uint32_t DMA_INTR_EN;
+    __RW uint32_t INTR_MASK;
+    __RW uint32_t MMC_INTR_MASK_RX;
+    __RW uint32_t MMC_INTR_MASK_TX;
+    __RW uint32_t MMC_IPC_INTR_MASK_RX;
+} ENET_Type;
+
+extern ENET_Type g_hpmEnetSimRegs[2];
+
+#define HPM_ENET0   (&g_hpmEnetSimRegs[0])
+#define HPM_ENET1   (&g_hpmEnetSimRegs[1])
+#define IRQn_ENET0  51
+#define IRQn_ENET1  52
+
+#define ENET_MACFF_PR_MASK              (0x1U)
+#define ENET_DMA_STATUS_TI_MASK         (0x1U)
+#define ENET_DMA_STATUS_TI_SET(x)       (((uint32_t)(x) << 0U) & ENET_DMA_STATUS_TI_MASK)
+#define ENET_DMA_STATUS_TI_GET(x)       (((uint32_t)(x) & ENET_DMA_STATUS_TI_MASK) >> 0U)
+#define ENET_DMA_STATUS_RI_MASK         (0x40U)
+#define ENET_DMA_STATUS_RI_SET(x)       (((uint32_t)(x) << 6U) & ENET_DMA_STATUS_RI_MASK)
+#define ENET_DMA_STATUS_RI_GET(x)       (((uint32_t)(x) & ENET_DMA_STATUS_RI_MASK) >> 6U)
+#define ENET_DMA_STATUS_GLPII_MASK      (0x40000000UL)
+#define ENET_DMA_STATUS_GLPII_SET(x)    (((uint32_t)(x) << 30U) & ENET_DMA_STATUS_GLPII_MASK)
+#define ENET_DMA_STATUS_GLPII_GET(x)    (((uint32_t)(x) & ENET_DMA_STATUS_GLPII_MASK) >> 30U)
+#define ENET_DMA_INTR_EN_TIE_MASK       (0x1U)
+#define ENET_DMA_INTR_EN_TIE_SET(x)     (((uint32_t)(x) << 0U) & ENET_DMA_INTR_EN_TIE_MASK)
+#define ENET_DMA_INTR_EN_RIE_MASK       (0x40U)
+#define ENET_DMA_INTR_EN_RIE_SET(x)     (((uint32_t)(x) << 6U) & ENET_DMA_INTR_EN_RIE_MASK)
+#define ENET_DMA_INTR_EN_NIE_MASK       (0x10000UL)
+#define ENET_DMA_INTR_EN_NIE_SET(x)     (((uint32_t)(x) << 16U) & ENET_DMA_INTR_EN_NIE_MASK)
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: LiteOS-M base types */
+#ifndef HPM_SIM_LOS_COMPILER_H
+#define HPM_SIM_LOS_COMPILER_H
+
+#include <stdint.h>
+
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int32_t INT32;
+typedef uintptr_t UINTPTR;
+typedef char CHAR;
+typedef unsigned int BOOL;
+#define VOID void
+
+#define TRUE 1U
+#define FALSE 0U
+#define LOS_OK 0U
+#define LOS_NOK 1U
+#define LOS_WAIT_FOREVER 0xFFFFFFFFU
+#define LOS_NO_WAIT 0U
+
+#endif
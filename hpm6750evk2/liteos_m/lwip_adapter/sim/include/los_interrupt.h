@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host shim: interrupts. LOS_IntLock() takes one process wide recursive mutex, and the
+ * simulated devices call their handler through HpmSimHwiRaise() with that mutex held, so a
+ * locked section keeps "interrupts" out as on the target. Handlers run on the thread of the
+ * device that raised them.
+ */
+#ifndef HPM_SIM_LOS_INTERRUPT_H
+#define HPM_SIM_LOS_INTERRUPT_H
+
+#include "los_compiler.h"
+
+#define HPM_SIM_HWI_NUM             128U
+#define HPM2LITEOS_IRQ(irq)         (irq)
+#define OS_ERRNO_HWI_NUM_INVALID    0x02000900U
+
+typedef VOID (*HWI_PROC_FUNC)(VOID *parm);
+typedef UINT16 HWI_PRIOR_T;
+typedef UINT16 HWI_MODE_T;
+
+typedef struct {
+    int swIrq;
+    VOID *pDevId;
+    const CHAR *pName;
+} HwiIrqParam;
+
+UINT32 LOS_IntLock(VOID);
+VOID LOS_IntRestore(UINT32 intSave);
+UINT32 LOS_HwiCreate(UINT32 hwiNum, HWI_PRIOR_T hwiPrio, HWI_MODE_T mode, HWI_PROC_FUNC handler,
+                     HwiIrqParam *irqParam);
+UINT32 LOS_HwiDelete(UINT32 hwiNum, HwiIrqParam *irqParam);
+UINT32 LOS_HwiEnable(UINT32 hwiNum);
+UINT32 LOS_HwiDisable(UINT32 hwiNum);
+
+/* Run the handler of hwiNum if it is created and enabled, the caller holds LOS_IntLock(); 1 if it ran */
+int HpmSimHwiRaise(UINT32 hwiNum);
+
+#endif
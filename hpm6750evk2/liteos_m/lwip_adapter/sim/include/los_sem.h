@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: counting semaphores on a pthread mutex and condition variable, hpm_los_sim.c */
+#ifndef HPM_SIM_LOS_SEM_H
+#define HPM_SIM_LOS_SEM_H
+
+#include "los_compiler.h"
+
+#define LOS_ERRNO_SEM_INVALID       0x02000700U
+#define LOS_ERRNO_SEM_UNAVAILABLE   0x02000706U
+#define LOS_ERRNO_SEM_TIMEOUT       0x02000709U
+#define LOS_ERRNO_SEM_ALL_BUSY      0x0200070aU
+
+UINT32 LOS_SemCreate(UINT16 count, UINT32 *semHandle);
+UINT32 LOS_BinarySemCreate(UINT16 count, UINT32 *semHandle);
+UINT32 LOS_SemDelete(UINT32 semHandle);
+UINT32 LOS_SemPend(UINT32 semHandle, UINT32 timeout);
+UINT32 LOS_SemPost(UINT32 semHandle);
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: one tick per millisecond of CLOCK_MONOTONIC since the sim started */
+#ifndef HPM_SIM_LOS_TICK_H
+#define HPM_SIM_LOS_TICK_H
+
+#include "los_compiler.h"
+
+#define LOSCFG_BASE_CORE_TICK_PER_SECOND 1000UL
+
+UINT64 LOS_TickCountGet(VOID);
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host shim: base lwIP options, in place of the LiteOS-M porting lwipopts.h. lwip_adapter/lwipopts.h
+ * adjusts them as on the target. Only the raw API and the tcpip thread are built: the sim drives
+ * lwiperf, not sockets.
+ */
+#ifndef HPM_SIM_LWIP_LWIPOPTS_H
+#define HPM_SIM_LWIP_LWIPOPTS_H
+
+#define NO_SYS                      0
+#define SYS_LIGHTWEIGHT_PROT        1
+#define LWIP_TCPIP_CORE_LOCKING     1
+#define LWIP_SOCKET                 0
+#define LWIP_NETCONN                0
+#define LWIP_NETIF_API              0
+
+#define MEM_ALIGNMENT               4
+#define MEM_SIZE                    (64 * 1024)
+#define PBUF_POOL_SIZE              48
+#define MEMP_NUM_TCP_SEG            32
+#define MEMP_NUM_PBUF               32
+
+#define LWIP_IPV4                   1
+#define LWIP_IPV6                   0
+#define LWIP_ARP                    1
+#define LWIP_ETHERNET               1
+#define LWIP_ICMP                   1
+#define LWIP_UDP                    1
+#define LWIP_TCP                    1
+#define LWIP_IGMP                   1
+#define LWIP_DHCP                   0
+#define LWIP_DNS                    0
+
+#define TCP_MSS                     1460
+#define TCP_SND_BUF                 (4 * TCP_MSS)
+
+#define TCPIP_THREAD_NAME           "tcpip"
+#define TCPIP_THREAD_STACKSIZE      (64 * 1024)
+#define TCPIP_THREAD_PRIO           1
+#define TCPIP_MBOX_SIZE             64
+#define DEFAULT_THREAD_STACKSIZE    (64 * 1024)
+#define DEFAULT_RAW_RECVMBOX_SIZE   16
+#define DEFAULT_UDP_RECVMBOX_SIZE   16
+#define DEFAULT_TCP_RECVMBOX_SIZE   16
+#define DEFAULT_ACCEPTMBOX_SIZE     16
+
+#define LWIP_NETIF_LINK_CALLBACK    0
+#define LWIP_NETIF_STATUS_CALLBACK  0
+
+#endif
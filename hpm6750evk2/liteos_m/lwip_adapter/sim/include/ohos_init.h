@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2022 HPMicro
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim: nothing runs from the init sections, the sim runner calls what it needs */
+#ifndef HPM_SIM_OHOS_INIT_H
+#define HPM_SIM_OHOS_INIT_H
+
+#define APP_FEATURE_INIT(func)
+#define APP_SERVICE_INIT(func)
+#define SYS_RUN(func)
+
+#endif
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 HPMicro.
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Memory budget report of a linked hpm6750evk2 image.
+
+Prints the use of every memory region of ld/liteos_flash_xip.ld, the budget the image was linked
+with (hpm_*_kb build args) and the largest symbols of each region, e.g.
+    tools/mem_report.py out/hpm6750evk2/<product>/OHOS_Image --top 15
+    tools/mem_report.py OHOS_Image --headroom 10    # stricter than the build, e.g. for CI
+Exits with 1 when a budget is exceeded. The linker enforces the same checks at build time.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+DEFAULT_LD = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "ld", "liteos_flash_xip.ld")
+SIZE_SUFFIX = {"": 1, "K": 1024, "M": 1024 * 1024}
+
+
+def parse_int(text):
+    match = re.fullmatch(r"(0x[0-9a-fA-F]+|\d+)([KM]?)", text.strip())
+    if match is None:
+        raise ValueError("cannot parse size '%s'" % text)
+    return int(match.group(1), 0) * SIZE_SUFFIX[match.group(2)]
+
+
+def parse_regions(ld_path):
+    with open(ld_path) as f:
+        script = f.read()
+    memory = re.search(r"MEMORY\s*\{(.*?)\}", script, re.S).group(1)
+    regions = []
+    for match in re.finditer(r"(\w+)\s*\([^)]*\)\s*:\s*ORIGIN\s*=\s*(\w+)\s*,\s*LENGTH\s*=\s*(\w+)", memory):
+        regions.append({
+            "name": match.group(1),
+            "origin": parse_int(match.group(2)),
+            "length": parse_int(match.group(3)),
+            "used": 0,
+            "symbols": [],
+        })
+    return regions
+
+
+def find_region(regions, addr):
+    for region in regions:
+        if region["origin"] <= addr < region["origin"] + region["length"]:
+            return region
+    return None
+
+
+def run(tool, args):
+    return subprocess.run([tool] + args, check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+
+
+def read_sections(prefix, elf):
+    # Idx Name Size VMA LMA File-off Algn Flags
+    sections = []
+    for line in run(prefix + "objdump", ["-h", "-w", elf]).splitlines():
+        fields = line.split(None, 7)
+        if len(fields) < 8 or not fields[0].isdigit():
+            continue
+        flags = [flag.strip() for flag in fields[7].split(",")]
+        if "ALLOC" not in flags:
+            continue
+        sections.append({
+            "name": fields[1],
+            "size": int(fields[2], 16),
+            "vma": int(fields[3], 16),
+            "lma": int(fields[4], 16),
+            "load": "LOAD" in flags,
+        })
+    return sections
+
+
+def read_symbols(prefix, elf):
+    # objects and functions have a size, the budget symbols of the linker script do not
+    sized = []
+    values = {}
+    for line in run(prefix + "nm", ["-S", "-C", elf]).splitlines():
+        fields = line.split(None, 3)
+        if len(fields) == 4:
+            sized.append((int(fields[1], 16), int(fields[0], 16), fields[2], fields[3]))
+        elif len(fields) == 3:
+            values[fields[2]] = int(fields[0], 16)
+    return sized, values
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="linked image")
+    parser.add_argument("--ld", default=DEFAULT_LD, help="linker script the image was linked with")
+    parser.add_argument("--prefix", default="riscv32-unknown-elf-", help="toolchain prefix of objdump and nm")
+    parser.add_argument("--top", type=int, default=10, help="largest symbols listed per region")
+    parser.add_argument("--headroom", type=int, default=None,
+                        help="percent of AXI SRAM and DLM that must stay unused, default: as linked")
+    args = parser.parse_args()
+
+    regions = parse_regions(args.ld)
+    sections = read_sections(args.prefix, args.elf)
+    symbols, values = read_symbols(args.prefix, args.elf)
+    heap = 0
+
+    for section in sections:
+        # the heap section only marks the rest of AXI SRAM, it is accounted against HEAP_SIZE below
+        if section["name"] == ".heap":
+            heap = section["size"]
+            continue
+        region = find_region(regions, section["vma"])
+        if region is not None:
+            region["used"] += section["size"]
+        # initialized data and code also take flash at their load address
+        if section["load"] and section["lma"] != section["vma"]:
+            region = find_region(regions, section["lma"])
+            if region is not None:
+                region["used"] += section["size"]
+
+    for size, addr, kind, name in symbols:
+        region = find_region(regions, addr)
+        if region is not None and size != 0:
+            region["symbols"].append((size, addr, kind, name))
+
+    print("%-10s %10s %10s %6s" % ("region", "used", "size", "use"))
+    for region in regions:
+        print("%-10s %10d %10d %5.1f%%" % (region["name"], region["used"], region["length"],
+                                           100.0 * region["used"] / region["length"]))
+    print("heap: %d bytes, HEAP_SIZE minimum %d" % (heap, values.get("HEAP_SIZE", 0)))
+
+    failed = []
+    headroom = values.get("MEM_HEADROOM", 0) if args.headroom is None else args.headroom
+    budget = {
+        "noncacheable": (values.get("__noncacheable_size__"), values.get("NONCACHEABLE_MAX")),
+        "flash": (values.get("__flash_used__"), values.get("FLASH_IMAGE_END")),
+        "axi sram": (values.get("__axi_sram_used__"), None),
+        "dlm": (values.get("__dlm_used__"), values.get("DLM_MAX")),
+    }
+    axi = next((r for r in regions if r["name"] == "AXI_SRAM"), None)
+    if axi is not None:
+        budget["axi sram"] = (budget["axi sram"][0], axi["length"])
+
+    print("\nbudget (headroom %d%%):" % headroom)
+    for name, (used, limit) in budget.items():
+        if used is None or limit is None:
+            print("  %-12s not in the image, linked with an older linker script?" % name)
+            continue
+        allowed = limit
+        if name in ("axi sram", "dlm"):
+            allowed = limit * (100 - headroom) // 100
+        state = "ok" if used <= allowed else "OVER"
+        print("  %-12s %10d of %10d allowed (limit %d) %s" % (name, used, allowed, limit, state))
+        if used > allowed:
+            failed.append(name)
+
+    for region in regions:
+        if not region["symbols"]:
+            continue
+        print("\nlargest symbols in %s:" % region["name"])
+        for size, addr, kind, name in sorted(region["symbols"], reverse=True)[:args.top]:
+            print("  %8d  0x%08x %s %s" % (size, addr, kind, name))
+
+    if failed:
+        print("\nover budget: %s" % ", ".join(failed))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 HPMicro.
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+
+"""Symbolize the samples of the "prof" shell command.
+
+Reads either a console log holding the output of "prof dump" (the last prof-begin/prof-end block
+is used) or a file written by "prof save", looks the sampled PCs up in the symbols of the image
+and prints a flat profile with the cache misses per function, e.g.
+    tools/prof_symbolize.py OHOS_Image console.log --top 30
+    tools/prof_symbolize.py OHOS_Image prof.bin --folded > prof.folded
+    flamegraph.pl prof.folded > prof.svg
+The samples hold the PC only, no call stacks, so the folded output is "task;function count".
+"""
+
+import argparse
+import bisect
+import re
+import struct
+import subprocess
+import sys
+from collections import Counter, defaultdict
+
+FILE_MAGIC = 0x464F5250
+FILE_HDR = struct.Struct("<6I4Q")
+FILE_TASK = struct.Struct("<I28s")
+FILE_SAMPLE = struct.Struct("<IHHHH")
+# where the PC was fetched from, see ld/liteos_flash_xip.ld
+REGIONS = [
+    (0x00000000, 0x00040000, "ilm"),
+    (0x01080000, 0x01180000, "axi-sram"),
+    (0x80000000, 0x81000000, "xip"),
+]
+
+
+class Profile:
+    def __init__(self):
+        self.hz = 0
+        self.dropped = 0
+        self.counters = {}
+        self.tasks = {}
+        self.samples = []  # (pc, task, icmiss, dcmiss)
+
+
+def parse_dump(text):
+    start = text.rfind("prof-begin")
+    if start < 0:
+        raise ValueError("no prof-begin line, is this the output of \"prof dump\"?")
+    prof = Profile()
+    for line in text[start:].splitlines():
+        line = line.strip()
+        if line.startswith("prof-end"):
+            return prof
+        if line.startswith("prof-begin"):
+            fields = dict(re.findall(r"(\w+)=(\d+)", line))
+            prof.hz = int(fields.get("hz", 0))
+            prof.dropped = int(fields.get("dropped", 0))
+        elif line.startswith("prof-counters"):
+            prof.counters = {k: int(v) for k, v in re.findall(r"(\w+)=(\d+)", line)}
+        elif line.startswith("prof-task"):
+            fields = line.split(None, 2)
+            prof.tasks[int(fields[1])] = fields[2] if len(fields) > 2 else "?"
+        else:
+            fields = line.split()
+            if len(fields) == 4:
+                prof.samples.append((int(fields[0], 16), int(fields[1]), int(fields[2]), int(fields[3])))
+    raise ValueError("no prof-end line, the dump is truncated")
+
+
+def parse_file(data):
+    magic, version, hz, num, dropped, task_num, cycles, instret, icmiss, dcmiss = FILE_HDR.unpack_from(data)
+    if magic != FILE_MAGIC or version != 1:
+        raise ValueError("not a prof file")
+    prof = Profile()
+    prof.hz = hz
+    prof.dropped = dropped
+    prof.counters = {"cycles": cycles, "instret": instret, "icmiss": icmiss, "dcmiss": dcmiss}
+    offset = FILE_HDR.size
+    for _ in range(task_num):
+        task, name = FILE_TASK.unpack_from(data, offset)
+        prof.tasks[task] = name.split(b"\0", 1)[0].decode(errors="replace")
+        offset += FILE_TASK.size
+    for _ in range(num):
+        pc, task, icmiss, dcmiss, _ = FILE_SAMPLE.unpack_from(data, offset)
+        prof.samples.append((pc, task, icmiss, dcmiss))
+        offset += FILE_SAMPLE.size
+    return prof
+
+
+def read_profile(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) >= 4 and struct.unpack_from("<I", data)[0] == FILE_MAGIC:
+        return parse_file(data)
+    return parse_dump(data.decode(errors="replace"))
+
+
+class Symbols:
+    def __init__(self, prefix, elf):
+        out = subprocess.run([prefix + "nm", "-n", "-C", "--defined-only", elf], check=True,
+                             stdout=subprocess.PIPE, universal_newlines=True).stdout
+        self.addrs = []
+        self.names = []
+        for line in out.splitlines():
+            fields = line.split(None, 2)
+            if len(fields) == 3 and fields[1] in "tTwW":
+                self.addrs.append(int(fields[0], 16))
+                self.names.append(fields[2])
+
+    def lookup(self, pc):
+        index = bisect.bisect_right(self.addrs, pc) - 1
+        return self.names[index] if index >= 0 else "0x%08x" % pc
+
+
+def region(pc):
+    for start, end, name in REGIONS:
+        if start <= pc < end:
+            return name
+    return "?"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="image the samples were taken from")
+    parser.add_argument("profile", help="console log with a \"prof dump\" or a \"prof save\" file")
+    parser.add_argument("--prefix", default="riscv32-unknown-elf-", help="toolchain prefix of nm")
+    parser.add_argument("--top", type=int, default=25, help="functions listed")
+    parser.add_argument("--folded", action="store_true", help="print task;function counts for flamegraph.pl")
+    args = parser.parse_args()
+
+    prof = read_profile(args.profile)
+    if not prof.samples:
+        print("no samples")
+        return 1
+    symbols = Symbols(args.prefix, args.elf)
+
+    funcs = defaultdict(lambda: [0, 0, 0, None])
+    folded = Counter()
+    per_task = Counter()
+    for pc, task, icmiss, dcmiss in prof.samples:
+        name = symbols.lookup(pc)
+        entry = funcs[name]
+        entry[0] += 1
+        entry[1] += icmiss
+        entry[2] += dcmiss
+        entry[3] = region(pc)
+        task_name = prof.tasks.get(task, "task%d" % task)
+        folded["%s;%s" % (task_name, name)] += 1
+        per_task[task_name] += 1
+
+    if args.folded:
+        for stack, count in sorted(folded.items()):
+            print("%s %d" % (stack, count))
+        return 0
+
+    total = len(prof.samples)
+    print("%d samples at %d Hz, %d dropped" % (total, prof.hz, prof.dropped))
+    counters = prof.counters
+    if counters.get("cycles") and counters.get("instret"):
+        kinst = counters["instret"] / 1000.0
+        print("IPC %.2f, I$ miss %.2f/kinst, D$ miss %.2f/kinst" % (
+            counters["instret"] / counters["cycles"], counters.get("icmiss", 0) / kinst,
+            counters.get("dcmiss", 0) / kinst))
+
+    print("\n%7s %7s %9s %9s %-8s %s" % ("samples", "%", "I$ miss", "D$ miss", "region", "function"))
+    ranked = sorted(funcs.items(), key=lambda item: item[1][0], reverse=True)
+    for name, (count, icmiss, dcmiss, where) in ranked[:args.top]:
+        print("%7d %6.1f%% %9d %9d %-8s %s" % (count, 100.0 * count / total, icmiss, dcmiss, where, name))
+
+    print("\n%7s %7s %s" % ("samples", "%", "task"))
+    for task_name, count in per_task.most_common():
+        print("%7d %6.1f%% %s" % (count, 100.0 * count / total, task_name))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())